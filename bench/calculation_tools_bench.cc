@@ -0,0 +1,1422 @@
+#include <calculation_tools/linear_algebra.h>
+#include <calculation_tools/graphic.h>
+#include <calculation_tools/transform_hierarchy.h>
+#include <calculation_tools/binary_file.h>
+#include <calculation_tools/vector_stream.h>
+#include <calculation_tools/reduction.h>
+#include <calculation_tools/factorization.h>
+#include <calculation_tools/sparse.h>
+#include <calculation_tools/expression.h>
+#include <calculation_tools/portable.h>
+#include <calculation_tools/dispatch.h>
+#include <calculation_tools/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+    Benchmark suite over every kernel, the fixed-size operators and the graphic.h builders.
+
+    usage: calculation_tools_bench [--filter SUBSTRING] [--min-time SECONDS] [--json FILE]
+                                   [--ispc-target NAME]
+
+    Each row is one timed call ("op") of a kernel or operator:
+      - ns/op     wall time per call,
+      - GB/s      bytes read plus bytes written by the call,
+      - GFLOPS    arithmetic operations of the call (pow, sqrt and the like count as one).
+    Kernels are timed on every backend compiled in, so ISPC and the portable loops can be compared
+    at the same size; rows tagged "inline" go through the public API of the fixed-size types.
+    "ispc" rows run on the target picked at startup unless --ispc-target pins one, see dispatch.h.
+*/
+
+using namespace kplutl;
+
+namespace {
+using clock = std::chrono::steady_clock;
+
+/* harness */
+
+// keeps the compiler from dropping a computation whose result is never read
+inline void clobber(const void* ptr) { asm volatile("" : : "g"(ptr) : "memory"); }
+
+template <typename T>
+const char* typeName();
+template <>
+const char* typeName<float>() {
+  return "float";
+}
+template <>
+const char* typeName<double>() {
+  return "double";
+}
+template <>
+const char* typeName<std::int32_t>() {
+  return "int32";
+}
+template <>
+const char* typeName<Half>() {
+  return "half";
+}
+
+struct Options {
+  std::string filter;
+  std::string json_path;
+  double min_time = 0.05;
+};
+
+struct Result {
+  std::string name;
+  std::string backend;
+  std::string type;
+  size_t size;
+  double ns_per_op;
+  double gb_per_s;
+  double gflops;
+};
+
+class Suite {
+ public:
+  explicit Suite(Options options) : options_(std::move(options)) {
+    std::printf(
+        "%-28s %-9s %-7s %9s %12s %10s %10s\n", "name", "backend", "type", "size", "ns/op", "GB/s",
+        "GFLOPS");
+  }
+
+  // Times `run`, which performs `ops` calls that each move `bytes` and perform `flops`.
+  template <typename F>
+  void Run(
+      const std::string& name, const char* backend, const char* type, const size_t size,
+      const double ops, const double bytes, const double flops, F&& run) {
+    if (!Selected(name)) return;
+
+    const double seconds = secondsPerRun_(run) / ops;
+    Result res{name, backend, type, size, seconds * 1e9, bytes / seconds * 1e-9,
+               flops / seconds * 1e-9};
+    std::printf(
+        "%-28s %-9s %-7s %9zu %12.2f %10.2f %10.2f\n", res.name.c_str(), res.backend.c_str(),
+        res.type.c_str(), res.size, res.ns_per_op, res.gb_per_s, res.gflops);
+    results_.push_back(std::move(res));
+  }
+
+  // whether --filter lets rows named `name` run, for setups too costly to do for nothing
+  bool Selected(const std::string& name) const {
+    return options_.filter.empty() || name.find(options_.filter) != std::string::npos;
+  }
+
+  bool WriteJson() const {
+    if (options_.json_path.empty()) return true;
+    std::ofstream out(options_.json_path);
+    if (!out) return false;
+
+    out << "{\n";
+    out << "  \"kernels\": \"" << kBackend << "\",\n";
+    out << "  \"ispc_target\": \"" << IspcTargetName(ActiveIspcTarget()) << "\",\n";
+    out << "  \"simd\": \"" << kSimd << "\",\n";
+    out << "  \"compiler\": \"" << escape_(kCompiler) << "\",\n";
+    out << "  \"min_time\": " << options_.min_time << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results_.size(); ++i) {
+      const Result& res = results_[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    {\"name\": \"" << res.name << "\", \"backend\": \"" << res.backend
+          << "\", \"type\": \"" << res.type << "\", \"size\": " << res.size
+          << ", \"ns_per_op\": " << res.ns_per_op << ", \"gb_per_s\": " << res.gb_per_s
+          << ", \"gflops\": " << res.gflops << "}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+  }
+
+#ifdef ENABLE_ISPC
+  static constexpr const char* kBackend = "ispc";
+#else
+  static constexpr const char* kBackend = "portable";
+#endif
+#ifdef ENABLE_SSE
+  static constexpr const char* kSimd = "sse2";
+#else
+  static constexpr const char* kSimd = "none";
+#endif
+#ifdef __VERSION__
+  static constexpr const char* kCompiler = __VERSION__;
+#else
+  static constexpr const char* kCompiler = "unknown";
+#endif
+
+ private:
+  // Repeats `run` until one batch of calls takes at least min_time; small sizes need thousands of
+  // calls per clock read to stay above the timer resolution.
+  template <typename F>
+  double secondsPerRun_(F& run) const {
+    run();  // warm-up
+    size_t reps = 1;
+    for (;;) {
+      const auto start = clock::now();
+      for (size_t i = 0; i < reps; ++i) run();
+      const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      if (elapsed >= options_.min_time) return elapsed / reps;
+
+      const double scale = elapsed > 0 ? options_.min_time * 1.2 / elapsed : 100.0;
+      reps = std::max(reps * 2, static_cast<size_t>(reps * std::min(scale, 100.0)));
+    }
+  }
+
+  static std::string escape_(const char* text) {
+    std::string res;
+    for (; *text != '\0'; ++text) {
+      if (*text == '"' || *text == '\\') res += '\\';
+      res += *text;
+    }
+    return res;
+  }
+
+  Options options_;
+  std::vector<Result> results_;
+};
+
+template <typename T>
+void fillRandom(T* data, const size_t len, std::mt19937& rng, const T min, const T max) {
+  if constexpr (std::is_integral_v<T>) {
+    std::uniform_int_distribution<T> dist(min, max);
+    for (size_t i = 0; i < len; ++i) data[i] = dist(rng);
+  } else {
+    std::uniform_real_distribution<compute_t<T>> dist(min, max);
+    for (size_t i = 0; i < len; ++i) data[i] = T(dist(rng));
+  }
+}
+
+/* kernel tables */
+
+template <typename Fn>
+struct Kernel {
+  const char* name;
+  const char* backend;
+  Fn fn;
+  double flops;  // per element
+};
+
+template <typename T>
+using BinaryFn = void (*)(T*, const T*, const T*, std::uint64_t);
+template <typename T>
+using UnaryFn = void (*)(T*, const T*, std::uint64_t);
+template <typename T>
+using ScalarFn = void (*)(T*, const T*, T, std::uint64_t);
+template <typename T>
+using ScalarLhsFn = void (*)(T*, T, const T*, std::uint64_t);
+template <typename T>
+using InplaceFn = void (*)(T*, const T*, std::uint64_t);
+template <typename T>
+using ScalarInplaceFn = void (*)(T*, T, std::uint64_t);
+template <typename T>
+using UnaryInplaceFn = void (*)(T*, std::uint64_t);
+
+#define CT_BINARY_KERNELS(X) \
+  X(AddForeach, 1)           \
+  X(SubForeach, 1)           \
+  X(MulForeach, 1)           \
+  X(DivForeach, 1)           \
+  X(PowForeach, 1)
+#define CT_UNARY_KERNELS(X) \
+  X(AbsForeach, 1)          \
+  X(SqrtForeach, 1)         \
+  X(NegForeach, 1)
+#define CT_SCALAR_KERNELS(X) \
+  X(AddScalarForeach, 1)     \
+  X(SubScalarForeach, 1)     \
+  X(MulScalarForeach, 1)     \
+  X(DivScalarForeach, 1)     \
+  X(PowScalarForeach, 1)
+#define CT_SCALAR_LHS_KERNELS(X) \
+  X(ScalarSubForeach, 1)         \
+  X(ScalarDivForeach, 1)         \
+  X(ScalarPowForeach, 1)
+#define CT_INPLACE_KERNELS(X) \
+  X(AddInplaceForeach, 1)     \
+  X(SubInplaceForeach, 1)     \
+  X(MulInplaceForeach, 1)     \
+  X(DivInplaceForeach, 1)     \
+  X(PowInplaceForeach, 1)
+#define CT_SCALAR_INPLACE_KERNELS(X) \
+  X(AddScalarInplaceForeach, 1)      \
+  X(SubScalarInplaceForeach, 1)      \
+  X(MulScalarInplaceForeach, 1)      \
+  X(DivScalarInplaceForeach, 1)      \
+  X(PowScalarInplaceForeach, 1)
+#define CT_UNARY_INPLACE_KERNELS(X) \
+  X(AbsInplaceForeach, 1)           \
+  X(SqrtInplaceForeach, 1)          \
+  X(NegInplaceForeach, 1)
+
+#define CT_PORTABLE_KERNEL(kernel, flops) {#kernel, "portable", &portable::kernel<T>, flops},
+#ifdef ENABLE_ISPC
+#define CT_ISPC_KERNEL(kernel, flops) {#kernel, "ispc", &ispc::kernel, flops},
+#endif
+
+// every backend compiled in for T
+#ifdef ENABLE_ISPC
+#define CT_KERNEL_TABLE(Fn, LIST)                                                     \
+  template <typename T>                                                               \
+  std::vector<Kernel<Fn<T>>> kernels##Fn() {                                          \
+    return std::vector<Kernel<Fn<T>>>{LIST(CT_ISPC_KERNEL) LIST(CT_PORTABLE_KERNEL)}; \
+  }
+#else
+#define CT_KERNEL_TABLE(Fn, LIST)                                          \
+  template <typename T>                                                    \
+  std::vector<Kernel<Fn<T>>> kernels##Fn() {                               \
+    return std::vector<Kernel<Fn<T>>>{LIST(CT_PORTABLE_KERNEL)};           \
+  }
+#endif
+
+CT_KERNEL_TABLE(BinaryFn, CT_BINARY_KERNELS)
+CT_KERNEL_TABLE(UnaryFn, CT_UNARY_KERNELS)
+CT_KERNEL_TABLE(ScalarFn, CT_SCALAR_KERNELS)
+CT_KERNEL_TABLE(ScalarLhsFn, CT_SCALAR_LHS_KERNELS)
+CT_KERNEL_TABLE(InplaceFn, CT_INPLACE_KERNELS)
+CT_KERNEL_TABLE(ScalarInplaceFn, CT_SCALAR_INPLACE_KERNELS)
+CT_KERNEL_TABLE(UnaryInplaceFn, CT_UNARY_INPLACE_KERNELS)
+
+// one entry per backend compiled in, for the kernels with a signature of their own
+#ifdef ENABLE_ISPC
+#define CT_BACKENDS(kernel, flops)                                 \
+  std::vector<Kernel<decltype(&portable::kernel<T>)>>{              \
+      {#kernel, "ispc", &ispc::kernel, flops},                      \
+      {#kernel, "portable", &portable::kernel<T>, flops}}
+#else
+#define CT_BACKENDS(kernel, flops)                            \
+  std::vector<Kernel<decltype(&portable::kernel<T>)>>{        \
+      {#kernel, "portable", &portable::kernel<T>, flops}}
+#endif
+
+/* basic.ispc */
+
+constexpr size_t kLengths[]{
+    3, 4, 16, 64, 256, 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20};
+constexpr size_t kMaxLength = 1 << 20;
+
+template <typename T>
+void benchBasic(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  AlignedArray<T> lhs(kMaxLength), rhs(kMaxLength), out(kMaxLength), ones(kMaxLength);
+  // [1, 2] keeps pow, div and sqrt away from denormals and NaN
+  fillRandom(lhs.data(), kMaxLength, rng, T(1), T(2));
+  fillRandom(rhs.data(), kMaxLength, rng, T(1), T(2));
+  std::fill_n(ones.data(), kMaxLength, T(1));
+  const T scalar = T(1.5);
+  T* out_ptr = out.data();
+  const T* lhs_ptr = lhs.data();
+  const T* rhs_ptr = rhs.data();
+  const T* ones_ptr = ones.data();
+
+  for (const auto& k : kernelsBinaryFn<T>()) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 3.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, lhs_ptr, rhs_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : kernelsUnaryFn<T>()) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, lhs_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : kernelsScalarFn<T>()) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, lhs_ptr, scalar, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : kernelsScalarLhsFn<T>()) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, scalar, rhs_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+
+  // In-place kernels run on their own output over and over, so the operand is the identity of
+  // mul, div and pow and the values never drift into denormals.
+  for (const auto& k : kernelsInplaceFn<T>()) {
+    for (size_t len : kLengths) {
+      std::copy_n(lhs_ptr, len, out_ptr);
+      suite.Run(k.name, k.backend, type, len, 1, 3.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, ones_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : kernelsScalarInplaceFn<T>()) {
+    for (size_t len : kLengths) {
+      std::copy_n(lhs_ptr, len, out_ptr);
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, T(1), len);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : kernelsUnaryInplaceFn<T>()) {
+    for (size_t len : kLengths) {
+      std::copy_n(lhs_ptr, len, out_ptr);
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+
+  // out = lhs * rhs + ones - lhs, four arrays through the register interpreter
+  ExprProgram<T> program;
+  const int lhs_op = program.Array(lhs_ptr);
+  const int rhs_op = program.Array(rhs_ptr);
+  const int ones_op = program.Array(ones_ptr);
+  program.Emit(kExprMul, 0, lhs_op, rhs_op);
+  program.Emit(kExprAdd, 0, 0, ones_op);
+  program.Emit(kExprSub, kExprOut, 0, lhs_op);
+  for (const auto& k : CT_BACKENDS(ExprForeach, 3)) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 4.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, program.code, program.size, program.arrays, program.scalars, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+}
+
+/* linear_algebra.ispc */
+
+constexpr size_t kBatch = 1024;
+constexpr size_t kCounts[]{16, 256, 1 << 12, 1 << 16, 1 << 20};
+constexpr size_t kGemmDims[]{4, 16, 32, 64, 128, 256, 512};
+
+template <typename T>
+void benchLinearAlgebra(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  AlignedArray<T> lhs(kMaxLength), rhs(kMaxLength), out(kMaxLength);
+  fillRandom(lhs.data(), kMaxLength, rng, T(-1), T(1));
+  fillRandom(rhs.data(), kMaxLength, rng, T(-1), T(1));
+  T* out_ptr = out.data();
+  const T* lhs_ptr = lhs.data();
+  const T* rhs_ptr = rhs.data();
+
+  for (const auto& k : CT_BACKENDS(VectorDotProd, 2)) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 2.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(out_ptr, lhs_ptr, rhs_ptr, len);
+        clobber(out_ptr);
+      });
+    }
+  }
+
+  // single-vector kernels, timed per call over a batch of distinct vectors
+  for (const auto& k : CT_BACKENDS(VectorCrossProdV3, 9)) {
+    suite.Run(k.name, k.backend, type, 3, kBatch, 9.0 * sizeof(T), k.flops, [&] {
+      for (size_t i = 0; i < kBatch; ++i) k.fn(out_ptr + 3 * i, lhs_ptr + 3 * i, rhs_ptr + 3 * i);
+      clobber(out_ptr);
+    });
+  }
+  for (const auto& k : CT_BACKENDS(VectorTransformV4, 28)) {
+    std::copy_n(rhs_ptr, 4 * kBatch, out_ptr);
+    suite.Run(k.name, k.backend, type, 4, kBatch, 24.0 * sizeof(T), k.flops, [&] {
+      for (size_t i = 0; i < kBatch; ++i) k.fn(lhs_ptr, out_ptr + 4 * i);
+      clobber(out_ptr);
+    });
+  }
+
+  // vertex batches: 4x4 transform, perspective divide and viewport mapping
+  const T viewport[6]{0, 0, 1920, 1080, 0, 1};
+  const std::uint32_t flags = kVertexPerspectiveDivide | kVertexViewportMapping;
+  for (const auto& k : CT_BACKENDS(VertexTransformSoA, 37)) {
+    for (size_t count : kCounts) {
+      const size_t stride = kMaxLength / 8;
+      if (count > stride) continue;
+      suite.Run(k.name, k.backend, type, count, 1, 8.0 * count * sizeof(T), k.flops * count, [&] {
+        k.fn(
+            lhs_ptr, rhs_ptr, rhs_ptr + stride, rhs_ptr + 2 * stride, rhs_ptr + 3 * stride, out_ptr,
+            out_ptr + stride, out_ptr + 2 * stride, out_ptr + 3 * stride, count, flags, viewport);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(VertexTransformAoS, 37)) {
+    for (size_t count : kCounts) {
+      if (4 * count > kMaxLength) continue;
+      suite.Run(k.name, k.backend, type, count, 1, 8.0 * count * sizeof(T), k.flops * count, [&] {
+        k.fn(lhs_ptr, rhs_ptr, 4, 4, out_ptr, 4, count, flags, viewport);
+        clobber(out_ptr);
+      });
+    }
+  }
+
+  for (const auto& k : CT_BACKENDS(MatrixGemm, 2)) {
+    for (size_t dim : kGemmDims) {
+      // the portable loop is far slower at the top end and only serves as a reference there
+      if (std::strcmp(k.backend, "portable") == 0 && dim > 256) continue;
+      const double flops = k.flops * dim * dim * dim;
+      suite.Run(k.name, k.backend, type, dim, 1, 3.0 * dim * dim * sizeof(T), flops, [&] {
+        k.fn(dim, dim, dim, T(1), lhs_ptr, dim, rhs_ptr, dim, T(0), out_ptr, dim);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(BuildIdentity, 0)) {
+    for (size_t dim : kGemmDims) {
+      suite.Run(k.name, k.backend, type, dim, 1, 1.0 * dim * dim * sizeof(T), 0, [&] {
+        k.fn(out_ptr, dim, dim);
+        clobber(out_ptr);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(MatrixTranspose, 0)) {
+    for (size_t dim : kGemmDims) {
+      suite.Run(k.name, k.backend, type, dim, 1, 2.0 * dim * dim * sizeof(T), 0, [&] {
+        k.fn(out_ptr, lhs_ptr, dim, dim, dim, dim);
+        clobber(out_ptr);
+      });
+    }
+  }
+}
+
+/* reduction.ispc */
+
+// 100M elements, the size the threaded reductions are meant to saturate memory bandwidth at
+constexpr size_t kReduceLargeLength = 100000000;
+
+template <typename T>
+void benchReduction(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  AlignedArray<T> lhs(kMaxLength), rhs(kMaxLength);
+  fillRandom(lhs.data(), kMaxLength, rng, T(-1), T(1));
+  fillRandom(rhs.data(), kMaxLength, rng, T(-1), T(1));
+  const T* lhs_ptr = lhs.data();
+  const T* rhs_ptr = rhs.data();
+  compute_t<T> sum;
+  T min_max[2];
+  std::uint64_t index[2];
+
+  for (const std::uint32_t flags : {kReduceDefault, kReduceKahan, kReducePairwise}) {
+    const std::string suffix = flags == kReduceKahan      ? " kahan"
+                               : flags == kReducePairwise ? " pairwise"
+                                                          : "";
+    for (const auto& k : CT_BACKENDS(ReduceSum, 1)) {
+      for (size_t len : kLengths) {
+        suite.Run(k.name + suffix, k.backend, type, len, 1, 1.0 * len * sizeof(T), len, [&] {
+          k.fn(&sum, lhs_ptr, len, flags);
+          clobber(&sum);
+        });
+      }
+    }
+    for (const auto& k : CT_BACKENDS(ReduceDotProd, 2)) {
+      for (size_t len : kLengths) {
+        const double flops = k.flops * len;
+        suite.Run(k.name + suffix, k.backend, type, len, 1, 2.0 * len * sizeof(T), flops, [&] {
+          k.fn(&sum, lhs_ptr, rhs_ptr, len, flags);
+          clobber(&sum);
+        });
+      }
+    }
+  }
+  for (const auto& k : CT_BACKENDS(ReduceAbsSum, 2)) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 1.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(&sum, lhs_ptr, len, kReduceDefault);
+        clobber(&sum);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(ReduceMinMax, 2)) {
+    for (size_t len : kLengths) {
+      suite.Run(k.name, k.backend, type, len, 1, 1.0 * len * sizeof(T), k.flops * len, [&] {
+        k.fn(min_max, index, lhs_ptr, len);
+        clobber(min_max);
+      });
+    }
+  }
+
+  // the public API at 100M elements, on one thread and on every hardware thread
+  if constexpr (std::is_same_v<T, float>) {
+    if (!suite.Selected("Sum threads") && !suite.Selected("MinMax threads")) return;
+    VectorRT<T> vec(kReduceLargeLength, kUninitialized);
+    fillRandom(&vec[0], vec.size(), rng, T(-1), T(1));
+    const double bytes = 1.0 * vec.size() * sizeof(T);
+    for (const size_t threads : {size_t(1), size_t(0)}) {
+      const std::string suffix = threads == 1 ? " threads=1" : " threads=auto";
+      const ReduceOptions options{kReduceDefault, threads};
+      suite.Run("Sum" + suffix, "inline", type, vec.size(), 1, bytes, 1.0 * vec.size(), [&] {
+        T res = Sum(vec, options);
+        clobber(&res);
+      });
+      suite.Run("MinMax" + suffix, "inline", type, vec.size(), 1, bytes, 2.0 * vec.size(), [&] {
+        MinMaxResult<T> res = MinMax(vec, options);
+        clobber(&res);
+      });
+    }
+  }
+}
+
+/* fixed-size types */
+
+template <typename T, size_t N>
+void benchVectorCT(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  std::vector<VectorCT<T, N>> lhs(kBatch), rhs(kBatch), out(kBatch);
+  std::vector<T> dots(kBatch);
+  for (size_t i = 0; i < kBatch; ++i) {
+    fillRandom(&lhs[i][0], N, rng, T(1), T(2));
+    fillRandom(&rhs[i][0], N, rng, T(1), T(2));
+  }
+  const double bytes = sizeof(T) * N;
+
+  suite.Run("VectorCT operator+", "inline", type, N, kBatch, 3 * bytes, N, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = lhs[i] + rhs[i];
+    clobber(out.data());
+  });
+  suite.Run("VectorCT operator*(scalar)", "inline", type, N, kBatch, 2 * bytes, N, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = lhs[i] * T(1.5);
+    clobber(out.data());
+  });
+  suite.Run("VectorCT operator+=", "inline", type, N, kBatch, 3 * bytes, N, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] += rhs[i];
+    clobber(out.data());
+  });
+  suite.Run("VectorCT Sqrt", "inline", type, N, kBatch, 2 * bytes, N, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = Sqrt(lhs[i]);
+    clobber(out.data());
+  });
+  suite.Run("DotProd", "inline", type, N, kBatch, 2 * bytes, 2 * N, [&] {
+    for (size_t i = 0; i < kBatch; ++i) dots[i] = DotProd(lhs[i], rhs[i]);
+    clobber(dots.data());
+  });
+  suite.Run("Normalize", "inline", type, N, kBatch, 2 * bytes, 3 * N + 1, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = Normalize(lhs[i]);
+    clobber(out.data());
+  });
+  if constexpr (N == 3) {
+    suite.Run("CrossProd", "inline", type, N, kBatch, 3 * bytes, 9, [&] {
+      for (size_t i = 0; i < kBatch; ++i) out[i] = CrossProd(lhs[i], rhs[i]);
+      clobber(out.data());
+    });
+  }
+}
+
+// SoA streams against the same vectors stored as VectorCT, one Normalize call per vector
+template <typename T, size_t N>
+void benchVectorStream(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  const size_t max_count = 1 << 20;
+  VectorStream<T, N> lhs(max_count, kUninitialized), rhs(max_count, kUninitialized);
+  VectorStream<T, N> out(max_count, kUninitialized);
+  for (size_t c = 0; c < N; ++c) {
+    fillRandom(lhs[c], max_count, rng, T(1), T(2));
+    fillRandom(rhs[c], max_count, rng, T(1), T(2));
+  }
+  std::vector<VectorCT<T, N>> aos(max_count), aos_out(max_count);
+  for (size_t i = 0; i < max_count; ++i) aos[i] = lhs.Get(i);
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  const auto out_comps = out.Components();
+  // bytes per vector
+  const double bytes = sizeof(T) * N;
+  const double reduce_bytes = bytes + sizeof(T);
+
+  for (const auto& k : CT_BACKENDS(StreamDotProd, 2 * N)) {
+    for (size_t count : kCounts) {
+      const double flops = k.flops * count;
+      suite.Run(k.name, k.backend, type, count, 1, (bytes + reduce_bytes) * count, flops, [&] {
+        k.fn(out_comps[0], lhs_comps.data(), rhs_comps.data(), N, count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  if constexpr (N == 3) {
+    for (const auto& k : CT_BACKENDS(StreamCrossProd, 9)) {
+      for (size_t count : kCounts) {
+        suite.Run(k.name, k.backend, type, count, 1, 3 * bytes * count, k.flops * count, [&] {
+          k.fn(out_comps.data(), lhs_comps.data(), rhs_comps.data(), count);
+          clobber(out_comps[0]);
+        });
+      }
+    }
+  }
+  for (const auto& k : CT_BACKENDS(StreamLength, 2 * N)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, reduce_bytes * count, k.flops * count, [&] {
+        k.fn(out_comps[0], lhs_comps.data(), N, count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  for (const std::uint32_t flags : {kNormalizeExact, kNormalizeFast}) {
+    const std::string name = flags & kNormalizeFast ? "StreamNormalize fast" : "StreamNormalize";
+    for (const auto& k : CT_BACKENDS(StreamNormalize, 3 * N + 1)) {
+      for (size_t count : kCounts) {
+        suite.Run(name, k.backend, type, count, 1, 2 * bytes * count, k.flops * count, [&] {
+          k.fn(out_comps.data(), lhs_comps.data(), N, count, flags);
+          clobber(out_comps[0]);
+        });
+      }
+    }
+  }
+  for (size_t count : kCounts) {
+    const double flops = (3 * N + 1) * count;
+    suite.Run("Normalize VectorCT loop", "inline", type, count, 1, 2 * bytes * count, flops, [&] {
+      for (size_t i = 0; i < count; ++i) aos_out[i] = Normalize(aos[i]);
+      clobber(aos_out.data());
+    });
+  }
+}
+
+template <typename T>
+void benchQuaternion(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  const size_t max_count = 1 << 20;
+  QuaternionStream<T> lhs(max_count, kUninitialized), rhs(max_count, kUninitialized);
+  QuaternionStream<T> out(max_count, kUninitialized);
+  VectorStream<T, 3> vec(max_count, kUninitialized);
+  for (size_t c = 0; c < 4; ++c) {
+    fillRandom(lhs[c], max_count, rng, T(-1), T(1));
+    fillRandom(rhs[c], max_count, rng, T(-1), T(1));
+  }
+  for (size_t c = 0; c < 3; ++c) fillRandom(vec[c], max_count, rng, T(-1), T(1));
+  Normalize(lhs, lhs);
+  Normalize(rhs, rhs);
+  std::vector<T> weight(max_count);
+  fillRandom(weight.data(), max_count, rng, T(0), T(1));
+  std::vector<MatrixCT<T, 4, 4>> mats(max_count);
+  BuildRotationMatrix(lhs, mats.data());
+  std::vector<Quaternion<T>> aos_lhs(max_count), aos_rhs(max_count), aos_out(max_count);
+  for (size_t i = 0; i < max_count; ++i) {
+    aos_lhs[i] = Quaternion<T>(lhs.Get(i));
+    aos_rhs[i] = Quaternion<T>(rhs.Get(i));
+  }
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  const auto out_comps = out.Components();
+  const auto vec_comps = vec.Components();
+  // bytes per quaternion
+  const double bytes = sizeof(T) * 4;
+
+  for (const auto& k : CT_BACKENDS(QuaternionMulSoA, 28)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, 3 * bytes * count, k.flops * count, [&] {
+        k.fn(out_comps.data(), lhs_comps.data(), rhs_comps.data(), count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(QuaternionRotateSoA, 30)) {
+    for (size_t count : kCounts) {
+      const double rotate_bytes = (bytes + 6 * sizeof(T)) * count;
+      suite.Run(k.name, k.backend, type, count, 1, rotate_bytes, k.flops * count, [&] {
+        k.fn(out_comps.data(), lhs_comps.data(), vec_comps.data(), count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  const double lerp_bytes = 3 * bytes + sizeof(T);
+  for (const auto& k : CT_BACKENDS(QuaternionNlerpSoA, 28)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, lerp_bytes * count, k.flops * count, [&] {
+        k.fn(out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight.data(), 1, count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(QuaternionSlerpSoA, 30)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, lerp_bytes * count, k.flops * count, [&] {
+        k.fn(out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight.data(), 1, count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+  for (size_t count : kCounts) {
+    const double flops = 30 * count;
+    suite.Run("Slerp Quaternion loop", "inline", type, count, 1, lerp_bytes * count, flops, [&] {
+      for (size_t i = 0; i < count; ++i) aos_out[i] = Slerp(aos_lhs[i], aos_rhs[i], weight[i]);
+      clobber(aos_out.data());
+    });
+  }
+  for (const auto& k : CT_BACKENDS(QuaternionToMatrixSoA, 24)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, 5 * bytes * count, k.flops * count, [&] {
+        k.fn(mats[0], lhs_comps.data(), count);
+        clobber(mats.data());
+      });
+    }
+  }
+  for (const auto& k : CT_BACKENDS(QuaternionFromMatrixSoA, 12)) {
+    for (size_t count : kCounts) {
+      suite.Run(k.name, k.backend, type, count, 1, 5 * bytes * count, k.flops * count, [&] {
+        k.fn(out_comps.data(), mats[0], count);
+        clobber(out_comps[0]);
+      });
+    }
+  }
+}
+
+template <typename T, size_t D>
+void benchMatrixCT(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  constexpr size_t batch = D <= 4 ? kBatch : 64;
+  std::vector<MatrixCT<T, D, D>> lhs(batch), rhs(batch), out(batch);
+  for (size_t i = 0; i < batch; ++i) {
+    for (size_t r = 0; r < D; ++r) {
+      fillRandom(&lhs[i][r][0], D, rng, T(-1), T(1));
+      fillRandom(&rhs[i][r][0], D, rng, T(-1), T(1));
+    }
+  }
+  const double bytes = sizeof(T) * D * D;
+
+  suite.Run("MatrixCT operator+", "inline", type, D, batch, 3 * bytes, D * D, [&] {
+    for (size_t i = 0; i < batch; ++i) out[i] = lhs[i] + rhs[i];
+    clobber(out.data());
+  });
+  suite.Run("MatrixProd", "inline", type, D, batch, 3 * bytes, 2.0 * D * D * D, [&] {
+    for (size_t i = 0; i < batch; ++i) out[i] = MatrixProd(lhs[i], rhs[i]);
+    clobber(out.data());
+  });
+  if constexpr (D <= 4) {
+    suite.Run("MatrixProd(batch)", "api", type, D, batch, 3 * bytes, 2.0 * D * D * D, [&] {
+      MatrixProd(lhs.data(), rhs.data(), out.data(), batch);
+      clobber(out.data());
+    });
+    suite.Run("MatrixProd(one x batch)", "api", type, D, batch, 2 * bytes, 2.0 * D * D * D, [&] {
+      MatrixProd(lhs[0], rhs.data(), out.data(), batch);
+      clobber(out.data());
+    });
+  }
+  suite.Run("Transpose", "inline", type, D, batch, 2 * bytes, 0, [&] {
+    for (size_t i = 0; i < batch; ++i) out[i] = Transpose(lhs[i]);
+    clobber(out.data());
+  });
+  suite.Run("BuildIdentity", "inline", type, D, batch, bytes, 0, [&] {
+    for (size_t i = 0; i < batch; ++i) BuildIdentity(out[i]);
+    clobber(out.data());
+  });
+
+  if constexpr (D == 4) {
+    std::vector<VectorCT<T, 4>> vec_in(kBatch), vec_out(kBatch);
+    for (auto& vec : vec_in) fillRandom(&vec[0], 4, rng, T(-1), T(1));
+    const MatrixCT<T, 4, 4> mat = lhs[0];
+    suite.Run("Transform", "inline", type, 4, kBatch, 8.0 * sizeof(T), 28, [&] {
+      for (size_t i = 0; i < kBatch; ++i) vec_out[i] = Transform(mat, vec_in[i]);
+      clobber(vec_out.data());
+    });
+    const double batch_bytes = 8.0 * kBatch * sizeof(T);
+    suite.Run("Transform(batch)", "api", type, kBatch, 1, batch_bytes, 28.0 * kBatch, [&] {
+      Transform(mat, vec_in.data(), vec_out.data(), kBatch);
+      clobber(vec_out.data());
+    });
+  }
+}
+
+template <typename T, size_t D>
+void benchInverse(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  // larger batches only add memory traffic to the picture
+  const size_t max_count = 1 << 16;
+  // well-conditioned: random entries around a scaled identity
+  std::vector<MatrixCT<T, D, D>> mats(max_count), out(max_count);
+  for (auto& mat : mats) {
+    for (size_t r = 0; r < D; ++r) {
+      fillRandom(&mat[r][0], D, rng, T(-1), T(1));
+      mat[r][r] += T(4);
+    }
+  }
+  constexpr size_t ld = MatrixCT<T, D, D>::kLeadingDim;
+  const T* in = reinterpret_cast<const T*>(mats.data());
+  T* res = reinterpret_cast<T*>(out.data());
+  // adjugate, determinant and scaling
+  const double flops = D == 4 ? 200 : 45;
+  const double bytes = 2.0 * sizeof(T) * D * D;
+
+  suite.Run("Inverse", "inline", type, D, kBatch, bytes, flops, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = Inverse(mats[i]);
+    clobber(out.data());
+  });
+  std::vector<T> dets(kBatch);
+  suite.Run("Determinant", "inline", type, D, kBatch, bytes / 2, D == 4 ? 60 : 17, [&] {
+    for (size_t i = 0; i < kBatch; ++i) dets[i] = Determinant(mats[i]);
+    clobber(dets.data());
+  });
+  for (const auto& k : CT_BACKENDS(MatrixInverseBatch, flops)) {
+    for (size_t count : kCounts) {
+      if (count > max_count) continue;
+      suite.Run(k.name, k.backend, type, count, 1, bytes * count, k.flops * count, [&] {
+        k.fn(res, nullptr, in, D, ld, count, kInverseDefault);
+        clobber(res);
+      });
+    }
+  }
+  if constexpr (D == 4) {
+    suite.Run("InverseAffine", "inline", type, D, kBatch, bytes, 40, [&] {
+      for (size_t i = 0; i < kBatch; ++i) out[i] = InverseAffine(mats[i]);
+      clobber(out.data());
+    });
+    for (const auto& k : CT_BACKENDS(MatrixInverseAffineBatch, 40)) {
+      for (size_t count : kCounts) {
+        if (count > max_count) continue;
+        suite.Run(k.name, k.backend, type, count, 1, bytes * count, k.flops * count, [&] {
+          k.fn(res, in, count);
+          clobber(res);
+        });
+      }
+    }
+  }
+}
+
+/* runtime-sized types */
+
+constexpr size_t kThreadedLength = size_t(1) << 24;
+constexpr const char* kThreadedRuntimeNames[]{
+    "VectorRT a * b + c", "VectorRT *=", "MatrixRT Transpose", "MatrixRT MatrixProd"};
+
+template <typename T>
+void benchRuntime(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  for (size_t len : kLengths) {
+    VectorRT<T> vec_a(len, kUninitialized), vec_b(len, kUninitialized), vec_c(len, kUninitialized);
+    fillRandom(&vec_a[0], len, rng, T(1), T(2));
+    fillRandom(&vec_b[0], len, rng, T(1), T(2));
+    fillRandom(&vec_c[0], len, rng, T(1), T(2));
+    VectorRT<T> res(len);
+    suite.Run("VectorRT a * b + c", "api", type, len, 1, 4.0 * len * sizeof(T), 2.0 * len, [&] {
+      res = vec_a * vec_b + vec_c;
+      clobber(&res[0]);
+    });
+    suite.Run("VectorRT DotProd", "api", type, len, 1, 2.0 * len * sizeof(T), 2.0 * len, [&] {
+      T dot = DotProd(vec_a, vec_b);
+      clobber(&dot);
+    });
+  }
+
+  for (size_t dim : kGemmDims) {
+    MatrixRT<T> mat_a(dim, dim, kUninitialized), mat_b(dim, dim, kUninitialized);
+    for (size_t r = 0; r < dim; ++r) {
+      fillRandom(mat_a[r], dim, rng, T(-1), T(1));
+      fillRandom(mat_b[r], dim, rng, T(-1), T(1));
+    }
+    MatrixRT<T> res(dim, dim);
+    const double flops = 2.0 * dim * dim * dim;
+    suite.Run("MatrixRT MatrixProd", "api", type, dim, 1, 3.0 * dim * dim * sizeof(T), flops, [&] {
+      res = MatrixProd(mat_a, mat_b);
+      clobber(&res[0][0]);
+    });
+  }
+
+  // a chain of temporaries, Transpose(a) * b + a, on the heap and from a Workspace
+  for (size_t dim : {size_t(8), size_t(32), size_t(128)}) {
+    MatrixRT<T> mat_a(dim, dim, kUninitialized), mat_b(dim, dim, kUninitialized);
+    for (size_t r = 0; r < dim; ++r) {
+      fillRandom(mat_a[r], dim, rng, T(-1), T(1));
+      fillRandom(mat_b[r], dim, rng, T(-1), T(1));
+    }
+    const double flops = 2.0 * dim * dim * dim + dim * dim;
+    const double bytes = 4.0 * dim * dim * sizeof(T);
+    for (const bool workspace : {false, true}) {
+      suite.Run(
+          "MatrixRT temporaries", workspace ? "workspace" : "heap", type, dim, 1, bytes, flops,
+          [&] {
+            std::optional<Workspace> scope;
+            if (workspace) scope.emplace();
+            const MatrixRT<T> res = MatrixProd(Transpose(mat_a), mat_b) + mat_a;
+            T sum = Sum(VectorRT<T>(res[0], res[0] + dim));
+            clobber(&sum);
+          });
+    }
+  }
+
+  // the thread pool: large arrays on one thread and on every hardware thread
+  const bool selected = std::any_of(
+      std::begin(kThreadedRuntimeNames), std::end(kThreadedRuntimeNames), [&](const char* name) {
+        return suite.Selected(std::string(name) + " threads=1") ||
+               suite.Selected(std::string(name) + " threads=auto");
+      });
+  if (!selected) return;
+  const size_t len = kThreadedLength;
+  VectorRT<T> vec_a(len, kUninitialized), vec_b(len, kUninitialized), vec_c(len, kUninitialized);
+  fillRandom(&vec_a[0], len, rng, T(1), T(2));
+  fillRandom(&vec_b[0], len, rng, T(1), T(2));
+  fillRandom(&vec_c[0], len, rng, T(1), T(2));
+  VectorRT<T> res(len);
+  const size_t dim = 4096;
+  MatrixRT<T> mat(dim, dim, kUninitialized);
+  for (size_t r = 0; r < dim; ++r) fillRandom(mat[r], dim, rng, T(-1), T(1));
+  MatrixRT<T> mat_t(dim, dim);
+  const size_t gemm_dim = 1024;
+  MatrixRT<T> mat_a(gemm_dim, gemm_dim, kUninitialized), mat_b(gemm_dim, gemm_dim, kUninitialized);
+  for (size_t r = 0; r < gemm_dim; ++r) {
+    fillRandom(mat_a[r], gemm_dim, rng, T(-1), T(1));
+    fillRandom(mat_b[r], gemm_dim, rng, T(-1), T(1));
+  }
+  MatrixRT<T> prod(gemm_dim, gemm_dim);
+  const double gemm_flops = 2.0 * gemm_dim * gemm_dim * gemm_dim;
+  const size_t threads = ThreadCount();
+  for (const size_t count : {size_t(1), size_t(0)}) {
+    SetThreadCount(count);
+    const std::string suffix = count == 1 ? " threads=1" : " threads=auto";
+    suite.Run(
+        "VectorRT a * b + c" + suffix, "api", type, len, 1, 4.0 * len * sizeof(T), 2.0 * len, [&] {
+          res = vec_a * vec_b + vec_c;
+          clobber(&res[0]);
+        });
+    suite.Run("VectorRT *=" + suffix, "api", type, len, 1, 3.0 * len * sizeof(T), 1.0 * len, [&] {
+      res *= vec_a;
+      clobber(&res[0]);
+    });
+    suite.Run(
+        "MatrixRT Transpose" + suffix, "api", type, dim, 1, 2.0 * dim * dim * sizeof(T), 0, [&] {
+          mat_t = Transpose(mat);
+          clobber(&mat_t[0][0]);
+        });
+    const double gemm_bytes = 3.0 * gemm_dim * gemm_dim * sizeof(T);
+    suite.Run(
+        "MatrixRT MatrixProd" + suffix, "api", type, gemm_dim, 1, gemm_bytes, gemm_flops, [&] {
+          prod = MatrixProd(mat_a, mat_b);
+          clobber(&prod[0][0]);
+        });
+  }
+  SetThreadCount(threads);
+}
+
+/* factorization.h */
+
+constexpr size_t kFactorDims[]{64, 256, 1024};
+
+template <typename T>
+void benchFactorization(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  const size_t rhs_count = 64;
+  for (size_t dim : kFactorDims) {
+    // diagonally dominant, so it is both well-conditioned for LU and positive definite
+    MatrixRT<T> mat(dim, dim, kUninitialized);
+    for (size_t r = 0; r < dim; ++r) fillRandom(mat[r], dim, rng, T(-1), T(1));
+    for (size_t r = 0; r < dim; ++r) {
+      for (size_t c = 0; c < r; ++c) mat[r][c] = mat[c][r];
+      mat[r][r] += T(dim);
+    }
+    MatrixRT<T> rhs(dim, rhs_count, kUninitialized);
+    for (size_t r = 0; r < dim; ++r) fillRandom(rhs[r], rhs_count, rng, T(-1), T(1));
+    const double bytes = double(dim) * dim * sizeof(T);
+    const double lu_flops = 2.0 / 3.0 * dim * dim * dim;
+    const double solve_flops = 2.0 * dim * dim * rhs_count;
+    // one panel as wide as the matrix is the unblocked algorithm
+    const FactorOptions unblocked{dim, 1};
+
+    suite.Run("FactorLu", "api", type, dim, 1, bytes, lu_flops, [&] {
+      auto lu = FactorLu(mat);
+      clobber(&lu.factors[0][0]);
+    });
+    suite.Run("FactorLu unblocked", "api", type, dim, 1, bytes, lu_flops, [&] {
+      auto lu = FactorLu(mat, unblocked);
+      clobber(&lu.factors[0][0]);
+    });
+    suite.Run("FactorCholesky", "api", type, dim, 1, bytes, lu_flops / 2, [&] {
+      auto cholesky = FactorCholesky(mat);
+      clobber(&cholesky.factors[0][0]);
+    });
+    suite.Run("FactorCholesky unblocked", "api", type, dim, 1, bytes, lu_flops / 2, [&] {
+      auto cholesky = FactorCholesky(mat, unblocked);
+      clobber(&cholesky.factors[0][0]);
+    });
+    const auto lu = FactorLu(mat);
+    suite.Run("SolveMany LU x64", "api", type, dim, 1, bytes, solve_flops, [&] {
+      auto res = SolveMany(lu, rhs);
+      clobber(&res[0][0]);
+    });
+    suite.Run("SolveMany LU x64 unblocked", "api", type, dim, 1, bytes, solve_flops, [&] {
+      auto res = SolveMany(lu, rhs, unblocked);
+      clobber(&res[0][0]);
+    });
+  }
+}
+
+/* sparse.h */
+
+constexpr size_t kSparseGrids[]{256, 1024};
+constexpr size_t kCgIterations = 50;
+
+// 5-point Laplacian on a grid x grid mesh, five nonzeros in most rows
+template <typename T>
+MatrixCSR<T> poissonMatrix(const size_t grid) {
+  std::vector<std::uint32_t> row, col;
+  std::vector<T> value;
+  for (size_t y = 0; y < grid; ++y) {
+    for (size_t x = 0; x < grid; ++x) {
+      const auto add = [&](const size_t nx, const size_t ny, const T v) {
+        row.push_back(std::uint32_t(y * grid + x));
+        col.push_back(std::uint32_t(ny * grid + nx));
+        value.push_back(v);
+      };
+      add(x, y, T(4));
+      if (x > 0) add(x - 1, y, T(-1));
+      if (x + 1 < grid) add(x + 1, y, T(-1));
+      if (y > 0) add(x, y - 1, T(-1));
+      if (y + 1 < grid) add(x, y + 1, T(-1));
+    }
+  }
+  return BuildCsr<T>(grid * grid, grid * grid, row.data(), col.data(), value.data(), value.size());
+}
+
+template <typename T>
+void benchSparse(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  for (size_t grid : kSparseGrids) {
+    const MatrixCSR<T> mat = poissonMatrix<T>(grid);
+    const size_t len = mat.rows();
+    VectorRT<T> vec(len, kUninitialized);
+    fillRandom(static_cast<T*>(vec), len, rng, T(-1), T(1));
+    VectorRT<T> res(len, kUninitialized);
+    // values, column indices and the row's output; vec_in is mostly served from cache
+    const double nnz = double(mat.nonzeros());
+    const double bytes = nnz * (sizeof(T) + sizeof(std::uint32_t)) + 3.0 * len * sizeof(T);
+    suite.Run("SparseMatVec", "api", type, len, 1, bytes, 2 * nnz, [&] {
+      MatVec(mat, vec, res);
+      clobber(&res[0]);
+    });
+    suite.Run("SparseMatVec 1 thread", "api", type, len, 1, bytes, 2 * nnz, [&] {
+      MatVec(mat, vec, res, SparseOptions{1});
+      clobber(&res[0]);
+    });
+    // a fixed number of iterations: one product, two dot products, a norm and three updates each
+    const CgOptions fixed{0.0, kCgIterations};
+    const double cg_flops = kCgIterations * (2 * nnz + 14.0 * len);
+    suite.Run("ConjugateGradient x50", "api", type, len, 1, kCgIterations * bytes, cg_flops, [&] {
+      VectorRT<T> x(len);
+      ConjugateGradient(mat, vec, x, fixed);
+      clobber(&x[0]);
+    });
+  }
+}
+
+/* graphic.h */
+
+constexpr size_t kCullObjects = 200000;
+constexpr size_t kHierarchyNodes = 100000;
+constexpr size_t kSkinVertices = 100000;
+constexpr size_t kSkinBones = 64;
+
+template <typename T>
+void benchGraphic(Suite& suite, std::mt19937& rng) {
+  const char* type = typeName<T>();
+  std::vector<T> angles(kBatch);
+  fillRandom(angles.data(), kBatch, rng, T(-3), T(3));
+  std::vector<MatrixCT<T, 4, 4>> out(kBatch);
+  const double bytes = 16.0 * sizeof(T);
+
+  suite.Run("BuildTranslationMatrix", "inline", type, 4, kBatch, bytes, 0, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = BuildTranslationMatrix(angles[i], T(1), T(2));
+    clobber(out.data());
+  });
+  suite.Run("BuildScaleMatrix", "inline", type, 4, kBatch, bytes, 0, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = BuildScaleMatrix(angles[i], T(1), T(2));
+    clobber(out.data());
+  });
+  suite.Run("BuildRotationMatrixX", "inline", type, 4, kBatch, bytes, 2, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = BuildRotationMatrixX(angles[i]);
+    clobber(out.data());
+  });
+  suite.Run("BuildRotationMatrixY", "inline", type, 4, kBatch, bytes, 2, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = BuildRotationMatrixY(angles[i]);
+    clobber(out.data());
+  });
+  suite.Run("BuildRotationMatrixZ", "inline", type, 4, kBatch, bytes, 2, [&] {
+    for (size_t i = 0; i < kBatch; ++i) out[i] = BuildRotationMatrixZ(angles[i]);
+    clobber(out.data());
+  });
+  // per-instance transforms: one matrix per Euler triple or axis-angle pair, batched against the
+  // single-axis builders and products
+  VectorStream<T, 3> euler(kBatch, kUninitialized), axis(kBatch, kUninitialized);
+  for (size_t c = 0; c < 3; ++c) fillRandom(euler[c], kBatch, rng, T(-3), T(3));
+  for (size_t i = 0; i < kBatch; ++i) {
+    axis.Set(i, Normalize(VectorCT<T, 3>{angles[i], T(1), T(0.5)}));
+  }
+  // six sines and cosines count as one flop each
+  suite.Run("BuildRotation Z*Y*X", "inline", type, 4, kBatch, bytes, 134, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = MatrixProd(
+          BuildRotationMatrixZ(euler[2][i]),
+          MatrixProd(BuildRotationMatrixY(euler[1][i]), BuildRotationMatrixX(euler[0][i])));
+    }
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(Euler)", "inline", type, 4, kBatch, bytes, 22, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = BuildRotationMatrix(euler[0][i], euler[1][i], euler[2][i]);
+    }
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(Euler) batch", "api", type, 4, kBatch, bytes, 22, [&] {
+    BuildRotationMatrix(euler, out.data());
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(Euler) fast", "api", type, 4, kBatch, bytes, 22, [&] {
+    BuildRotationMatrix(euler, out.data(), kRotationFast);
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(quaternion)", "inline", type, 4, kBatch, bytes, 30, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = BuildRotationMatrix(BuildQuaternion(axis.Get(i), angles[i]));
+    }
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(axis) batch", "api", type, 4, kBatch, bytes, 23, [&] {
+    BuildRotationMatrix(axis, angles.data(), out.data());
+    clobber(out.data());
+  });
+  suite.Run("BuildRotation(axis) fast", "api", type, 4, kBatch, bytes, 23, [&] {
+    BuildRotationMatrix(axis, angles.data(), out.data(), kRotationFast);
+    clobber(out.data());
+  });
+  suite.Run("BuildViewMatrixRH", "inline", type, 4, kBatch, bytes, 40, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = BuildViewMatrixRH(
+          VectorCT<T, 3>{angles[i], T(1), T(5)}, VectorCT<T, 3>{}, VectorCT<T, 3>{0, 1, 0});
+    }
+    clobber(out.data());
+  });
+  suite.Run("BuildOrthographicProjection", "inline", type, 4, kBatch, bytes, 12, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = BuildOrthographicProjectionMatrixRH(
+          angles[i] + T(4), T(-1), T(1), T(-1), T(0.1), T(100));
+    }
+    clobber(out.data());
+  });
+  suite.Run("BuildPerspectiveProjection", "inline", type, 4, kBatch, bytes, 16, [&] {
+    for (size_t i = 0; i < kBatch; ++i) {
+      out[i] = BuildPerspectiveProjectionMatrixRH(
+          angles[i] + T(4), T(-1), T(1), T(-1), T(0.1), T(100));
+    }
+    clobber(out.data());
+  });
+
+  // a frame's worth of bounding volumes, scattered so that about an eighth of them are visible
+  const Frustum<T> frustum = ExtractFrustum(
+      BuildOrthographicProjectionMatrixRH(T(50), T(-50), T(50), T(-50), T(0), T(-100)));
+  VectorStream<T, 3> aabb_min(kCullObjects, kUninitialized), aabb_max(kCullObjects, kUninitialized);
+  VectorStream<T, 4> spheres(kCullObjects, kUninitialized);
+  for (size_t c = 0; c < 3; ++c) {
+    fillRandom(aabb_min[c], kCullObjects, rng, T(-100), T(100));
+    fillRandom(spheres[c], kCullObjects, rng, T(-100), T(100));
+    for (size_t i = 0; i < kCullObjects; ++i) aabb_max[c][i] = aabb_min[c][i] + T(2);
+  }
+  fillRandom(spheres[3], kCullObjects, rng, T(0.5), T(2));
+  std::vector<std::uint32_t> visible(kCullObjects);
+  // six planes of three multiply-adds each
+  const double cull_flops = 36.0 * kCullObjects;
+  const double aabb_bytes = kCullObjects * (6.0 * sizeof(T) + sizeof(std::uint32_t));
+  suite.Run("CullAabbs", "api", type, kCullObjects, 1, aabb_bytes, cull_flops, [&] {
+    size_t found = CullAabbs(frustum, aabb_min, aabb_max, visible.data());
+    clobber(&found);
+  });
+  const double sphere_bytes = kCullObjects * (4.0 * sizeof(T) + sizeof(std::uint32_t));
+  suite.Run("CullSpheres", "api", type, kCullObjects, 1, sphere_bytes, cull_flops, [&] {
+    size_t found = CullSpheres(frustum, spheres, visible.data());
+    clobber(&found);
+  });
+
+  if constexpr (std::is_floating_point_v<T>) {
+    // a wide, shallow scene; each row first dirties its nodes, then runs Update
+    TransformHierarchy<T> scene;
+    for (size_t i = 0; i < kHierarchyNodes; ++i) {
+      const auto parent = i < 64 ? kNoParent : std::uint32_t(rng() % i / 4);
+      scene.AddNode(parent, VectorCT<T, 3>{T(i % 7), T(1), T(0)});
+    }
+    scene.Update();
+    const Quaternion<T> turn = BuildQuaternion(VectorCT<T, 3>{0, 1, 0}, T(0.1));
+    std::vector<std::uint32_t> moved(kHierarchyNodes / 100);
+    for (auto& node : moved) node = std::uint32_t(rng() % kHierarchyNodes);
+    for (const std::uint32_t node : moved) scene.SetRotation(node, turn);
+    // a 3x3 rotation from the quaternion, scaled and multiplied with the parent's 4x4
+    const double node_flops = 120.0;
+    const double node_bytes = (10.0 + 32.0) * sizeof(T) + 2.0 * sizeof(std::uint32_t);
+    const double moved_nodes = double(scene.Update());
+    suite.Run(
+        "TransformHierarchy 1% dirty", "api", type, kHierarchyNodes, 1,
+        moved_nodes * node_bytes, moved_nodes * node_flops, [&] {
+          for (const std::uint32_t node : moved) scene.SetRotation(node, turn);
+          size_t updated = scene.Update();
+          clobber(&updated);
+        });
+    suite.Run(
+        "TransformHierarchy all dirty", "api", type, kHierarchyNodes, 1,
+        kHierarchyNodes * node_bytes, kHierarchyNodes * node_flops, [&] {
+          for (std::uint32_t node = 0; node < kHierarchyNodes; node += 64)
+            scene.SetTranslation(node, VectorCT<T, 3>{T(1), T(2), T(3)});
+          size_t updated = scene.Update();
+          clobber(&updated);
+        });
+
+    // a crowd of skinned vertices, four influences each, against the per-vertex Vector4 loop
+    std::vector<MatrixCT<T, 4, 4>> palette(kSkinBones);
+    for (auto& bone : palette) {
+      bone = MatrixProd(
+          BuildTranslationMatrix(T(rng() % 5), T(1), T(0)),
+          BuildRotationMatrix(BuildQuaternion(VectorCT<T, 3>{0, 1, 0}, T(rng() % 7))));
+    }
+    VectorStream<std::uint32_t, 4> bones(kSkinVertices, kUninitialized);
+    VectorStream<T, 4> weights(kSkinVertices, VectorCT<T, 4>{T(0.4), T(0.3), T(0.2), T(0.1)});
+    VectorStream<T, 3> position(kSkinVertices, kUninitialized);
+    VectorStream<T, 3> normal(kSkinVertices, VectorCT<T, 3>{0, 0, 1});
+    for (size_t c = 0; c < 4; ++c) {
+      for (size_t i = 0; i < kSkinVertices; ++i) bones[c][i] = std::uint32_t(rng() % kSkinBones);
+    }
+    for (size_t c = 0; c < 3; ++c) fillRandom(position[c], kSkinVertices, rng, T(-1), T(1));
+    VectorStream<T, 3> position_out(kSkinVertices), normal_out(kSkinVertices);
+    // blending 12 matrix entries from four bones, two 3x4 transforms and a normalization
+    const double skin_flops = kSkinVertices * (96.0 + 42.0 + 9.0);
+    const double skin_bytes = kSkinVertices * (16.0 * sizeof(T) + 4.0 * sizeof(std::uint32_t));
+    suite.Run("Skin", "api", type, kSkinVertices, 1, skin_bytes, skin_flops, [&] {
+      Skin(palette.data(), bones, weights, position, normal, position_out, normal_out);
+      clobber(position_out[0]);
+    });
+    suite.Run("Skin Vector4 loop", "inline", type, kSkinVertices, 1, skin_bytes, skin_flops, [&] {
+      for (size_t i = 0; i < kSkinVertices; ++i) {
+        const VectorCT<T, 3> pos = position.Get(i), nrm = normal.Get(i);
+        VectorCT<T, 4> pos_sum{}, nrm_sum{};
+        for (size_t k = 0; k < 4; ++k) {
+          const MatrixCT<T, 4, 4>& bone = palette[bones[k][i]];
+          pos_sum = pos_sum + Transform(bone, VectorCT<T, 4>{pos[0], pos[1], pos[2], 1}) *
+                                  weights[k][i];
+          nrm_sum = nrm_sum + Transform(bone, VectorCT<T, 4>{nrm[0], nrm[1], nrm[2], 0}) *
+                                  weights[k][i];
+        }
+        position_out.Set(i, VectorCT<T, 3>{pos_sum[0], pos_sum[1], pos_sum[2]});
+        normal_out.Set(i, Normalize(VectorCT<T, 3>{nrm_sum[0], nrm_sum[1], nrm_sum[2]}));
+      }
+      clobber(position_out[0]);
+    });
+  }
+}
+
+/* binary_file.h */
+
+constexpr size_t kFileElements = size_t(1) << 20;
+
+// Loading a dataset and touching all of it once: parsing text against viewing a mapped binary
+// file. The files are rewritten once per run of the bench.
+template <typename T>
+void benchBinaryFile(Suite& suite, std::mt19937& rng) {
+  if (!suite.Selected("load+Sum")) return;
+  const char* type = typeName<T>();
+  VectorRT<T> values(kFileElements, kUninitialized);
+  fillRandom(static_cast<T*>(values), kFileElements, rng, T(-1), T(1));
+  const char* text_path = "bench_values.txt";
+  const char* binary_path = "bench_values.bin";
+  {
+    std::ofstream text(text_path);
+    for (size_t i = 0; i < kFileElements; ++i) text << values[i] << '\n';
+  }
+  BinaryFileWriter writer;
+  writer.AddArray("values", values);
+  if (!writer.Write(binary_path)) return;
+
+  const double bytes = double(kFileElements) * sizeof(T);
+  suite.Run("load+Sum", "text", type, kFileElements, 1, bytes, 0, [&] {
+    std::ifstream text(text_path);
+    VectorRT<T> loaded(kFileElements, kUninitialized);
+    for (size_t i = 0; i < kFileElements; ++i) text >> loaded[i];
+    T sum = Sum(loaded);
+    clobber(&sum);
+  });
+  suite.Run("load+Sum", "mmap", type, kFileElements, 1, bytes, 0, [&] {
+    BinaryFile file;
+    file.Open(binary_path);
+    T sum = Sum(file.Array<T>("values"));
+    clobber(&sum);
+  });
+  std::remove(text_path);
+  std::remove(binary_path);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (arg == "--json" && i + 1 < argc) {
+      options.json_path = argv[++i];
+    } else if (arg == "--min-time" && i + 1 < argc) {
+      options.min_time = std::atof(argv[++i]);
+    } else if (arg == "--ispc-target" && i + 1 < argc) {
+      IspcTarget target;
+      if (!ParseIspcTarget(argv[++i], target) || !SetIspcTarget(target)) {
+        std::fprintf(stderr, "ISPC target %s is not available\n", argv[i]);
+        return 1;
+      }
+    } else {
+      std::fprintf(
+          stderr,
+          "usage: %s [--filter SUBSTRING] [--min-time SECONDS] [--json FILE]"
+          " [--ispc-target NAME]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+  std::printf("ISPC target: %s\n", IspcTargetName(ActiveIspcTarget()));
+
+  std::mt19937 rng(42);
+  Suite suite(options);
+
+  benchBasic<float>(suite, rng);
+  benchBasic<double>(suite, rng);
+  benchBasic<std::int32_t>(suite, rng);
+  benchBasic<Half>(suite, rng);
+  // no int32 here, the perspective divide of the vertex kernels would divide by zero
+  benchLinearAlgebra<float>(suite, rng);
+  benchLinearAlgebra<double>(suite, rng);
+  benchLinearAlgebra<Half>(suite, rng);
+  benchReduction<float>(suite, rng);
+  benchReduction<double>(suite, rng);
+
+  benchVectorCT<float, 2>(suite, rng);
+  benchVectorCT<float, 3>(suite, rng);
+  benchVectorCT<float, 4>(suite, rng);
+  benchVectorCT<float, 8>(suite, rng);
+  benchVectorCT<float, 16>(suite, rng);
+  benchVectorStream<float, 3>(suite, rng);
+  benchVectorStream<float, 4>(suite, rng);
+  benchVectorStream<double, 3>(suite, rng);
+  benchQuaternion<float>(suite, rng);
+  benchQuaternion<double>(suite, rng);
+  benchMatrixCT<float, 2>(suite, rng);
+  benchMatrixCT<float, 3>(suite, rng);
+  benchMatrixCT<float, 4>(suite, rng);
+  benchMatrixCT<float, 8>(suite, rng);
+  benchMatrixCT<float, 16>(suite, rng);
+  benchInverse<float, 3>(suite, rng);
+  benchInverse<float, 4>(suite, rng);
+  benchInverse<double, 4>(suite, rng);
+  benchRuntime<float>(suite, rng);
+  benchFactorization<float>(suite, rng);
+  benchFactorization<double>(suite, rng);
+  benchSparse<float>(suite, rng);
+  benchSparse<double>(suite, rng);
+  benchGraphic<float>(suite, rng);
+  benchBinaryFile<float>(suite, rng);
+
+  if (!suite.WriteJson()) {
+    std::fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+    return 1;
+  }
+}
@@ -0,0 +1,72 @@
+#include <calculation_tools/linear_algebra.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace kplutl;
+
+namespace {
+// The pre-GEMM MatrixProd: transposed copy of rhs and one out-of-line dot product per element.
+// VectorDotProd takes a uint8 length, so the dot is reproduced here to keep large sizes honest.
+__attribute__((noinline)) float legacyDot(const float* lhs, const float* rhs, size_t len) {
+  float sum = 0;
+  for (size_t i = 0; i < len; ++i) sum += lhs[i] * rhs[i];
+  return sum;
+}
+
+void legacyProd(const float* lhs, const float* rhs, float* out, size_t dim) {
+  std::vector<float> rhs_t(dim * dim);
+  for (size_t r = 0; r < dim; ++r)
+    for (size_t c = 0; c < dim; ++c) rhs_t[c * dim + r] = rhs[r * dim + c];
+  for (size_t r = 0; r < dim; ++r)
+    for (size_t c = 0; c < dim; ++c)
+      out[r * dim + c] = legacyDot(&lhs[r * dim], &rhs_t[c * dim], dim);
+}
+
+template <typename F>
+double secondsPerRun(F&& run) {
+  using clock = std::chrono::steady_clock;
+  run();  // warm-up
+  size_t runs = 0;
+  auto start = clock::now();
+  double elapsed = 0;
+  do {
+    run();
+    ++runs;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < 0.25);
+  return elapsed / runs;
+}
+}  // namespace
+
+int main() {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1, 1);
+
+  std::printf(
+      "%6s %14s %14s %10s %12s\n", "dim", "legacy GFLOPS", "gemm GFLOPS", "speedup", "max |err|");
+  for (size_t dim : {16, 64, 128, 256, 512, 1024}) {
+    std::vector<float> lhs(dim * dim), rhs(dim * dim), out_legacy(dim * dim), out_gemm(dim * dim);
+    for (auto& value : lhs) value = dist(rng);
+    for (auto& value : rhs) value = dist(rng);
+
+    double legacy =
+        secondsPerRun([&] { legacyProd(lhs.data(), rhs.data(), out_legacy.data(), dim); });
+    double gemm = secondsPerRun([&] {
+      Gemm(dim, dim, dim, 1.0f, lhs.data(), dim, rhs.data(), dim, 0.0f, out_gemm.data(), dim);
+    });
+
+    float max_err = 0;
+    for (size_t i = 0; i < dim * dim; ++i)
+      max_err = std::max(max_err, std::abs(out_legacy[i] - out_gemm[i]));
+
+    double flops = 2.0 * dim * dim * dim;
+    std::printf(
+        "%6zu %14.2f %14.2f %9.1fx %12.3g\n", dim, flops / legacy * 1e-9, flops / gemm * 1e-9,
+        legacy / gemm, max_err);
+  }
+}
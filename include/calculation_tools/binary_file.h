@@ -0,0 +1,345 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "half.h"
+#include "memory.h"
+#include "vector.h"
+#include "matrix.h"
+#include "vector_rt.h"
+#include "matrix_rt.h"
+#include "vector_stream.h"
+
+/*
+    Binary container for vector, matrix and mesh arrays, read by mapping the file into memory
+    instead of parsing it. A file holds named arrays, each with an element type (dtype), a number
+    of elements, the shape of one element (rows x cols, 1 x N for vectors, 1 x 1 for scalars) and a
+    layout:
+
+      - kAoS: element i starts at offset + i * stride, row r of it r * row_stride further on,
+      - kSoA: component k = r * cols + c of all elements is one array at offset + k * stride.
+
+    Every array starts on a kAlignment boundary and is padded to whole aligned blocks, so the
+    containers of this library view it in place: Array, Matrix and Stream hand out VectorRT,
+    MatrixRT and VectorStream views of the mapped pages, and Vectors / Matrices hand out arrays of
+    VectorCT / MatrixCT for the batch functions. A mesh is a file with several arrays, by
+    convention "position" and "normal" (vectors) and "index" (uint32, 1 x 3 per triangle).
+
+    On disk, in native byte order: BinaryFileHeader, one BinaryArrayHeader per array, then the
+    data. The mapping is private and writable; writes through a view copy the touched pages and
+    never reach the file. ForEachChunk walks an array range by range and releases the pages behind
+    it, so a pass over a file larger than memory keeps only a few ranges resident.
+*/
+
+namespace kplutl {
+enum class DataType : std::uint32_t {
+  kFloat32 = 1,
+  kFloat64,
+  kInt32,
+  kUInt32,
+  kFloat16,
+};
+
+enum class ArrayLayout : std::uint32_t {
+  kAoS = 0,
+  kSoA,
+};
+
+constexpr char kBinaryFileMagic[8] = {'K', 'P', 'L', 'U', 'T', 'L', 'B', '\0'};
+constexpr std::uint32_t kBinaryFileVersion = 1;
+// written as is, reads back differently on a machine of the other byte order
+constexpr std::uint32_t kBinaryFileByteOrder = 0x01020304;
+
+struct BinaryFileHeader {
+  char magic[8];
+  std::uint32_t byte_order;
+  std::uint32_t version;
+  std::uint64_t array_count;
+  std::uint8_t reserved[40];
+};
+static_assert(sizeof(BinaryFileHeader) == 64, "the file header takes 64 bytes");
+
+struct BinaryArrayHeader {
+  char name[32];  // zero-terminated
+  DataType dtype;
+  ArrayLayout layout;
+  std::uint32_t rows;  // shape of one element
+  std::uint32_t cols;
+  std::uint64_t count;       // elements
+  std::uint64_t stride;      // bytes, kAoS: between elements, kSoA: between component arrays
+  std::uint64_t row_stride;  // bytes between the rows of a kAoS element
+  std::uint64_t offset;      // bytes from the start of the file, a multiple of kAlignment
+  std::uint64_t size;        // bytes, padding included
+  std::uint8_t reserved[40];
+};
+static_assert(sizeof(BinaryArrayHeader) == 128, "array headers take 128 bytes");
+
+template <typename T>
+struct DataTypeOf;
+template <>
+struct DataTypeOf<float> {
+  static constexpr DataType value = DataType::kFloat32;
+};
+template <>
+struct DataTypeOf<double> {
+  static constexpr DataType value = DataType::kFloat64;
+};
+template <>
+struct DataTypeOf<std::int32_t> {
+  static constexpr DataType value = DataType::kInt32;
+};
+template <>
+struct DataTypeOf<std::uint32_t> {
+  static constexpr DataType value = DataType::kUInt32;
+};
+template <>
+struct DataTypeOf<Half> {
+  static constexpr DataType value = DataType::kFloat16;
+};
+
+// bytes per element of `dtype`, 0 for unknown types
+constexpr size_t DataTypeSize(const DataType dtype) {
+  switch (dtype) {
+    case DataType::kFloat32:
+    case DataType::kInt32:
+    case DataType::kUInt32:
+      return 4;
+    case DataType::kFloat64:
+      return 8;
+    case DataType::kFloat16:
+      return 2;
+  }
+  return 0;
+}
+
+// `count` elements at `data`, empty when the requested array does not exist or does not match
+template <typename E>
+struct ArrayView {
+  E* data = nullptr;
+  size_t count = 0;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  E* begin() const { return data; }
+  E* end() const { return data + count; }
+  E& operator[](const size_t index) const {
+    assert(index < count);
+    return data[index];
+  }
+};
+
+// Read side: maps a file and hands out views of its arrays. The views share the mapping and must
+// not outlive the BinaryFile.
+class BinaryFile {
+ public:
+  BinaryFile() = default;
+  BinaryFile(const BinaryFile&) = delete;
+  BinaryFile& operator=(const BinaryFile&) = delete;
+  BinaryFile(BinaryFile&& other) noexcept { swap(other); }
+  BinaryFile& operator=(BinaryFile&& other) noexcept {
+    swap(other);
+    return *this;
+  }
+  ~BinaryFile() { Close(); }
+
+  void swap(BinaryFile& other) noexcept;
+
+  // Maps `path`. Returns false and stays closed when the file cannot be read or is not a
+  // well-formed container: bad magic, version or byte order, or an array outside the file.
+  bool Open(const std::string& path);
+  void Close();
+  bool is_open() const { return data_ != nullptr; }
+
+  // number of arrays
+  size_t size() const { return arrays_.size(); }
+  const BinaryArrayHeader& operator[](const size_t index) const { return arrays_[index]; }
+  // nullptr when there is no array `name`
+  const BinaryArrayHeader* Find(const std::string& name) const;
+  // first byte of `array`
+  std::uint8_t* Data(const BinaryArrayHeader& array) const { return data_ + array.offset; }
+
+  // scalar array
+  template <typename T>
+  VectorRT<T> Array(const std::string& name) const {
+    VectorRT<T> res;
+    const BinaryArrayHeader* array = find_<T>(name, 1, 1);
+    if (array != nullptr && (array->layout == ArrayLayout::kSoA || array->stride == sizeof(T)) &&
+        array->size >= PaddedLength<T>(array->count) * sizeof(T)) {
+      res.data_ = AlignedArray<T>::View(reinterpret_cast<T*>(Data(*array)), array->count);
+    }
+    return res;
+  }
+
+  // a single rows x cols matrix whose rows are padded the way MatrixRT pads them
+  template <typename T>
+  MatrixRT<T> Matrix(const std::string& name) const {
+    MatrixRT<T> res;
+    const BinaryArrayHeader* array = Find(name);
+    if (array == nullptr || array->dtype != DataTypeOf<T>::value || array->count != 1 ||
+        array->layout != ArrayLayout::kAoS) {
+      return res;
+    }
+    const size_t ld = PaddedLength<T>(array->cols);
+    if (array->row_stride != ld * sizeof(T) || array->size < array->rows * ld * sizeof(T)) {
+      return res;
+    }
+    res.data_ = AlignedArray<T>::View(reinterpret_cast<T*>(Data(*array)), array->rows * ld);
+    res.rows_ = array->rows;
+    res.cols_ = array->cols;
+    res.ld_ = ld;
+    return res;
+  }
+
+  // kSoA vectors of N components
+  template <typename T, size_t N>
+  VectorStream<T, N> Stream(const std::string& name) const {
+    VectorStream<T, N> res;
+    const BinaryArrayHeader* array = find_<T>(name, 1, N);
+    if (array == nullptr || array->layout != ArrayLayout::kSoA ||
+        array->stride % kAlignment != 0 ||
+        array->stride < PaddedLength<T>(array->count) * sizeof(T)) {
+      return res;
+    }
+    const size_t stride = array->stride / sizeof(T);
+    res.data_ = AlignedArray<T>::View(reinterpret_cast<T*>(Data(*array)), N * stride);
+    res.size_ = array->count;
+    res.stride_ = stride;
+    return res;
+  }
+
+  // kAoS vectors laid out like VectorCT<T, N>
+  template <typename T, size_t N>
+  ArrayView<VectorCT<T, N>> Vectors(const std::string& name) const {
+    return elements_<VectorCT<T, N>, T>(name, 1, N, sizeof(VectorCT<T, N>));
+  }
+
+  // kAoS matrices laid out like MatrixCT<T, ROWS, COLS>
+  template <typename T, size_t ROWS, size_t COLS>
+  ArrayView<MatrixCT<T, ROWS, COLS>> Matrices(const std::string& name) const {
+    return elements_<MatrixCT<T, ROWS, COLS>, T>(name, ROWS, COLS, sizeof(VectorCT<T, COLS>));
+  }
+
+  // Calls fn(first, count) for consecutive ranges of at most `chunk` elements of `array`. The
+  // next range is read ahead while fn runs and the pages of a range are released after it, which
+  // also drops whatever was written to them through a view.
+  template <typename F>
+  void ForEachChunk(const BinaryArrayHeader& array, const size_t chunk, const F& fn) const {
+    assert(chunk > 0);
+    const size_t count = array.count;
+    if (count != 0) adviseRange_(array, 0, std::min(chunk, count), true);
+    for (size_t first = 0; first < count; first += chunk) {
+      const size_t len = std::min(chunk, count - first);
+      const size_t next = first + len;
+      if (next < count) adviseRange_(array, next, std::min(chunk, count - next), true);
+      fn(first, len);
+      adviseRange_(array, first, len, false);
+    }
+  }
+
+ private:
+  template <typename T>
+  const BinaryArrayHeader* find_(const std::string& name, const size_t rows, const size_t cols)
+      const {
+    const BinaryArrayHeader* array = Find(name);
+    if (array == nullptr || array->dtype != DataTypeOf<T>::value || array->rows != rows ||
+        array->cols != cols) {
+      return nullptr;
+    }
+    return array;
+  }
+
+  template <typename E, typename T>
+  ArrayView<E> elements_(
+      const std::string& name, const size_t rows, const size_t cols,
+      const size_t row_stride) const {
+    ArrayView<E> res;
+    const BinaryArrayHeader* array = find_<T>(name, rows, cols);
+    if (array != nullptr && array->layout == ArrayLayout::kAoS && array->stride == sizeof(E) &&
+        (rows == 1 || array->row_stride == row_stride) &&
+        array->size >= array->count * sizeof(E)) {
+      res.data = reinterpret_cast<E*>(Data(*array));
+      res.count = array->count;
+    }
+    return res;
+  }
+
+  // asks the OS to read the pages of elements [first, first + count) ahead or to drop them
+  void adviseRange_(
+      const BinaryArrayHeader& array, size_t first, size_t count, bool will_need) const;
+
+  std::uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;  // false when the platform has no mmap and the file was read instead
+  std::vector<BinaryArrayHeader> arrays_;
+};
+
+// Write side: collects arrays and writes them into one file. The arrays are written straight from
+// the memory they were added from, which has to stay valid until Write; that memory may itself be
+// a view of a mapped file.
+class BinaryFileWriter {
+ public:
+  template <typename T>
+  void AddArray(const std::string& name, const T* data, const size_t count) {
+    add_(name, DataTypeOf<T>::value, ArrayLayout::kAoS, 1, 1, count, sizeof(T), 0, data,
+         count * sizeof(T));
+  }
+  template <typename T>
+  void AddArray(const std::string& name, const VectorRT<T>& vec) {
+    AddArray(name, static_cast<const T*>(vec), vec.size());
+  }
+
+  template <typename T>
+  void AddMatrix(const std::string& name, const MatrixRT<T>& mat) {
+    const size_t row_stride = mat.ld() * sizeof(T);
+    add_(name, DataTypeOf<T>::value, ArrayLayout::kAoS, mat.rows(), mat.cols(), 1,
+         mat.rows() * row_stride, row_stride, static_cast<const T*>(mat),
+         mat.rows() * row_stride);
+  }
+
+  template <typename T, size_t N>
+  void AddStream(const std::string& name, const VectorStream<T, N>& stream) {
+    const size_t stride = stream.stride() * sizeof(T);
+    add_(name, DataTypeOf<T>::value, ArrayLayout::kSoA, 1, N, stream.size(), stride, 0,
+         stream[0], N * stride);
+  }
+
+  template <typename T, size_t N>
+  void AddVectors(const std::string& name, const VectorCT<T, N>* data, const size_t count) {
+    add_(name, DataTypeOf<T>::value, ArrayLayout::kAoS, 1, N, count, sizeof(VectorCT<T, N>), 0,
+         data, count * sizeof(VectorCT<T, N>));
+  }
+
+  template <typename T, size_t ROWS, size_t COLS>
+  void AddMatrices(
+      const std::string& name, const MatrixCT<T, ROWS, COLS>* data, const size_t count) {
+    using M = MatrixCT<T, ROWS, COLS>;
+    add_(name, DataTypeOf<T>::value, ArrayLayout::kAoS, ROWS, COLS, count, sizeof(M),
+         sizeof(VectorCT<T, COLS>), data, count * sizeof(M));
+  }
+
+  // Writes every array added so far. Returns false when the file cannot be written or two
+  // arrays share a name; names are at most 31 characters long.
+  bool Write(const std::string& path) const;
+
+ private:
+  struct Source {
+    BinaryArrayHeader header;
+    const void* data;
+    size_t bytes;  // read from data, the file pads them to whole kAlignment blocks
+  };
+
+  void add_(
+      const std::string& name, DataType dtype, ArrayLayout layout, size_t rows, size_t cols,
+      size_t count, size_t stride, size_t row_stride, const void* data, size_t bytes);
+
+  std::vector<Source> sources_;
+  bool valid_ = true;  // false once a name did not fit
+};
+
+}  // namespace kplutl
@@ -1,3 +1,16 @@
 #pragma once
 
-#define ENABLE_ISPC
\ No newline at end of file
+// ISPC kernels; without them every kernel comes from the scalar backend in portable.h
+#ifndef CT_DISABLE_ISPC
+#define ENABLE_ISPC
+#endif
+
+// inline SSE2 path for the small fixed-size types, see simd.h
+#if !defined(CT_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define ENABLE_SSE
+#endif
+
+// per-kernel call counters and timers, see profile.h; off unless the build asks for them
+#ifdef CT_ENABLE_PROFILE
+#define ENABLE_PROFILE
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include "config.h"
+
+/*
+    Runtime choice of the ISPC target. The kernels are compiled once per target listed in
+    CT_ISPC_TARGETS and the first kernel call picks the best one the CPU supports (CPUID). The
+    environment variable CT_ISPC_TARGET=<name> or SetIspcTarget pins another one, e.g. to keep
+    results reproducible across machines.
+*/
+
+namespace kplutl {
+// ordered from the most portable to the widest
+enum class IspcTarget : std::int32_t {
+  kPortable = 0,  // the scalar kernels of portable.h
+  kSse2,
+  kSse4,
+  kAvx2,
+  kAvx512Skx,
+};
+
+// "portable", "sse2", "sse4", "avx2" or "avx512skx"
+const char* IspcTargetName(IspcTarget target);
+
+// false when `name` is not one of the names above
+bool ParseIspcTarget(const char* name, IspcTarget& target);
+
+// built into this library and supported by the CPU; kPortable is always available
+bool IsIspcTargetAvailable(IspcTarget target);
+
+// the widest available target
+IspcTarget BestIspcTarget();
+
+// the target the kernels currently run on
+IspcTarget ActiveIspcTarget();
+
+// Routes every following kernel call to `target`. Returns false and keeps the current target when
+// `target` is not available. Not meant to race with kernels running on other threads.
+bool SetIspcTarget(IspcTarget target);
+
+}  // namespace kplutl
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+
+#include "utils.h"
+#include "profile.h"
+#include "vector.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+/*
+    Lazy elementwise expressions. Operators on runtime-sized containers (and on anything wrapped
+    with Lazy()) build a tree of nodes instead of a temporary per operator; the whole tree is
+    evaluated in one pass when it is assigned to a container:
+      - compile-time sized containers run a generated fused loop,
+      - runtime sized containers compile the tree into register bytecode that a single
+        ExprForeach kernel interprets over L1-sized blocks.
+    Nodes hold containers by reference, so an expression must not outlive its operands.
+*/
+
+namespace kplutl {
+/* containers */
+
+// Describes how an expression reads and creates a container. Specialized per container type.
+template <typename C>
+struct ExprContainer;
+
+template <typename T, size_t N>
+struct ExprContainer<VectorCT<T, N>> {
+  using value_type = T;
+  static constexpr bool kRuntime = false;
+
+  static size_t Length(const VectorCT<T, N>&) { return N; }
+  static bool SameShape(const VectorCT<T, N>&, const VectorCT<T, N>&) { return true; }
+  static VectorCT<T, N> MakeLike(const VectorCT<T, N>&) { return VectorCT<T, N>{}; }
+};
+
+template <typename T, size_t ROWS, size_t COLS>
+struct ExprContainer<MatrixCT<T, ROWS, COLS>> {
+  using value_type = T;
+  static constexpr bool kRuntime = false;
+
+  static size_t Length(const MatrixCT<T, ROWS, COLS>&) {
+    return MatrixCT<T, ROWS, COLS>::kStorageLength;
+  }
+  static bool SameShape(const MatrixCT<T, ROWS, COLS>&, const MatrixCT<T, ROWS, COLS>&) {
+    return true;
+  }
+  static MatrixCT<T, ROWS, COLS> MakeLike(const MatrixCT<T, ROWS, COLS>&) {
+    return MatrixCT<T, ROWS, COLS>{};
+  }
+};
+
+template <typename X, typename = void>
+struct IsExprContainer : std::false_type {};
+
+template <typename X>
+struct IsExprContainer<X, std::void_t<typename ExprContainer<X>::value_type>> : std::true_type {};
+
+/* program */
+
+// Register bytecode for ExprForeach, four int32 per instruction: op, dst, lhs, rhs.
+// Operands >= 0 name a register, operands < 0 name array -(operand + 1).
+template <typename T>
+struct ExprProgram {
+  std::int32_t code[4 * kExprMaxInstructions]{};
+  std::int32_t size = 0;
+  const T* arrays[kExprMaxArrays]{};
+  std::int32_t num_arrays = 0;
+  T scalars[kExprMaxScalars]{};
+  std::int32_t num_scalars = 0;
+
+  void Emit(const ExprOp op, const int dst, const int lhs, const int rhs) {
+    assert(size + 4 <= 4 * kExprMaxInstructions);
+    code[size++] = op;
+    code[size++] = dst;
+    code[size++] = lhs;
+    code[size++] = rhs;
+  }
+
+  int Array(const T* array) {
+    for (int i = 0; i < num_arrays; ++i) {
+      if (arrays[i] == array) return -(i + 1);
+    }
+    assert(num_arrays < kExprMaxArrays);
+    arrays[num_arrays++] = array;
+    return -num_arrays;
+  }
+
+  int Scalar(const T value) {
+    assert(num_scalars < kExprMaxScalars);
+    scalars[num_scalars] = value;
+    return num_scalars++;
+  }
+};
+
+/* nodes */
+
+struct ExprTag {};
+
+template <typename E>
+struct Expr : ExprTag {
+  const E& Self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename X>
+using IsExpr = std::is_base_of<ExprTag, X>;
+
+template <typename C>
+struct ExprTerminal : Expr<ExprTerminal<C>> {
+  using container_type = C;
+  using value_type = typename ExprContainer<C>::value_type;
+  static constexpr bool kHasContainer = true;
+  static constexpr int kNodes = 0;
+  static constexpr int kRegisters = 0;
+  static constexpr int kArrays = 1;
+
+  const C& container_;
+  const value_type* data_;
+
+  explicit ExprTerminal(const C& container)
+      : container_(container), data_(static_cast<const value_type*>(container)) {}
+
+  value_type Eval(const size_t index) const { return data_[index]; }
+  const C& Like() const { return container_; }
+  bool SameShape(const C& like) const { return ExprContainer<C>::SameShape(container_, like); }
+
+  int Compile(ExprProgram<value_type>& program, int&) const { return program.Array(data_); }
+};
+
+template <typename T>
+struct ExprScalar : Expr<ExprScalar<T>> {
+  using container_type = void;
+  using value_type = T;
+  static constexpr bool kHasContainer = false;
+  static constexpr int kNodes = 1;
+  static constexpr int kRegisters = 1;
+  static constexpr int kArrays = 0;
+
+  T value_;
+
+  explicit ExprScalar(const T value) : value_(value) {}
+
+  T Eval(const size_t) const { return value_; }
+  template <typename C>
+  bool SameShape(const C&) const {
+    return true;
+  }
+
+  int Compile(ExprProgram<T>& program, int& top) const {
+    int dst = top++;
+    program.Emit(kExprScalar, dst, program.Scalar(value_), 0);
+    return dst;
+  }
+};
+
+template <typename Op, typename A>
+struct ExprUnary : Expr<ExprUnary<Op, A>> {
+  using container_type = typename A::container_type;
+  using value_type = typename A::value_type;
+  static constexpr bool kHasContainer = A::kHasContainer;
+  static constexpr int kNodes = A::kNodes + 1;
+  static constexpr int kRegisters = A::kRegisters > 1 ? A::kRegisters : 1;
+  static constexpr int kArrays = A::kArrays;
+
+  A arg_;
+
+  explicit ExprUnary(const A& arg) : arg_(arg) {}
+
+  value_type Eval(const size_t index) const { return Op::Apply(arg_.Eval(index)); }
+  const container_type& Like() const { return arg_.Like(); }
+  template <typename C>
+  bool SameShape(const C& like) const {
+    return arg_.SameShape(like);
+  }
+
+  int Compile(ExprProgram<value_type>& program, int& top) const {
+    int arg = arg_.Compile(program, top);
+    if (arg >= 0) --top;
+    int dst = top++;
+    program.Emit(Op::kOp, dst, arg, 0);
+    return dst;
+  }
+};
+
+template <typename Op, typename L, typename R>
+struct ExprBinary : Expr<ExprBinary<Op, L, R>> {
+  static_assert(
+      !L::kHasContainer || !R::kHasContainer ||
+          std::is_same<typename L::container_type, typename R::container_type>::value,
+      "elementwise expressions need operands of the same container type");
+
+  using container_type = std::conditional_t<
+      L::kHasContainer, typename L::container_type, typename R::container_type>;
+  using value_type = typename L::value_type;
+  static constexpr bool kHasContainer = L::kHasContainer || R::kHasContainer;
+  static constexpr int kNodes = L::kNodes + R::kNodes + 1;
+  // operands are evaluated left to right and the left result stays live meanwhile
+  static constexpr int kRightRegisters = R::kRegisters + (L::kRegisters > 0 ? 1 : 0);
+  static constexpr int kRegisters = std::max({L::kRegisters, kRightRegisters, 1});
+  // array operands, an array used twice counts twice
+  static constexpr int kArrays = L::kArrays + R::kArrays;
+
+  L lhs_;
+  R rhs_;
+
+  ExprBinary(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  value_type Eval(const size_t index) const {
+    return Op::Apply(lhs_.Eval(index), rhs_.Eval(index));
+  }
+  const container_type& Like() const {
+    if constexpr (L::kHasContainer) {
+      return lhs_.Like();
+    } else {
+      return rhs_.Like();
+    }
+  }
+  template <typename C>
+  bool SameShape(const C& like) const {
+    return lhs_.SameShape(like) && rhs_.SameShape(like);
+  }
+
+  int Compile(ExprProgram<value_type>& program, int& top) const {
+    int lhs = lhs_.Compile(program, top);
+    int rhs = rhs_.Compile(program, top);
+    if (rhs >= 0) --top;
+    if (lhs >= 0) --top;
+    int dst = top++;
+    program.Emit(Op::kOp, dst, lhs, rhs);
+    return dst;
+  }
+};
+
+/* operations */
+
+struct ExprAdd {
+  static constexpr ExprOp kOp = kExprAdd;
+  template <typename T>
+  static T Apply(const T lhs, const T rhs) {
+    return lhs + rhs;
+  }
+};
+
+struct ExprSub {
+  static constexpr ExprOp kOp = kExprSub;
+  template <typename T>
+  static T Apply(const T lhs, const T rhs) {
+    return lhs - rhs;
+  }
+};
+
+struct ExprMul {
+  static constexpr ExprOp kOp = kExprMul;
+  template <typename T>
+  static T Apply(const T lhs, const T rhs) {
+    return lhs * rhs;
+  }
+};
+
+struct ExprDiv {
+  static constexpr ExprOp kOp = kExprDiv;
+  template <typename T>
+  static T Apply(const T lhs, const T rhs) {
+    return lhs / rhs;
+  }
+};
+
+struct ExprNeg {
+  static constexpr ExprOp kOp = kExprNeg;
+  template <typename T>
+  static T Apply(const T arg) {
+    return -arg;
+  }
+};
+
+struct ExprAbs {
+  static constexpr ExprOp kOp = kExprAbs;
+  template <typename T>
+  static T Apply(const T arg) {
+    return std::abs(arg);
+  }
+};
+
+struct ExprSqrt {
+  static constexpr ExprOp kOp = kExprSqrt;
+  template <typename T>
+  static T Apply(const T arg) {
+    return std::sqrt(arg);
+  }
+};
+
+/* operands */
+
+// containers that build expressions on their own, without Lazy()
+template <typename X>
+struct IsLazyContainer : std::false_type {};
+
+template <typename X>
+struct IsLazyOperand
+    : std::integral_constant<bool, IsExpr<X>::value || IsLazyContainer<X>::value> {};
+
+template <typename X>
+struct IsExprOperand : std::integral_constant<
+                           bool, IsExpr<X>::value || IsExprContainer<X>::value ||
+                                     std::is_arithmetic<X>::value> {};
+
+template <typename L, typename R>
+constexpr bool kIsLazyBinary = IsExprOperand<L>::value && IsExprOperand<R>::value &&
+                               (IsLazyOperand<L>::value || IsLazyOperand<R>::value);
+
+template <typename X, typename = void>
+struct ExprValue {
+  using type = void;
+};
+
+template <typename X>
+struct ExprValue<X, std::enable_if_t<IsExpr<X>::value>> {
+  using type = typename X::value_type;
+};
+
+template <typename X>
+struct ExprValue<X, std::enable_if_t<IsExprContainer<X>::value>> {
+  using type = typename ExprContainer<X>::value_type;
+};
+
+template <typename T, typename X>
+auto asExpr_(const X& operand) {
+  if constexpr (IsExpr<X>::value) {
+    return operand;
+  } else if constexpr (std::is_arithmetic<X>::value) {
+    return ExprScalar<T>{static_cast<T>(operand)};
+  } else {
+    return ExprTerminal<X>{operand};
+  }
+}
+
+template <typename Op, typename L, typename R>
+auto makeBinary_(const L& lhs, const R& rhs) {
+  using T = std::conditional_t<
+      std::is_arithmetic<L>::value, typename ExprValue<R>::type, typename ExprValue<L>::type>;
+  auto lhs_expr = asExpr_<T>(lhs);
+  auto rhs_expr = asExpr_<T>(rhs);
+  return ExprBinary<Op, decltype(lhs_expr), decltype(rhs_expr)>{lhs_expr, rhs_expr};
+}
+
+template <typename Op, typename A>
+auto makeUnary_(const A& arg) {
+  auto arg_expr = asExpr_<typename ExprValue<A>::type>(arg);
+  return ExprUnary<Op, decltype(arg_expr)>{arg_expr};
+}
+
+/* inline functions */
+
+template <typename T, typename E>
+inline void exprForeach_(T* out, const E& expr, const size_t len) {
+  static_assert(E::kNodes <= kExprMaxInstructions, "expression too large for one pass");
+  static_assert(E::kRegisters <= kExprRegisters, "expression needs too many registers");
+  static_assert(E::kArrays <= kExprMaxArrays, "expression reads too many arrays for one pass");
+  if constexpr (E::kNodes == 0) {
+    // a bare operand, Lazy(a), compiles to no instruction: copy it
+    const T* in = expr.data_;
+    if (in == out) return;
+    parallelForeach_<T>(len, [&](const size_t begin, const size_t end) {
+      std::copy(in + begin, in + end, out + begin);
+    });
+  } else {
+    ExprProgram<T> program;
+    int top = 0;
+    expr.Compile(program, top);
+    program.code[program.size - 3] = kExprOut;  // the root instruction writes straight to `out`
+    // long arrays run as independent ranges on the thread pool, each with its operands offset
+    parallelForeach_<T>(len, [&](const size_t begin, const size_t end) {
+      const T* arrays[kExprMaxArrays]{};
+      for (int i = 0; i < program.num_arrays; ++i) arrays[i] = program.arrays[i] + begin;
+      CT_PROFILE_BEGIN(ExprForeach);
+#ifdef ENABLE_ISPC
+      ispc::ExprForeach(
+          out + begin, program.code, program.size, arrays, program.scalars, end - begin);
+#else
+      portable::ExprForeach<T>(
+          out + begin, program.code, program.size, arrays, program.scalars, end - begin);
+#endif
+      CT_PROFILE_END(
+          ExprForeach, end - begin, (program.num_arrays + 1) * (end - begin) * sizeof(T));
+    });
+  }
+}
+
+/* evaluation */
+
+// Evaluates `expr` into `out` in one pass. `out` may be one of the operands.
+template <typename C, typename E>
+void Assign(C& out, const Expr<E>& expr) {
+  static_assert(
+      std::is_same<C, typename E::container_type>::value,
+      "expression assigned to a different container type");
+  const E& self = expr.Self();
+  assert(self.SameShape(out));
+
+  using T = typename ExprContainer<C>::value_type;
+  T* data = static_cast<T*>(out);
+  const size_t len = ExprContainer<C>::Length(out);
+  if constexpr (ExprContainer<C>::kRuntime) {
+    exprForeach_(data, self, len);
+  } else {
+    for (size_t i = 0; i < len; ++i) data[i] = self.Eval(i);
+  }
+}
+
+template <typename E>
+typename E::container_type Evaluate(const Expr<E>& expr) {
+  using C = typename E::container_type;
+  C res = ExprContainer<C>::MakeLike(expr.Self().Like());
+  Assign(res, expr);
+  return res;
+}
+
+// Starts a fused expression on a compile-time sized container, e.g. `res = Lazy(a) * b + c - d`.
+// Runtime sized containers build expressions on their own; Lazy() accepts them too.
+template <typename C>
+ExprTerminal<C> Lazy(const C& container) {
+  static_assert(IsExprContainer<C>::value, "Lazy() takes a vector or matrix");
+  return ExprTerminal<C>{container};
+}
+
+/* operators */
+
+template <typename A, typename = std::enable_if_t<IsLazyOperand<A>::value>>
+auto operator-(const A& arg) {
+  return makeUnary_<ExprNeg>(arg);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<kIsLazyBinary<L, R>>>
+auto operator+(const L& lhs, const R& rhs) {
+  return makeBinary_<ExprAdd>(lhs, rhs);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<kIsLazyBinary<L, R>>>
+auto operator-(const L& lhs, const R& rhs) {
+  return makeBinary_<ExprSub>(lhs, rhs);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<kIsLazyBinary<L, R>>>
+auto operator*(const L& lhs, const R& rhs) {
+  return makeBinary_<ExprMul>(lhs, rhs);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<kIsLazyBinary<L, R>>>
+auto operator/(const L& lhs, const R& rhs) {
+  return makeBinary_<ExprDiv>(lhs, rhs);
+}
+
+/* free functions */
+
+template <typename A, typename = std::enable_if_t<IsLazyOperand<A>::value>>
+auto Abs(const A& arg) {
+  return makeUnary_<ExprAbs>(arg);
+}
+
+template <typename A, typename = std::enable_if_t<IsLazyOperand<A>::value>>
+auto Sqrt(const A& arg) {
+  return makeUnary_<ExprSqrt>(arg);
+}
+
+/* stream */
+
+template <typename E>
+std::ostream& operator<<(std::ostream& out, const Expr<E>& expr) {
+  return out << Evaluate(expr);
+}
+
+}  // namespace kplutl
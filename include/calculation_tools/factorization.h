@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "vector_rt.h"
+#include "matrix_rt.h"
+#include "linear_algebra.h"
+#include "portable.h"
+#include "thread_pool.h"
+
+/*
+    Dense LU (partial pivoting) and Cholesky factorizations of runtime-sized square matrices, and
+    solves that reuse one factorization for any number of right-hand sides. Both factorizations are
+    blocked and right-looking. A panel `block` columns wide is factored by an unblocked kernel. The
+    rows right of the panel are solved against its triangle. The trailing matrix is then updated by
+    one GEMM of depth `block`, which does nearly all of the arithmetic and is split over threads by
+    rows. Solves run both triangular solves blocked the same way, with the right-hand sides split
+    over threads by columns.
+*/
+
+namespace kplutl {
+// panel width, deep enough for the trailing GEMM to run near its peak
+constexpr size_t kFactorBlock = 128;
+// rows (columns for solves) per thread, see threadsFor_
+constexpr size_t kFactorGrain = 64;
+
+struct FactorOptions {
+  // panel width, 0 takes kFactorBlock
+  size_t block = 0;
+  // 0 takes up to ThreadCount() threads but at most one per kFactorGrain rows
+  size_t threads = 0;
+};
+
+// P A = L U with unit lower triangular L and upper triangular U
+template <typename T>
+struct LuFactorization {
+  MatrixRT<T> factors;          // L strictly below the diagonal, U on and above it
+  AlignedArray<size_t> pivots;  // row i was swapped with row pivots[i], for i in increasing order
+  bool singular = false;        // U has a zero on its diagonal, solves divide by it
+};
+
+// A = L L^T with lower triangular L, for symmetric positive definite A
+template <typename T>
+struct CholeskyFactorization {
+  MatrixRT<T> factors;  // L on and below the diagonal, L^T above it
+  // false when a pivot was not positive; factors is then only partly computed
+  bool positive_definite = false;
+};
+
+/* inline functions */
+
+inline size_t factorBlock_(const FactorOptions& options) {
+  return options.block != 0 ? options.block : kFactorBlock;
+}
+
+// Runs fn(begin, end) over [0, len) split into contiguous ranges, one per thread, on the thread
+// pool. Ranges start on kAlignment boundaries. `triangular` sizes the ranges for a cost per index
+// that falls linearly to zero, like the rows of an update that only touches the upper triangle.
+template <typename T, typename F>
+void factorRanges_(const size_t len, const size_t threads, const bool triangular, const F& fn) {
+  const size_t parts = threadsFor_(len, kFactorGrain, threads);
+  const auto start = [&](const size_t part) {
+    double fraction = double(part) / double(parts);
+    if (triangular) fraction = 1.0 - std::sqrt(1.0 - fraction);
+    return size_t(fraction * double(len));
+  };
+  parallelRanges_(
+      len, parts, PaddedLength<T>(1), start, [&](size_t, const size_t begin, const size_t end) {
+        if (begin < end) fn(begin, end);
+      });
+}
+
+template <typename T>
+inline void triangularSolve_(
+    const size_t m, const size_t n, const T* mat_a, const size_t lda, T* mat_b, const size_t ldb,
+    const std::uint32_t flags) {
+  CT_PROFILE_BEGIN(MatrixTriangularSolve);
+#ifdef ENABLE_ISPC
+  ispc::MatrixTriangularSolve(m, n, mat_a, lda, mat_b, ldb, flags);
+#else
+  portable::MatrixTriangularSolve<T>(m, n, mat_a, lda, mat_b, ldb, flags);
+#endif
+  CT_PROFILE_END(MatrixTriangularSolve, m * n, (m * m / 2 + 2 * m * n) * sizeof(T));
+}
+
+template <typename T>
+inline void luPanel_(
+    T* mat, const size_t rows, const size_t cols, const size_t ld, std::uint64_t* pivots) {
+  CT_PROFILE_BEGIN(MatrixLuPanel);
+#ifdef ENABLE_ISPC
+  ispc::MatrixLuPanel(mat, rows, cols, ld, pivots);
+#else
+  portable::MatrixLuPanel<T>(mat, rows, cols, ld, pivots);
+#endif
+  CT_PROFILE_END(MatrixLuPanel, rows * cols, 2 * rows * cols * sizeof(T));
+}
+
+// true when the block was positive definite
+template <typename T>
+inline bool choleskyBlock_(T* mat, const size_t dim, const size_t ld) {
+  std::uint64_t info = 0;
+  CT_PROFILE_BEGIN(MatrixCholeskyBlock);
+#ifdef ENABLE_ISPC
+  ispc::MatrixCholeskyBlock(mat, dim, ld, &info);
+#else
+  portable::MatrixCholeskyBlock<T>(mat, dim, ld, &info);
+#endif
+  CT_PROFILE_END(MatrixCholeskyBlock, dim * dim, dim * dim * sizeof(T));
+  return info == dim;
+}
+
+template <typename T>
+inline void transposeBlock_(
+    T* mat_out, const T* mat_arg, const size_t rows, const size_t cols, const size_t ld_out,
+    const size_t ld_arg) {
+  CT_PROFILE_BEGIN(MatrixTranspose);
+#ifdef ENABLE_ISPC
+  ispc::MatrixTranspose(mat_out, mat_arg, rows, cols, ld_out, ld_arg);
+#else
+  portable::MatrixTranspose<T>(mat_out, mat_arg, rows, cols, ld_out, ld_arg);
+#endif
+  CT_PROFILE_END(MatrixTranspose, rows * cols, 2 * rows * cols * sizeof(T));
+}
+
+// Solves A X = B in place of the dim x n B for the triangular A selected by `flags`, `block` rows
+// at a time: each diagonal block is solved by the kernel and one GEMM removes the solved rows from
+// the rows still to solve.
+template <typename T>
+void triangularSolveBlocked_(
+    const size_t dim, const size_t n, const T* mat_a, const size_t lda, T* mat_b,
+    const size_t ldb, const std::uint32_t flags, const size_t block) {
+  const bool upper = flags & kTriangularUpper;
+  for (size_t done = 0; done < dim; done += block) {
+    const size_t kb = std::min(block, dim - done);
+    const size_t k = upper ? dim - done - kb : done;
+    const T* a_kk = mat_a + k * lda + k;
+    T* b_k = mat_b + k * ldb;
+    triangularSolve_(kb, n, a_kk, lda, b_k, ldb, flags);
+    if (upper && k > 0) {
+      matrixGemm_(k, n, kb, T(-1), mat_a + k, lda, b_k, ldb, T(1), mat_b, ldb);
+    } else if (!upper && k + kb < dim) {
+      matrixGemm_(
+          dim - k - kb, n, kb, T(-1), a_kk + kb * lda, lda, b_k, ldb, T(1), b_k + kb * ldb, ldb);
+    }
+  }
+}
+
+// forward and back substitution of the n columns of B, split over threads
+template <typename T>
+void factorSolve_(
+    const MatrixRT<T>& factors, const AlignedArray<size_t>* pivots, const std::uint32_t lower_flags,
+    T* mat_b, const size_t n, const size_t ldb, const FactorOptions& options) {
+  const size_t dim = factors.rows();
+  const size_t block = factorBlock_(options);
+  factorRanges_<T>(n, options.threads, false, [&](const size_t begin, const size_t end) {
+    T* cols = mat_b + begin;
+    const size_t width = end - begin;
+    if (pivots != nullptr) {
+      for (size_t i = 0; i < dim; ++i) {
+        const size_t pivot = (*pivots)[i];
+        if (pivot == i) continue;
+        std::swap_ranges(cols + i * ldb, cols + i * ldb + width, cols + pivot * ldb);
+      }
+    }
+    triangularSolveBlocked_<T>(dim, width, factors, factors.ld(), cols, ldb, lower_flags, block);
+    triangularSolveBlocked_<T>(
+        dim, width, factors, factors.ld(), cols, ldb, kTriangularUpper, block);
+  });
+}
+
+/* factorizations */
+
+// LU with partial pivoting of the square `mat`. A singular matrix is still factored to the end,
+// with `singular` set.
+template <typename T>
+LuFactorization<T> FactorLu(const MatrixRT<T>& mat, const FactorOptions& options = {}) {
+  static_assert(!std::is_integral_v<T>, "FactorLu needs a floating-point element type");
+  assert(mat.rows() == mat.cols());
+  LuFactorization<T> res{mat, AlignedArray<size_t>(mat.rows())};
+  MatrixRT<T>& a = res.factors;
+  const size_t dim = a.rows();
+  const size_t ld = a.ld();
+  const size_t block = factorBlock_(options);
+  ScratchArray<std::uint64_t> panel_pivots(std::min(block, dim));
+  for (size_t k = 0; k < dim; k += block) {
+    const size_t kb = std::min(block, dim - k);
+    const size_t rest = dim - k - kb;
+    luPanel_(a[k] + k, dim - k, kb, ld, panel_pivots.data());
+    // the panel kernel swapped its own columns, the ones left and right of it follow here
+    for (size_t j = 0; j < kb; ++j) {
+      const size_t pivot = k + panel_pivots[j];
+      res.pivots[k + j] = pivot;
+      if (pivot == k + j) continue;
+      std::swap_ranges(a[k + j], a[k + j] + k, a[pivot]);
+      std::swap_ranges(a[k + j] + k + kb, a[k + j] + dim, a[pivot] + k + kb);
+    }
+    if (rest == 0) break;
+
+    T* a_12 = a[k] + k + kb;
+    // U12 = L11^-1 A12
+    factorRanges_<T>(rest, options.threads, false, [&](const size_t begin, const size_t end) {
+      const std::uint32_t flags = kTriangularLower | kTriangularUnitDiagonal;
+      triangularSolve_(kb, end - begin, a[k] + k, ld, a_12 + begin, ld, flags);
+    });
+    // A22 -= L21 U12
+    factorRanges_<T>(rest, options.threads, false, [&](const size_t begin, const size_t end) {
+      T* row = a[k + kb + begin];
+      matrixGemm_(end - begin, rest, kb, T(-1), row + k, ld, a_12, ld, T(1), row + k + kb, ld);
+    });
+  }
+  for (size_t i = 0; i < dim; ++i) {
+    if (compute_t<T>(a[i][i]) == compute_t<T>(0)) res.singular = true;
+  }
+  return res;
+}
+
+// Cholesky factorization of the symmetric positive definite `mat`; only its upper triangle is
+// read. It stops at the first pivot that is not positive.
+template <typename T>
+CholeskyFactorization<T> FactorCholesky(
+    const MatrixRT<T>& mat, const FactorOptions& options = {}) {
+  static_assert(!std::is_integral_v<T>, "FactorCholesky needs a floating-point element type");
+  assert(mat.rows() == mat.cols());
+  // factored as A = U^T U in the upper triangle; every finished block of U is mirrored below the
+  // diagonal, which is where the updates read L = U^T from
+  CholeskyFactorization<T> res{mat};
+  MatrixRT<T>& a = res.factors;
+  const size_t dim = a.rows();
+  const size_t ld = a.ld();
+  const size_t block = factorBlock_(options);
+  for (size_t k = 0; k < dim; k += block) {
+    const size_t kb = std::min(block, dim - k);
+    const size_t rest = dim - k - kb;
+    if (!choleskyBlock_(a[k] + k, kb, ld)) return res;
+    if (rest == 0) break;
+
+    T* a_12 = a[k] + k + kb;
+    // U12 = U11^-T A12, with U11^T already below the diagonal of the block
+    factorRanges_<T>(rest, options.threads, false, [&](const size_t begin, const size_t end) {
+      triangularSolve_(kb, end - begin, a[k] + k, ld, a_12 + begin, ld, kTriangularLower);
+    });
+    T* a_21 = a[k + kb] + k;
+    transposeBlock_(a_21, a_12, kb, rest, ld, ld);
+    // A22 -= U12^T U12 on and above the diagonal, each `block` rows from their first column on
+    factorRanges_<T>(rest, options.threads, true, [&](const size_t begin, const size_t end) {
+      for (size_t r = begin; r < end; r += block) {
+        const size_t rows = std::min(block, end - r);
+        T* row = a_21 + r * ld;
+        matrixGemm_(rows, rest - r, kb, T(-1), row, ld, a_12 + r, ld, T(1), row + kb + r, ld);
+      }
+    });
+  }
+  res.positive_definite = true;
+  return res;
+}
+
+/* solves */
+
+// x with A x = rhs
+template <typename T>
+VectorRT<T> Solve(
+    const LuFactorization<T>& lu, const VectorRT<T>& rhs, const FactorOptions& options = {}) {
+  assert(rhs.size() == lu.factors.rows());
+  VectorRT<T> res = rhs;
+  factorSolve_<T>(
+      lu.factors, &lu.pivots, kTriangularLower | kTriangularUnitDiagonal, res, 1, 1, options);
+  return res;
+}
+
+template <typename T>
+VectorRT<T> Solve(
+    const CholeskyFactorization<T>& cholesky, const VectorRT<T>& rhs,
+    const FactorOptions& options = {}) {
+  assert(cholesky.positive_definite && rhs.size() == cholesky.factors.rows());
+  VectorRT<T> res = rhs;
+  factorSolve_<T>(cholesky.factors, nullptr, kTriangularLower, res, 1, 1, options);
+  return res;
+}
+
+// X with A X = rhs, one right-hand side per column of rhs
+template <typename T>
+MatrixRT<T> SolveMany(
+    const LuFactorization<T>& lu, const MatrixRT<T>& rhs, const FactorOptions& options = {}) {
+  assert(rhs.rows() == lu.factors.rows());
+  MatrixRT<T> res = rhs;
+  factorSolve_<T>(
+      lu.factors, &lu.pivots, kTriangularLower | kTriangularUnitDiagonal, res, res.cols(),
+      res.ld(), options);
+  return res;
+}
+
+template <typename T>
+MatrixRT<T> SolveMany(
+    const CholeskyFactorization<T>& cholesky, const MatrixRT<T>& rhs,
+    const FactorOptions& options = {}) {
+  assert(cholesky.positive_definite && rhs.rows() == cholesky.factors.rows());
+  MatrixRT<T> res = rhs;
+  factorSolve_<T>(
+      cholesky.factors, nullptr, kTriangularLower, res, res.cols(), res.ld(), options);
+  return res;
+}
+
+// x with mat x = rhs for one right-hand side; factor once with FactorLu to solve for several
+template <typename T>
+VectorRT<T> Solve(
+    const MatrixRT<T>& mat, const VectorRT<T>& rhs, const FactorOptions& options = {}) {
+  return Solve(FactorLu(mat, options), rhs, options);
+}
+
+}  // namespace kplutl
@@ -1,26 +1,55 @@
 #pragma once
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
 #include "vector.h"
 #include "matrix.h"
 #include "linear_algebra.h"
+#include "quaternion.h"
+#include "vector_stream.h"
+#include "profile.h"
+#include "thread_pool.h"
 
 /*
     Y-up
 */
 
 namespace kplutl {
-template <class T>
-class Quaternion : public VectorCT<T, 4> {
- public:
-  using VectorCT<T, 4>::VectorCT;
-
-  const T x() const { return this->data_[0]; }
-  const T y() const { return this->data_[1]; }
-  const T z() const { return this->data_[2]; }
-  const T w() const { return this->data_[3]; }
+// Window-space mapping applied after the perspective divide, NDC is [-1, 1] on every axis.
+template <typename T>
+struct Viewport {
+  T x = 0;
+  T y = 0;
+  T width = 1;
+  T height = 1;
+  T min_depth = 0;
+  T max_depth = 1;
 };
 
+// Planes of a view frustum, see ExtractFrustum.
+enum FrustumPlane : std::uint32_t {
+  kFrustumLeft = 0,
+  kFrustumRight = 1,
+  kFrustumBottom = 2,
+  kFrustumTop = 3,
+  kFrustumNear = 4,
+  kFrustumFar = 5,
+};
+
+// Six planes (a, b, c, d) indexed by FrustumPlane, inside where a x + b y + c z + d >= 0. Normals
+// are unit length, so the left side is the signed distance to the plane.
 template <typename T>
-MatrixCT<T, 4, 4> BuildTranslationMatrix(const T xAxis, const T yAxis, const T zAxis) {
+struct Frustum {
+  compute_t<T> planes[6][4];
+};
+
+template <typename T>
+constexpr MatrixCT<T, 4, 4> BuildTranslationMatrix(const T xAxis, const T yAxis, const T zAxis) {
   return MatrixCT<T, 4, 4>{
       {1, 0, 0, xAxis},
       {0, 1, 0, yAxis},
@@ -30,7 +59,7 @@ MatrixCT<T, 4, 4> BuildTranslationMatrix(const T xAxis, const T yAxis, const T z
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildScaleMatrix(const T xAxis, const T yAxis, const T zAxis) {
+constexpr MatrixCT<T, 4, 4> BuildScaleMatrix(const T xAxis, const T yAxis, const T zAxis) {
   return MatrixCT<T, 4, 4>{
       {xAxis, 0,     0,     0},
       {0,     yAxis, 0,     0},
@@ -40,9 +69,9 @@ MatrixCT<T, 4, 4> BuildScaleMatrix(const T xAxis, const T yAxis, const T zAxis)
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildRotationMatrixX(const T angel) {
-  T sinAngel = std::sin(angel);
-  T cosAngel = std::cos(angel);
+constexpr MatrixCT<T, 4, 4> BuildRotationMatrixX(const T angel) {
+  T sinAngel = portable::sin_(angel);
+  T cosAngel = portable::cos_(angel);
 
   return MatrixCT<T, 4, 4>{
       {1, 0,        0,         0},
@@ -53,9 +82,9 @@ MatrixCT<T, 4, 4> BuildRotationMatrixX(const T angel) {
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildRotationMatrixY(const T angel) {
-  T sinAngel = std::sin(angel);
-  T cosAngel = std::cos(angel);
+constexpr MatrixCT<T, 4, 4> BuildRotationMatrixY(const T angel) {
+  T sinAngel = portable::sin_(angel);
+  T cosAngel = portable::cos_(angel);
 
   return MatrixCT<T, 4, 4>{
       {cosAngel,  0, sinAngel, 0},
@@ -66,9 +95,9 @@ MatrixCT<T, 4, 4> BuildRotationMatrixY(const T angel) {
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildRotationMatrixZ(const T angel) {
-  T sinAngel = std::sin(angel);
-  T cosAngel = std::cos(angel);
+constexpr MatrixCT<T, 4, 4> BuildRotationMatrixZ(const T angel) {
+  T sinAngel = portable::sin_(angel);
+  T cosAngel = portable::cos_(angel);
 
   return MatrixCT<T, 4, 4>{
       {cosAngel, -sinAngel, 0, 0},
@@ -78,49 +107,28 @@ MatrixCT<T, 4, 4> BuildRotationMatrixZ(const T angel) {
   };
 }
 
-// template <typename T>
-// MatrixCT<T, 4, 4> BuildRotationMatrix(const T x, const T y, const T z) {
-//   T sinRoll = std::sin(x);
-//   T sinPitch = std::sin(y);
-//   T sinYaw = std::sin(z);
-//
-//   T cRoll = std::cos(x);
-//   T cPitch = std::cos(y);
-//   T cYaw = std::cos(z);
-//
-//   T r00 = cYaw * cPitch;
-//   T r01 = cYaw * sinPitch * sinRoll - sinYaw * cRoll;
-//   T r02 = cYaw * sinPitch * cRoll + sinYaw * sinRoll;
-//
-//   T r10 = sinYaw * cPitch;
-//   T r11 = sinYaw * sinPitch * sinRoll + cYaw * cRoll;
-//   T r12 = sinYaw * sinPitch * cRoll - cYaw * sinRoll;
-//
-//   T r20 = -sinPitch;
-//   T r21 = cPitch * sinRoll;
-//   T r22 = cPitch * cRoll;
-//
-//   return MatrixCT<T, 4, 4>{
-//   {r00, r01, r02, 0},
-//   {r10, r11, r12, 0},
-//   {r20, r21, r22, 0},
-//   {0,   0,   0,   1}
-//   };
-// }
-
-template <typename T>
-MatrixCT<T, 4, 4> BuildRotationMatrix(const Quaternion<T> quaternion) {
-  T r00 = 2.0 * (quaternion.w * quaternion.w + quaternion.x * quaternion.x) - 1.0;
-  T r01 = 2.0 * (quaternion.x * quaternion.y - quaternion.w * quaternion.z);
-  T r02 = 2.0 * (quaternion.x * quaternion.z + quaternion.w * quaternion.y);
-
-  T r10 = 2.0 * (quaternion.x * quaternion.y + quaternion.w * quaternion.z);
-  T r11 = 2.0 * (quaternion.w * quaternion.w + quaternion.y * quaternion.y) - 1.0;
-  T r12 = 2.0 * (quaternion.y * quaternion.z - quaternion.w * quaternion.x);
-
-  T r20 = 2.0 * (quaternion.x * quaternion.z - quaternion.w * quaternion.y);
-  T r21 = 2.0 * (quaternion.y * quaternion.z + quaternion.w * quaternion.x);
-  T r22 = 2.0 * (quaternion.w * quaternion.w + quaternion.z * quaternion.z) - 1.0;
+// Rz(z) * Ry(y) * Rx(x): x (roll) applies first, z (yaw) last
+template <typename T>
+constexpr MatrixCT<T, 4, 4> BuildRotationMatrix(const T x, const T y, const T z) {
+  T sinRoll = portable::sin_(x);
+  T sinPitch = portable::sin_(y);
+  T sinYaw = portable::sin_(z);
+
+  T cosRoll = portable::cos_(x);
+  T cosPitch = portable::cos_(y);
+  T cosYaw = portable::cos_(z);
+
+  T r00 = cosYaw * cosPitch;
+  T r01 = cosYaw * sinPitch * sinRoll - sinYaw * cosRoll;
+  T r02 = cosYaw * sinPitch * cosRoll + sinYaw * sinRoll;
+
+  T r10 = sinYaw * cosPitch;
+  T r11 = sinYaw * sinPitch * sinRoll + cosYaw * cosRoll;
+  T r12 = sinYaw * sinPitch * cosRoll - cosYaw * sinRoll;
+
+  T r20 = -sinPitch;
+  T r21 = cosPitch * sinRoll;
+  T r22 = cosPitch * cosRoll;
 
   return MatrixCT<T, 4, 4>{
       {r00, r01, r02, 0},
@@ -131,7 +139,7 @@ MatrixCT<T, 4, 4> BuildRotationMatrix(const Quaternion<T> quaternion) {
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildViewMatrixRH(
+constexpr MatrixCT<T, 4, 4> BuildViewMatrixRH(
     const VectorCT<T, 3> eye, const VectorCT<T, 3> target, const VectorCT<T, 3> up) {
   VectorCT<T, 3> xAxis, yAxis, zAxis;
 
@@ -148,7 +156,7 @@ MatrixCT<T, 4, 4> BuildViewMatrixRH(
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildViewMatrixLH(
+constexpr MatrixCT<T, 4, 4> BuildViewMatrixLH(
     const VectorCT<T, 3> eye, const VectorCT<T, 3> target, const VectorCT<T, 3> up) {
   VectorCT<T, 3> xAxis, yAxis, zAxis;
 
@@ -165,7 +173,7 @@ MatrixCT<T, 4, 4> BuildViewMatrixLH(
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildOrthographicProjectionMatrixRH(
+constexpr MatrixCT<T, 4, 4> BuildOrthographicProjectionMatrixRH(
     const T rightPlane, const T leftPlane, const T topPlane, const T bottomPlane, const T nearPlane,
     const T farPlane) {
   T width = rightPlane - leftPlane;
@@ -181,7 +189,7 @@ MatrixCT<T, 4, 4> BuildOrthographicProjectionMatrixRH(
 }
 
 template <typename T>
-MatrixCT<T, 4, 4> BuildPerspectiveProjectionMatrixRH(
+constexpr MatrixCT<T, 4, 4> BuildPerspectiveProjectionMatrixRH(
     const T rightPlane, const T leftPlane, const T topPlane, const T bottomPlane, const T nearPlane,
     const T farPlane) {
   T width = rightPlane - leftPlane;
@@ -198,4 +206,359 @@ MatrixCT<T, 4, 4> BuildPerspectiveProjectionMatrixRH(
   };
 }
 
+/* batch rotation builders */
+
+// below this many matrices per task the rotations are built on the calling thread
+constexpr size_t kRotationGrain = 8192;
+
+template <typename T>
+inline void rotationFromEulerSoA_(
+    T* mat_out, const T* const angle[3], const size_t count, const std::uint32_t flags) {
+  CT_PROFILE_BEGIN(RotationFromEulerSoA);
+#ifdef ENABLE_ISPC
+  ispc::RotationFromEulerSoA(mat_out, angle, count, flags);
+#else
+  portable::RotationFromEulerSoA<T>(mat_out, angle, count, flags);
+#endif
+  CT_PROFILE_END(
+      RotationFromEulerSoA, count, (flags & kRotationAffine ? 15 : 19) * count * sizeof(T));
+}
+
+template <typename T>
+inline void rotationFromAxisAngleSoA_(
+    T* mat_out, const T* const axis[3], const T* angle, const size_t count,
+    const std::uint32_t flags) {
+  CT_PROFILE_BEGIN(RotationFromAxisAngleSoA);
+#ifdef ENABLE_ISPC
+  ispc::RotationFromAxisAngleSoA(mat_out, axis, angle, count, flags);
+#else
+  portable::RotationFromAxisAngleSoA<T>(mat_out, axis, angle, count, flags);
+#endif
+  CT_PROFILE_END(
+      RotationFromAxisAngleSoA, count, (flags & kRotationAffine ? 16 : 20) * count * sizeof(T));
+}
+
+// Runs the Euler builder, or the axis-angle one when `angle` is set, over ranges of the stream on
+// the thread pool. `stride` is 16 for 4x4 and 12 for 3x4 matrices.
+template <typename T>
+void rotationRanges_(
+    const VectorStream<T, 3>& vec, const T* angle, void* mat_out, const size_t stride,
+    const std::uint32_t flags) {
+  const size_t count = vec.size();
+  ParallelFor(count, kRotationGrain, PaddedLength<T>(1), [&](const size_t begin, const size_t end) {
+    const T* const comps[3]{vec[0] + begin, vec[1] + begin, vec[2] + begin};
+    T* mat = static_cast<T*>(mat_out) + stride * begin;
+    if (angle == nullptr) {
+      rotationFromEulerSoA_<T>(mat, comps, end - begin, flags);
+    } else {
+      rotationFromAxisAngleSoA_<T>(mat, comps, angle + begin, end - begin, flags);
+    }
+  });
+}
+
+// BuildRotationMatrix(euler.x, euler.y, euler.z) for every angle triple of the stream, written to
+// mat_out[0, euler.size()). kRotationFast trades the math library's sine and cosine for a
+// polynomial good to 1e-7 absolute in float for angles below 1e4 in magnitude.
+template <typename T>
+void BuildRotationMatrix(
+    const VectorStream<T, 3>& euler, MatrixCT<T, 4, 4> mat_out[],
+    const std::uint32_t flags = kRotationDefault) {
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  rotationRanges_<T>(euler, nullptr, mat_out, 16, flags & ~kRotationAffine);
+}
+
+// the same as affine 3x4 matrices, without the constant last row
+template <typename T>
+void BuildRotationMatrix(
+    const VectorStream<T, 3>& euler, MatrixCT<T, 3, 4> mat_out[],
+    const std::uint32_t flags = kRotationDefault) {
+  static_assert(sizeof(MatrixCT<T, 3, 4>) == 12 * sizeof(T), "3x4 matrices have to be dense");
+  rotationRanges_<T>(euler, nullptr, mat_out, 12, flags | kRotationAffine);
+}
+
+// Rotations by angle[i] around the unit axis[i], the same as
+// BuildRotationMatrix(BuildQuaternion(axis[i], angle[i])), for axis.size() matrices. See the
+// Euler version for the flags.
+template <typename T>
+void BuildRotationMatrix(
+    const VectorStream<T, 3>& axis, const T angle[], MatrixCT<T, 4, 4> mat_out[],
+    const std::uint32_t flags = kRotationDefault) {
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  rotationRanges_<T>(axis, angle, mat_out, 16, flags & ~kRotationAffine);
+}
+
+template <typename T>
+void BuildRotationMatrix(
+    const VectorStream<T, 3>& axis, const T angle[], MatrixCT<T, 3, 4> mat_out[],
+    const std::uint32_t flags = kRotationDefault) {
+  static_assert(sizeof(MatrixCT<T, 3, 4>) == 12 * sizeof(T), "3x4 matrices have to be dense");
+  rotationRanges_<T>(axis, angle, mat_out, 12, flags | kRotationAffine);
+}
+
+/* frustum culling */
+
+// Planes bounding the points that `view_projection` (projection * view) maps into the clip volume
+// -w <= x, y, z <= w, the NDC cube of the projections above. Planes that vanish, like the far
+// plane of an infinite projection, come out as (0, 0, 0, d) and cull nothing.
+template <typename T>
+constexpr Frustum<T> ExtractFrustum(const MatrixCT<T, 4, 4>& view_projection) {
+  static_assert(!std::is_integral_v<T>, "frustum planes need a floating-point type");
+  using C = compute_t<T>;
+  Frustum<T> res{};
+  for (size_t axis = 0; axis < 3; ++axis) {
+    for (size_t c = 0; c < 4; ++c) {
+      const C w = static_cast<C>(view_projection[3][c]);
+      const C value = static_cast<C>(view_projection[axis][c]);
+      res.planes[2 * axis][c] = w + value;
+      res.planes[2 * axis + 1][c] = w - value;
+    }
+  }
+  for (auto& plane : res.planes) {
+    const C len = portable::sqrt_(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    if (len == C(0)) continue;
+    for (C& value : plane) value /= len;
+  }
+  return res;
+}
+
+template <typename T>
+inline void cullAabb_(
+    std::uint32_t* out, std::uint64_t* out_count, const Frustum<T>& frustum,
+    const T* const aabb_min[3], const T* const aabb_max[3], const size_t first,
+    const size_t count) {
+  const compute_t<T>* planes = frustum.planes[0];
+  CT_PROFILE_BEGIN(CullAabbSoA);
+#ifdef ENABLE_ISPC
+  ispc::CullAabbSoA(out, out_count, planes, aabb_min, aabb_max, first, count);
+#else
+  portable::CullAabbSoA<T>(out, out_count, planes, aabb_min, aabb_max, first, count);
+#endif
+  CT_PROFILE_END(CullAabbSoA, count, 6 * count * sizeof(T));
+}
+
+template <typename T>
+inline void cullSphere_(
+    std::uint32_t* out, std::uint64_t* out_count, const Frustum<T>& frustum,
+    const T* const sphere[4], const size_t first, const size_t count) {
+  const compute_t<T>* planes = frustum.planes[0];
+  CT_PROFILE_BEGIN(CullSphereSoA);
+#ifdef ENABLE_ISPC
+  ispc::CullSphereSoA(out, out_count, planes, sphere, first, count);
+#else
+  portable::CullSphereSoA<T>(out, out_count, planes, sphere, first, count);
+#endif
+  CT_PROFILE_END(CullSphereSoA, count, 4 * count * sizeof(T));
+}
+
+// Runs cull(begin, end, out, found) over ranges of [0, count) on the thread pool. Every range
+// writes its visible indices from visible + begin on; the lists are then moved together in range
+// order, so the result is the same as one pass over all objects.
+template <typename T, typename F>
+size_t cullRanges_(const size_t count, std::uint32_t* visible, const F& cull) {
+  assert(count <= std::numeric_limits<std::uint32_t>::max());
+  if (count == 0) return 0;
+  const size_t grain = ParallelGrain();
+  const size_t ranges =
+      count < 2 * grain ? 1 : std::min(count / grain, ThreadCount() * kParallelTasksPerThread);
+  const size_t step = PaddedLength<T>((count + ranges - 1) / ranges);
+  const size_t parts = (count + step - 1) / step;
+  ScratchArray<std::uint64_t> found(parts);
+  ParallelTasks(parts, [&](const size_t i) {
+    const size_t begin = i * step;
+    cull(begin, std::min(begin + step, count), visible + begin, &found[i]);
+  });
+  size_t res = found[0];
+  for (size_t i = 1; i < parts; ++i) {
+    std::copy_n(visible + i * step, found[i], visible + res);
+    res += found[i];
+  }
+  return res;
+}
+
+// Writes the indices of the boxes [aabb_min[i], aabb_max[i]] that may intersect `frustum` to
+// `visible`, in increasing order, and returns their number. `visible` needs room for
+// aabb_min.size() indices, not just the visible ones: the threads write their ranges' indices
+// from visible + begin before they are moved together. A box is only culled when it lies outside
+// one plane, so some boxes near the frustum edges pass.
+template <typename T>
+size_t CullAabbs(
+    const Frustum<T>& frustum, const VectorStream<T, 3>& aabb_min,
+    const VectorStream<T, 3>& aabb_max, std::uint32_t* visible) {
+  assert(aabb_min.size() == aabb_max.size());
+  const auto min_comps = aabb_min.Components();
+  const auto max_comps = aabb_max.Components();
+  return cullRanges_<T>(
+      aabb_min.size(), visible,
+      [&](const size_t begin, const size_t end, std::uint32_t* out, std::uint64_t* found) {
+        const T* const min_range[3]{min_comps[0] + begin, min_comps[1] + begin,
+                                    min_comps[2] + begin};
+        const T* const max_range[3]{max_comps[0] + begin, max_comps[1] + begin,
+                                    max_comps[2] + begin};
+        cullAabb_(out, found, frustum, min_range, max_range, begin, end - begin);
+      });
+}
+
+template <typename T>
+std::vector<std::uint32_t> CullAabbs(
+    const Frustum<T>& frustum, const VectorStream<T, 3>& aabb_min,
+    const VectorStream<T, 3>& aabb_max) {
+  std::vector<std::uint32_t> res(aabb_min.size());
+  res.resize(CullAabbs(frustum, aabb_min, aabb_max, res.data()));
+  return res;
+}
+
+// Same as CullAabbs for spheres stored as (x, y, z, radius); `visible` needs room for
+// spheres.size() indices.
+template <typename T>
+size_t CullSpheres(
+    const Frustum<T>& frustum, const VectorStream<T, 4>& spheres, std::uint32_t* visible) {
+  const auto comps = spheres.Components();
+  return cullRanges_<T>(
+      spheres.size(), visible,
+      [&](const size_t begin, const size_t end, std::uint32_t* out, std::uint64_t* found) {
+        const T* const range[4]{comps[0] + begin, comps[1] + begin, comps[2] + begin,
+                                comps[3] + begin};
+        cullSphere_(out, found, frustum, range, begin, end - begin);
+      });
+}
+
+template <typename T>
+std::vector<std::uint32_t> CullSpheres(
+    const Frustum<T>& frustum, const VectorStream<T, 4>& spheres) {
+  std::vector<std::uint32_t> res(spheres.size());
+  res.resize(CullSpheres(frustum, spheres, res.data()));
+  return res;
+}
+
+/* batch projection */
+
+// Transforms SoA vertices to clip space and divides by w in the same pass. `out_w` keeps the
+// clip-space w when not null.
+template <typename T>
+void ProjectSoA(
+    const MatrixCT<T, 4, 4>& mat, const T* in_x, const T* in_y, const T* in_z,
+    const non_deduced_t<T>* in_w, T* out_x, T* out_y, T* out_z, non_deduced_t<T>* out_w,
+    const size_t count) {
+  vertexTransformSoA_(
+      mat, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count, kVertexPerspectiveDivide,
+      static_cast<const T*>(nullptr));
+}
+
+template <typename T>
+void ProjectSoA(
+    const MatrixCT<T, 4, 4>& mat, const T* in_x, const T* in_y, const T* in_z,
+    const non_deduced_t<T>* in_w, T* out_x, T* out_y, T* out_z, non_deduced_t<T>* out_w,
+    const size_t count, const Viewport<T>& viewport) {
+  const T viewport_arr[6]{viewport.x,      viewport.y,         viewport.width,
+                          viewport.height, viewport.min_depth, viewport.max_depth};
+  vertexTransformSoA_(
+      mat, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count,
+      kVertexPerspectiveDivide | kVertexViewportMapping, viewport_arr);
+}
+
+template <typename T>
+void ProjectAoS(
+    const MatrixCT<T, 4, 4>& mat, const T* vec_in, const size_t in_stride, const size_t in_comps,
+    T* vec_out, const size_t out_stride, const size_t count) {
+  assert(in_comps == 3 || in_comps == 4);
+  assert(in_stride >= in_comps && out_stride >= 4);
+  vertexTransformAoS_(
+      mat, vec_in, in_stride, in_comps, vec_out, out_stride, count, kVertexPerspectiveDivide,
+      static_cast<const T*>(nullptr));
+}
+
+template <typename T>
+void ProjectAoS(
+    const MatrixCT<T, 4, 4>& mat, const T* vec_in, const size_t in_stride, const size_t in_comps,
+    T* vec_out, const size_t out_stride, const size_t count, const Viewport<T>& viewport) {
+  assert(in_comps == 3 || in_comps == 4);
+  assert(in_stride >= in_comps && out_stride >= 4);
+  const T viewport_arr[6]{viewport.x,      viewport.y,         viewport.width,
+                          viewport.height, viewport.min_depth, viewport.max_depth};
+  vertexTransformAoS_(
+      mat, vec_in, in_stride, in_comps, vec_out, out_stride, count,
+      kVertexPerspectiveDivide | kVertexViewportMapping, viewport_arr);
+}
+
+/* skinning */
+
+// below this many vertices per task a mesh is skinned on the calling thread
+constexpr size_t kSkinGrain = 4096;
+
+template <typename T>
+inline void skinSoA_(
+    T* const pos_out[3], T* const normal_out[3], const T* palette,
+    const std::uint32_t* const bone[4], const T* const weight[4], const T* const pos_in[3],
+    const T* const normal_in[3], const size_t count) {
+  CT_PROFILE_BEGIN(SkinSoA);
+#ifdef ENABLE_ISPC
+  ispc::SkinSoA(pos_out, normal_out, palette, bone, weight, pos_in, normal_in, count);
+#else
+  portable::SkinSoA<T>(pos_out, normal_out, palette, bone, weight, pos_in, normal_in, count);
+#endif
+  CT_PROFILE_END(
+      SkinSoA, count, count * (4 * sizeof(std::uint32_t) + (normal_in ? 16 : 10) * sizeof(T)));
+}
+
+// Runs the kernel over ranges of the vertices on the thread pool; the normals may be null.
+template <typename T>
+void skinRanges_(
+    const MatrixCT<T, 4, 4>* palette, const VectorStream<std::uint32_t, 4>& bones,
+    const VectorStream<T, 4>& weights, const VectorStream<T, 3>& position_in,
+    const VectorStream<T, 3>* normal_in, VectorStream<T, 3>& position_out,
+    VectorStream<T, 3>* normal_out) {
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  const T* matrices = reinterpret_cast<const T*>(palette);
+  const size_t count = position_in.size();
+  ParallelFor(count, kSkinGrain, PaddedLength<T>(1), [&](const size_t begin, const size_t end) {
+    const std::uint32_t* const bone[4]{bones[0] + begin, bones[1] + begin, bones[2] + begin,
+                                       bones[3] + begin};
+    const T* const weight[4]{weights[0] + begin, weights[1] + begin, weights[2] + begin,
+                             weights[3] + begin};
+    const T* const pos_in[3]{position_in[0] + begin, position_in[1] + begin,
+                             position_in[2] + begin};
+    T* const pos_out[3]{position_out[0] + begin, position_out[1] + begin,
+                        position_out[2] + begin};
+    if (normal_in == nullptr) {
+      skinSoA_<T>(pos_out, nullptr, matrices, bone, weight, pos_in, nullptr, end - begin);
+      return;
+    }
+    const T* const nrm_in[3]{(*normal_in)[0] + begin, (*normal_in)[1] + begin,
+                             (*normal_in)[2] + begin};
+    T* const nrm_out[3]{(*normal_out)[0] + begin, (*normal_out)[1] + begin,
+                        (*normal_out)[2] + begin};
+    skinSoA_<T>(pos_out, nrm_out, matrices, bone, weight, pos_in, nrm_in, end - begin);
+  });
+}
+
+// Linear-blend skinning in one pass: vertex i moves by sum_k weights[k][i] * palette[bones[k][i]]
+// over its four influences, unused ones with weight 0. Bone matrices have to be affine with
+// (0, 0, 0, 1) as last row. Normals go through the same blend and are renormalized, which is exact
+// for rotations and uniform scales. Large meshes are split over the thread pool. The outputs are
+// resized to the input size and may be the inputs.
+template <typename T>
+void Skin(
+    const MatrixCT<T, 4, 4>* palette, const VectorStream<std::uint32_t, 4>& bones,
+    const VectorStream<T, 4>& weights, const VectorStream<T, 3>& position_in,
+    const VectorStream<T, 3>& normal_in, VectorStream<T, 3>& position_out,
+    VectorStream<T, 3>& normal_out) {
+  const size_t count = position_in.size();
+  assert(bones.size() == count && weights.size() == count && normal_in.size() == count);
+  if (position_out.size() != count) position_out = VectorStream<T, 3>(count, kUninitialized);
+  if (normal_out.size() != count) normal_out = VectorStream<T, 3>(count, kUninitialized);
+  skinRanges_(palette, bones, weights, position_in, &normal_in, position_out, &normal_out);
+}
+
+// positions only
+template <typename T>
+void Skin(
+    const MatrixCT<T, 4, 4>* palette, const VectorStream<std::uint32_t, 4>& bones,
+    const VectorStream<T, 4>& weights, const VectorStream<T, 3>& position_in,
+    VectorStream<T, 3>& position_out) {
+  const size_t count = position_in.size();
+  assert(bones.size() == count && weights.size() == count);
+  if (position_out.size() != count) position_out = VectorStream<T, 3>(count, kUninitialized);
+  skinRanges_<T>(palette, bones, weights, position_in, nullptr, position_out, nullptr);
+}
+
 }  // namespace kplutl
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+namespace kplutl {
+// IEEE 754 binary16 storage type. Arithmetic goes through float, so an expression over Half values
+// is computed in float and rounded once when stored back; the kernels work the same way.
+struct Half {
+  std::uint16_t bits = 0;
+
+  Half() = default;
+  Half(const float value) : bits(FromFloat(value)) {}
+
+  operator float() const { return ToFloat(bits); }
+
+  Half& operator+=(const float rhs) { return *this = float(*this) + rhs; }
+  Half& operator-=(const float rhs) { return *this = float(*this) - rhs; }
+  Half& operator*=(const float rhs) { return *this = float(*this) * rhs; }
+  Half& operator/=(const float rhs) { return *this = float(*this) / rhs; }
+
+  static Half FromBits(const std::uint16_t bits) {
+    Half res;
+    res.bits = bits;
+    return res;
+  }
+
+  // round to nearest even, out of range values become infinity
+  static std::uint16_t FromFloat(const float value) {
+    std::uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const std::uint32_t sign = (x >> 16) & 0x8000u;
+    const std::uint32_t abs = x & 0x7fffffffu;
+
+    if (abs >= 0x7f800000u) return sign | (abs > 0x7f800000u ? 0x7e00u : 0x7c00u);
+    if (abs >= 0x477ff000u) return sign | 0x7c00u;  // 65520 and up round past the largest half
+    if (abs < 0x38800000u) {
+      // below 2^-14 the result is subnormal, in units of 2^-24
+      const std::uint32_t exponent = abs >> 23;
+      if (exponent < 102) return sign;
+      const std::uint32_t mantissa = (abs & 0x007fffffu) | 0x00800000u;
+      const std::uint32_t shift = 126 - exponent;
+      std::uint32_t res = mantissa >> shift;
+      const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+      const std::uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (res & 1u))) ++res;
+      return static_cast<std::uint16_t>(sign | res);
+    }
+
+    // rebias the exponent from 127 to 15, a carry out of the mantissa bumps the exponent
+    std::uint32_t res = (abs - 0x38000000u) >> 13;
+    const std::uint32_t rest = abs & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (res & 1u))) ++res;
+    return static_cast<std::uint16_t>(sign | res);
+  }
+
+  static float ToFloat(const std::uint16_t bits) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(bits & 0x8000u) << 16;
+    std::uint32_t exponent = (bits >> 10) & 0x1fu;
+    std::uint32_t mantissa = bits & 0x3ffu;
+
+    std::uint32_t x;
+    if (exponent == 0x1f) {
+      x = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+      x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+      x = sign;
+    } else {
+      // subnormal half, normal float
+      exponent = 113;
+      while ((mantissa & 0x400u) == 0) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      x = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float res;
+    std::memcpy(&res, &x, sizeof(res));
+    return res;
+  }
+};
+
+static_assert(
+    sizeof(Half) == 2 && std::is_trivially_copyable<Half>::value,
+    "Half must match the uint16 storage of the fp16 kernels");
+
+inline std::ostream& operator<<(std::ostream& out, const Half value) {
+  return out << static_cast<float>(value);
+}
+
+inline std::istream& operator>>(std::istream& in, Half& value) {
+  float res;
+  in >> res;
+  value = res;
+  return in;
+}
+
+// type the kernels do arithmetic in, Half is only a storage format
+template <typename T>
+struct ComputeType {
+  using type = T;
+};
+
+template <>
+struct ComputeType<Half> {
+  using type = float;
+};
+
+template <typename T>
+using compute_t = typename ComputeType<T>::type;
+
+}  // namespace kplutl
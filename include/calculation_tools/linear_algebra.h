@@ -1,118 +1,623 @@
 #pragma once
 
+#include <cmath>
+
+#include <algorithm>
+#include <type_traits>
+
 #include "vector.h"
 #include "matrix.h"
+#include "vector_rt.h"
+#include "matrix_rt.h"
+#include "profile.h"
+#include "portable.h"
+#include "thread_pool.h"
 
 namespace kplutl {
+// fewest C rows that one GEMM task takes, and the multiple its row ranges are cut at
+constexpr size_t kGemmRowGrain = 64;
+
 /* inline functions */
 
 template <typename T, size_t N>
-inline void vectorDot_(T& out, const VectorCT<T, N>& vec_lhs, const VectorCT<T, N>& vec_rhs) {
+constexpr void vectorDot_(T& out, const VectorCT<T, N>& vec_lhs, const VectorCT<T, N>& vec_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::VectorDotProd<T>(&out, vec_lhs, vec_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    out = B::Sum(B::Mul(B::Load(vec_lhs), B::Load(vec_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(VectorDotProd);
+#ifdef ENABLE_ISPC
+    ispc::VectorDotProd(&out, vec_lhs, vec_rhs, N);
+#else
+    portable::VectorDotProd<T>(&out, vec_lhs, vec_rhs, N);
+#endif
+    CT_PROFILE_END(VectorDotProd, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T>
+inline void vectorDot_(T& out, const VectorRT<T>& vec_lhs, const VectorRT<T>& vec_rhs) {
+  assert(vec_lhs.size() == vec_rhs.size());
+  CT_PROFILE_BEGIN(VectorDotProd);
 #ifdef ENABLE_ISPC
-  ispc::VectorDotProd(&out, vec_lhs, vec_rhs, N);
+  ispc::VectorDotProd(&out, vec_lhs, vec_rhs, vec_lhs.size());
 #else
-  VectorDotProd(out, vec_lhs, vec_rhs);
+  portable::VectorDotProd<T>(&out, vec_lhs, vec_rhs, vec_lhs.size());
 #endif
+  CT_PROFILE_END(VectorDotProd, vec_lhs.size(), 2 * vec_lhs.size() * sizeof(T));
 }
 
 template <typename T>
-inline void vectorCross_(
+constexpr void vectorCross_(
     VectorCT<T, 3>& vec_out, const VectorCT<T, 3>& vec_lhs, const VectorCT<T, 3>& vec_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::VectorCrossProdV3<T>(vec_out, vec_lhs, vec_rhs);
+  } else if constexpr (SimdBackend<T, 3>::kEnabled) {
+    using B = SimdBackend<T, 3>;
+    B::Store(vec_out, B::Cross(B::Load(vec_lhs), B::Load(vec_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(VectorCrossProdV3);
 #ifdef ENABLE_ISPC
-  ispc::VectorCrossProdV3(vec_out, vec_lhs, vec_rhs);
+    ispc::VectorCrossProdV3(vec_out, vec_lhs, vec_rhs);
 #else
-  VectorCrossV3(vec_out, vec_lhs, vec_rhs);
+    portable::VectorCrossProdV3<T>(vec_out, vec_lhs, vec_rhs);
 #endif
+    CT_PROFILE_END(VectorCrossProdV3, 3, 9 * sizeof(T));
+  }
 }
 
 template <typename T>
-inline void vertexTransform_(const MatrixCT<T, 4, 4>& mat_lhs, VectorCT<T, 4>& vec_rhs) {
+constexpr void vertexTransform_(const MatrixCT<T, 4, 4>& mat_lhs, VectorCT<T, 4>& vec_rhs) {
+  if (isConstantEvaluated_()) {
+    // constant evaluation cannot walk the rows as one flat array
+    VectorCT<T, 4> res;
+    for (size_t r = 0; r < 4; ++r) vectorDot_(res[r], mat_lhs[r], vec_rhs);
+    vec_rhs = res;
+  } else if constexpr (SimdBackend<T, 4>::kEnabled) {
+    using B = SimdBackend<T, 4>;
+    B::Store(vec_rhs, B::Transform(mat_lhs, B::Load(vec_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(VectorTransformV4);
 #ifdef ENABLE_ISPC
-  ispc::VectorTransformV4(mat_lhs, vec_rhs);
+    ispc::VectorTransformV4(mat_lhs, vec_rhs);
 #else
-  VectorTransformV4(mat_lhs, vec_rhs);
+    portable::VectorTransformV4<T>(mat_lhs, vec_rhs);
 #endif
+    CT_PROFILE_END(VectorTransformV4, 4, 24 * sizeof(T));
+  }
+}
+
+template <typename T>
+inline void vertexTransformSoA_(
+    const MatrixCT<T, 4, 4>& mat_lhs, const T* in_x, const T* in_y, const T* in_z, const T* in_w,
+    T* out_x, T* out_y, T* out_z, T* out_w, const size_t count, const std::uint32_t flags,
+    const T* viewport) {
+  CT_PROFILE_BEGIN(VertexTransformSoA);
+#ifdef ENABLE_ISPC
+  ispc::VertexTransformSoA(
+      mat_lhs, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count, flags, viewport);
+#else
+  portable::VertexTransformSoA<T>(
+      mat_lhs, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count, flags, viewport);
+#endif
+  CT_PROFILE_END(VertexTransformSoA, count, 8 * count * sizeof(T));
+}
+
+template <typename T>
+inline void vertexTransformAoS_(
+    const MatrixCT<T, 4, 4>& mat_lhs, const T* vec_in, const size_t in_stride,
+    const size_t in_comps, T* vec_out, const size_t out_stride, const size_t count,
+    const std::uint32_t flags, const T* viewport) {
+  CT_PROFILE_BEGIN(VertexTransformAoS);
+#ifdef ENABLE_ISPC
+  ispc::VertexTransformAoS(
+      mat_lhs, vec_in, in_stride, in_comps, vec_out, out_stride, count, flags, viewport);
+#else
+  portable::VertexTransformAoS<T>(
+      mat_lhs, vec_in, in_stride, in_comps, vec_out, out_stride, count, flags, viewport);
+#endif
+  CT_PROFILE_END(VertexTransformAoS, count, (in_comps + 4) * count * sizeof(T));
+}
+
+template <typename T>
+inline void matrixGemm_(
+    const size_t m, const size_t n, const size_t k, const T alpha, const T* mat_a, const size_t lda,
+    const T* mat_b, const size_t ldb, const T beta, T* mat_c, const size_t ldc) {
+  CT_PROFILE_BEGIN(MatrixGemm);
+#ifdef ENABLE_ISPC
+  ispc::MatrixGemm(m, n, k, alpha, mat_a, lda, mat_b, ldb, beta, mat_c, ldc);
+#else
+  portable::MatrixGemm<T>(m, n, k, alpha, mat_a, lda, mat_b, ldb, beta, mat_c, ldc);
+#endif
+  CT_PROFILE_END(MatrixGemm, m * n, (m * k + k * n + 2 * m * n) * sizeof(T));
+}
+
+// C rows split over the thread pool, every task at least kGemmRowGrain rows and ParallelGrain()
+// multiply-adds; the blocked factorizations call matrixGemm_ as they split their work themselves
+template <typename T>
+inline void matrixGemmParallel_(
+    const size_t m, const size_t n, const size_t k, const T alpha, const T* mat_a, const size_t lda,
+    const T* mat_b, const size_t ldb, const T beta, T* mat_c, const size_t ldc) {
+  const size_t grain = std::max(kGemmRowGrain, ParallelGrain() / std::max<size_t>(n * k, 1));
+  ParallelFor(m, grain, kGemmRowGrain, [&](const size_t begin, const size_t end) {
+    matrixGemm_(
+        end - begin, n, k, alpha, mat_a + begin * lda, lda, mat_b, ldb, beta, mat_c + begin * ldc,
+        ldc);
+  });
+}
+
+// row i of the product is the sum of rhs rows weighted by lhs[i], kept in one register
+template <typename T, size_t Da, size_t Db, size_t Dc>
+inline void matrixProdSimd_(
+    MatrixCT<T, Da, Dc>& out, const MatrixCT<T, Da, Db>& lhs, const MatrixCT<T, Db, Dc>& rhs) {
+  using B = SimdBackend<T, Dc>;
+  for (size_t i = 0; i < Da; ++i) {
+    auto acc = B::Mul(B::Set(lhs[i][0]), B::Load(rhs[0]));
+    for (size_t k = 1; k < Db; ++k) acc = B::Add(acc, B::Mul(B::Set(lhs[i][k]), B::Load(rhs[k])));
+    B::Store(out[i], acc);
+  }
+}
+
+template <typename T, size_t Da, size_t Db, size_t Dc>
+constexpr void matrixProdConstexpr_(
+    MatrixCT<T, Da, Dc>& out, const MatrixCT<T, Da, Db>& lhs, const MatrixCT<T, Db, Dc>& rhs) {
+  for (size_t i = 0; i < Da; ++i) {
+    for (size_t j = 0; j < Dc; ++j) {
+      T sum = T(0);
+      for (size_t k = 0; k < Db; ++k) sum += lhs[i][k] * rhs[k][j];
+      out[i][j] = sum;
+    }
+  }
 }
 
 template <typename T, size_t D>
-inline void buildIdentity_(MatrixCT<T, D, D>& mat, const size_t n) {
+constexpr void buildIdentity_(MatrixCT<T, D, D>& mat, const size_t n) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < n; ++r) {
+      for (size_t c = 0; c < n; ++c) mat[r][c] = r == c ? T(1) : T(0);
+    }
+  } else {
+    CT_PROFILE_BEGIN(BuildIdentity);
 #ifdef ENABLE_ISPC
-  ispc::BuildIdentity(mat, n);
+    ispc::BuildIdentity(mat, n, MatrixCT<T, D, D>::kLeadingDim);
 #else
-  BuildIdentity(mat, n);
+    portable::BuildIdentity<T>(mat, n, MatrixCT<T, D, D>::kLeadingDim);
 #endif
+    CT_PROFILE_END(BuildIdentity, n * n, n * n * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixTranspose_(MatrixCT<T, COLS, ROWS>& out, const MatrixCT<T, ROWS, COLS>& mat) {
+constexpr void matrixTranspose_(MatrixCT<T, COLS, ROWS>& out, const MatrixCT<T, ROWS, COLS>& mat) {
+  constexpr size_t ld_out = MatrixCT<T, COLS, ROWS>::kLeadingDim;
+  constexpr size_t ld_arg = MatrixCT<T, ROWS, COLS>::kLeadingDim;
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) {
+      for (size_t c = 0; c < COLS; ++c) out[c][r] = mat[r][c];
+    }
+  } else {
+    CT_PROFILE_BEGIN(MatrixTranspose);
+#ifdef ENABLE_ISPC
+    ispc::MatrixTranspose(out, mat, ROWS, COLS, ld_out, ld_arg);
+#else
+    portable::MatrixTranspose<T>(out, mat, ROWS, COLS, ld_out, ld_arg);
+#endif
+    CT_PROFILE_END(MatrixTranspose, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T>
+inline void buildIdentity_(MatrixRT<T>& mat) {
+  assert(mat.rows() == mat.cols());
+  CT_PROFILE_BEGIN(BuildIdentity);
+#ifdef ENABLE_ISPC
+  ispc::BuildIdentity(mat, mat.rows(), mat.ld());
+#else
+  portable::BuildIdentity<T>(mat, mat.rows(), mat.ld());
+#endif
+  CT_PROFILE_END(BuildIdentity, mat.rows() * mat.cols(), mat.rows() * mat.cols() * sizeof(T));
+}
+
+// input rows split over the thread pool, so every task writes its own aligned columns of `out`
+template <typename T>
+inline void matrixTranspose_(MatrixRT<T>& out, const MatrixRT<T>& mat) {
+  assert(out.rows() == mat.cols() && out.cols() == mat.rows());
+  const size_t cols = mat.cols();
+  const size_t grain = std::max<size_t>(ParallelGrain() / std::max<size_t>(cols, 1), 1);
+  T* data = out;
+  ParallelFor(mat.rows(), grain, PaddedLength<T>(1), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(MatrixTranspose);
+#ifdef ENABLE_ISPC
+    ispc::MatrixTranspose(data + begin, mat[begin], end - begin, cols, out.ld(), mat.ld());
+#else
+    portable::MatrixTranspose<T>(data + begin, mat[begin], end - begin, cols, out.ld(), mat.ld());
+#endif
+    CT_PROFILE_END(MatrixTranspose, (end - begin) * cols, 2 * (end - begin) * cols * sizeof(T));
+  });
+}
+
+// dense copy in compute_t<T> that the portable inverse helpers work on
+template <typename T, size_t D>
+constexpr void matrixLoad_(compute_t<T> out[D * D], const MatrixCT<T, D, D>& mat) {
+  for (size_t r = 0; r < D; ++r) {
+    for (size_t c = 0; c < D; ++c) out[r * D + c] = static_cast<compute_t<T>>(mat[r][c]);
+  }
+}
+
+template <typename T, size_t D>
+constexpr void matrixStore_(MatrixCT<T, D, D>& out, const compute_t<T> arg[D * D]) {
+  for (size_t r = 0; r < D; ++r) {
+    for (size_t c = 0; c < D; ++c) out[r][c] = static_cast<T>(arg[r * D + c]);
+  }
+}
+
+template <typename T, size_t D>
+constexpr T matrixInversePortable_(
+    MatrixCT<T, D, D>& out, const MatrixCT<T, D, D>& mat, const std::uint32_t flags) {
+  compute_t<T> arg[D * D]{};
+  matrixLoad_(arg, mat);
+  const compute_t<T> det = portable::matrixInverse_(arg, arg, D, flags);
+  matrixStore_(out, arg);
+  return static_cast<T>(det);
+}
+
+template <typename T, size_t D>
+constexpr T matrixDeterminantPortable_(const MatrixCT<T, D, D>& mat) {
+  compute_t<T> arg[D * D]{};
+  matrixLoad_(arg, mat);
+  return static_cast<T>(portable::matrixDeterminant_(arg, D));
+}
+
+template <typename T, size_t D>
+constexpr T matrixDeterminant_(const MatrixCT<T, D, D>& mat) {
+  static_assert(D >= 2 && D <= 4, "determinant of a 2x2, 3x3 or 4x4 matrix");
+  if (isConstantEvaluated_()) {
+    return matrixDeterminantPortable_(mat);
+  } else if constexpr (SimdBackend<T, D>::kEnabled && D >= 3) {
+    return SimdBackend<T, D>::Determinant(mat);
+  } else {
+    return matrixDeterminantPortable_(mat);
+  }
+}
+
+// returns the determinant
+template <typename T, size_t D>
+constexpr T matrixInverse_(
+    MatrixCT<T, D, D>& out, const MatrixCT<T, D, D>& mat, const std::uint32_t flags) {
+  static_assert(D >= 2 && D <= 4, "inverse of a 2x2, 3x3 or 4x4 matrix");
+  static_assert(!std::is_integral_v<T>, "inverses need a floating-point element type");
+  if (isConstantEvaluated_()) {
+    return matrixInversePortable_(out, mat, flags);
+  } else if constexpr (SimdBackend<T, D>::kEnabled && D >= 3) {
+    return SimdBackend<T, D>::Inverse(out, mat, flags & kInverseTranspose);
+  } else {
+    return matrixInversePortable_(out, mat, flags);
+  }
+}
+
+template <typename T>
+constexpr void matrixInverseAffinePortable_(
+    MatrixCT<T, 4, 4>& out, const MatrixCT<T, 4, 4>& mat) {
+  compute_t<T> arg[16]{};
+  matrixLoad_(arg, mat);
+  portable::matrixInverseAffine_(arg, arg);
+  matrixStore_(out, arg);
+}
+
+template <typename T>
+constexpr void matrixInverseAffine_(MatrixCT<T, 4, 4>& out, const MatrixCT<T, 4, 4>& mat) {
+  static_assert(!std::is_integral_v<T>, "inverses need a floating-point element type");
+  if (isConstantEvaluated_()) {
+    matrixInverseAffinePortable_(out, mat);
+  } else if constexpr (SimdBackend<T, 4>::kEnabled) {
+    SimdBackend<T, 4>::InverseAffine(out, mat);
+  } else {
+    matrixInverseAffinePortable_(out, mat);
+  }
+}
+
+template <typename T, size_t D>
+inline void matrixInverseBatch_(
+    MatrixCT<T, D, D>* mat_out, T* det_out, const MatrixCT<T, D, D>* mat_in, const size_t count,
+    const std::uint32_t flags) {
+  static_assert(D >= 2 && D <= 4, "batched inverses of 2x2, 3x3 or 4x4 matrices");
+  static_assert(!std::is_integral_v<T>, "inverses need a floating-point element type");
+  constexpr size_t ld = MatrixCT<T, D, D>::kLeadingDim;
+  static_assert(sizeof(MatrixCT<T, D, D>) == D * ld * sizeof(T), "matrices have to be packed");
+  T* out = reinterpret_cast<T*>(mat_out);
+  const T* in = reinterpret_cast<const T*>(mat_in);
+  CT_PROFILE_BEGIN(MatrixInverseBatch);
+#ifdef ENABLE_ISPC
+  ispc::MatrixInverseBatch(out, det_out, in, D, ld, count, flags);
+#else
+  portable::MatrixInverseBatch<T>(out, det_out, in, D, ld, count, flags);
+#endif
+  CT_PROFILE_END(MatrixInverseBatch, count, 2 * count * sizeof(MatrixCT<T, D, D>));
+}
+
+template <typename T, size_t D>
+inline void matrixProdBatch_(
+    MatrixCT<T, D, D>* mat_out, const MatrixCT<T, D, D>* mat_lhs, const size_t lhs_step,
+    const MatrixCT<T, D, D>* mat_rhs, const size_t rhs_step, const size_t count) {
+  static_assert(D >= 2 && D <= 4, "batched products of 2x2, 3x3 or 4x4 matrices");
+  constexpr size_t ld = MatrixCT<T, D, D>::kLeadingDim;
+  static_assert(sizeof(MatrixCT<T, D, D>) == D * ld * sizeof(T), "matrices have to be packed");
+  T* out = reinterpret_cast<T*>(mat_out);
+  const T* lhs = reinterpret_cast<const T*>(mat_lhs);
+  const T* rhs = reinterpret_cast<const T*>(mat_rhs);
+  CT_PROFILE_BEGIN(MatrixProdBatch);
 #ifdef ENABLE_ISPC
-  ispc::MatrixTranspose(out, mat, ROWS, COLS);
+  ispc::MatrixProdBatch(out, lhs, rhs, D, ld, lhs_step * D * ld, rhs_step * D * ld, count);
 #else
-  MatrixTranspose(out, mat, ROWS, COLS);
+  portable::MatrixProdBatch<T>(out, lhs, rhs, D, ld, lhs_step * D * ld, rhs_step * D * ld, count);
 #endif
+  CT_PROFILE_END(MatrixProdBatch, count, 3 * count * sizeof(MatrixCT<T, D, D>));
 }
 
 /* free functions */
 
 template <typename T, size_t N>
-T DotProd(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+constexpr T DotProd(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+  T res{};
+  vectorDot_(res, lhs, rhs);
+  return res;
+}
+
+template <typename T>
+T DotProd(const VectorRT<T>& lhs, const VectorRT<T>& rhs) {
   T res;
   vectorDot_(res, lhs, rhs);
   return res;
 }
 
 template <typename T>
-T CrossProd(const VectorCT<T, 2>& lhs, const VectorCT<T, 2>& rhs) {
-  return lhs.v[0] * rhs.v[1] - lhs.v[1] * rhs.v[0];
+constexpr T CrossProd(const VectorCT<T, 2>& lhs, const VectorCT<T, 2>& rhs) {
+  return lhs[0] * rhs[1] - lhs[1] * rhs[0];
 }
 
 template <typename T>
-VectorCT<T, 3> CrossProd(const VectorCT<T, 3>& lhs, const VectorCT<T, 3>& rhs) {
+constexpr VectorCT<T, 3> CrossProd(const VectorCT<T, 3>& lhs, const VectorCT<T, 3>& rhs) {
   VectorCT<T, 3> res;
   vectorCross_(res, lhs, rhs);
   return res;
 }
 
 template <typename T, size_t N>
-T Length(const VectorCT<T, N>& vec) {
-  return (T)std::sqrt(Dot(vec, vec));
+constexpr T Length(const VectorCT<T, N>& vec) {
+  return portable::sqrt_(DotProd(vec, vec));
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> Normalize(const VectorCT<T, N>& vec) {
+constexpr VectorCT<T, N> Normalize(const VectorCT<T, N>& vec) {
   return vec / Length(vec);
 }
 
 template <typename T, size_t D>
-void BuildIdentity(MatrixCT<T, D, D>& mat) {
+constexpr void BuildIdentity(MatrixCT<T, D, D>& mat) {
   buildIdentity_(mat, D);
 }
 
 template <typename T>
-VectorCT<T, 4> Transform(const MatrixCT<T, 4, 4>& mat, const VectorCT<T, 4>& vec) {
+void BuildIdentity(MatrixRT<T>& mat) {
+  buildIdentity_(mat);
+}
+
+template <typename T>
+constexpr VectorCT<T, 4> Transform(const MatrixCT<T, 4, 4>& mat, const VectorCT<T, 4>& vec) {
   VectorCT<T, 4> res{vec};
   vertexTransform_(mat, res);
   return res;
 }
 
+/* batch transform */
+
+// Transforms `count` vertices stored as separate x/y/z/w arrays with a single kernel call.
+// `in_w` may be null (w = 1) and so may `out_w` (w is dropped).
+template <typename T>
+void TransformSoA(
+    const MatrixCT<T, 4, 4>& mat, const T* in_x, const T* in_y, const T* in_z,
+    const non_deduced_t<T>* in_w, T* out_x, T* out_y, T* out_z, non_deduced_t<T>* out_w,
+    const size_t count) {
+  vertexTransformSoA_(
+      mat, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count, kVertexTransformNone,
+      static_cast<const T*>(nullptr));
+}
+
+// Transforms `count` interleaved vertices. Strides are in elements; `in_comps` is 3 (w = 1) or 4,
+// the output always receives 4 components.
+template <typename T>
+void TransformAoS(
+    const MatrixCT<T, 4, 4>& mat, const T* vec_in, const size_t in_stride, const size_t in_comps,
+    T* vec_out, const size_t out_stride, const size_t count) {
+  assert(in_comps == 3 || in_comps == 4);
+  assert(in_stride >= in_comps && out_stride >= 4);
+  vertexTransformAoS_(
+      mat, vec_in, in_stride, in_comps, vec_out, out_stride, count, kVertexTransformNone,
+      static_cast<const T*>(nullptr));
+}
+
+template <typename T>
+void Transform(
+    const MatrixCT<T, 4, 4>& mat, const VectorCT<T, 4>* vec_in, VectorCT<T, 4>* vec_out,
+    const size_t count) {
+  constexpr size_t stride = sizeof(VectorCT<T, 4>) / sizeof(T);
+  TransformAoS(
+      mat, reinterpret_cast<const T*>(vec_in), stride, 4, reinterpret_cast<T*>(vec_out), stride,
+      count);
+}
+
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, COLS, ROWS> Transpose(const MatrixCT<T, ROWS, COLS>& mat) {
+constexpr MatrixCT<T, COLS, ROWS> Transpose(const MatrixCT<T, ROWS, COLS>& mat) {
   MatrixCT<T, COLS, ROWS> res;
   matrixTranspose_(res, mat);
   return res;
 }
 
+template <typename T>
+MatrixRT<T> Transpose(const MatrixRT<T>& mat) {
+  MatrixRT<T> res(mat.cols(), mat.rows(), kUninitialized);
+  matrixTranspose_(res, mat);
+  return res;
+}
+
+/* inverse */
+
+template <typename T, size_t D>
+constexpr T Determinant(const MatrixCT<T, D, D>& mat) {
+  return matrixDeterminant_(mat);
+}
+
+// Inverse of a 2x2, 3x3 or 4x4 floating-point matrix; singular matrices give inf or NaN. Affine
+// transforms without shear invert faster and more accurately with InverseAffine.
+template <typename T, size_t D>
+constexpr MatrixCT<T, D, D> Inverse(const MatrixCT<T, D, D>& mat) {
+  MatrixCT<T, D, D> res;
+  matrixInverse_(res, mat, kInverseDefault);
+  return res;
+}
+
+// Transpose(Inverse(mat)) in one pass
+template <typename T, size_t D>
+constexpr MatrixCT<T, D, D> InverseTranspose(const MatrixCT<T, D, D>& mat) {
+  MatrixCT<T, D, D> res;
+  matrixInverse_(res, mat, kInverseTranspose);
+  return res;
+}
+
+// Inverse of an affine transform whose upper 3x3 is a rotation times a per-axis scale, e.g. a
+// model or view matrix: the transposed 3x3 with each row divided by the squared scale, and the
+// translation mapped back through it. Shear or a projective last row need Inverse.
+template <typename T>
+constexpr MatrixCT<T, 4, 4> InverseAffine(const MatrixCT<T, 4, 4>& mat) {
+  MatrixCT<T, 4, 4> res;
+  matrixInverseAffine_(res, mat);
+  return res;
+}
+
+// Matrix for transforming normals by `mat`: the inverse transpose of its upper 3x3.
+template <typename T>
+constexpr MatrixCT<T, 3, 3> NormalMatrix(const MatrixCT<T, 4, 4>& mat) {
+  MatrixCT<T, 3, 3> upper;
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 3; ++c) upper[r][c] = mat[r][c];
+  }
+  return InverseTranspose(upper);
+}
+
+/* batch inverse */
+
+// Inverts `count` floating-point matrices in one kernel call, `mat_out` may be `mat_in`. The
+// determinants go to `det_out` unless it is null.
+template <typename T, size_t D>
+void Inverse(
+    const MatrixCT<T, D, D>* mat_in, MatrixCT<T, D, D>* mat_out, const size_t count,
+    non_deduced_t<T>* det_out = nullptr) {
+  matrixInverseBatch_(mat_out, det_out, mat_in, count, kInverseDefault);
+}
+
+template <typename T, size_t D>
+void InverseTranspose(
+    const MatrixCT<T, D, D>* mat_in, MatrixCT<T, D, D>* mat_out, const size_t count,
+    non_deduced_t<T>* det_out = nullptr) {
+  matrixInverseBatch_(mat_out, det_out, mat_in, count, kInverseTranspose);
+}
+
+template <typename T>
+void InverseAffine(
+    const MatrixCT<T, 4, 4>* mat_in, MatrixCT<T, 4, 4>* mat_out, const size_t count) {
+  static_assert(!std::is_integral_v<T>, "inverses need a floating-point element type");
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  T* out = reinterpret_cast<T*>(mat_out);
+  const T* in = reinterpret_cast<const T*>(mat_in);
+  CT_PROFILE_BEGIN(MatrixInverseAffineBatch);
+#ifdef ENABLE_ISPC
+  ispc::MatrixInverseAffineBatch(out, in, count);
+#else
+  portable::MatrixInverseAffineBatch<T>(out, in, count);
+#endif
+  CT_PROFILE_END(MatrixInverseAffineBatch, count, 32 * count * sizeof(T));
+}
+
+/* matrix product */
+
+// C = alpha * A * B + beta * C for row-major A (m x k), B (k x n) and C (m x n). Leading dimensions
+// are in elements; C must not overlap A or B.
+template <typename T>
+void Gemm(
+    const size_t m, const size_t n, const size_t k, const T alpha, const T* mat_a, const size_t lda,
+    const T* mat_b, const size_t ldb, const T beta, T* mat_c, const size_t ldc) {
+  assert(lda >= k && ldb >= n && ldc >= n);
+  matrixGemmParallel_(m, n, k, alpha, mat_a, lda, mat_b, ldb, beta, mat_c, ldc);
+}
+
 template <typename T, size_t Da, size_t Db, size_t Dc>
-MatrixCT<T, Da, Dc> MatrixProd(const MatrixCT<T, Da, Db>& lhs, const MatrixCT<T, Db, Dc>& rhs) {
+void Gemm(
+    const T alpha, const MatrixCT<T, Da, Db>& lhs, const MatrixCT<T, Db, Dc>& rhs, const T beta,
+    MatrixCT<T, Da, Dc>& out) {
+  constexpr size_t lda = MatrixCT<T, Da, Db>::kLeadingDim;
+  constexpr size_t ldb = MatrixCT<T, Db, Dc>::kLeadingDim;
+  constexpr size_t ldc = MatrixCT<T, Da, Dc>::kLeadingDim;
+  matrixGemm_<T>(Da, Dc, Db, alpha, lhs, lda, rhs, ldb, beta, out, ldc);
+}
+
+template <typename T>
+void Gemm(
+    const T alpha, const MatrixRT<T>& lhs, const MatrixRT<T>& rhs, const T beta, MatrixRT<T>& out) {
+  assert(lhs.cols() == rhs.rows() && out.rows() == lhs.rows() && out.cols() == rhs.cols());
+  matrixGemmParallel_<T>(
+      lhs.rows(), rhs.cols(), lhs.cols(), alpha, lhs, lhs.ld(), rhs, rhs.ld(), beta, out,
+      out.ld());
+}
+
+template <typename T, size_t Da, size_t Db, size_t Dc>
+constexpr MatrixCT<T, Da, Dc> MatrixProd(
+    const MatrixCT<T, Da, Db>& lhs, const MatrixCT<T, Db, Dc>& rhs) {
   MatrixCT<T, Da, Dc> res;
-  MatrixCT<T, Dc, Db> rhs_t{Transpose(rhs)};
-  for (size_t r = 0; r < Da; ++r) {
-    for (size_t c = 0; c < Dc; ++c) {
-      T tmp = DotProd(lhs.data_[r], rhs_t.data_[c]);
-      res.data_[r][c] = tmp;
-    }
+  if (isConstantEvaluated_()) {
+    matrixProdConstexpr_(res, lhs, rhs);
+  } else if constexpr (kSimdMatrix<T, Da, Dc> && Db <= 4) {
+    matrixProdSimd_(res, lhs, rhs);
+  } else {
+    Gemm(T(1), lhs, rhs, T(0), res);
   }
   return res;
 }
 
-}  // namespace kplutl
+template <typename T>
+MatrixRT<T> MatrixProd(const MatrixRT<T>& lhs, const MatrixRT<T>& rhs) {
+  MatrixRT<T> res(lhs.rows(), rhs.cols(), kUninitialized);
+  Gemm(T(1), lhs, rhs, T(0), res);
+  return res;
+}
+
+/* batch matrix product */
+
+// mat_out[i] = MatrixProd(mat_lhs[i], mat_rhs[i]) for `count` pairs in one kernel call, which
+// works on as many products at a time as the SIMD width allows. mat_out may be either input.
+template <typename T, size_t D>
+void MatrixProd(
+    const MatrixCT<T, D, D>* mat_lhs, const MatrixCT<T, D, D>* mat_rhs,
+    MatrixCT<T, D, D>* mat_out, const size_t count) {
+  matrixProdBatch_(mat_out, mat_lhs, 1, mat_rhs, 1, count);
+}
+
+// mat_out[i] = MatrixProd(lhs, mat_rhs[i]), e.g. view-projection times every model matrix.
+// mat_out may be mat_rhs but must not overlap lhs.
+template <typename T, size_t D>
+void MatrixProd(
+    const MatrixCT<T, D, D>& lhs, const MatrixCT<T, D, D>* mat_rhs, MatrixCT<T, D, D>* mat_out,
+    const size_t count) {
+  matrixProdBatch_(mat_out, &lhs, 0, mat_rhs, 1, count);
+}
+
+// mat_out[i] = MatrixProd(mat_lhs[i], rhs); mat_out may be mat_lhs but must not overlap rhs
+template <typename T, size_t D>
+void MatrixProd(
+    const MatrixCT<T, D, D>* mat_lhs, const MatrixCT<T, D, D>& rhs, MatrixCT<T, D, D>* mat_out,
+    const size_t count) {
+  matrixProdBatch_(mat_out, mat_lhs, 1, &rhs, 0, count);
+}
+
+}  // namespace kplutl
\ No newline at end of file
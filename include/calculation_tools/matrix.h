@@ -2,29 +2,36 @@
 
 #include <iostream>
 #include <initializer_list>
+#include <utility>
 
 #include "utils.h"
+#include "profile.h"
 #include "vector.h"
 
 namespace kplutl {
 template <typename T, size_t ROWS, size_t COLS>
 struct MatrixCT {
-  VectorCT<T, COLS> data_[ROWS]; // column-major
+  VectorCT<T, COLS> data_[ROWS]{};  // row-major
 
-  MatrixCT<T, ROWS, COLS>() = default;
-  MatrixCT<T, ROWS, COLS>(MatrixCT<T, ROWS, COLS>& matrixCT) = default;
-  MatrixCT<T, ROWS, COLS>& operator=(MatrixCT<T, ROWS, COLS>& matrixCT) = default;
-  MatrixCT<T, ROWS, COLS>(MatrixCT<T, ROWS, COLS>&& matrixCT) = default;
-  MatrixCT<T, ROWS, COLS>& operator=(MatrixCT<T, ROWS, COLS>&& matrixCT) = default;
+  // distance in elements between the starts of consecutive rows
+  static constexpr size_t kLeadingDim = sizeof(VectorCT<T, COLS>) / sizeof(T);
+  // elements spanned by data_, row padding included
+  static constexpr size_t kStorageLength = ROWS * kLeadingDim;
 
-  MatrixCT<T, ROWS, COLS>(T value) {
+  constexpr MatrixCT<T, ROWS, COLS>() = default;
+  constexpr MatrixCT<T, ROWS, COLS>(const MatrixCT<T, ROWS, COLS>& matrixCT) = default;
+  constexpr MatrixCT<T, ROWS, COLS>& operator=(const MatrixCT<T, ROWS, COLS>& matrixCT) = default;
+  constexpr MatrixCT<T, ROWS, COLS>(MatrixCT<T, ROWS, COLS>&& matrixCT) = default;
+  constexpr MatrixCT<T, ROWS, COLS>& operator=(MatrixCT<T, ROWS, COLS>&& matrixCT) = default;
+
+  constexpr MatrixCT<T, ROWS, COLS>(T value) {
     for (size_t r = 0; r < ROWS; ++r) {
       for (size_t c = 0; c < COLS; ++c) {
         data_[r][c] = value;
       }
     }
   }
-  MatrixCT<T, ROWS, COLS>(std::initializer_list<std::initializer_list<const T>> list) {
+  constexpr MatrixCT<T, ROWS, COLS>(std::initializer_list<std::initializer_list<const T>> list) {
     assert(list.size() == ROWS);
     size_t i = 0;
     for (auto sub_list : list) {
@@ -38,7 +45,7 @@ struct MatrixCT {
   }
 
   template <typename It>
-  MatrixCT<T, ROWS, COLS>(It first, It last) {
+  constexpr MatrixCT<T, ROWS, COLS>(It first, It last) {
     auto size = std::distance(first, last);
     assert(size == ROWS * COLS);
     auto it = first;
@@ -50,8 +57,14 @@ struct MatrixCT {
     }
   }
 
+  // evaluates a fused expression started with Lazy(), see expression.h
+  template <typename E>
+  MatrixCT<T, ROWS, COLS>(const Expr<E>& expr) {
+    Assign(*this, expr);
+  }
+
   template <typename S>
-  explicit MatrixCT<T, ROWS, COLS>(const S* source) {
+  explicit constexpr MatrixCT<T, ROWS, COLS>(const S* source) {
     for (size_t r = 0; r < ROWS; ++r) {
       for (size_t c = 0; c < COLS; ++c) {
         data_[r][c] = (T)source[r][c];
@@ -59,7 +72,7 @@ struct MatrixCT {
     }
   }
   template <typename S>
-  explicit MatrixCT<T, ROWS, COLS>(const MatrixCT<S, ROWS, COLS>& source) {
+  explicit constexpr MatrixCT<T, ROWS, COLS>(const MatrixCT<S, ROWS, COLS>& source) {
     for (size_t r = 0; r < ROWS; ++r) {
       for (size_t c = 0; c < COLS; ++c) {
         data_[r][c] = (T)source[r][c];
@@ -67,104 +80,547 @@ struct MatrixCT {
     }
   }
 
-  VectorCT<T, COLS>& operator[](int row_index) { return data_[row_index]; }
+  constexpr VectorCT<T, COLS>& operator[](int row_index) { return data_[row_index]; }
+  constexpr const VectorCT<T, COLS>& operator[](int row_index) const { return data_[row_index]; }
+
+  constexpr operator T*() { return &data_[0][0]; };
+
+  constexpr operator const T*() const { return static_cast<const T*>(&data_[0][0]); };
+
+  template <typename E>
+  MatrixCT<T, ROWS, COLS>& operator=(const Expr<E>& expr) {
+    Assign(*this, expr);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator+=(const MatrixCT<T, ROWS, COLS>& lhs) {
+    matrixAddInplace_(*this, lhs);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator+=(const T scalar) {
+    matrixAddScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator-=(const MatrixCT<T, ROWS, COLS>& lhs) {
+    matrixSubInplace_(*this, lhs);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator-=(const T scalar) {
+    matrixSubScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator*=(const MatrixCT<T, ROWS, COLS>& lhs) {
+    matrixMulInplace_(*this, lhs);
+    return *this;
+  }
 
-  operator T*() { return &data_[0][0]; };
+  constexpr MatrixCT<T, ROWS, COLS>& operator*=(const T scalar) {
+    matrixMulScalarInplace_(*this, scalar);
+    return *this;
+  }
 
-  operator const T*() const { return static_cast<const T*>(&data_[0][0]); };
+  constexpr MatrixCT<T, ROWS, COLS>& operator/=(const MatrixCT<T, ROWS, COLS>& lhs) {
+    matrixDivInplace_(*this, lhs);
+    return *this;
+  }
+
+  constexpr MatrixCT<T, ROWS, COLS>& operator/=(const T scalar) {
+    matrixDivScalarInplace_(*this, scalar);
+    return *this;
+  }
 };
 
 /* type defines */
 
 using Matrix3X3f = MatrixCT<float, 3, 3>;
 using Matrix4X4f = MatrixCT<float, 4, 4>;
+using Matrix3X3d = MatrixCT<double, 3, 3>;
+using Matrix4X4d = MatrixCT<double, 4, 4>;
 
 /* inline functions */
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixAdd_(
+constexpr void matrixAdd_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs,
+    const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAdd_(out.data_[r], in_lhs.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(AddForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddForeach(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AddForeach<T>(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AddForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSub_(
     MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs,
     const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSub_(out.data_[r], in_lhs.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(SubForeach);
 #ifdef ENABLE_ISPC
-  ispc::AddForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    ispc::SubForeach(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  AddForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    portable::SubForeach<T>(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(SubForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixSub_(
+constexpr void matrixMul_(
     MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs,
     const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorMul_(out.data_[r], in_lhs.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(MulForeach);
 #ifdef ENABLE_ISPC
-  ispc::SubForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    ispc::MulForeach(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  SubForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    portable::MulForeach<T>(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(MulForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixMul_(
+constexpr void matrixDiv_(
     MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs,
     const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorDiv_(out.data_[r], in_lhs.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(DivForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivForeach(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::DivForeach<T>(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(DivForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixAbs_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAbs_(out.data_[r], in_arg.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(AbsForeach);
+#ifdef ENABLE_ISPC
+    ispc::AbsForeach(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AbsForeach<T>(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AbsForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSqrt_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSqrt_(out.data_[r], in_arg.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(SqrtForeach);
+#ifdef ENABLE_ISPC
+    ispc::SqrtForeach(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::SqrtForeach<T>(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(SqrtForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixNeg_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorNeg_(out.data_[r], in_arg.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(NegForeach);
 #ifdef ENABLE_ISPC
-  ispc::MulForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    ispc::NegForeach(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  MulForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    portable::NegForeach<T>(out, in_arg, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(NegForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixDiv_(
+constexpr void matrixPow_(
     MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs,
     const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorPow_(out.data_[r], in_lhs.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(PowForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowForeach(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::PowForeach<T>(out, in_lhs, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(PowForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixAddScalar_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAddScalar_(out.data_[r], in_lhs.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(AddScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarForeach(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AddScalarForeach<T>(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AddScalarForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSubScalar_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSubScalar_(out.data_[r], in_lhs.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(SubScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubScalarForeach(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::SubScalarForeach<T>(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(SubScalarForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixMulScalar_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorMulScalar_(out.data_[r], in_lhs.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(MulScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulScalarForeach(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::MulScalarForeach<T>(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(MulScalarForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixDivScalar_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorDivScalar_(out.data_[r], in_lhs.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(DivScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivScalarForeach(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::DivScalarForeach<T>(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(DivScalarForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixPowScalar_(
+    MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorPowScalar_(out.data_[r], in_lhs.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(PowScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowScalarForeach(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::PowScalarForeach<T>(out, in_lhs, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(PowScalarForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixScalarSub_(
+    MatrixCT<T, ROWS, COLS>& out, const T scalar, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorScalarSub_(out.data_[r], scalar, in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(ScalarSubForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarSubForeach(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::ScalarSubForeach<T>(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(ScalarSubForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixScalarDiv_(
+    MatrixCT<T, ROWS, COLS>& out, const T scalar, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorScalarDiv_(out.data_[r], scalar, in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(ScalarDivForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarDivForeach(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::ScalarDivForeach<T>(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(ScalarDivForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixScalarPow_(
+    MatrixCT<T, ROWS, COLS>& out, const T scalar, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorScalarPow_(out.data_[r], scalar, in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(ScalarPowForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarPowForeach(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::ScalarPowForeach<T>(out, scalar, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(ScalarPowForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixAddInplace_(
+    MatrixCT<T, ROWS, COLS>& inout, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAddInplace_(inout.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(AddInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddInplaceForeach(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AddInplaceForeach<T>(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AddInplaceForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSubInplace_(
+    MatrixCT<T, ROWS, COLS>& inout, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSubInplace_(inout.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(SubInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubInplaceForeach(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::SubInplaceForeach<T>(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(SubInplaceForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixMulInplace_(
+    MatrixCT<T, ROWS, COLS>& inout, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorMulInplace_(inout.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(MulInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulInplaceForeach(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::MulInplaceForeach<T>(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(MulInplaceForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixDivInplace_(
+    MatrixCT<T, ROWS, COLS>& inout, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorDivInplace_(inout.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(DivInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivInplaceForeach(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::DivInplaceForeach<T>(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(DivInplaceForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixPowInplace_(
+    MatrixCT<T, ROWS, COLS>& inout, const MatrixCT<T, ROWS, COLS>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorPowInplace_(inout.data_[r], in_rhs.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(PowInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowInplaceForeach(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::PowInplaceForeach<T>(inout, in_rhs, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(PowInplaceForeach, ROWS * COLS, 3 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixAddScalarInplace_(MatrixCT<T, ROWS, COLS>& inout, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAddScalarInplace_(inout.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(AddScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarInplaceForeach(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AddScalarInplaceForeach<T>(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AddScalarInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSubScalarInplace_(MatrixCT<T, ROWS, COLS>& inout, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSubScalarInplace_(inout.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(SubScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::DivForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    ispc::SubScalarInplaceForeach(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  DivForeach(out, in_lhs, in_rhs, ROWS * COLS);
+    portable::SubScalarInplaceForeach<T>(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(SubScalarInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixAbs_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+constexpr void matrixMulScalarInplace_(MatrixCT<T, ROWS, COLS>& inout, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorMulScalarInplace_(inout.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(MulScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::AbsForeach(out, in_arg, ROWS * COLS);
+    ispc::MulScalarInplaceForeach(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  AbsForeach(out, in_arg, ROWS * COLS);
+    portable::MulScalarInplaceForeach<T>(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(MulScalarInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixSqrt_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+constexpr void matrixDivScalarInplace_(MatrixCT<T, ROWS, COLS>& inout, const T scalar) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorDivScalarInplace_(inout.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(DivScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::SqrtForeach(out, in_arg, ROWS * COLS);
+    ispc::DivScalarInplaceForeach(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  SqrtForeach(out, in_arg, ROWS * COLS);
+    portable::DivScalarInplaceForeach<T>(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(DivScalarInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-inline void matrixNeg_(MatrixCT<T, ROWS, COLS>& out, const MatrixCT<T, ROWS, COLS>& in_arg) {
+constexpr void matrixPowScalarInplace_(MatrixCT<T, ROWS, COLS>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorPowScalarInplace_(inout.data_[r], scalar);
+  } else {
+    CT_PROFILE_BEGIN(PowScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::NegForeach(out, in_arg, ROWS * COLS);
+    ispc::PowScalarInplaceForeach(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #else
-  NegForeach(out, in_arg, ROWS * COLS);
+    portable::PowScalarInplaceForeach<T>(inout, scalar, MatrixCT<T, ROWS, COLS>::kStorageLength);
 #endif
+    CT_PROFILE_END(PowScalarInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixAbsInplace_(MatrixCT<T, ROWS, COLS>& inout) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorAbsInplace_(inout.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(AbsInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AbsInplaceForeach(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::AbsInplaceForeach<T>(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(AbsInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixSqrtInplace_(MatrixCT<T, ROWS, COLS>& inout) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorSqrtInplace_(inout.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(SqrtInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SqrtInplaceForeach(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::SqrtInplaceForeach<T>(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(SqrtInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr void matrixNegInplace_(MatrixCT<T, ROWS, COLS>& inout) {
+  if (kSimdMatrix<T, ROWS, COLS> || isConstantEvaluated_()) {
+    for (size_t r = 0; r < ROWS; ++r) vectorNegInplace_(inout.data_[r]);
+  } else {
+    CT_PROFILE_BEGIN(NegInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::NegInplaceForeach(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#else
+    portable::NegInplaceForeach<T>(inout, MatrixCT<T, ROWS, COLS>::kStorageLength);
+#endif
+    CT_PROFILE_END(NegInplaceForeach, ROWS * COLS, 2 * ROWS * COLS * sizeof(T));
+  }
 }
 
 /* operators */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator-(const MatrixCT<T, ROWS, COLS>& mat) {
+constexpr MatrixCT<T, ROWS, COLS> operator-(const MatrixCT<T, ROWS, COLS>& mat) {
   MatrixCT<T, ROWS, COLS> res;
   matrixNeg_(res, mat);
   return res;
 }
 
+// temporaries are reused in place, e.g. `-(lhs - rhs)`
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> operator-(MatrixCT<T, ROWS, COLS>&& mat) {
+  matrixNegInplace_(mat);
+  return std::move(mat);
+}
+
 /* + */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator+(
+constexpr MatrixCT<T, ROWS, COLS> operator+(
     const MatrixCT<T, ROWS, COLS>& lhs, const MatrixCT<T, ROWS, COLS>& rhs) {
   MatrixCT<T, ROWS, COLS> res;
   matrixAdd_(res, lhs, rhs);
@@ -172,23 +628,23 @@ MatrixCT<T, ROWS, COLS> operator+(
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator+(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixAdd_(res, lhs, res);
+constexpr MatrixCT<T, ROWS, COLS> operator+(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixAddScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator+(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixAdd_(res, res, rhs);
+constexpr MatrixCT<T, ROWS, COLS> operator+(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixAddScalar_(res, rhs, scalar);
   return res;
 }
 
 /* - */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator-(
+constexpr MatrixCT<T, ROWS, COLS> operator-(
     const MatrixCT<T, ROWS, COLS>& lhs, const MatrixCT<T, ROWS, COLS>& rhs) {
   MatrixCT<T, ROWS, COLS> res;
   matrixSub_(res, lhs, rhs);
@@ -196,23 +652,23 @@ MatrixCT<T, ROWS, COLS> operator-(
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator-(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixSub_(res, lhs, res);
+constexpr MatrixCT<T, ROWS, COLS> operator-(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixSubScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator-(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixSub_(res, res, rhs);
+constexpr MatrixCT<T, ROWS, COLS> operator-(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixScalarSub_(res, scalar, rhs);
   return res;
 }
 
 /* * */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator*(
+constexpr MatrixCT<T, ROWS, COLS> operator*(
     const MatrixCT<T, ROWS, COLS>& lhs, const MatrixCT<T, ROWS, COLS>& rhs) {
   MatrixCT<T, ROWS, COLS> res;
   matrixMul_(res, lhs, rhs);
@@ -220,23 +676,23 @@ MatrixCT<T, ROWS, COLS> operator*(
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator*(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixMul_(res, lhs, res);
+constexpr MatrixCT<T, ROWS, COLS> operator*(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixMulScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator*(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixMul_(res, res, rhs);
+constexpr MatrixCT<T, ROWS, COLS> operator*(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixMulScalar_(res, rhs, scalar);
   return res;
 }
 
 /* / */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator/(
+constexpr MatrixCT<T, ROWS, COLS> operator/(
     const MatrixCT<T, ROWS, COLS>& lhs, const MatrixCT<T, ROWS, COLS>& rhs) {
   MatrixCT<T, ROWS, COLS> res;
   matrixDiv_(res, lhs, rhs);
@@ -244,35 +700,69 @@ MatrixCT<T, ROWS, COLS> operator/(
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator/(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixDiv_(res, lhs, res);
+constexpr MatrixCT<T, ROWS, COLS> operator/(const MatrixCT<T, ROWS, COLS>& lhs, const T scalar) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixDivScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> operator/(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
-  MatrixCT<T, ROWS, COLS> res{scalar};
-  matrixDiv_(res, res, rhs);
+constexpr MatrixCT<T, ROWS, COLS> operator/(const T scalar, const MatrixCT<T, ROWS, COLS>& rhs) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixScalarDiv_(res, scalar, rhs);
   return res;
 }
 
 /* free functions */
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> Abs(const MatrixCT<T, ROWS, COLS>& mat) {
+constexpr MatrixCT<T, ROWS, COLS> Abs(const MatrixCT<T, ROWS, COLS>& mat) {
   MatrixCT<T, ROWS, COLS> res;
   matrixAbs_(res, mat);
   return res;
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-MatrixCT<T, ROWS, COLS> Sqrt(const MatrixCT<T, ROWS, COLS>& mat) {
+constexpr MatrixCT<T, ROWS, COLS> Abs(MatrixCT<T, ROWS, COLS>&& mat) {
+  matrixAbsInplace_(mat);
+  return std::move(mat);
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> Sqrt(const MatrixCT<T, ROWS, COLS>& mat) {
   MatrixCT<T, ROWS, COLS> res;
   matrixSqrt_(res, mat);
   return res;
 }
 
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> Sqrt(MatrixCT<T, ROWS, COLS>&& mat) {
+  matrixSqrtInplace_(mat);
+  return std::move(mat);
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> Pow(
+    const MatrixCT<T, ROWS, COLS>& base, const MatrixCT<T, ROWS, COLS>& exponent) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixPow_(res, base, exponent);
+  return res;
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> Pow(const MatrixCT<T, ROWS, COLS>& base, const T exponent) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixPowScalar_(res, base, exponent);
+  return res;
+}
+
+template <typename T, size_t ROWS, size_t COLS>
+constexpr MatrixCT<T, ROWS, COLS> Pow(const T base, const MatrixCT<T, ROWS, COLS>& exponent) {
+  MatrixCT<T, ROWS, COLS> res;
+  matrixScalarPow_(res, base, exponent);
+  return res;
+}
+
 /* stream */
 
 template <typename T, size_t ROWS, size_t COLS>
@@ -282,14 +772,7 @@ std::istream& operator>>(std::istream& in, MatrixCT<T, ROWS, COLS>& mat) {
 }
 
 template <typename T, size_t ROWS, size_t COLS>
-std::ostream& operator<<(std::ostream& out, MatrixCT<T, ROWS, COLS>& mat) {
-  out << std::endl;
-  for (size_t r = 0; r < ROWS; ++r) out << mat[r] << std::endl;
-  return out;
-}
-
-template <typename T, size_t ROWS, size_t COLS>
-std::ostream& operator<<(std::ostream& out, MatrixCT<T, ROWS, COLS>&& mat) {
+std::ostream& operator<<(std::ostream& out, const MatrixCT<T, ROWS, COLS>& mat) {
   out << std::endl;
   for (size_t r = 0; r < ROWS; ++r) out << mat[r] << std::endl;
   return out;
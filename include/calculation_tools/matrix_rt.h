@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cassert>
+
+#include <algorithm>
+#include <iostream>
+#include <initializer_list>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "matrix.h"
+#include "expression.h"
+#include "thread_pool.h"
+
+namespace kplutl {
+// Heap-backed row-major matrix whose shape is only known at run time. Every row starts on a
+// kAlignment boundary: rows are padded to `ld()` elements and the padding is zero-initialized.
+// Arithmetic is lazy (see expression.h) and runs over the padding too, so its contents carry no
+// meaning afterwards.
+template <typename T>
+struct MatrixRT {
+  AlignedArray<T> data_;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  size_t ld_ = 0;
+
+  MatrixRT<T>() = default;
+  MatrixRT<T>(const MatrixRT<T>& matrixRT) = default;
+  MatrixRT<T>& operator=(const MatrixRT<T>& matrixRT) = default;
+  MatrixRT<T>(MatrixRT<T>&& matrixRT) = default;
+  MatrixRT<T>& operator=(MatrixRT<T>&& matrixRT) = default;
+
+  MatrixRT<T>(size_t rows, size_t cols, UninitializedTag)
+      : data_(rows * PaddedLength<T>(cols)), rows_(rows), cols_(cols), ld_(PaddedLength<T>(cols)) {}
+  MatrixRT<T>(size_t rows, size_t cols) : MatrixRT<T>(rows, cols, kUninitialized) {
+    std::fill_n(data_.data(), data_.size(), T{});
+  }
+  MatrixRT<T>(size_t rows, size_t cols, T value) : MatrixRT<T>(rows, cols) {
+    for (size_t r = 0; r < rows_; ++r) std::fill_n((*this)[r], cols_, value);
+  }
+  MatrixRT<T>(std::initializer_list<std::initializer_list<const T>> list)
+      : MatrixRT<T>(list.size(), list.size() != 0 ? list.begin()->size() : 0) {
+    size_t i = 0;
+    for (auto sub_list : list) {
+      assert(sub_list.size() <= cols_);
+      std::copy(sub_list.begin(), sub_list.end(), (*this)[i++]);
+    }
+  }
+
+  template <typename E>
+  MatrixRT<T>(const Expr<E>& expr)
+      : MatrixRT<T>(expr.Self().Like().rows(), expr.Self().Like().cols(), kUninitialized) {
+    Assign(*this, expr);
+  }
+
+  template <typename S>
+  explicit MatrixRT<T>(const MatrixRT<S>& source) : MatrixRT<T>(source.rows(), source.cols()) {
+    for (size_t r = 0; r < rows_; ++r) {
+      for (size_t c = 0; c < cols_; ++c) {
+        (*this)[r][c] = (T)source[r][c];
+      }
+    }
+  }
+  template <typename S, size_t ROWS, size_t COLS>
+  explicit MatrixRT<T>(const MatrixCT<S, ROWS, COLS>& source) : MatrixRT<T>(ROWS, COLS) {
+    for (size_t r = 0; r < ROWS; ++r) {
+      for (size_t c = 0; c < COLS; ++c) {
+        (*this)[r][c] = (T)source.data_[r][c];
+      }
+    }
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  // distance in elements between the starts of consecutive rows
+  size_t ld() const { return ld_; }
+
+  T* operator[](size_t row_index) { return data_.data() + row_index * ld_; }
+  const T* operator[](size_t row_index) const { return data_.data() + row_index * ld_; }
+
+  operator T*() { return data_.data(); };
+
+  operator const T*() const { return data_.data(); };
+
+  template <typename E>
+  MatrixRT<T>& operator=(const Expr<E>& expr) {
+    if (ExprContainer<MatrixRT<T>>::SameShape(*this, expr.Self().Like())) {
+      Assign(*this, expr);
+    } else {
+      *this = MatrixRT<T>(expr);
+    }
+    return *this;
+  }
+
+  MatrixRT<T>& operator+=(const MatrixRT<T>& lhs) {
+    matrixAddInplace_(*this, lhs);
+    return *this;
+  }
+
+  MatrixRT<T>& operator+=(const T scalar) {
+    matrixAddScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  MatrixRT<T>& operator+=(const Expr<E>& expr) {
+    *this = *this + expr.Self();
+    return *this;
+  }
+
+  MatrixRT<T>& operator-=(const MatrixRT<T>& lhs) {
+    matrixSubInplace_(*this, lhs);
+    return *this;
+  }
+
+  MatrixRT<T>& operator-=(const T scalar) {
+    matrixSubScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  MatrixRT<T>& operator-=(const Expr<E>& expr) {
+    *this = *this - expr.Self();
+    return *this;
+  }
+
+  MatrixRT<T>& operator*=(const MatrixRT<T>& lhs) {
+    matrixMulInplace_(*this, lhs);
+    return *this;
+  }
+
+  MatrixRT<T>& operator*=(const T scalar) {
+    matrixMulScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  MatrixRT<T>& operator*=(const Expr<E>& expr) {
+    *this = *this * expr.Self();
+    return *this;
+  }
+
+  MatrixRT<T>& operator/=(const MatrixRT<T>& lhs) {
+    matrixDivInplace_(*this, lhs);
+    return *this;
+  }
+
+  MatrixRT<T>& operator/=(const T scalar) {
+    matrixDivScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  MatrixRT<T>& operator/=(const Expr<E>& expr) {
+    *this = *this / expr.Self();
+    return *this;
+  }
+};
+
+/* type defines */
+
+using MatrixXf = MatrixRT<float>;
+using MatrixXd = MatrixRT<double>;
+
+/* inline functions */
+
+template <typename T>
+inline void matrixAddInplace_(MatrixRT<T>& inout, const MatrixRT<T>& in_rhs) {
+  assert(inout.rows() == in_rhs.rows() && inout.cols() == in_rhs.cols());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(AddInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::AddInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(AddInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixSubInplace_(MatrixRT<T>& inout, const MatrixRT<T>& in_rhs) {
+  assert(inout.rows() == in_rhs.rows() && inout.cols() == in_rhs.cols());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(SubInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::SubInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(SubInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixMulInplace_(MatrixRT<T>& inout, const MatrixRT<T>& in_rhs) {
+  assert(inout.rows() == in_rhs.rows() && inout.cols() == in_rhs.cols());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(MulInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::MulInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(MulInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixDivInplace_(MatrixRT<T>& inout, const MatrixRT<T>& in_rhs) {
+  assert(inout.rows() == in_rhs.rows() && inout.cols() == in_rhs.cols());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(DivInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::DivInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(DivInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixAddScalarInplace_(MatrixRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(AddScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::AddScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(AddScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixSubScalarInplace_(MatrixRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(SubScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::SubScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(SubScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixMulScalarInplace_(MatrixRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(MulScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::MulScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(MulScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void matrixDivScalarInplace_(MatrixRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.data_.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(DivScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::DivScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(DivScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+/* expressions */
+
+template <typename T>
+struct ExprContainer<MatrixRT<T>> {
+  using value_type = T;
+  static constexpr bool kRuntime = true;
+
+  // expressions run over the padded storage, so one flat pass covers the whole matrix
+  static size_t Length(const MatrixRT<T>& mat) { return mat.data_.size(); }
+  static bool SameShape(const MatrixRT<T>& lhs, const MatrixRT<T>& rhs) {
+    return lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols();
+  }
+  static MatrixRT<T> MakeLike(const MatrixRT<T>& mat) {
+    return MatrixRT<T>(mat.rows(), mat.cols(), kUninitialized);
+  }
+};
+
+// +, -, *, /, Abs and Sqrt on MatrixRT build expressions, see expression.h
+template <typename T>
+struct IsLazyContainer<MatrixRT<T>> : std::true_type {};
+
+/* stream */
+
+template <typename T>
+std::istream& operator>>(std::istream& in, MatrixRT<T>& mat) {
+  for (size_t r = 0; r < mat.rows(); ++r) {
+    for (size_t c = 0; c < mat.cols(); ++c) in >> mat[r][c];
+  }
+  return in;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const MatrixRT<T>& mat) {
+  out << std::endl;
+  for (size_t r = 0; r < mat.rows(); ++r) {
+    out << "( ";
+    for (size_t c = 0; c < mat.cols(); ++c) out << mat[r][c] << (c != mat.cols() - 1 ? ", " : "");
+    out << " )" << std::endl;
+  }
+  return out;
+}
+
+}  // namespace kplutl
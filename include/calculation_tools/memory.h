@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kplutl {
+/* alignment */
+
+// heap-backed storage starts on a cache line, which also covers the widest (AVX-512) vector load
+constexpr size_t kAlignment = 64;
+
+// rounds `count` elements of T up to a whole number of kAlignment-byte blocks
+template <typename T>
+constexpr size_t PaddedLength(const size_t count) {
+  constexpr size_t block = kAlignment / sizeof(T);
+  return (count + block - 1) / block * block;
+}
+
+// kAlignment-aligned heap memory, nullptr for 0 bytes; counted in AllocationCounters
+void* AlignedAlloc(size_t bytes);
+void AlignedFree(void* ptr);
+
+/* allocation counters */
+
+// Totals over all threads since the start of the process. Diff two snapshots to check that a loop
+// allocates nothing in its steady state.
+struct AllocationCounters {
+  std::uint64_t heap_allocations = 0;  // AlignedAlloc calls that allocated
+  std::uint64_t heap_frees = 0;
+  std::uint64_t heap_bytes = 0;             // allocated, frees not subtracted
+  std::uint64_t workspace_allocations = 0;  // arrays and scratch buffers placed in an arena
+  std::uint64_t workspace_bytes = 0;
+};
+
+AllocationCounters GetAllocationCounters();
+
+inline AllocationCounters operator-(const AllocationCounters& lhs, const AllocationCounters& rhs) {
+  return {lhs.heap_allocations - rhs.heap_allocations, lhs.heap_frees - rhs.heap_frees,
+          lhs.heap_bytes - rhs.heap_bytes, lhs.workspace_allocations - rhs.workspace_allocations,
+          lhs.workspace_bytes - rhs.workspace_bytes};
+}
+
+/* workspace */
+
+// position in the calling thread's arena
+struct WorkspaceMark {
+  size_t block = 0;
+  size_t used = 0;
+
+  bool operator==(const WorkspaceMark& other) const {
+    return block == other.block && used == other.used;
+  }
+};
+
+// Every thread owns an arena: a list of heap blocks handed out front to back. Releasing rewinds
+// it, and the blocks stay for the next round. Once the arena is empty again, several blocks are
+// merged into one that fits them all, so a repeated sequence of allocations settles to no heap
+// allocations at all.
+//
+// A Workspace scope makes every AlignedArray created on its thread while it lives, and with it
+// the storage of VectorRT, MatrixRT and VectorStream, come from the arena. The arrays are freed
+// together when the scope ends. Nothing created inside may outlive the scope. Containers created
+// before it may still be assigned, moved or resized inside: they then allocate from the heap, and
+// a result moved into them is copied out of the arena. Workspaces nest, but they have to be
+// locals; worker threads of the pool do not see the scope of the thread that started the work.
+class Workspace {
+ public:
+  Workspace();
+  ~Workspace();
+  Workspace(const Workspace&) = delete;
+  Workspace& operator=(const Workspace&) = delete;
+
+ private:
+  WorkspaceMark mark_;
+  std::uint64_t previous_scope_;
+};
+
+/* inline functions */
+
+WorkspaceMark workspaceMark_();
+// id of the innermost Workspace open on the calling thread, 0 for none; ids only grow
+std::uint64_t workspaceScope_();
+// `bytes` from the arena, nullptr for 0 bytes
+void* workspaceAllocate_(size_t bytes);
+// nullptr unless a Workspace is open on the calling thread
+void* workspaceAllocateScoped_(size_t bytes);
+void workspaceRewind_(const WorkspaceMark& mark);
+
+// selects the constructors that leave freshly allocated storage uninitialized
+struct UninitializedTag {};
+constexpr UninitializedTag kUninitialized{};
+
+/* storage */
+
+// Owning, kAlignment-aligned array of trivially copyable elements. The allocation is padded to a
+// whole number of aligned blocks so kernels may run full-width over the tail.
+//
+// View() wraps memory owned by someone else, e.g. a mapped file, which has to meet the same
+// alignment and padding and outlive the view. Copies of a view allocate like new arrays.
+template <typename T>
+class AlignedArray {
+  static_assert(std::is_trivially_copyable<T>::value, "AlignedArray holds trivial types only");
+
+ public:
+  AlignedArray() : scope_(workspaceScope_()) {}
+  // from the arena while a Workspace is open on the calling thread, from the heap otherwise
+  explicit AlignedArray(const size_t size) : scope_(workspaceScope_()) { Allocate(size); }
+
+  AlignedArray(const AlignedArray& other) : AlignedArray(other.size_) {
+    if (size_ != 0) std::memcpy(data_, other.data_, size_ * sizeof(T));
+  }
+  // new storage comes from the heap unless this array was created in the innermost Workspace
+  AlignedArray& operator=(const AlignedArray& other) {
+    if (this != &other) {
+      Release();
+      Allocate(other.size_);
+      if (size_ != 0) std::memcpy(data_, other.data_, size_ * sizeof(T));
+    }
+    return *this;
+  }
+  AlignedArray(AlignedArray&& other) noexcept : scope_(workspaceScope_()) { Take(other); }
+  // copies instead when `other` holds arena memory of a Workspace this array outlives
+  AlignedArray& operator=(AlignedArray&& other) {
+    if (this == &other) return *this;
+    if (other.storage_scope_ > scope_) return *this = static_cast<const AlignedArray&>(other);
+    Release();
+    Take(other);
+    return *this;
+  }
+  ~AlignedArray() { Release(); }
+
+  static AlignedArray View(T* data, const size_t size) {
+    assert(reinterpret_cast<std::uintptr_t>(data) % kAlignment == 0);
+    AlignedArray res;
+    res.data_ = data;
+    res.size_ = size;
+    res.owned_ = false;
+    return res;
+  }
+
+  // exchanges the contents; arena memory only changes hands where a move would hand it over
+  void swap(AlignedArray& other) {
+    if (storage_scope_ > other.scope_ || other.storage_scope_ > scope_) {
+      AlignedArray tmp{std::move(*this)};
+      *this = std::move(other);
+      other = std::move(tmp);
+      return;
+    }
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(owned_, other.owned_);
+    std::swap(storage_scope_, other.storage_scope_);
+  }
+
+  // false for views and arrays in a Workspace
+  bool owned() const { return owned_; }
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  T& operator[](const size_t index) {
+    assert(index < size_);
+    return data_[index];
+  }
+  const T& operator[](const size_t index) const {
+    assert(index < size_);
+    return data_[index];
+  }
+
+ private:
+  // storage for `size` elements, see operator=(const AlignedArray&)
+  void Allocate(const size_t size) {
+    const size_t bytes = PaddedLength<T>(size) * sizeof(T);
+    size_ = size;
+    data_ = nullptr;
+    if (scope_ != 0 && scope_ == workspaceScope_()) {
+      data_ = static_cast<T*>(workspaceAllocateScoped_(bytes));
+    }
+    owned_ = data_ == nullptr;
+    storage_scope_ = owned_ ? 0 : scope_;
+    if (owned_) data_ = static_cast<T*>(AlignedAlloc(bytes));
+  }
+
+  void Release() {
+    if (owned_) AlignedFree(data_);
+    data_ = nullptr;
+    size_ = 0;
+    owned_ = true;
+    storage_scope_ = 0;
+  }
+
+  // takes over the storage of `other` and leaves it empty
+  void Take(AlignedArray& other) {
+    data_ = other.data_;
+    size_ = other.size_;
+    owned_ = other.owned_;
+    storage_scope_ = other.storage_scope_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.owned_ = true;
+    other.storage_scope_ = 0;
+  }
+
+  T* data_ = nullptr;
+  size_t size_ = 0;
+  bool owned_ = true;
+  std::uint64_t scope_;              // Workspace open when this array was created, 0 for none
+  std::uint64_t storage_scope_ = 0;  // Workspace whose arena holds data_, 0 for heap and views
+};
+
+// Scratch buffer of a kernel, taken from the calling thread's arena whether or not a Workspace is
+// open, and given back when it goes out of scope. Scratch buffers have to be locals so they are
+// released in reverse order. One that was not the last allocation when released is left to the
+// surrounding Workspace.
+template <typename T>
+class ScratchArray {
+  static_assert(std::is_trivially_copyable<T>::value, "ScratchArray holds trivial types only");
+
+ public:
+  explicit ScratchArray(const size_t size)
+      : mark_(workspaceMark_()),
+        data_(static_cast<T*>(workspaceAllocate_(PaddedLength<T>(size) * sizeof(T)))),
+        end_(workspaceMark_()),
+        size_(size) {}
+  ~ScratchArray() {
+    if (workspaceMark_() == end_) workspaceRewind_(mark_);
+  }
+  ScratchArray(const ScratchArray&) = delete;
+  ScratchArray& operator=(const ScratchArray&) = delete;
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  T& operator[](const size_t index) {
+    assert(index < size_);
+    return data_[index];
+  }
+  const T& operator[](const size_t index) const {
+    assert(index < size_);
+    return data_[index];
+  }
+
+ private:
+  WorkspaceMark mark_;
+  T* data_;
+  WorkspaceMark end_;
+  size_t size_;
+};
+
+}  // namespace kplutl
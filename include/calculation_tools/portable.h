@@ -0,0 +1,1567 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "utils.h"
+
+/*
+    Portable C++ implementation of every kernel in utils.h. It backs the build without ISPC and
+    constant evaluation: all kernels are constexpr, and so are the math helpers they rely on,
+    which switch to series expansions while constant evaluated and to <cmath> otherwise.
+    Signatures mirror the ISPC kernels, templated on the element type; arithmetic runs in
+    compute_t<T>, which only differs from T for Half.
+*/
+
+namespace kplutl::portable {
+/* math */
+
+template <typename T>
+constexpr T abs_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::abs(static_cast<compute_t<T>>(arg)));
+  return arg < T(0) ? T(-arg) : arg;
+}
+
+template <typename T>
+constexpr T sqrt_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::sqrt(static_cast<compute_t<T>>(arg)));
+  if (!(arg > T(0)) || arg == std::numeric_limits<T>::infinity()) {
+    return arg == T(0) || arg == std::numeric_limits<T>::infinity()
+               ? arg
+               : std::numeric_limits<T>::quiet_NaN();
+  }
+  // Newton from above decreases monotonically until it reaches the root
+  double value = static_cast<double>(arg);
+  double res = value > 1.0 ? value : 1.0;
+  for (double next = 0.5 * (res + value / res); next < res; next = 0.5 * (res + value / res)) {
+    res = next;
+  }
+  return static_cast<T>(res);
+}
+
+template <typename T>
+constexpr T exp_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::exp(static_cast<compute_t<T>>(arg)));
+  constexpr double kLn2 = 0.69314718055994530942;
+  // e^x = 2^n * e^r with |r| <= ln(2) / 2
+  const double value = static_cast<double>(arg);
+  const long long n = static_cast<long long>(value / kLn2 + (value < 0 ? -0.5 : 0.5));
+  const double r = value - static_cast<double>(n) * kLn2;
+  double res = 1.0;
+  double term = 1.0;
+  for (int i = 1; i < 24; ++i) {
+    term *= r / i;
+    res += term;
+  }
+  for (long long i = 0; i < n; ++i) res *= 2.0;
+  for (long long i = 0; i > n; --i) res *= 0.5;
+  return static_cast<T>(res);
+}
+
+template <typename T>
+constexpr T log_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::log(static_cast<compute_t<T>>(arg)));
+  if (!(arg > T(0))) {
+    return arg == T(0) ? T(-std::numeric_limits<T>::infinity())
+                       : std::numeric_limits<T>::quiet_NaN();
+  }
+  constexpr double kLn2 = 0.69314718055994530942;
+  // ln(x) = e * ln(2) + 2 * atanh((m - 1) / (m + 1)) with m in [0.5, 1)
+  double m = static_cast<double>(arg);
+  int e = 0;
+  for (; m >= 1.0; m *= 0.5) ++e;
+  for (; m < 0.5; m *= 2.0) --e;
+  const double s = (m - 1.0) / (m + 1.0);
+  double res = 0.0;
+  double power = s;
+  for (int i = 1; i < 60; i += 2) {
+    res += power / i;
+    power *= s * s;
+  }
+  return static_cast<T>(e * kLn2 + 2.0 * res);
+}
+
+template <typename T>
+constexpr T pow_(const T base, const T exponent) {
+  if (!isConstantEvaluated_()) {
+    using C = compute_t<T>;
+    return static_cast<T>(std::pow(static_cast<C>(base), static_cast<C>(exponent)));
+  }
+  const long long whole = static_cast<long long>(exponent);
+  if (static_cast<T>(whole) == exponent) {
+    // exact for integer exponents, including negative bases
+    T res = T(1);
+    T factor = base;
+    for (long long n = whole < 0 ? -whole : whole; n != 0; n >>= 1) {
+      if (n & 1) res *= factor;
+      factor *= factor;
+    }
+    return whole < 0 ? T(T(1) / res) : res;
+  }
+  return base < T(0) ? std::numeric_limits<T>::quiet_NaN() : T(exp_(exponent * log_(base)));
+}
+
+template <typename T>
+constexpr T sin_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::sin(static_cast<compute_t<T>>(arg)));
+  constexpr double kTwoPi = 6.28318530717958647692;
+  const double value = static_cast<double>(arg);
+  const double turns = value / kTwoPi;
+  const long long n = static_cast<long long>(turns + (turns < 0 ? -0.5 : 0.5));
+  const double r = value - kTwoPi * static_cast<double>(n);
+  double res = r;
+  double term = r;
+  for (int i = 1; i < 16; ++i) {
+    term *= -r * r / ((2 * i) * (2 * i + 1));
+    res += term;
+  }
+  return static_cast<T>(res);
+}
+
+template <typename T>
+constexpr T cos_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::cos(static_cast<compute_t<T>>(arg)));
+  constexpr double kHalfPi = 1.57079632679489661923;
+  return static_cast<T>(sin_(static_cast<double>(arg) + kHalfPi));
+}
+
+// Sine and cosine at once: a Cody-Waite reduction to r in [-pi/4, pi/4] with
+// arg = r + quadrant * pi / 2, then the minimax polynomials of Cephes' sinf and cosf in r. Branch
+// free, so loops over it vectorize. For |arg| < 1e4 the absolute error stays below 1e-7 in float
+// and 3e-9 in double; it grows past that, and |arg| >= 2^31 overflows the quadrant.
+template <typename C>
+constexpr void sincosFast_(const C arg, C& sin_out, C& cos_out) {
+  const C scaled = arg * C(0.636619772367581343076);  // 2 / pi
+  const std::int32_t quadrant = static_cast<std::int32_t>(scaled + (scaled < 0 ? C(-0.5) : C(0.5)));
+  const C q = static_cast<C>(quadrant);
+  // pi / 2 in three parts, q times the first is exact for |q| < 2^16
+  const C r = ((arg - q * C(1.5703125)) - q * C(4.837512969970703125e-4)) -
+              q * C(7.54978995489188216e-8);
+  const C r2 = r * r;
+  const C sin_r =
+      r + r * r2 *
+              (C(-1.6666654611e-1) + r2 * (C(8.3321608736e-3) + r2 * C(-1.9515295891e-4)));
+  const C cos_r =
+      C(1) - C(0.5) * r2 +
+      r2 * r2 *
+          (C(4.166664568298827e-2) +
+           r2 * (C(-1.388731625493765e-3) + r2 * C(2.443315711809948e-5)));
+  const bool swap = (quadrant & 1) != 0;
+  const C sin_q = swap ? cos_r : sin_r;
+  const C cos_q = swap ? sin_r : cos_r;
+  sin_out = (quadrant & 2) != 0 ? -sin_q : sin_q;
+  cos_out = ((quadrant + 1) & 2) != 0 ? -cos_q : cos_q;
+}
+
+template <typename T>
+constexpr T tan_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::tan(static_cast<compute_t<T>>(arg)));
+  return sin_(arg) / cos_(arg);
+}
+
+template <typename T>
+constexpr T acos_(const T arg) {
+  if (!isConstantEvaluated_()) return static_cast<T>(std::acos(static_cast<compute_t<T>>(arg)));
+  constexpr double kHalfPi = 1.57079632679489661923;
+  const double value = static_cast<double>(arg);
+  if (!(value >= -1.0 && value <= 1.0)) return std::numeric_limits<T>::quiet_NaN();
+  if (value == -1.0) return static_cast<T>(2.0 * kHalfPi);
+  // acos(x) = 2 * atan(t) with t = sqrt((1 - x) / (1 + x)); t is folded into [0, 1] and halved
+  // twice with atan(t) = 2 * atan(t / (1 + sqrt(1 + t^2))) before the series
+  double t = sqrt_((1.0 - value) / (1.0 + value));
+  const bool folded = t > 1.0;
+  if (folded) t = 1.0 / t;
+  for (int i = 0; i < 2; ++i) t = t / (1.0 + sqrt_(1.0 + t * t));
+  double res = 0.0;
+  double power = t;
+  for (int i = 1; i < 40; i += 2) {
+    res += (i % 4 == 1 ? power : -power) / i;
+    power *= t * t;
+  }
+  res *= 4.0;
+  if (folded) res = kHalfPi - res;
+  return static_cast<T>(2.0 * res);
+}
+
+/* basic */
+
+template <typename T>
+constexpr void AddForeach(T* out, const T* in_lhs, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] + in_rhs[i];
+}
+template <typename T>
+constexpr void SubForeach(T* out, const T* in_lhs, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] - in_rhs[i];
+}
+template <typename T>
+constexpr void MulForeach(T* out, const T* in_lhs, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] * in_rhs[i];
+}
+template <typename T>
+constexpr void DivForeach(T* out, const T* in_lhs, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] / in_rhs[i];
+}
+template <typename T>
+constexpr void PowForeach(T* out, const T* in_lhs, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = pow_(in_lhs[i], in_rhs[i]);
+}
+template <typename T>
+constexpr void AbsForeach(T* out, const T* in_arg, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = abs_(in_arg[i]);
+}
+template <typename T>
+constexpr void SqrtForeach(T* out, const T* in_arg, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = sqrt_(in_arg[i]);
+}
+template <typename T>
+constexpr void NegForeach(T* out, const T* in_arg, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = -in_arg[i];
+}
+
+template <typename T>
+constexpr void AddScalarForeach(T* out, const T* in_lhs, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] + scalar;
+}
+template <typename T>
+constexpr void SubScalarForeach(T* out, const T* in_lhs, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] - scalar;
+}
+template <typename T>
+constexpr void MulScalarForeach(T* out, const T* in_lhs, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] * scalar;
+}
+template <typename T>
+constexpr void DivScalarForeach(T* out, const T* in_lhs, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = in_lhs[i] / scalar;
+}
+template <typename T>
+constexpr void PowScalarForeach(T* out, const T* in_lhs, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = pow_(in_lhs[i], scalar);
+}
+template <typename T>
+constexpr void ScalarSubForeach(T* out, const T scalar, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = scalar - in_rhs[i];
+}
+template <typename T>
+constexpr void ScalarDivForeach(T* out, const T scalar, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = scalar / in_rhs[i];
+}
+template <typename T>
+constexpr void ScalarPowForeach(T* out, const T scalar, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) out[i] = pow_(scalar, in_rhs[i]);
+}
+
+template <typename T>
+constexpr void AddInplaceForeach(T* inout, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] += in_rhs[i];
+}
+template <typename T>
+constexpr void SubInplaceForeach(T* inout, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] -= in_rhs[i];
+}
+template <typename T>
+constexpr void MulInplaceForeach(T* inout, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] *= in_rhs[i];
+}
+template <typename T>
+constexpr void DivInplaceForeach(T* inout, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] /= in_rhs[i];
+}
+template <typename T>
+constexpr void PowInplaceForeach(T* inout, const T* in_rhs, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] = pow_(inout[i], in_rhs[i]);
+}
+template <typename T>
+constexpr void AddScalarInplaceForeach(T* inout, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] += scalar;
+}
+template <typename T>
+constexpr void SubScalarInplaceForeach(T* inout, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] -= scalar;
+}
+template <typename T>
+constexpr void MulScalarInplaceForeach(T* inout, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] *= scalar;
+}
+template <typename T>
+constexpr void DivScalarInplaceForeach(T* inout, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] /= scalar;
+}
+template <typename T>
+constexpr void PowScalarInplaceForeach(T* inout, const T scalar, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] = pow_(inout[i], scalar);
+}
+template <typename T>
+constexpr void AbsInplaceForeach(T* inout, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] = abs_(inout[i]);
+}
+template <typename T>
+constexpr void SqrtInplaceForeach(T* inout, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] = sqrt_(inout[i]);
+}
+template <typename T>
+constexpr void NegInplaceForeach(T* inout, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) inout[i] = -inout[i];
+}
+
+// Registers hold compute_t<T>. Array operands are read in place when that is T and converted
+// into `scratch` otherwise.
+template <typename T, typename C>
+constexpr const C* exprOperand_(
+    const std::int32_t operand, const C* regs, const std::uint64_t block, const T* const arrays[],
+    const std::uint64_t base, const std::uint64_t count, C* scratch) {
+  if (operand >= 0) return regs + operand * block;
+  const T* array = arrays[-(operand + 1)] + base;
+  if constexpr (std::is_same_v<T, C>) {
+    return array;
+  } else {
+    for (std::uint64_t i = 0; i < count; ++i) scratch[i] = static_cast<C>(array[i]);
+    return scratch;
+  }
+}
+
+// same register bytecode as the ISPC interpreter, over smaller blocks
+template <typename T>
+constexpr void ExprForeach(
+    T* out, const std::int32_t code[], const std::int32_t code_len, const T* const arrays[],
+    const T scalars[], const std::uint64_t len) {
+  using C = compute_t<T>;
+  constexpr bool kConverts = !std::is_same_v<T, C>;
+  constexpr std::uint64_t kBlock = 64;
+  C regs[kExprRegisters * kBlock]{};
+  // operands and result in C when arrays hold another type
+  C scratch[3][kConverts ? kBlock : 1]{};
+  for (std::uint64_t base = 0; base < len; base += kBlock) {
+    const std::uint64_t count = len - base < kBlock ? len - base : kBlock;
+    for (std::int32_t pc = 0; pc < code_len; pc += 4) {
+      const std::int32_t op = code[pc];
+      const std::int32_t dst = code[pc + 1];
+      C* res = regs + (dst < 0 ? 0 : dst) * kBlock;
+      if (dst < 0) {
+        if constexpr (kConverts) {
+          res = scratch[2];
+        } else {
+          res = out + base;
+        }
+      }
+
+      if (op == kExprScalar) {
+        for (std::uint64_t i = 0; i < count; ++i) res[i] = static_cast<C>(scalars[code[pc + 2]]);
+      } else {
+        const C* lhs = exprOperand_(code[pc + 2], regs, kBlock, arrays, base, count, scratch[0]);
+        const C* rhs =
+            op <= kExprDiv
+                ? exprOperand_(code[pc + 3], regs, kBlock, arrays, base, count, scratch[1])
+                : lhs;
+        switch (op) {
+          case kExprAdd:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = lhs[i] + rhs[i];
+            break;
+          case kExprSub:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = lhs[i] - rhs[i];
+            break;
+          case kExprMul:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = lhs[i] * rhs[i];
+            break;
+          case kExprDiv:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = lhs[i] / rhs[i];
+            break;
+          case kExprNeg:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = -lhs[i];
+            break;
+          case kExprAbs:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = abs_(lhs[i]);
+            break;
+          case kExprSqrt:
+            for (std::uint64_t i = 0; i < count; ++i) res[i] = sqrt_(lhs[i]);
+            break;
+        }
+      }
+
+      if constexpr (kConverts) {
+        if (dst < 0) {
+          for (std::uint64_t i = 0; i < count; ++i) out[base + i] = static_cast<T>(res[i]);
+        }
+      }
+    }
+  }
+}
+
+/* linear algebra */
+
+template <typename T>
+constexpr void VectorDotProd(T* out, const T* vec_lhs, const T* vec_rhs, const std::uint64_t len) {
+  compute_t<T> sum = 0;
+  for (std::uint64_t i = 0; i < len; ++i) sum += vec_lhs[i] * vec_rhs[i];
+  out[0] = static_cast<T>(sum);
+}
+
+template <typename T>
+constexpr void VectorCrossProdV3(T vec_out[3], const T vec_lhs[3], const T vec_rhs[3]) {
+  using C = compute_t<T>;
+  const C x = vec_lhs[1] * vec_rhs[2] - vec_lhs[2] * vec_rhs[1];
+  const C y = vec_lhs[2] * vec_rhs[0] - vec_lhs[0] * vec_rhs[2];
+  const C z = vec_lhs[0] * vec_rhs[1] - vec_lhs[1] * vec_rhs[0];
+  vec_out[0] = static_cast<T>(x);
+  vec_out[1] = static_cast<T>(y);
+  vec_out[2] = static_cast<T>(z);
+}
+
+template <typename T>
+constexpr void VectorTransformV4(const T mat_lhs[16], T vec_rhs[4]) {
+  compute_t<T> res[4]{};
+  for (int r = 0; r < 4; ++r) {
+    res[r] = mat_lhs[r * 4] * vec_rhs[0] + mat_lhs[r * 4 + 1] * vec_rhs[1] +
+             mat_lhs[r * 4 + 2] * vec_rhs[2] + mat_lhs[r * 4 + 3] * vec_rhs[3];
+  }
+  for (int r = 0; r < 4; ++r) vec_rhs[r] = static_cast<T>(res[r]);
+}
+
+template <typename T>
+constexpr void vertexTransform_(
+    const T mat_lhs[16], T& x, T& y, T& z, T& w, const std::uint32_t flags, const T viewport[6]) {
+  using C = compute_t<T>;
+  C tx = mat_lhs[0] * x + mat_lhs[1] * y + mat_lhs[2] * z + mat_lhs[3] * w;
+  C ty = mat_lhs[4] * x + mat_lhs[5] * y + mat_lhs[6] * z + mat_lhs[7] * w;
+  C tz = mat_lhs[8] * x + mat_lhs[9] * y + mat_lhs[10] * z + mat_lhs[11] * w;
+  const C tw = mat_lhs[12] * x + mat_lhs[13] * y + mat_lhs[14] * z + mat_lhs[15] * w;
+
+  if (flags & kVertexPerspectiveDivide) {
+    const C inv_w = C(1) / tw;
+    tx *= inv_w;
+    ty *= inv_w;
+    tz *= inv_w;
+  }
+  if (flags & kVertexViewportMapping) {
+    const C half_width = C(viewport[2]) / 2;
+    const C half_height = C(viewport[3]) / 2;
+    const C half_depth = (C(viewport[5]) - C(viewport[4])) / 2;
+    tx = tx * half_width + (viewport[0] + half_width);
+    ty = ty * half_height + (viewport[1] + half_height);
+    tz = tz * half_depth + (viewport[4] + half_depth);
+  }
+
+  x = static_cast<T>(tx);
+  y = static_cast<T>(ty);
+  z = static_cast<T>(tz);
+  w = static_cast<T>(tw);
+}
+
+template <typename T>
+constexpr void VertexTransformSoA(
+    const T mat_lhs[16], const T in_x[], const T in_y[], const T in_z[], const T in_w[], T out_x[],
+    T out_y[], T out_z[], T out_w[], const std::uint64_t count, const std::uint32_t flags,
+    const T viewport[6]) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    T x = in_x[i];
+    T y = in_y[i];
+    T z = in_z[i];
+    T w = in_w != nullptr ? in_w[i] : T(1);
+    vertexTransform_(mat_lhs, x, y, z, w, flags, viewport);
+    out_x[i] = x;
+    out_y[i] = y;
+    out_z[i] = z;
+    if (out_w != nullptr) out_w[i] = w;
+  }
+}
+
+template <typename T>
+constexpr void VertexTransformAoS(
+    const T mat_lhs[16], const T vec_in[], const std::uint64_t in_stride,
+    const std::uint32_t in_comps, T vec_out[], const std::uint64_t out_stride,
+    const std::uint64_t count, const std::uint32_t flags, const T viewport[6]) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const T* src = vec_in + i * in_stride;
+    T* dst = vec_out + i * out_stride;
+    T x = src[0];
+    T y = src[1];
+    T z = src[2];
+    T w = in_comps > 3 ? src[3] : T(1);
+    vertexTransform_(mat_lhs, x, y, z, w, flags, viewport);
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+    dst[3] = w;
+  }
+}
+
+// tile of the portable GEMM, see MatrixGemm
+constexpr std::uint64_t kGemmRows = 4;
+constexpr std::uint64_t kGemmCols = 256;
+
+template <typename T>
+constexpr void MatrixGemm(
+    const std::uint64_t m, const std::uint64_t n, const std::uint64_t k, const T alpha,
+    const T mat_a[], const std::uint64_t lda, const T mat_b[], const std::uint64_t ldb,
+    const T beta, T mat_c[], const std::uint64_t ldc) {
+  using C = compute_t<T>;
+  if constexpr (!std::is_same_v<T, C>) {
+    // one rounding per element of C instead of one per step of the sum
+    for (std::uint64_t i = 0; i < m; ++i) {
+      for (std::uint64_t j = 0; j < n; ++j) {
+        C sum = 0;
+        for (std::uint64_t p = 0; p < k; ++p) sum += C(mat_a[i * lda + p]) * C(mat_b[p * ldb + j]);
+        T& c_ij = mat_c[i * ldc + j];
+        c_ij = static_cast<T>(C(alpha) * sum + (beta == T(0) ? C(0) : C(beta) * C(c_ij)));
+      }
+    }
+  } else {
+    // i-p-j order streams through rows of B and C. Tiles of kGemmRows rows share every row of B
+    // they read, and kGemmCols columns keep the k rows of B a tile reads resident in L2.
+    for (std::uint64_t jc = 0; jc < n; jc += kGemmCols) {
+      const std::uint64_t nc = std::min(kGemmCols, n - jc);
+      for (std::uint64_t ic = 0; ic < m; ic += kGemmRows) {
+        const std::uint64_t mc = std::min(kGemmRows, m - ic);
+        T* c_rows[kGemmRows]{};
+        for (std::uint64_t r = 0; r < mc; ++r) {
+          c_rows[r] = mat_c + (ic + r) * ldc + jc;
+          for (std::uint64_t j = 0; j < nc; ++j) {
+            c_rows[r][j] = beta == T(0) ? T(0) : beta * c_rows[r][j];
+          }
+        }
+        for (std::uint64_t p = 0; p < k; ++p) {
+          const T* b_row = mat_b + p * ldb + jc;
+          if (mc == kGemmRows) {
+            const T a_0 = alpha * mat_a[ic * lda + p];
+            const T a_1 = alpha * mat_a[(ic + 1) * lda + p];
+            const T a_2 = alpha * mat_a[(ic + 2) * lda + p];
+            const T a_3 = alpha * mat_a[(ic + 3) * lda + p];
+            for (std::uint64_t j = 0; j < nc; ++j) {
+              const T b_pj = b_row[j];
+              c_rows[0][j] += a_0 * b_pj;
+              c_rows[1][j] += a_1 * b_pj;
+              c_rows[2][j] += a_2 * b_pj;
+              c_rows[3][j] += a_3 * b_pj;
+            }
+          } else {
+            for (std::uint64_t r = 0; r < mc; ++r) {
+              const T a_rp = alpha * mat_a[(ic + r) * lda + p];
+              for (std::uint64_t j = 0; j < nc; ++j) c_rows[r][j] += a_rp * b_row[j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+constexpr void BuildIdentity(T* mat_arg, const std::uint64_t dim, const std::uint64_t ld) {
+  for (std::uint64_t r = 0; r < dim; ++r) {
+    for (std::uint64_t c = 0; c < dim; ++c) mat_arg[r * ld + c] = r == c ? T(1) : T(0);
+  }
+}
+
+template <typename T>
+constexpr void MatrixTranspose(
+    T* mat_out, const T* mat_arg, const std::uint64_t row, const std::uint64_t col,
+    const std::uint64_t ld_out, const std::uint64_t ld_arg) {
+  for (std::uint64_t r = 0; r < row; ++r) {
+    for (std::uint64_t c = 0; c < col; ++c) mat_out[c * ld_out + r] = mat_arg[r * ld_arg + c];
+  }
+}
+
+/* matrix inverse */
+
+// 2x2 sub-determinants of the row-major 4x4 `a`, rows 0-1 in sub[0..5] and rows 2-3 in sub[6..11]
+template <typename C>
+constexpr void subDeterminants4_(C sub[12], const C a[16]) {
+  sub[0] = a[0] * a[5] - a[4] * a[1];
+  sub[1] = a[0] * a[6] - a[4] * a[2];
+  sub[2] = a[0] * a[7] - a[4] * a[3];
+  sub[3] = a[1] * a[6] - a[5] * a[2];
+  sub[4] = a[1] * a[7] - a[5] * a[3];
+  sub[5] = a[2] * a[7] - a[6] * a[3];
+  sub[6] = a[8] * a[13] - a[12] * a[9];
+  sub[7] = a[8] * a[14] - a[12] * a[10];
+  sub[8] = a[8] * a[15] - a[12] * a[11];
+  sub[9] = a[9] * a[14] - a[13] * a[10];
+  sub[10] = a[9] * a[15] - a[13] * a[11];
+  sub[11] = a[10] * a[15] - a[14] * a[11];
+}
+
+template <typename C>
+constexpr C determinant4_(const C sub[12]) {
+  return sub[0] * sub[11] - sub[1] * sub[10] + sub[2] * sub[9] + sub[3] * sub[8] -
+         sub[4] * sub[7] + sub[5] * sub[6];
+}
+
+// determinant of the dense row-major dim x dim (2, 3 or 4) matrix `a`
+template <typename C>
+constexpr C matrixDeterminant_(const C a[], const std::uint64_t dim) {
+  if (dim == 2) return a[0] * a[3] - a[1] * a[2];
+  if (dim == 3) {
+    return a[0] * (a[4] * a[8] - a[5] * a[7]) - a[1] * (a[3] * a[8] - a[5] * a[6]) +
+           a[2] * (a[3] * a[7] - a[4] * a[6]);
+  }
+  C sub[12]{};
+  subDeterminants4_(sub, a);
+  return determinant4_(sub);
+}
+
+// Adjugate of the dense row-major dim x dim (2, 3 or 4) matrix `a` in `adj`, returns the
+// determinant. The inverse is adj / det.
+template <typename C>
+constexpr C matrixAdjugate_(C adj[], const C a[], const std::uint64_t dim) {
+  if (dim == 2) {
+    adj[0] = a[3];
+    adj[1] = -a[1];
+    adj[2] = -a[2];
+    adj[3] = a[0];
+    return a[0] * a[3] - a[1] * a[2];
+  }
+  if (dim == 3) {
+    // the columns are the cross products of the rows: row1 x row2, row2 x row0, row0 x row1
+    adj[0] = a[4] * a[8] - a[5] * a[7];
+    adj[3] = a[5] * a[6] - a[3] * a[8];
+    adj[6] = a[3] * a[7] - a[4] * a[6];
+    adj[1] = a[7] * a[2] - a[8] * a[1];
+    adj[4] = a[8] * a[0] - a[6] * a[2];
+    adj[7] = a[6] * a[1] - a[7] * a[0];
+    adj[2] = a[1] * a[5] - a[2] * a[4];
+    adj[5] = a[2] * a[3] - a[0] * a[5];
+    adj[8] = a[0] * a[4] - a[1] * a[3];
+    return a[0] * adj[0] + a[1] * adj[3] + a[2] * adj[6];
+  }
+  C s[12]{};
+  subDeterminants4_(s, a);
+  adj[0] = a[5] * s[11] - a[6] * s[10] + a[7] * s[9];
+  adj[1] = -a[1] * s[11] + a[2] * s[10] - a[3] * s[9];
+  adj[2] = a[13] * s[5] - a[14] * s[4] + a[15] * s[3];
+  adj[3] = -a[9] * s[5] + a[10] * s[4] - a[11] * s[3];
+  adj[4] = -a[4] * s[11] + a[6] * s[8] - a[7] * s[7];
+  adj[5] = a[0] * s[11] - a[2] * s[8] + a[3] * s[7];
+  adj[6] = -a[12] * s[5] + a[14] * s[2] - a[15] * s[1];
+  adj[7] = a[8] * s[5] - a[10] * s[2] + a[11] * s[1];
+  adj[8] = a[4] * s[10] - a[5] * s[8] + a[7] * s[6];
+  adj[9] = -a[0] * s[10] + a[1] * s[8] - a[3] * s[6];
+  adj[10] = a[12] * s[4] - a[13] * s[2] + a[15] * s[0];
+  adj[11] = -a[8] * s[4] + a[9] * s[2] - a[11] * s[0];
+  adj[12] = -a[4] * s[9] + a[5] * s[7] - a[6] * s[6];
+  adj[13] = a[0] * s[9] - a[1] * s[7] + a[2] * s[6];
+  adj[14] = -a[12] * s[3] + a[13] * s[1] - a[14] * s[0];
+  adj[15] = a[8] * s[3] - a[9] * s[1] + a[10] * s[0];
+  return determinant4_(s);
+}
+
+// Inverse of the dense row-major dim x dim (2, 3 or 4) matrix `a` in `out`, transposed with
+// kInverseTranspose; `out` may be `a`. Returns the determinant. Singular matrices give inf or
+// NaN; integer matrices divide the adjugate by the determinant, which is exact for +-1.
+template <typename C>
+constexpr C matrixInverse_(
+    C out[], const C a[], const std::uint64_t dim, const std::uint32_t flags) {
+  C adj[16]{};
+  const C det = matrixAdjugate_(adj, a, dim);
+  if constexpr (std::is_integral_v<C>) {
+    for (std::uint64_t i = 0; i < dim * dim; ++i) adj[i] /= det;
+  } else {
+    const C inv_det = C(1) / det;
+    for (std::uint64_t i = 0; i < dim * dim; ++i) adj[i] *= inv_det;
+  }
+  for (std::uint64_t r = 0; r < dim; ++r) {
+    for (std::uint64_t c = 0; c < dim; ++c) {
+      out[r * dim + c] = flags & kInverseTranspose ? adj[c * dim + r] : adj[r * dim + c];
+    }
+  }
+  return det;
+}
+
+// Inverse of the row-major 4x4 affine `a` whose upper 3x3 has orthogonal columns (rotation and
+// per-axis scale, no shear): the transposed 3x3 with row j divided by the squared length of
+// column j, and the translation mapped back through it. `out` may be `a`.
+template <typename C>
+constexpr void matrixInverseAffine_(C out[16], const C a[16]) {
+  C res[16]{};
+  for (int j = 0; j < 3; ++j) {
+    const C size_sq = a[j] * a[j] + a[4 + j] * a[4 + j] + a[8 + j] * a[8 + j];
+    for (int k = 0; k < 3; ++k) res[4 * j + k] = a[4 * k + j] / size_sq;
+    res[4 * j + 3] = -(res[4 * j] * a[3] + res[4 * j + 1] * a[7] + res[4 * j + 2] * a[11]);
+  }
+  res[15] = C(1);
+  for (int i = 0; i < 16; ++i) out[i] = res[i];
+}
+
+// Inverts `count` dim x dim matrices, rows `ld` elements apart and consecutive matrices dim * ld
+// apart. det_out receives the determinants unless it is null.
+template <typename T>
+constexpr void MatrixInverseBatch(
+    T mat_out[], T det_out[], const T mat_arg[], const std::uint32_t dim, const std::uint64_t ld,
+    const std::uint64_t count, const std::uint32_t flags) {
+  using C = compute_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    C a[16]{};
+    const T* mat = mat_arg + i * dim * ld;
+    for (std::uint32_t r = 0; r < dim; ++r) {
+      for (std::uint32_t c = 0; c < dim; ++c) a[r * dim + c] = static_cast<C>(mat[r * ld + c]);
+    }
+    const C det = matrixInverse_(a, a, dim, flags);
+    T* out = mat_out + i * dim * ld;
+    for (std::uint32_t r = 0; r < dim; ++r) {
+      for (std::uint32_t c = 0; c < dim; ++c) out[r * ld + c] = static_cast<T>(a[r * dim + c]);
+    }
+    if (det_out != nullptr) det_out[i] = static_cast<T>(det);
+  }
+}
+
+// `count` dense row-major 4x4 matrices, see matrixInverseAffine_
+template <typename T>
+constexpr void MatrixInverseAffineBatch(
+    T mat_out[], const T mat_arg[], const std::uint64_t count) {
+  using C = compute_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    C a[16]{};
+    for (int j = 0; j < 16; ++j) a[j] = static_cast<C>(mat_arg[16 * i + j]);
+    matrixInverseAffine_(a, a);
+    for (int j = 0; j < 16; ++j) mat_out[16 * i + j] = static_cast<T>(a[j]);
+  }
+}
+
+// lhs * rhs for dense row-major D x D matrices with rows LD elements apart, both template
+// parameters so the loops unroll fully
+template <std::uint32_t D, std::uint64_t LD, typename T>
+constexpr void matrixProdBatch_(
+    T mat_out[], const T mat_lhs[], const T mat_rhs[], const std::uint64_t lhs_stride,
+    const std::uint64_t rhs_stride, const std::uint64_t count) {
+  using C = compute_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const T* a = mat_lhs + i * lhs_stride;
+    const T* b = mat_rhs + i * rhs_stride;
+    C res[D * D]{};
+    for (std::uint32_t r = 0; r < D; ++r) {
+      for (std::uint32_t k = 0; k < D; ++k) {
+        const C a_rk = static_cast<C>(a[r * LD + k]);
+        for (std::uint32_t c = 0; c < D; ++c) {
+          res[r * D + c] += a_rk * static_cast<C>(b[k * LD + c]);
+        }
+      }
+    }
+    T* out = mat_out + i * D * LD;
+    for (std::uint32_t r = 0; r < D; ++r) {
+      for (std::uint32_t c = 0; c < D; ++c) out[r * LD + c] = static_cast<T>(res[r * D + c]);
+    }
+  }
+}
+
+// `count` products of dim x dim matrices with rows `ld` elements apart, ld being dim or 4 for
+// padded 3x3 rows as in MatrixCT. Product i reads the matrices at mat_lhs + i * lhs_stride and
+// mat_rhs + i * rhs_stride, so a stride of 0 multiplies every matrix of the other side by the
+// same one, and writes mat_out + i * dim * ld. mat_out may be a side with a nonzero stride.
+template <typename T>
+constexpr void MatrixProdBatch(
+    T mat_out[], const T mat_lhs[], const T mat_rhs[], const std::uint32_t dim,
+    const std::uint64_t ld, const std::uint64_t lhs_stride, const std::uint64_t rhs_stride,
+    const std::uint64_t count) {
+  if (dim == 2) {
+    matrixProdBatch_<2, 2>(mat_out, mat_lhs, mat_rhs, lhs_stride, rhs_stride, count);
+  } else if (dim == 3 && ld == 3) {
+    matrixProdBatch_<3, 3>(mat_out, mat_lhs, mat_rhs, lhs_stride, rhs_stride, count);
+  } else if (dim == 3) {
+    matrixProdBatch_<3, 4>(mat_out, mat_lhs, mat_rhs, lhs_stride, rhs_stride, count);
+  } else {
+    matrixProdBatch_<4, 4>(mat_out, mat_lhs, mat_rhs, lhs_stride, rhs_stride, count);
+  }
+}
+
+/* dense factorizations */
+
+// Solves A X = B in place of the row-major m x n B, for the m x m triangular A that `flags`
+// selects (TriangularFlags). Only that triangle of A is read. Rows of B are solved in dependency
+// order, each as a combination of the rows solved before it.
+template <typename T>
+constexpr void MatrixTriangularSolve(
+    const std::uint64_t m, const std::uint64_t n, const T mat_a[], const std::uint64_t lda,
+    T mat_b[], const std::uint64_t ldb, const std::uint32_t flags) {
+  using C = compute_t<T>;
+  const bool upper = flags & kTriangularUpper;
+  const bool unit = flags & kTriangularUnitDiagonal;
+  for (std::uint64_t step = 0; step < m; ++step) {
+    const std::uint64_t i = upper ? m - 1 - step : step;
+    const std::uint64_t begin = upper ? i + 1 : 0;
+    const std::uint64_t end = upper ? m : i;
+    const T* a_row = mat_a + i * lda;
+    T* b_row = mat_b + i * ldb;
+    const C diag = unit ? C(1) : C(a_row[i]);
+    if constexpr (!std::is_same_v<T, C>) {
+      // one rounding per element of B instead of one per row it depends on
+      for (std::uint64_t j = 0; j < n; ++j) {
+        C sum = C(b_row[j]);
+        for (std::uint64_t p = begin; p < end; ++p) sum -= C(a_row[p]) * C(mat_b[p * ldb + j]);
+        b_row[j] = static_cast<T>(sum / diag);
+      }
+    } else {
+      for (std::uint64_t p = begin; p < end; ++p) {
+        const T a_ip = a_row[p];
+        const T* src = mat_b + p * ldb;
+        for (std::uint64_t j = 0; j < n; ++j) b_row[j] -= a_ip * src[j];
+      }
+      if (!unit) {
+        for (std::uint64_t j = 0; j < n; ++j) b_row[j] /= diag;
+      }
+    }
+  }
+}
+
+// Unblocked LU with partial pivoting of the row-major rows x cols panel, rows >= cols: L below the
+// diagonal with an implied unit diagonal, U on and above it. pivots[j] is the row, relative to
+// `mat`, that was swapped with row j; the swaps only move the panel's own columns. A column without
+// a nonzero pivot is left unscaled, so U ends up with a zero on its diagonal.
+template <typename T>
+constexpr void MatrixLuPanel(
+    T mat[], const std::uint64_t rows, const std::uint64_t cols, const std::uint64_t ld,
+    std::uint64_t pivots[]) {
+  using C = compute_t<T>;
+  for (std::uint64_t j = 0; j < cols; ++j) {
+    std::uint64_t pivot = j;
+    C largest = abs_(C(mat[j * ld + j]));
+    for (std::uint64_t i = j + 1; i < rows; ++i) {
+      const C value = abs_(C(mat[i * ld + j]));
+      if (value > largest) {
+        largest = value;
+        pivot = i;
+      }
+    }
+    pivots[j] = pivot;
+    T* pivot_row = mat + j * ld;
+    if (pivot != j) {
+      for (std::uint64_t c = 0; c < cols; ++c) {
+        const T tmp = pivot_row[c];
+        pivot_row[c] = mat[pivot * ld + c];
+        mat[pivot * ld + c] = tmp;
+      }
+    }
+    if (largest == C(0)) continue;
+
+    const C diag = C(pivot_row[j]);
+    for (std::uint64_t i = j + 1; i < rows; ++i) {
+      T* row = mat + i * ld;
+      const C l_ij = C(row[j]) / diag;
+      row[j] = static_cast<T>(l_ij);
+      for (std::uint64_t c = j + 1; c < cols; ++c) {
+        row[c] = static_cast<T>(C(row[c]) - l_ij * C(pivot_row[c]));
+      }
+    }
+  }
+}
+
+// Unblocked Cholesky A = U^T U of the row-major dim x dim block, reading only its upper triangle.
+// U replaces the upper triangle and U^T the lower one. info[0] is dim on success, otherwise the
+// first column whose pivot was not positive, and the block is left partly factored.
+template <typename T>
+constexpr void MatrixCholeskyBlock(
+    T mat[], const std::uint64_t dim, const std::uint64_t ld, std::uint64_t info[1]) {
+  using C = compute_t<T>;
+  for (std::uint64_t j = 0; j < dim; ++j) {
+    T* row_j = mat + j * ld;
+    const C pivot = C(row_j[j]);
+    if (!(pivot > C(0))) {
+      info[0] = j;
+      return;
+    }
+    const C diag = sqrt_(pivot);
+    row_j[j] = static_cast<T>(diag);
+    for (std::uint64_t c = j + 1; c < dim; ++c) row_j[c] = static_cast<T>(C(row_j[c]) / diag);
+    for (std::uint64_t i = j + 1; i < dim; ++i) {
+      T* row_i = mat + i * ld;
+      const C u_ji = C(row_j[i]);
+      for (std::uint64_t c = i; c < dim; ++c) {
+        row_i[c] = static_cast<T>(C(row_i[c]) - u_ji * C(row_j[c]));
+      }
+    }
+  }
+  for (std::uint64_t r = 0; r < dim; ++r) {
+    for (std::uint64_t c = r + 1; c < dim; ++c) mat[c * ld + r] = mat[r * ld + c];
+  }
+  info[0] = dim;
+}
+
+/* vector streams */
+
+template <typename T>
+constexpr compute_t<T> streamLengthSq_(
+    const T* const vec_arg[], const std::uint32_t comps, const std::uint64_t i) {
+  compute_t<T> sum = 0;
+  for (std::uint32_t c = 0; c < comps; ++c) sum += vec_arg[c][i] * vec_arg[c][i];
+  return sum;
+}
+
+template <typename T>
+constexpr void StreamDotProd(
+    T out[], const T* const vec_lhs[], const T* const vec_rhs[], const std::uint32_t comps,
+    const std::uint64_t count) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    compute_t<T> sum = 0;
+    for (std::uint32_t c = 0; c < comps; ++c) sum += vec_lhs[c][i] * vec_rhs[c][i];
+    out[i] = static_cast<T>(sum);
+  }
+}
+
+template <typename T>
+constexpr void StreamCrossProd(
+    T* const vec_out[3], const T* const vec_lhs[3], const T* const vec_rhs[3],
+    const std::uint64_t count) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    using C = compute_t<T>;
+    const C x = vec_lhs[1][i] * vec_rhs[2][i] - vec_lhs[2][i] * vec_rhs[1][i];
+    const C y = vec_lhs[2][i] * vec_rhs[0][i] - vec_lhs[0][i] * vec_rhs[2][i];
+    const C z = vec_lhs[0][i] * vec_rhs[1][i] - vec_lhs[1][i] * vec_rhs[0][i];
+    vec_out[0][i] = static_cast<T>(x);
+    vec_out[1][i] = static_cast<T>(y);
+    vec_out[2][i] = static_cast<T>(z);
+  }
+}
+
+template <typename T>
+constexpr void StreamLength(
+    T out[], const T* const vec_arg[], const std::uint32_t comps, const std::uint64_t count) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    out[i] = static_cast<T>(sqrt_(streamLengthSq_(vec_arg, comps, i)));
+  }
+}
+
+// Exact mode divides by the length, the same as vec / Length(vec) on a single vector. Fast mode
+// takes one division per vector and multiplies the components by 1 / length.
+template <typename T>
+constexpr void StreamNormalize(
+    T* const vec_out[], const T* const vec_arg[], const std::uint32_t comps,
+    const std::uint64_t count, const std::uint32_t flags) {
+  using C = compute_t<T>;
+  if constexpr (std::is_floating_point_v<C>) {
+    if (flags & kNormalizeFast) {
+      for (std::uint64_t i = 0; i < count; ++i) {
+        const C scale = C(1) / sqrt_(streamLengthSq_(vec_arg, comps, i));
+        for (std::uint32_t c = 0; c < comps; ++c) {
+          vec_out[c][i] = static_cast<T>(vec_arg[c][i] * scale);
+        }
+      }
+      return;
+    }
+  }
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const C length = sqrt_(streamLengthSq_(vec_arg, comps, i));
+    for (std::uint32_t c = 0; c < comps; ++c) {
+      vec_out[c][i] = static_cast<T>(vec_arg[c][i] / length);
+    }
+  }
+}
+
+/* reductions */
+
+// independent accumulators of the sums, standing in for the lanes of an ISPC gang
+constexpr std::uint64_t kReduceLanes = 8;
+
+// Sum of term(i) over [begin, end), one accumulator per lane. With kKahan every accumulator
+// carries a compensation holding the low-order bits its additions have lost so far.
+template <typename C, bool kKahan, typename F>
+constexpr C reduceLanes_(const std::uint64_t begin, const std::uint64_t end, const F& term) {
+  C sum[kReduceLanes]{};
+  C comp[kReduceLanes]{};
+  const auto add = [&](const std::uint64_t lane, const C value) {
+    if constexpr (kKahan) {
+      const C y = value - comp[lane];
+      const C t = sum[lane] + y;
+      comp[lane] = (t - sum[lane]) - y;
+      sum[lane] = t;
+    } else {
+      sum[lane] += value;
+    }
+  };
+  const std::uint64_t full = begin + (end - begin) / kReduceLanes * kReduceLanes;
+  for (std::uint64_t i = begin; i < full; i += kReduceLanes) {
+    for (std::uint64_t lane = 0; lane < kReduceLanes; ++lane) add(lane, term(i + lane));
+  }
+  // constant lane indices let the accumulators live in registers
+  for (std::uint64_t i = full; i < end; ++i) add(0, term(i));
+
+  C res = 0;
+  for (std::uint64_t lane = 0; lane < kReduceLanes; ++lane) res += sum[lane] - comp[lane];
+  return res;
+}
+
+// sum of term(i) over [0, len), pairwise over kReduceBlock-element blocks when `pairwise`
+template <typename C, bool kKahan, typename F>
+constexpr C reducePairwise_(const std::uint64_t len, const bool pairwise, const F& term) {
+  if (!pairwise) return reduceLanes_<C, kKahan>(0, len, term);
+
+  // block sums are merged like a binary counter, stack[d] holds the sum of 2^k blocks with k
+  // decreasing in d
+  C stack[64]{};
+  int depth = 0;
+  std::uint64_t blocks = 0;
+  for (std::uint64_t begin = 0; begin < len; begin += kReduceBlock) {
+    C value = reduceLanes_<C, kKahan>(begin, std::min(begin + kReduceBlock, len), term);
+    for (std::uint64_t n = ++blocks; (n & 1) == 0; n >>= 1) value = stack[--depth] + value;
+    stack[depth++] = value;
+  }
+  C res = 0;
+  while (depth > 0) res = stack[--depth] + res;
+  return res;
+}
+
+// sum of term(i) over [0, len) as selected by ReduceFlags
+template <typename C, typename F>
+constexpr C reduceSum_(const std::uint64_t len, const std::uint32_t flags, const F& term) {
+  const bool pairwise = flags & kReducePairwise;
+  if (std::is_floating_point_v<C> && (flags & kReduceKahan)) {
+    return reducePairwise_<C, true>(len, pairwise, term);
+  }
+  return reducePairwise_<C, false>(len, pairwise, term);
+}
+
+template <typename T>
+constexpr void ReduceSum(
+    compute_t<T> out[1], const T vec_arg[], const std::uint64_t len, const std::uint32_t flags) {
+  using C = compute_t<T>;
+  out[0] = reduceSum_<C>(len, flags, [&](const std::uint64_t i) { return C(vec_arg[i]); });
+}
+
+template <typename T>
+constexpr void ReduceAbsSum(
+    compute_t<T> out[1], const T vec_arg[], const std::uint64_t len, const std::uint32_t flags) {
+  using C = compute_t<T>;
+  out[0] = reduceSum_<C>(
+      len, flags, [&](const std::uint64_t i) { return abs_(C(vec_arg[i])); });
+}
+
+template <typename T>
+constexpr void ReduceDotProd(
+    compute_t<T> out[1], const T vec_lhs[], const T vec_rhs[], const std::uint64_t len,
+    const std::uint32_t flags) {
+  using C = compute_t<T>;
+  out[0] = reduceSum_<C>(
+      len, flags, [&](const std::uint64_t i) { return C(vec_lhs[i]) * C(vec_rhs[i]); });
+}
+
+// Smallest and largest element with the index of their first occurrence, len must not be 0.
+// Each kReduceBlock block is scanned for its extremes without tracking indices, which vectorizes;
+// only a block that improves on the extremes so far is searched again for the index.
+template <typename T>
+constexpr void ReduceMinMax(
+    T out[2], std::uint64_t index[2], const T vec_arg[], const std::uint64_t len) {
+  using C = compute_t<T>;
+  C lo_all = vec_arg[0];
+  C hi_all = lo_all;
+  index[0] = index[1] = 0;
+  for (std::uint64_t begin = 0; begin < len; begin += kReduceBlock) {
+    const std::uint64_t end = std::min(begin + kReduceBlock, len);
+    C lo[kReduceLanes]{};
+    C hi[kReduceLanes]{};
+    for (std::uint64_t lane = 0; lane < kReduceLanes; ++lane) lo[lane] = hi[lane] = vec_arg[begin];
+    const std::uint64_t full = begin + (end - begin) / kReduceLanes * kReduceLanes;
+    for (std::uint64_t i = begin; i < full; i += kReduceLanes) {
+      for (std::uint64_t lane = 0; lane < kReduceLanes; ++lane) {
+        const C value = vec_arg[i + lane];
+        lo[lane] = value < lo[lane] ? value : lo[lane];
+        hi[lane] = value > hi[lane] ? value : hi[lane];
+      }
+    }
+    for (std::uint64_t i = full; i < end; ++i) {
+      const C value = vec_arg[i];
+      lo[0] = value < lo[0] ? value : lo[0];
+      hi[0] = value > hi[0] ? value : hi[0];
+    }
+
+    C lo_block = lo[0];
+    C hi_block = hi[0];
+    for (std::uint64_t lane = 1; lane < kReduceLanes; ++lane) {
+      lo_block = lo[lane] < lo_block ? lo[lane] : lo_block;
+      hi_block = hi[lane] > hi_block ? hi[lane] : hi_block;
+    }
+    if (lo_block < lo_all) {
+      lo_all = lo_block;
+      for (index[0] = begin; !(C(vec_arg[index[0]]) == lo_block); ++index[0]) {
+      }
+    }
+    if (hi_block > hi_all) {
+      hi_all = hi_block;
+      for (index[1] = begin; !(C(vec_arg[index[1]]) == hi_block); ++index[1]) {
+      }
+    }
+  }
+  out[0] = vec_arg[index[0]];
+  out[1] = vec_arg[index[1]];
+}
+
+/* quaternions */
+
+// type the quaternion kernels evaluate in, int32 goes through float and truncates
+template <typename T>
+using quaternion_t = std::conditional_t<std::is_integral_v<T>, float, compute_t<T>>;
+
+// Quaternions are (x, y, z, w) with w the real part. Products follow Hamilton's convention, so
+// lhs * rhs rotates by rhs first; rotations expect unit quaternions. The helpers below are shared
+// by the kernels and the scalar functions in quaternion.h, outputs may alias inputs.
+
+template <typename C>
+constexpr void quaternionMul_(C out[4], const C lhs[4], const C rhs[4]) {
+  const C x = lhs[3] * rhs[0] + lhs[0] * rhs[3] + lhs[1] * rhs[2] - lhs[2] * rhs[1];
+  const C y = lhs[3] * rhs[1] - lhs[0] * rhs[2] + lhs[1] * rhs[3] + lhs[2] * rhs[0];
+  const C z = lhs[3] * rhs[2] + lhs[0] * rhs[1] - lhs[1] * rhs[0] + lhs[2] * rhs[3];
+  const C w = lhs[3] * rhs[3] - lhs[0] * rhs[0] - lhs[1] * rhs[1] - lhs[2] * rhs[2];
+  out[0] = x;
+  out[1] = y;
+  out[2] = z;
+  out[3] = w;
+}
+
+// v + w * t + q.xyz x t with t = 2 * q.xyz x v
+template <typename C>
+constexpr void quaternionRotate_(C out[3], const C quat[4], const C vec[3]) {
+  const C tx = 2 * (quat[1] * vec[2] - quat[2] * vec[1]);
+  const C ty = 2 * (quat[2] * vec[0] - quat[0] * vec[2]);
+  const C tz = 2 * (quat[0] * vec[1] - quat[1] * vec[0]);
+  const C x = vec[0] + quat[3] * tx + (quat[1] * tz - quat[2] * ty);
+  const C y = vec[1] + quat[3] * ty + (quat[2] * tx - quat[0] * tz);
+  const C z = vec[2] + quat[3] * tz + (quat[0] * ty - quat[1] * tx);
+  out[0] = x;
+  out[1] = y;
+  out[2] = z;
+}
+
+// normalized lerp along the shorter arc
+template <typename C>
+constexpr void quaternionNlerp_(C out[4], const C lhs[4], const C rhs[4], const C weight) {
+  const C dot = lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2] + lhs[3] * rhs[3];
+  const C rhs_weight = dot < 0 ? -weight : weight;
+  C res[4]{};
+  for (int i = 0; i < 4; ++i) res[i] = lhs[i] * (1 - weight) + rhs[i] * rhs_weight;
+  const C length = sqrt_(res[0] * res[0] + res[1] * res[1] + res[2] * res[2] + res[3] * res[3]);
+  for (int i = 0; i < 4; ++i) out[i] = res[i] / length;
+}
+
+// above this cosine of the angle between the inputs slerp falls back to nlerp
+constexpr double kSlerpNlerpThreshold = 0.9995;
+
+// spherical lerp along the shorter arc
+template <typename C>
+constexpr void quaternionSlerp_(C out[4], const C lhs[4], const C rhs[4], const C weight) {
+  const C dot = lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2] + lhs[3] * rhs[3];
+  const C cos_angle = dot < 0 ? -dot : dot;
+  if (cos_angle > C(kSlerpNlerpThreshold)) {
+    quaternionNlerp_(out, lhs, rhs, weight);
+    return;
+  }
+  const C angle = acos_(cos_angle);
+  const C sin_angle = sqrt_(1 - cos_angle * cos_angle);
+  const C lhs_weight = sin_((1 - weight) * angle) / sin_angle;
+  const C rhs_weight = (dot < 0 ? -sin_(weight * angle) : sin_(weight * angle)) / sin_angle;
+  C res[4]{};
+  for (int i = 0; i < 4; ++i) res[i] = lhs[i] * lhs_weight + rhs[i] * rhs_weight;
+  for (int i = 0; i < 4; ++i) out[i] = res[i];
+}
+
+// row-major 3x3 rotation
+template <typename C>
+constexpr void quaternionToMatrix_(C out[9], const C quat[4]) {
+  const C x = quat[0], y = quat[1], z = quat[2], w = quat[3];
+  out[0] = 1 - 2 * (y * y + z * z);
+  out[1] = 2 * (x * y - w * z);
+  out[2] = 2 * (x * z + w * y);
+  out[3] = 2 * (x * y + w * z);
+  out[4] = 1 - 2 * (x * x + z * z);
+  out[5] = 2 * (y * z - w * x);
+  out[6] = 2 * (x * z - w * y);
+  out[7] = 2 * (y * z + w * x);
+  out[8] = 1 - 2 * (x * x + y * y);
+}
+
+// from a row-major 3x3 rotation, pivoting on the largest of w, x, y, z (Shepperd)
+template <typename C>
+constexpr void quaternionFromMatrix_(C out[4], const C mat[9]) {
+  const C trace = mat[0] + mat[4] + mat[8];
+  if (trace > 0) {
+    const C s = 2 * sqrt_(trace + 1);
+    out[0] = (mat[7] - mat[5]) / s;
+    out[1] = (mat[2] - mat[6]) / s;
+    out[2] = (mat[3] - mat[1]) / s;
+    out[3] = s / 4;
+  } else if (mat[0] > mat[4] && mat[0] > mat[8]) {
+    const C s = 2 * sqrt_(1 + mat[0] - mat[4] - mat[8]);
+    out[0] = s / 4;
+    out[1] = (mat[1] + mat[3]) / s;
+    out[2] = (mat[2] + mat[6]) / s;
+    out[3] = (mat[7] - mat[5]) / s;
+  } else if (mat[4] > mat[8]) {
+    const C s = 2 * sqrt_(1 + mat[4] - mat[0] - mat[8]);
+    out[0] = (mat[1] + mat[3]) / s;
+    out[1] = s / 4;
+    out[2] = (mat[5] + mat[7]) / s;
+    out[3] = (mat[2] - mat[6]) / s;
+  } else {
+    const C s = 2 * sqrt_(1 + mat[8] - mat[0] - mat[4]);
+    out[0] = (mat[2] + mat[6]) / s;
+    out[1] = (mat[5] + mat[7]) / s;
+    out[2] = s / 4;
+    out[3] = (mat[3] - mat[1]) / s;
+  }
+}
+
+template <typename T, size_t N>
+constexpr void quaternionLoad_(
+    quaternion_t<T> out[], const T* const arg[N], const std::uint64_t i) {
+  for (size_t c = 0; c < N; ++c) out[c] = static_cast<quaternion_t<T>>(arg[c][i]);
+}
+
+template <typename T, size_t N>
+constexpr void quaternionStore_(
+    T* const out[N], const quaternion_t<T> arg[], const std::uint64_t i) {
+  for (size_t c = 0; c < N; ++c) out[c][i] = static_cast<T>(arg[c]);
+}
+
+template <typename T>
+constexpr void QuaternionMulSoA(
+    T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],
+    const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q lhs[4]{}, rhs[4]{}, res[4]{};
+    quaternionLoad_<T, 4>(lhs, quat_lhs, i);
+    quaternionLoad_<T, 4>(rhs, quat_rhs, i);
+    quaternionMul_(res, lhs, rhs);
+    quaternionStore_<T, 4>(quat_out, res, i);
+  }
+}
+
+template <typename T>
+constexpr void QuaternionRotateSoA(
+    T* const vec_out[3], const T* const quat_arg[4], const T* const vec_arg[3],
+    const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q quat[4]{}, vec[3]{}, res[3]{};
+    quaternionLoad_<T, 4>(quat, quat_arg, i);
+    quaternionLoad_<T, 3>(vec, vec_arg, i);
+    quaternionRotate_(res, quat, vec);
+    quaternionStore_<T, 3>(vec_out, res, i);
+  }
+}
+
+// weight[i * weight_stride] blends quaternion i, a stride of 0 applies weight[0] to all of them
+template <typename T>
+constexpr void QuaternionNlerpSoA(
+    T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],
+    const T weight[], const std::uint64_t weight_stride, const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q lhs[4]{}, rhs[4]{}, res[4]{};
+    quaternionLoad_<T, 4>(lhs, quat_lhs, i);
+    quaternionLoad_<T, 4>(rhs, quat_rhs, i);
+    quaternionNlerp_(res, lhs, rhs, static_cast<Q>(weight[i * weight_stride]));
+    quaternionStore_<T, 4>(quat_out, res, i);
+  }
+}
+
+template <typename T>
+constexpr void QuaternionSlerpSoA(
+    T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],
+    const T weight[], const std::uint64_t weight_stride, const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q lhs[4]{}, rhs[4]{}, res[4]{};
+    quaternionLoad_<T, 4>(lhs, quat_lhs, i);
+    quaternionLoad_<T, 4>(rhs, quat_rhs, i);
+    quaternionSlerp_(res, lhs, rhs, static_cast<Q>(weight[i * weight_stride]));
+    quaternionStore_<T, 4>(quat_out, res, i);
+  }
+}
+
+// writes `count` row-major 4x4 rotation matrices, 16 elements apart
+template <typename T>
+constexpr void QuaternionToMatrixSoA(
+    T mat_out[], const T* const quat_arg[4], const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q quat[4]{}, rot[9]{};
+    quaternionLoad_<T, 4>(quat, quat_arg, i);
+    quaternionToMatrix_(rot, quat);
+    T* mat = mat_out + 16 * i;
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) mat[4 * r + c] = static_cast<T>(rot[3 * r + c]);
+      mat[4 * r + 3] = T(0);
+    }
+    mat[12] = mat[13] = mat[14] = T(0);
+    mat[15] = T(1);
+  }
+}
+
+// reads the rotation part of `count` row-major 4x4 matrices, 16 elements apart
+template <typename T>
+constexpr void QuaternionFromMatrixSoA(
+    T* const quat_out[4], const T mat_arg[], const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    Q rot[9]{}, res[4]{};
+    const T* mat = mat_arg + 16 * i;
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) rot[3 * r + c] = static_cast<Q>(mat[4 * r + c]);
+    }
+    quaternionFromMatrix_(res, rot);
+    quaternionStore_<T, 4>(quat_out, res, i);
+  }
+}
+
+/* rotation builders */
+
+// angles per block of the rotation builders, their sines and cosines are taken in one loop first
+constexpr std::uint64_t kRotationBlock = 64;
+
+template <typename T>
+constexpr void rotationSinCos_(
+    quaternion_t<T> sin_out[], quaternion_t<T> cos_out[], const T angle[],
+    const std::uint64_t len, const std::uint32_t flags) {
+  using Q = quaternion_t<T>;
+  if (flags & kRotationFast) {
+    for (std::uint64_t i = 0; i < len; ++i) {
+      sincosFast_(static_cast<Q>(angle[i]), sin_out[i], cos_out[i]);
+    }
+    return;
+  }
+  for (std::uint64_t i = 0; i < len; ++i) {
+    sin_out[i] = sin_(static_cast<Q>(angle[i]));
+    cos_out[i] = cos_(static_cast<Q>(angle[i]));
+  }
+}
+
+// a row-major 3x3 rotation as the upper 3x4 of `mat`, followed by (0, 0, 0, 1) unless
+// kRotationAffine
+template <typename T, typename C>
+constexpr void rotationStore_(T mat[], const C rot[9], const std::uint32_t flags) {
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 3; ++c) mat[4 * r + c] = static_cast<T>(rot[3 * r + c]);
+    mat[4 * r + 3] = T(0);
+  }
+  if (flags & kRotationAffine) return;
+  mat[12] = mat[13] = mat[14] = T(0);
+  mat[15] = T(1);
+}
+
+// Rz(angle[2]) * Ry(angle[1]) * Rx(angle[0]) for `count` angle triples, so x (roll) applies first
+// and z (yaw) last. Writes row-major 4x4 matrices 16 elements apart, or 3x4 ones 12 apart with
+// kRotationAffine.
+template <typename T>
+constexpr void RotationFromEulerSoA(
+    T mat_out[], const T* const angle[3], const std::uint64_t count, const std::uint32_t flags) {
+  using Q = quaternion_t<T>;
+  const std::uint64_t stride = flags & kRotationAffine ? 12 : 16;
+  for (std::uint64_t begin = 0; begin < count; begin += kRotationBlock) {
+    const std::uint64_t len = std::min(count - begin, kRotationBlock);
+    Q sines[3][kRotationBlock]{}, cosines[3][kRotationBlock]{};
+    for (int a = 0; a < 3; ++a) {
+      rotationSinCos_<T>(sines[a], cosines[a], angle[a] + begin, len, flags);
+    }
+    for (std::uint64_t i = 0; i < len; ++i) {
+      const Q sx = sines[0][i], sy = sines[1][i], sz = sines[2][i];
+      const Q cx = cosines[0][i], cy = cosines[1][i], cz = cosines[2][i];
+      const Q rot[9]{cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx,
+                     sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx,
+                     -sy,     cy * sx,                cy * cx};
+      rotationStore_(mat_out + stride * (begin + i), rot, flags);
+    }
+  }
+}
+
+// Rotations by angle[i] around the unit axis i (Rodrigues), the same as BuildQuaternion followed
+// by BuildRotationMatrix. Writes like RotationFromEulerSoA.
+template <typename T>
+constexpr void RotationFromAxisAngleSoA(
+    T mat_out[], const T* const axis[3], const T angle[], const std::uint64_t count,
+    const std::uint32_t flags) {
+  using Q = quaternion_t<T>;
+  const std::uint64_t stride = flags & kRotationAffine ? 12 : 16;
+  for (std::uint64_t begin = 0; begin < count; begin += kRotationBlock) {
+    const std::uint64_t len = std::min(count - begin, kRotationBlock);
+    Q sines[kRotationBlock]{}, cosines[kRotationBlock]{};
+    rotationSinCos_<T>(sines, cosines, angle + begin, len, flags);
+    for (std::uint64_t i = 0; i < len; ++i) {
+      const std::uint64_t n = begin + i;
+      const Q x = static_cast<Q>(axis[0][n]), y = static_cast<Q>(axis[1][n]);
+      const Q z = static_cast<Q>(axis[2][n]);
+      const Q s = sines[i], c = cosines[i], t = 1 - cosines[i];
+      const Q rot[9]{c + x * x * t,     x * y * t - z * s, x * z * t + y * s,
+                     x * y * t + z * s, c + y * y * t,     y * z * t - x * s,
+                     x * z * t - y * s, y * z * t + x * s, c + z * z * t};
+      rotationStore_(mat_out + stride * n, rot, flags);
+    }
+  }
+}
+
+// marks a root in the parent array of TransformComposeSoA
+constexpr std::uint32_t kTransformNoParent = 0xFFFFFFFF;
+
+// world[n] = world[parent[n]] * translation * rotation * scale of n, for every n in node[0, count);
+// roots take their local matrix alone. Matrices are row-major 4x4, 16 elements apart. `local`
+// holds the translation x, y, z, the rotation x, y, z, w and the scale x, y, z arrays, indexed by
+// node. No node may be the parent of another node of the same call.
+template <typename T>
+constexpr void TransformComposeSoA(
+    T world[], const T* const local[10], const std::uint32_t parent[],
+    const std::uint32_t node[], const std::uint64_t count) {
+  using Q = quaternion_t<T>;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const std::uint32_t n = node[i];
+    Q trs[10]{}, rot[9]{};
+    for (int c = 0; c < 10; ++c) trs[c] = static_cast<Q>(local[c][n]);
+    quaternionToMatrix_(rot, trs + 3);
+    // rows 0 to 2 of the local matrix, row 3 is (0, 0, 0, 1)
+    Q mat[12]{};
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) mat[4 * r + c] = rot[3 * r + c] * trs[7 + c];
+      mat[4 * r + 3] = trs[r];
+    }
+    T* out = world + 16 * std::uint64_t(n);
+    if (parent[n] == kTransformNoParent) {
+      for (int k = 0; k < 12; ++k) out[k] = static_cast<T>(mat[k]);
+      out[12] = out[13] = out[14] = T(0);
+      out[15] = T(1);
+      continue;
+    }
+    const T* in = world + 16 * std::uint64_t(parent[n]);
+    for (int r = 0; r < 4; ++r) {
+      const Q w0 = static_cast<Q>(in[4 * r]), w1 = static_cast<Q>(in[4 * r + 1]);
+      const Q w2 = static_cast<Q>(in[4 * r + 2]), w3 = static_cast<Q>(in[4 * r + 3]);
+      for (int c = 0; c < 4; ++c) {
+        Q sum = w0 * mat[c] + w1 * mat[4 + c] + w2 * mat[8 + c];
+        if (c == 3) sum += w3;
+        out[4 * r + c] = static_cast<T>(sum);
+      }
+    }
+  }
+}
+
+/* skinning */
+
+// Linear-blend skinning of SoA vertices: every vertex blends the upper 3x4 of up to four row-major
+// 4x4 bone matrices of `palette` by its weights and transforms its position by the blend, and its
+// normal by the blend's 3x3 followed by a renormalization. Influences of weight 0 are skipped.
+// normal_in and normal_out may be null to skin positions only; outputs may alias their inputs.
+template <typename T>
+constexpr void SkinSoA(
+    T* const pos_out[3], T* const normal_out[3], const T palette[],
+    const std::uint32_t* const bone[4], const T* const weight[4], const T* const pos_in[3],
+    const T* const normal_in[3], const std::uint64_t count) {
+  using C = compute_t<T>;
+  const bool normals = normal_in != nullptr && normal_out != nullptr;
+  for (std::uint64_t i = 0; i < count; ++i) {
+    C blend[12]{};
+    for (int k = 0; k < 4; ++k) {
+      const C w = static_cast<C>(weight[k][i]);
+      if (w == C(0)) continue;
+      const T* mat = palette + std::uint64_t(bone[k][i]) * 16;
+      for (int j = 0; j < 12; ++j) blend[j] += w * static_cast<C>(mat[j]);
+    }
+    const C pos[3]{
+        static_cast<C>(pos_in[0][i]), static_cast<C>(pos_in[1][i]), static_cast<C>(pos_in[2][i])};
+    for (int r = 0; r < 3; ++r) {
+      const C* row = blend + 4 * r;
+      pos_out[r][i] = static_cast<T>(row[0] * pos[0] + row[1] * pos[1] + row[2] * pos[2] + row[3]);
+    }
+    if (!normals) continue;
+    const C normal[3]{
+        static_cast<C>(normal_in[0][i]), static_cast<C>(normal_in[1][i]),
+        static_cast<C>(normal_in[2][i])};
+    C res[3]{};
+    for (int r = 0; r < 3; ++r) {
+      const C* row = blend + 4 * r;
+      res[r] = row[0] * normal[0] + row[1] * normal[1] + row[2] * normal[2];
+    }
+    const C length = sqrt_(res[0] * res[0] + res[1] * res[1] + res[2] * res[2]);
+    for (int r = 0; r < 3; ++r) {
+      normal_out[r][i] = static_cast<T>(length > C(0) ? res[r] / length : res[r]);
+    }
+  }
+}
+
+/* culling */
+
+// objects per pass over the six planes, the distances of one pass stay in L1
+constexpr std::uint64_t kCullBlock = 256;
+
+// appends the indices of the objects in [base, base + len) that no plane culled
+constexpr std::uint64_t cullCompact_(
+    std::uint32_t out_index[], std::uint64_t visible, const std::uint8_t culled[],
+    const std::uint32_t index_base, const std::uint64_t base, const std::uint64_t len) {
+  for (std::uint64_t i = 0; i < len; ++i) {
+    if (!culled[i]) out_index[visible++] = index_base + static_cast<std::uint32_t>(base + i);
+  }
+  return visible;
+}
+
+// An object is culled when it lies entirely on the outer side of one of the six planes
+// (a, b, c, d), inside where a x + b y + c z + d >= 0. Indices of the others go to out_index in
+// increasing order, offset by index_base, and out_count[0] receives their number. Each block is
+// tested one plane at a time, so the inner loops have no branches and vectorize.
+template <typename T>
+constexpr void CullAabbSoA(
+    std::uint32_t out_index[], std::uint64_t out_count[1], const compute_t<T> planes[24],
+    const T* const aabb_min[3], const T* const aabb_max[3], const std::uint32_t index_base,
+    const std::uint64_t count) {
+  using C = compute_t<T>;
+  std::uint64_t visible = 0;
+  for (std::uint64_t base = 0; base < count; base += kCullBlock) {
+    const std::uint64_t len = std::min(kCullBlock, count - base);
+    std::uint8_t culled[kCullBlock]{};
+    for (int p = 0; p < 6; ++p) {
+      // the corner furthest along the plane normal is the last one to leave the half space
+      const C* plane = planes + 4 * p;
+      const T* x = (plane[0] >= C(0) ? aabb_max[0] : aabb_min[0]) + base;
+      const T* y = (plane[1] >= C(0) ? aabb_max[1] : aabb_min[1]) + base;
+      const T* z = (plane[2] >= C(0) ? aabb_max[2] : aabb_min[2]) + base;
+      for (std::uint64_t i = 0; i < len; ++i) {
+        const C dist = plane[0] * static_cast<C>(x[i]) + plane[1] * static_cast<C>(y[i]) +
+                       plane[2] * static_cast<C>(z[i]) + plane[3];
+        culled[i] |= dist < C(0);
+      }
+    }
+    visible = cullCompact_(out_index, visible, culled, index_base, base, len);
+  }
+  out_count[0] = visible;
+}
+
+// spheres are (x, y, z, radius)
+template <typename T>
+constexpr void CullSphereSoA(
+    std::uint32_t out_index[], std::uint64_t out_count[1], const compute_t<T> planes[24],
+    const T* const sphere[4], const std::uint32_t index_base, const std::uint64_t count) {
+  using C = compute_t<T>;
+  std::uint64_t visible = 0;
+  for (std::uint64_t base = 0; base < count; base += kCullBlock) {
+    const std::uint64_t len = std::min(kCullBlock, count - base);
+    const T* x = sphere[0] + base;
+    const T* y = sphere[1] + base;
+    const T* z = sphere[2] + base;
+    const T* radius = sphere[3] + base;
+    std::uint8_t culled[kCullBlock]{};
+    for (int p = 0; p < 6; ++p) {
+      const C* plane = planes + 4 * p;
+      for (std::uint64_t i = 0; i < len; ++i) {
+        const C dist = plane[0] * static_cast<C>(x[i]) + plane[1] * static_cast<C>(y[i]) +
+                       plane[2] * static_cast<C>(z[i]) + plane[3];
+        culled[i] |= dist < -static_cast<C>(radius[i]);
+      }
+    }
+    visible = cullCompact_(out_index, visible, culled, index_base, base, len);
+  }
+  out_count[0] = visible;
+}
+
+/* sparse */
+
+// vec_out = A vec_in for the CSR matrix A with `rows` rows
+template <typename T>
+constexpr void SparseMatVec(
+    T vec_out[], const std::uint64_t row_begin[], const std::uint32_t col[], const T values[],
+    const T vec_in[], const std::uint64_t rows) {
+  using C = compute_t<T>;
+  for (std::uint64_t r = 0; r < rows; ++r) {
+    C sum = 0;
+    for (std::uint64_t k = row_begin[r]; k < row_begin[r + 1]; ++k) {
+      sum += static_cast<C>(values[k]) * static_cast<C>(vec_in[col[k]]);
+    }
+    vec_out[r] = static_cast<T>(sum);
+  }
+}
+
+}  // namespace kplutl::portable
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+
+#include "config.h"
+#include "utils.h"
+
+/*
+    Opt-in instrumentation of the kernel calls. In a build with the CMake option CT_ENABLE_PROFILE,
+    every call a dispatch helper makes into a kernel of CT_KERNELS (AddForeach, MatrixGemm, ...)
+    adds to that kernel's call count, element count, bytes touched, nanoseconds and time-stamp
+    counter cycles. The counters belong to the calling thread: only that thread writes them, with
+    plain relaxed stores, so recording takes neither a lock nor a locked read-modify-write.
+    GetKernelProfile sums the counters of all threads. Without the option CT_PROFILE_BEGIN and
+    CT_PROFILE_END expand to nothing and the helpers compile as before.
+
+    Timing reads two clocks per call, which outweighs a kernel on a 4-element vector; for those the
+    call and element counts are what tells.
+*/
+
+namespace kplutl {
+#ifdef ENABLE_PROFILE
+constexpr bool kProfileEnabled = true;
+#else
+constexpr bool kProfileEnabled = false;
+#endif
+
+// one per kernel of CT_KERNELS, in list order
+enum class KernelId : std::uint32_t {
+#define CT_KERNEL_ID(name, params, args, T, suffix) k##name,
+  CT_KERNELS(CT_KERNEL_ID, float, )
+#undef CT_KERNEL_ID
+  kCount
+};
+
+constexpr size_t kKernelCount = static_cast<size_t>(KernelId::kCount);
+
+// "AddForeach" for KernelId::kAddForeach
+const char* KernelName(KernelId kernel);
+
+struct KernelCounters {
+  std::uint64_t calls = 0;
+  // what the kernel runs over: elements of element-wise kernels and reductions, matrices of batch
+  // kernels, vertices, rows or nonzeros, as the helper counts them
+  std::uint64_t elements = 0;
+  std::uint64_t bytes = 0;  // read plus written, as the helper estimates them
+  std::uint64_t nanoseconds = 0;
+  std::uint64_t cycles = 0;  // time-stamp counter ticks, 0 on CPUs without one
+};
+
+inline KernelCounters operator-(const KernelCounters& lhs, const KernelCounters& rhs) {
+  return {lhs.calls - rhs.calls, lhs.elements - rhs.elements, lhs.bytes - rhs.bytes,
+          lhs.nanoseconds - rhs.nanoseconds, lhs.cycles - rhs.cycles};
+}
+
+// Totals over all threads since the start of the process, all zero unless kProfileEnabled. Diff
+// two snapshots to profile a stretch of code.
+struct KernelProfile {
+  KernelCounters kernels[kKernelCount];
+
+  const KernelCounters& operator[](const KernelId kernel) const {
+    return kernels[static_cast<size_t>(kernel)];
+  }
+};
+
+inline KernelProfile operator-(const KernelProfile& lhs, const KernelProfile& rhs) {
+  KernelProfile res;
+  for (size_t k = 0; k < kKernelCount; ++k) res.kernels[k] = lhs.kernels[k] - rhs.kernels[k];
+  return res;
+}
+
+KernelProfile GetKernelProfile();
+
+// A table of the kernels called in `profile`, most time first: calls, elements, bytes,
+// nanoseconds, cycles and nanoseconds per call.
+std::string KernelProfileReport(const KernelProfile& profile);
+
+/* inline functions */
+
+// clocks at the start of a kernel call
+struct ProfileStamp {
+  std::uint64_t nanoseconds = 0;
+  std::uint64_t cycles = 0;
+};
+
+ProfileStamp profileBegin_();
+// adds one call started at `start` to the calling thread's counters of `kernel`
+void profileEnd_(
+    KernelId kernel, const ProfileStamp& start, std::uint64_t elements, std::uint64_t bytes);
+
+}  // namespace kplutl
+
+// Brackets a kernel call in a dispatch helper, constexpr ones included:
+//   CT_PROFILE_BEGIN(AddForeach);
+//   ... ispc::AddForeach or portable::AddForeach<T> ...
+//   CT_PROFILE_END(AddForeach, N, 3 * N * sizeof(T));
+// The arguments of CT_PROFILE_END are not evaluated without ENABLE_PROFILE.
+#ifdef ENABLE_PROFILE
+#define CT_PROFILE_BEGIN(kernel) \
+  const ::kplutl::ProfileStamp ct_profile_##kernel##_ = ::kplutl::profileBegin_()
+#define CT_PROFILE_END(kernel, elements, bytes)                                         \
+  ::kplutl::profileEnd_(                                                               \
+      ::kplutl::KernelId::k##kernel, ct_profile_##kernel##_, std::uint64_t(elements), \
+      std::uint64_t(bytes))
+#else
+#define CT_PROFILE_BEGIN(kernel) static_cast<void>(0)
+#define CT_PROFILE_END(kernel, elements, bytes) static_cast<void>(0)
+#endif
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cassert>
+
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "utils.h"
+#include "profile.h"
+#include "vector.h"
+#include "matrix.h"
+#include "linear_algebra.h"
+#include "vector_stream.h"
+#include "portable.h"
+
+/*
+    Quaternions are (x, y, z, w) with w the real part. QuaternionProd(lhs, rhs) is the Hamilton
+    product and rotates by rhs first, Rotate and the matrix conversions expect unit quaternions.
+    Batches of quaternions are VectorStream<T, 4>; their functions run one quaternion per SIMD
+    lane. int32 quaternions are evaluated in float and truncated on the way out.
+*/
+
+namespace kplutl {
+template <class T>
+class Quaternion : public VectorCT<T, 4> {
+ public:
+  using VectorCT<T, 4>::VectorCT;
+
+  constexpr Quaternion<T>() = default;
+  explicit constexpr Quaternion<T>(const VectorCT<T, 4>& vec) : VectorCT<T, 4>(vec) {}
+
+  static constexpr Quaternion<T> Identity() { return Quaternion<T>{0, 0, 0, 1}; }
+
+  constexpr const T x() const { return this->data_[0]; }
+  constexpr const T y() const { return this->data_[1]; }
+  constexpr const T z() const { return this->data_[2]; }
+  constexpr const T w() const { return this->data_[3]; }
+};
+
+template <typename T>
+using QuaternionStream = VectorStream<T, 4>;
+
+/* type defines */
+
+using Quaternionf = Quaternion<float>;
+using Quaterniond = Quaternion<double>;
+
+/* inline functions */
+
+template <typename T, size_t N>
+constexpr std::array<portable::quaternion_t<T>, N> quaternionArgs_(const VectorCT<T, N>& vec) {
+  std::array<portable::quaternion_t<T>, N> res{};
+  for (size_t i = 0; i < N; ++i) res[i] = static_cast<portable::quaternion_t<T>>(vec[i]);
+  return res;
+}
+
+template <typename R, typename C, size_t N>
+constexpr R quaternionResult_(const std::array<C, N>& res) {
+  using T = std::remove_reference_t<decltype(std::declval<R&>()[0])>;
+  R out;
+  for (size_t i = 0; i < N; ++i) out[i] = static_cast<T>(res[i]);
+  return out;
+}
+
+// row-major 3x3 rotation part of a 3x3 or 4x4 matrix
+template <typename T, size_t D>
+constexpr std::array<portable::quaternion_t<T>, 9> rotationArgs_(const MatrixCT<T, D, D>& mat) {
+  std::array<portable::quaternion_t<T>, 9> res{};
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 3; ++c) {
+      res[3 * r + c] = static_cast<portable::quaternion_t<T>>(mat[r][c]);
+    }
+  }
+  return res;
+}
+
+template <typename T>
+inline void quaternionMulSoA_(
+    QuaternionStream<T>& out, const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs) {
+  assert(lhs.size() == rhs.size() && out.size() == lhs.size());
+  const auto out_comps = out.Components();
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  CT_PROFILE_BEGIN(QuaternionMulSoA);
+#ifdef ENABLE_ISPC
+  ispc::QuaternionMulSoA(out_comps.data(), lhs_comps.data(), rhs_comps.data(), lhs.size());
+#else
+  portable::QuaternionMulSoA<T>(out_comps.data(), lhs_comps.data(), rhs_comps.data(), lhs.size());
+#endif
+  CT_PROFILE_END(QuaternionMulSoA, lhs.size(), 12 * lhs.size() * sizeof(T));
+}
+
+template <typename T>
+inline void quaternionRotateSoA_(
+    VectorStream<T, 3>& out, const QuaternionStream<T>& quat, const VectorStream<T, 3>& vec) {
+  assert(quat.size() == vec.size() && out.size() == vec.size());
+  const auto out_comps = out.Components();
+  const auto quat_comps = quat.Components();
+  const auto vec_comps = vec.Components();
+  CT_PROFILE_BEGIN(QuaternionRotateSoA);
+#ifdef ENABLE_ISPC
+  ispc::QuaternionRotateSoA(out_comps.data(), quat_comps.data(), vec_comps.data(), vec.size());
+#else
+  portable::QuaternionRotateSoA<T>(
+      out_comps.data(), quat_comps.data(), vec_comps.data(), vec.size());
+#endif
+  CT_PROFILE_END(QuaternionRotateSoA, vec.size(), 10 * vec.size() * sizeof(T));
+}
+
+template <typename T>
+inline void quaternionLerpSoA_(
+    QuaternionStream<T>& out, const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs,
+    const T* weight, const std::uint64_t weight_stride, const bool spherical) {
+  assert(lhs.size() == rhs.size() && out.size() == lhs.size());
+  const auto out_comps = out.Components();
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  if (spherical) {
+    CT_PROFILE_BEGIN(QuaternionSlerpSoA);
+#ifdef ENABLE_ISPC
+    ispc::QuaternionSlerpSoA(
+        out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight, weight_stride, lhs.size());
+#else
+    portable::QuaternionSlerpSoA<T>(
+        out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight, weight_stride, lhs.size());
+#endif
+    CT_PROFILE_END(QuaternionSlerpSoA, lhs.size(), 12 * lhs.size() * sizeof(T));
+  } else {
+    CT_PROFILE_BEGIN(QuaternionNlerpSoA);
+#ifdef ENABLE_ISPC
+    ispc::QuaternionNlerpSoA(
+        out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight, weight_stride, lhs.size());
+#else
+    portable::QuaternionNlerpSoA<T>(
+        out_comps.data(), lhs_comps.data(), rhs_comps.data(), weight, weight_stride, lhs.size());
+#endif
+    CT_PROFILE_END(QuaternionNlerpSoA, lhs.size(), 12 * lhs.size() * sizeof(T));
+  }
+}
+
+/* free functions */
+
+// Hamilton product, the rotation by rhs followed by the one by lhs
+template <typename T>
+constexpr Quaternion<T> QuaternionProd(const Quaternion<T>& lhs, const Quaternion<T>& rhs) {
+  const auto lhs_args = quaternionArgs_(lhs);
+  const auto rhs_args = quaternionArgs_(rhs);
+  std::array<portable::quaternion_t<T>, 4> res{};
+  portable::quaternionMul_(res.data(), lhs_args.data(), rhs_args.data());
+  return quaternionResult_<Quaternion<T>>(res);
+}
+
+// inverse of a unit quaternion
+template <typename T>
+constexpr Quaternion<T> Conjugate(const Quaternion<T>& quat) {
+  return Quaternion<T>{-quat.x(), -quat.y(), -quat.z(), quat.w()};
+}
+
+template <typename T>
+constexpr Quaternion<T> Normalize(const Quaternion<T>& quat) {
+  return Quaternion<T>(Normalize(static_cast<const VectorCT<T, 4>&>(quat)));
+}
+
+template <typename T>
+constexpr VectorCT<T, 3> Rotate(const Quaternion<T>& quat, const VectorCT<T, 3>& vec) {
+  const auto quat_args = quaternionArgs_(quat);
+  const auto vec_args = quaternionArgs_(vec);
+  std::array<portable::quaternion_t<T>, 3> res{};
+  portable::quaternionRotate_(res.data(), quat_args.data(), vec_args.data());
+  return quaternionResult_<VectorCT<T, 3>>(res);
+}
+
+// normalized lerp along the shorter arc, `weight` 0 gives lhs and 1 gives rhs up to sign
+template <typename T>
+constexpr Quaternion<T> Nlerp(const Quaternion<T>& lhs, const Quaternion<T>& rhs, const T weight) {
+  const auto lhs_args = quaternionArgs_(lhs);
+  const auto rhs_args = quaternionArgs_(rhs);
+  std::array<portable::quaternion_t<T>, 4> res{};
+  portable::quaternionNlerp_(
+      res.data(), lhs_args.data(), rhs_args.data(), static_cast<portable::quaternion_t<T>>(weight));
+  return quaternionResult_<Quaternion<T>>(res);
+}
+
+// Spherical lerp along the shorter arc at constant angular speed. Inputs closer than
+// kSlerpNlerpThreshold (cosine of the angle between them) fall back to Nlerp.
+template <typename T>
+constexpr Quaternion<T> Slerp(const Quaternion<T>& lhs, const Quaternion<T>& rhs, const T weight) {
+  const auto lhs_args = quaternionArgs_(lhs);
+  const auto rhs_args = quaternionArgs_(rhs);
+  std::array<portable::quaternion_t<T>, 4> res{};
+  portable::quaternionSlerp_(
+      res.data(), lhs_args.data(), rhs_args.data(), static_cast<portable::quaternion_t<T>>(weight));
+  return quaternionResult_<Quaternion<T>>(res);
+}
+
+// rotation by `angle` radians around the unit vector `axis`, counter-clockwise seen from its tip
+template <typename T>
+constexpr Quaternion<T> BuildQuaternion(const VectorCT<T, 3>& axis, const T angle) {
+  const T sinHalf = portable::sin_(angle / 2);
+  return Quaternion<T>{axis[0] * sinHalf, axis[1] * sinHalf, axis[2] * sinHalf,
+                       portable::cos_(angle / 2)};
+}
+
+// rotation part of a 3x3 or 4x4 matrix, which has to be orthonormal
+template <typename T, size_t D>
+constexpr Quaternion<T> ToQuaternion(const MatrixCT<T, D, D>& mat) {
+  static_assert(D == 3 || D == 4, "ToQuaternion takes a 3x3 or 4x4 matrix");
+  const auto mat_args = rotationArgs_(mat);
+  std::array<portable::quaternion_t<T>, 4> res{};
+  portable::quaternionFromMatrix_(res.data(), mat_args.data());
+  return quaternionResult_<Quaternion<T>>(res);
+}
+
+template <typename T>
+constexpr MatrixCT<T, 4, 4> BuildRotationMatrix(const Quaternion<T>& quat) {
+  const auto quat_args = quaternionArgs_(quat);
+  std::array<portable::quaternion_t<T>, 9> rot{};
+  portable::quaternionToMatrix_(rot.data(), quat_args.data());
+  MatrixCT<T, 4, 4> res{};
+  for (size_t r = 0; r < 3; ++r) {
+    for (size_t c = 0; c < 3; ++c) res[r][c] = static_cast<T>(rot[3 * r + c]);
+  }
+  res[3][3] = T(1);
+  return res;
+}
+
+/* stream functions */
+
+// Writes lhs[i] * rhs[i] to `out`, which may be either input.
+template <typename T>
+void QuaternionProd(
+    const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs, QuaternionStream<T>& out) {
+  quaternionMulSoA_(out, lhs, rhs);
+}
+
+template <typename T>
+QuaternionStream<T> QuaternionProd(const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs) {
+  QuaternionStream<T> res(lhs.size(), kUninitialized);
+  quaternionMulSoA_(res, lhs, rhs);
+  return res;
+}
+
+// Rotates vec[i] by quat[i] into `out`, which may be `vec`.
+template <typename T>
+void Rotate(
+    const QuaternionStream<T>& quat, const VectorStream<T, 3>& vec, VectorStream<T, 3>& out) {
+  quaternionRotateSoA_(out, quat, vec);
+}
+
+template <typename T>
+VectorStream<T, 3> Rotate(const QuaternionStream<T>& quat, const VectorStream<T, 3>& vec) {
+  VectorStream<T, 3> res(vec.size(), kUninitialized);
+  quaternionRotateSoA_(res, quat, vec);
+  return res;
+}
+
+// one weight for every pair
+template <typename T>
+QuaternionStream<T> Nlerp(
+    const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs, const T weight) {
+  QuaternionStream<T> res(lhs.size(), kUninitialized);
+  quaternionLerpSoA_(res, lhs, rhs, &weight, 0, false);
+  return res;
+}
+
+// weight[i] blends pair i
+template <typename T>
+QuaternionStream<T> Nlerp(
+    const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs, const VectorRT<T>& weight) {
+  assert(weight.size() == lhs.size());
+  QuaternionStream<T> res(lhs.size(), kUninitialized);
+  quaternionLerpSoA_(res, lhs, rhs, static_cast<const T*>(weight), 1, false);
+  return res;
+}
+
+template <typename T>
+QuaternionStream<T> Slerp(
+    const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs, const T weight) {
+  QuaternionStream<T> res(lhs.size(), kUninitialized);
+  quaternionLerpSoA_(res, lhs, rhs, &weight, 0, true);
+  return res;
+}
+
+template <typename T>
+QuaternionStream<T> Slerp(
+    const QuaternionStream<T>& lhs, const QuaternionStream<T>& rhs, const VectorRT<T>& weight) {
+  assert(weight.size() == lhs.size());
+  QuaternionStream<T> res(lhs.size(), kUninitialized);
+  quaternionLerpSoA_(res, lhs, rhs, static_cast<const T*>(weight), 1, true);
+  return res;
+}
+
+// Writes the rotation matrix of quat[i] to mat_out[i], for quat.size() matrices.
+template <typename T>
+void BuildRotationMatrix(const QuaternionStream<T>& quat, MatrixCT<T, 4, 4> mat_out[]) {
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  if (quat.size() == 0) return;
+  const auto quat_comps = quat.Components();
+  CT_PROFILE_BEGIN(QuaternionToMatrixSoA);
+#ifdef ENABLE_ISPC
+  ispc::QuaternionToMatrixSoA(mat_out[0], quat_comps.data(), quat.size());
+#else
+  portable::QuaternionToMatrixSoA<T>(mat_out[0], quat_comps.data(), quat.size());
+#endif
+  CT_PROFILE_END(QuaternionToMatrixSoA, quat.size(), 20 * quat.size() * sizeof(T));
+}
+
+// quaternions of the rotation parts of `count` orthonormal matrices
+template <typename T>
+QuaternionStream<T> ToQuaternion(const MatrixCT<T, 4, 4> mat_arg[], const size_t count) {
+  static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+  QuaternionStream<T> res(count, kUninitialized);
+  if (count == 0) return res;
+  const auto out_comps = res.Components();
+  CT_PROFILE_BEGIN(QuaternionFromMatrixSoA);
+#ifdef ENABLE_ISPC
+  ispc::QuaternionFromMatrixSoA(out_comps.data(), mat_arg[0], count);
+#else
+  portable::QuaternionFromMatrixSoA<T>(out_comps.data(), mat_arg[0], count);
+#endif
+  CT_PROFILE_END(QuaternionFromMatrixSoA, count, 20 * count * sizeof(T));
+  return res;
+}
+
+}  // namespace kplutl
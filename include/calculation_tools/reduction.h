@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "vector_rt.h"
+#include "portable.h"
+#include "thread_pool.h"
+
+/*
+    Reductions over runtime-sized vectors: sums, dot products, min / max with their indices and
+    the L1, L2 and Linf norms. Long vectors are split into one contiguous range per thread, each
+    range is reduced by a kernel that keeps one accumulator per SIMD lane, and the per-thread
+    results are combined in range order. Floating-point sums therefore depend on the number of
+    threads; pin ReduceOptions::threads when results have to be reproducible across machines.
+*/
+
+namespace kplutl {
+// elements per thread, see threadsFor_
+constexpr size_t kReduceGrain = size_t(1) << 18;
+
+struct ReduceOptions {
+  // ReduceFlags, the min / max reductions ignore them
+  std::uint32_t flags = kReduceDefault;
+  // 0 takes up to ThreadCount() threads but at most one per kReduceGrain elements
+  size_t threads = 0;
+};
+
+template <typename T>
+struct MinMaxResult {
+  T min;
+  T max;
+  size_t argmin;  // first index holding min
+  size_t argmax;  // first index holding max
+};
+
+/* inline functions */
+
+// length of the ranges reduceRanges_ splits [0, len) into, a multiple of the kAlignment block
+template <typename T>
+size_t reduceStep_(const size_t len, const size_t threads) {
+  const size_t ranges = threadsFor_(len, kReduceGrain, threads);
+  return PaddedLength<T>((len + ranges - 1) / ranges);
+}
+
+// number of results reduceRanges_ writes
+template <typename T>
+size_t reduceRangeCount_(const size_t len, const size_t threads) {
+  const size_t step = reduceStep_<T>(len, threads);
+  return len == 0 ? 1 : (len + step - 1) / step;
+}
+
+// Runs fn(begin, end) over [0, len) split into contiguous ranges, one per thread, on the thread
+// pool and writes the results to `res` in range order. Ranges start on kAlignment boundaries and
+// none of them is empty unless len is 0.
+template <typename T, typename R, typename F>
+void reduceRanges_(const size_t len, const size_t threads, R* res, const F& fn) {
+  const size_t step = reduceStep_<T>(len, threads);
+  parallelRanges_(
+      len, reduceRangeCount_<T>(len, threads), 1, [&](const size_t i) { return i * step; },
+      [&](const size_t i, const size_t begin, const size_t end) { res[i] = fn(begin, end); });
+}
+
+// adds the per-range sums in order, compensated when kReduceKahan is set
+template <typename C>
+C combineSums_(const ScratchArray<C>& partials, const std::uint32_t flags) {
+  C sum = 0;
+  C comp = 0;
+  for (size_t i = 0; i < partials.size(); ++i) {
+    const C value = partials[i];
+    if (std::is_floating_point_v<C> && (flags & kReduceKahan)) {
+      const C y = value - comp;
+      const C t = sum + y;
+      comp = (t - sum) - y;
+      sum = t;
+    } else {
+      sum += value;
+    }
+  }
+  return sum;
+}
+
+template <typename T>
+inline compute_t<T> reduceSum_(
+    const T* vec_arg, const size_t len, const ReduceOptions& options, const bool abs) {
+  using C = compute_t<T>;
+  ScratchArray<C> partials(reduceRangeCount_<T>(len, options.threads));
+  reduceRanges_<T>(len, options.threads, partials.data(), [&](size_t begin, size_t end) {
+    C res;
+    if (abs) {
+      CT_PROFILE_BEGIN(ReduceAbsSum);
+#ifdef ENABLE_ISPC
+      ispc::ReduceAbsSum(&res, vec_arg + begin, end - begin, options.flags);
+#else
+      portable::ReduceAbsSum<T>(&res, vec_arg + begin, end - begin, options.flags);
+#endif
+      CT_PROFILE_END(ReduceAbsSum, end - begin, (end - begin) * sizeof(T));
+    } else {
+      CT_PROFILE_BEGIN(ReduceSum);
+#ifdef ENABLE_ISPC
+      ispc::ReduceSum(&res, vec_arg + begin, end - begin, options.flags);
+#else
+      portable::ReduceSum<T>(&res, vec_arg + begin, end - begin, options.flags);
+#endif
+      CT_PROFILE_END(ReduceSum, end - begin, (end - begin) * sizeof(T));
+    }
+    return res;
+  });
+  return combineSums_(partials, options.flags);
+}
+
+template <typename T>
+inline compute_t<T> reduceDot_(
+    const T* vec_lhs, const T* vec_rhs, const size_t len, const ReduceOptions& options) {
+  using C = compute_t<T>;
+  ScratchArray<C> partials(reduceRangeCount_<T>(len, options.threads));
+  reduceRanges_<T>(len, options.threads, partials.data(), [&](size_t begin, size_t end) {
+    C res;
+    CT_PROFILE_BEGIN(ReduceDotProd);
+#ifdef ENABLE_ISPC
+    ispc::ReduceDotProd(&res, vec_lhs + begin, vec_rhs + begin, end - begin, options.flags);
+#else
+    portable::ReduceDotProd<T>(&res, vec_lhs + begin, vec_rhs + begin, end - begin, options.flags);
+#endif
+    CT_PROFILE_END(ReduceDotProd, end - begin, 2 * (end - begin) * sizeof(T));
+    return res;
+  });
+  return combineSums_(partials, options.flags);
+}
+
+template <typename T>
+inline MinMaxResult<T> reduceMinMax_(
+    const T* vec_arg, const size_t len, const ReduceOptions& options) {
+  assert(len > 0);
+  ScratchArray<MinMaxResult<T>> partials(reduceRangeCount_<T>(len, options.threads));
+  reduceRanges_<T>(len, options.threads, partials.data(), [&](size_t begin, size_t end) {
+    T out[2];
+    std::uint64_t index[2];
+    CT_PROFILE_BEGIN(ReduceMinMax);
+#ifdef ENABLE_ISPC
+    ispc::ReduceMinMax(out, index, vec_arg + begin, end - begin);
+#else
+    portable::ReduceMinMax<T>(out, index, vec_arg + begin, end - begin);
+#endif
+    CT_PROFILE_END(ReduceMinMax, end - begin, (end - begin) * sizeof(T));
+    return MinMaxResult<T>{out[0], out[1], begin + index[0], begin + index[1]};
+  });
+  // strict comparisons keep the earlier range on ties
+  MinMaxResult<T> res = partials[0];
+  for (size_t i = 1; i < partials.size(); ++i) {
+    using C = compute_t<T>;
+    if (C(partials[i].min) < C(res.min)) {
+      res.min = partials[i].min;
+      res.argmin = partials[i].argmin;
+    }
+    if (C(partials[i].max) > C(res.max)) {
+      res.max = partials[i].max;
+      res.argmax = partials[i].argmax;
+    }
+  }
+  return res;
+}
+
+/* free functions */
+
+// sum of the elements, kReduceKahan and kReducePairwise bound the rounding error on long vectors
+template <typename T>
+T Sum(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return static_cast<T>(reduceSum_<T>(vec, vec.size(), options, false));
+}
+
+// DotProd(lhs, rhs) with control over summation and threads
+template <typename T>
+T DotProd(const VectorRT<T>& lhs, const VectorRT<T>& rhs, const ReduceOptions& options) {
+  assert(lhs.size() == rhs.size());
+  return static_cast<T>(reduceDot_<T>(lhs, rhs, lhs.size(), options));
+}
+
+// smallest and largest element in one pass, `vec` must not be empty
+template <typename T>
+MinMaxResult<T> MinMax(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return reduceMinMax_<T>(vec, vec.size(), options);
+}
+
+template <typename T>
+T Min(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return MinMax(vec, options).min;
+}
+
+template <typename T>
+T Max(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return MinMax(vec, options).max;
+}
+
+template <typename T>
+size_t ArgMin(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return MinMax(vec, options).argmin;
+}
+
+template <typename T>
+size_t ArgMax(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return MinMax(vec, options).argmax;
+}
+
+// sum of the absolute values
+template <typename T>
+T NormL1(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return static_cast<T>(reduceSum_<T>(vec, vec.size(), options, true));
+}
+
+// Euclidean length; the squares are summed unscaled, so elements beyond the square root of the
+// largest finite value overflow
+template <typename T>
+T NormL2(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  return static_cast<T>(portable::sqrt_(reduceDot_<T>(vec, vec, vec.size(), options)));
+}
+
+// largest absolute value, 0 for an empty vector
+template <typename T>
+T NormInf(const VectorRT<T>& vec, const ReduceOptions& options = {}) {
+  if (vec.size() == 0) return T(0);
+  const MinMaxResult<T> res = MinMax(vec, options);
+  using C = compute_t<T>;
+  return static_cast<T>(std::max(portable::abs_(C(res.min)), portable::abs_(C(res.max))));
+}
+
+}  // namespace kplutl
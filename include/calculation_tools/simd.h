@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "config.h"
+
+#ifdef ENABLE_SSE
+#include <emmintrin.h>
+#endif
+
+/*
+    Inline fast path for the small fixed-size types. Every ISPC kernel is an out-of-line call, which
+    costs more than the whole operation on a 3-element vector; for these sizes the operations are
+    done here instead so the compiler can inline them and keep values in registers.
+      - VectorStorage decides the in-memory layout of VectorCT<T, N>,
+      - SimdBackend<T, N> is specialized for the sizes that have an inline path; everything else
+        keeps going through ISPC.
+*/
+
+namespace kplutl {
+/* storage */
+
+// Physical length and alignment of VectorCT<T, N>. The float specializations do not depend on
+// ENABLE_SSE, so the layout stays the same whatever the instruction set.
+template <typename T, size_t N>
+struct VectorStorage {
+  static constexpr size_t kLength = N;
+  static constexpr size_t kAlign = alignof(T);
+};
+
+// two floats fill the lower half of a register; rows of MatrixCT<float, R, 2> stay dense
+template <>
+struct VectorStorage<float, 2> {
+  static constexpr size_t kLength = 2;
+  static constexpr size_t kAlign = 8;
+};
+
+// the fourth lane is padding, its contents are unspecified after arithmetic
+template <>
+struct VectorStorage<float, 3> {
+  static constexpr size_t kLength = 4;
+  static constexpr size_t kAlign = 16;
+};
+
+template <>
+struct VectorStorage<float, 4> {
+  static constexpr size_t kLength = 4;
+  static constexpr size_t kAlign = 16;
+};
+
+/* backend */
+
+template <typename T, size_t N>
+struct SimdBackend {
+  static constexpr bool kEnabled = false;
+};
+
+#ifdef ENABLE_SSE
+// SSE2 path over one register holding a whole VectorStorage<float, N>
+template <size_t N>
+struct SseBackend {
+  using Reg = __m128;
+  static constexpr bool kEnabled = true;
+
+  static Reg Load(const float* src) {
+    if constexpr (N == 2) {
+      return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(src)));
+    } else {
+      return _mm_load_ps(src);
+    }
+  }
+  static void Store(float* dst, const Reg reg) {
+    if constexpr (N == 2) {
+      _mm_store_sd(reinterpret_cast<double*>(dst), _mm_castps_pd(reg));
+    } else {
+      _mm_store_ps(dst, reg);
+    }
+  }
+  static Reg Set(const float value) { return _mm_set1_ps(value); }
+
+  static Reg Add(const Reg lhs, const Reg rhs) { return _mm_add_ps(lhs, rhs); }
+  static Reg Sub(const Reg lhs, const Reg rhs) { return _mm_sub_ps(lhs, rhs); }
+  static Reg Mul(const Reg lhs, const Reg rhs) { return _mm_mul_ps(lhs, rhs); }
+  static Reg Div(const Reg lhs, const Reg rhs) { return _mm_div_ps(lhs, rhs); }
+  static Reg Abs(const Reg arg) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), arg); }
+  static Reg Sqrt(const Reg arg) { return _mm_sqrt_ps(arg); }
+  static Reg Neg(const Reg arg) { return _mm_xor_ps(_mm_set1_ps(-0.0f), arg); }
+
+  // sum of the N meaningful lanes
+  static float Sum(const Reg arg) {
+    Reg res = _mm_add_ss(arg, _mm_shuffle_ps(arg, arg, _MM_SHUFFLE(1, 1, 1, 1)));
+    if constexpr (N >= 3) res = _mm_add_ss(res, _mm_movehl_ps(arg, arg));
+    if constexpr (N == 4) res = _mm_add_ss(res, _mm_shuffle_ps(arg, arg, _MM_SHUFFLE(3, 3, 3, 3)));
+    return _mm_cvtss_f32(res);
+  }
+
+  // lanes (lhs[X], lhs[Y], rhs[Z], rhs[W]), listed in output order unlike _MM_SHUFFLE
+  template <int X, int Y, int Z, int W>
+  static Reg Shuffle(const Reg lhs, const Reg rhs) {
+    return _mm_shuffle_ps(lhs, rhs, _MM_SHUFFLE(W, Z, Y, X));
+  }
+  template <int X, int Y, int Z, int W>
+  static Reg Swizzle(const Reg arg) {
+    return Shuffle<X, Y, Z, W>(arg, arg);
+  }
+};
+
+template <>
+struct SimdBackend<float, 2> : SseBackend<2> {};
+template <>
+struct SimdBackend<float, 3> : SseBackend<3> {
+  static Reg Cross(const Reg lhs, const Reg rhs) {
+    const Reg lhs_yzx = _mm_shuffle_ps(lhs, lhs, _MM_SHUFFLE(3, 0, 2, 1));
+    const Reg rhs_yzx = _mm_shuffle_ps(rhs, rhs, _MM_SHUFFLE(3, 0, 2, 1));
+    const Reg res_zxy = _mm_sub_ps(_mm_mul_ps(lhs, rhs_yzx), _mm_mul_ps(lhs_yzx, rhs));
+    return _mm_shuffle_ps(res_zxy, res_zxy, _MM_SHUFFLE(3, 0, 2, 1));
+  }
+
+  // determinant of the row-major 3x3 `mat` (rows 4 floats apart), row_0 . (row_1 x row_2)
+  static float Determinant(const float* mat) {
+    const Reg cross = Cross(_mm_load_ps(mat + 4), _mm_load_ps(mat + 8));
+    return Sum(_mm_mul_ps(_mm_load_ps(mat), cross));
+  }
+
+  // Inverse of the row-major 3x3 `mat` (rows 4 floats apart) into `out`, transposed if
+  // `transpose`; returns the determinant. The rows of the transposed inverse are the cross
+  // products of the rows of `mat` over the determinant.
+  static float Inverse(float* out, const float* mat, const bool transpose) {
+    const Reg row_0 = _mm_load_ps(mat);
+    const Reg row_1 = _mm_load_ps(mat + 4);
+    const Reg row_2 = _mm_load_ps(mat + 8);
+    Reg inv_0 = Cross(row_1, row_2);
+    Reg inv_1 = Cross(row_2, row_0);
+    Reg inv_2 = Cross(row_0, row_1);
+    const float det = Sum(_mm_mul_ps(row_0, inv_0));
+    const Reg inv_det = _mm_set1_ps(1.0f / det);
+    inv_0 = _mm_mul_ps(inv_0, inv_det);
+    inv_1 = _mm_mul_ps(inv_1, inv_det);
+    inv_2 = _mm_mul_ps(inv_2, inv_det);
+    if (!transpose) {
+      Reg pad = _mm_setzero_ps();
+      _MM_TRANSPOSE4_PS(inv_0, inv_1, inv_2, pad);
+    }
+    _mm_store_ps(out, inv_0);
+    _mm_store_ps(out + 4, inv_1);
+    _mm_store_ps(out + 8, inv_2);
+    return det;
+  }
+};
+template <>
+struct SimdBackend<float, 4> : SseBackend<4> {
+  // row-major 4x4 matrix times column vector
+  static Reg Transform(const float* mat, const Reg vec) {
+    Reg row_0 = _mm_mul_ps(_mm_load_ps(mat), vec);
+    Reg row_1 = _mm_mul_ps(_mm_load_ps(mat + 4), vec);
+    Reg row_2 = _mm_mul_ps(_mm_load_ps(mat + 8), vec);
+    Reg row_3 = _mm_mul_ps(_mm_load_ps(mat + 12), vec);
+    _MM_TRANSPOSE4_PS(row_0, row_1, row_2, row_3);
+    return _mm_add_ps(_mm_add_ps(row_0, row_1), _mm_add_ps(row_2, row_3));
+  }
+
+  // determinant of the row-major 4x4 `mat`, the |M| of Inverse below
+  static float Determinant(const float* mat) {
+    const Reg row_0 = _mm_load_ps(mat);
+    const Reg row_1 = _mm_load_ps(mat + 4);
+    const Reg row_2 = _mm_load_ps(mat + 8);
+    const Reg row_3 = _mm_load_ps(mat + 12);
+    // (|A|, |B|, |C|, |D|) times (|D|, |C|, |B|, |A|)
+    const Reg det_sub = _mm_sub_ps(
+        _mm_mul_ps(Shuffle<0, 2, 0, 2>(row_0, row_2), Shuffle<1, 3, 1, 3>(row_1, row_3)),
+        _mm_mul_ps(Shuffle<1, 3, 1, 3>(row_0, row_2), Shuffle<0, 2, 0, 2>(row_1, row_3)));
+    const Reg det_prod = _mm_mul_ps(det_sub, Swizzle<3, 2, 1, 0>(det_sub));
+    const Reg a_b = Mat2AdjMul(_mm_movelh_ps(row_0, row_1), _mm_movehl_ps(row_1, row_0));
+    const Reg d_c = Mat2AdjMul(_mm_movehl_ps(row_3, row_2), _mm_movelh_ps(row_2, row_3));
+    return _mm_cvtss_f32(det_prod) + _mm_cvtss_f32(Swizzle<1, 1, 1, 1>(det_prod)) -
+           Sum(_mm_mul_ps(a_b, Swizzle<0, 2, 1, 3>(d_c)));
+  }
+
+  // Inverse of the row-major 4x4 `mat` into `out`, transposed if `transpose`; returns the
+  // determinant. Works on the 2x2 blocks M = | A B ; C D |, each held in one register, through
+  // their adjugates (A#): inverse = 1 / |M| * | X Y ; Z W | with X# = |D| A - B (D# C),
+  // W# = |A| D - C (A# B), Y# = |B| C - D (A# B)#, Z# = |C| B - A (D# C)# and
+  // |M| = |A| |D| + |B| |C| - tr((A# B) (D# C)).
+  static float Inverse(float* out, const float* mat, const bool transpose) {
+    const Reg row_0 = _mm_load_ps(mat);
+    const Reg row_1 = _mm_load_ps(mat + 4);
+    const Reg row_2 = _mm_load_ps(mat + 8);
+    const Reg row_3 = _mm_load_ps(mat + 12);
+    const Reg a = _mm_movelh_ps(row_0, row_1);
+    const Reg b = _mm_movehl_ps(row_1, row_0);
+    const Reg c = _mm_movelh_ps(row_2, row_3);
+    const Reg d = _mm_movehl_ps(row_3, row_2);
+
+    // (|A|, |B|, |C|, |D|)
+    const Reg det_sub = _mm_sub_ps(
+        _mm_mul_ps(Shuffle<0, 2, 0, 2>(row_0, row_2), Shuffle<1, 3, 1, 3>(row_1, row_3)),
+        _mm_mul_ps(Shuffle<1, 3, 1, 3>(row_0, row_2), Shuffle<0, 2, 0, 2>(row_1, row_3)));
+    const Reg det_a = Swizzle<0, 0, 0, 0>(det_sub);
+    const Reg det_b = Swizzle<1, 1, 1, 1>(det_sub);
+    const Reg det_c = Swizzle<2, 2, 2, 2>(det_sub);
+    const Reg det_d = Swizzle<3, 3, 3, 3>(det_sub);
+
+    const Reg d_c = Mat2AdjMul(d, c);
+    const Reg a_b = Mat2AdjMul(a, b);
+    Reg x = _mm_sub_ps(_mm_mul_ps(det_d, a), Mat2Mul(b, d_c));
+    Reg w = _mm_sub_ps(_mm_mul_ps(det_a, d), Mat2Mul(c, a_b));
+    Reg y = _mm_sub_ps(_mm_mul_ps(det_b, c), Mat2MulAdj(d, a_b));
+    Reg z = _mm_sub_ps(_mm_mul_ps(det_c, b), Mat2MulAdj(a, d_c));
+
+    Reg trace = _mm_mul_ps(a_b, Swizzle<0, 2, 1, 3>(d_c));
+    trace = _mm_add_ps(trace, Swizzle<2, 3, 0, 1>(trace));
+    trace = _mm_add_ps(trace, Swizzle<1, 0, 3, 2>(trace));
+    const Reg det = _mm_sub_ps(
+        _mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+    // the signs turn the blocks' adjugates back into the blocks, the shuffles below finish that
+    const Reg inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+    x = _mm_mul_ps(x, inv_det);
+    y = _mm_mul_ps(y, inv_det);
+    z = _mm_mul_ps(z, inv_det);
+    w = _mm_mul_ps(w, inv_det);
+    Reg res_0 = Shuffle<3, 1, 3, 1>(x, y);
+    Reg res_1 = Shuffle<2, 0, 2, 0>(x, y);
+    Reg res_2 = Shuffle<3, 1, 3, 1>(z, w);
+    Reg res_3 = Shuffle<2, 0, 2, 0>(z, w);
+    if (transpose) _MM_TRANSPOSE4_PS(res_0, res_1, res_2, res_3);
+    _mm_store_ps(out, res_0);
+    _mm_store_ps(out + 4, res_1);
+    _mm_store_ps(out + 8, res_2);
+    _mm_store_ps(out + 12, res_3);
+    return _mm_cvtss_f32(det);
+  }
+
+  // Inverse of a row-major affine 4x4 whose upper 3x3 has orthogonal columns (rotation and
+  // per-axis scale), see portable::matrixInverseAffine_. Scaling the rows by 1 / |column|^2 and
+  // transposing gives the inverse 3x3; the translation rides along as the fourth row.
+  static void InverseAffine(float* out, const float* mat) {
+    const Reg row_0 = _mm_load_ps(mat);
+    const Reg row_1 = _mm_load_ps(mat + 4);
+    const Reg row_2 = _mm_load_ps(mat + 8);
+    const Reg size_sq = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(row_0, row_0), _mm_mul_ps(row_1, row_1)), _mm_mul_ps(row_2, row_2));
+    const Reg inv_size_sq = _mm_div_ps(_mm_set1_ps(1.0f), size_sq);
+    Reg res_0 = _mm_mul_ps(row_0, inv_size_sq);
+    Reg res_1 = _mm_mul_ps(row_1, inv_size_sq);
+    Reg res_2 = _mm_mul_ps(row_2, inv_size_sq);
+    Reg res_3 = _mm_add_ps(
+        _mm_add_ps(
+            _mm_mul_ps(res_0, Swizzle<3, 3, 3, 3>(row_0)),
+            _mm_mul_ps(res_1, Swizzle<3, 3, 3, 3>(row_1))),
+        _mm_mul_ps(res_2, Swizzle<3, 3, 3, 3>(row_2)));
+    res_3 = Neg(res_3);
+    _MM_TRANSPOSE4_PS(res_0, res_1, res_2, res_3);
+    _mm_store_ps(out, res_0);
+    _mm_store_ps(out + 4, res_1);
+    _mm_store_ps(out + 8, res_2);
+    _mm_store_ps(out + 12, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+
+ private:
+  // 2x2 row-major matrices in one register: A * B, A# * B and A * B#
+  static Reg Mat2Mul(const Reg lhs, const Reg rhs) {
+    return _mm_add_ps(
+        _mm_mul_ps(lhs, Swizzle<0, 3, 0, 3>(rhs)),
+        _mm_mul_ps(Swizzle<1, 0, 3, 2>(lhs), Swizzle<2, 1, 2, 1>(rhs)));
+  }
+  static Reg Mat2AdjMul(const Reg lhs, const Reg rhs) {
+    return _mm_sub_ps(
+        _mm_mul_ps(Swizzle<3, 3, 0, 0>(lhs), rhs),
+        _mm_mul_ps(Swizzle<1, 1, 2, 2>(lhs), Swizzle<2, 3, 0, 1>(rhs)));
+  }
+  static Reg Mat2MulAdj(const Reg lhs, const Reg rhs) {
+    return _mm_sub_ps(
+        _mm_mul_ps(lhs, Swizzle<3, 0, 3, 0>(rhs)),
+        _mm_mul_ps(Swizzle<1, 0, 3, 2>(lhs), Swizzle<2, 1, 2, 1>(rhs)));
+  }
+};
+#endif
+
+// matrices small enough that a row loop over SimdBackend beats a kernel call
+template <typename T, size_t ROWS, size_t COLS>
+constexpr bool kSimdMatrix = SimdBackend<T, COLS>::kEnabled && ROWS <= 4;
+
+}  // namespace kplutl
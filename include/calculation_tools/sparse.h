@@ -0,0 +1,284 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "vector_rt.h"
+#include "reduction.h"
+#include "portable.h"
+#include "thread_pool.h"
+
+/*
+    Compressed sparse row (CSR) matrices for systems that are mostly zeros, like stiffness matrices
+    or graph Laplacians. Storage grows with the number of nonzeros: rows + 1 row offsets, then one
+    column index and one value per nonzero. BuildCsr assembles a matrix from coordinate (COO)
+    triplets in any order. MatVec splits the rows into ranges holding about the same number of
+    nonzeros and runs one kernel call per range on the thread pool. ConjugateGradient solves
+    symmetric positive definite systems on top of MatVec and the VectorRT arithmetic.
+*/
+
+namespace kplutl {
+// nonzeros per thread, see threadsFor_
+constexpr size_t kSparseGrain = size_t(1) << 15;
+
+struct SparseOptions {
+  // 0 takes up to ThreadCount() threads but at most one per kSparseGrain nonzeros
+  size_t threads = 0;
+};
+
+// Row r holds the nonzeros [row_begin_[r], row_begin_[r + 1]) of col_ and values_, sorted by column
+// without repeats.
+template <typename T>
+struct MatrixCSR {
+  AlignedArray<std::uint64_t> row_begin_;
+  AlignedArray<std::uint32_t> col_;
+  AlignedArray<T> values_;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+
+  MatrixCSR<T>() = default;
+  // rows x cols without nonzeros
+  MatrixCSR<T>(size_t rows, size_t cols) : row_begin_(rows + 1), rows_(rows), cols_(cols) {
+    std::fill_n(row_begin_.data(), rows + 1, std::uint64_t(0));
+  }
+
+  size_t rows() const { return rows_; }
+  size_t cols() const { return cols_; }
+  size_t nonzeros() const { return values_.size(); }
+
+  // the stored value at (row, col), 0 when there is none
+  T operator()(const size_t row, const size_t col) const {
+    assert(row < rows_ && col < cols_);
+    const std::uint32_t* first = col_.data() + row_begin_[row];
+    const std::uint32_t* last = col_.data() + row_begin_[row + 1];
+    const std::uint32_t* it = std::lower_bound(first, last, std::uint32_t(col));
+    return it != last && *it == col ? values_[it - col_.data()] : T(0);
+  }
+};
+
+struct CgOptions {
+  // stops once ||rhs - A x|| <= tolerance * ||rhs||
+  double tolerance = 1e-6;
+  // 0 takes the number of rows
+  size_t max_iterations = 0;
+  // scales the residual by the inverse diagonal (Jacobi); rows without a positive diagonal entry
+  // are left unscaled
+  bool jacobi = true;
+  // threads of the products and dot products, see SparseOptions; the vector updates split like
+  // any VectorRT arithmetic
+  size_t threads = 0;
+};
+
+struct CgResult {
+  size_t iterations = 0;
+  double residual = 0;  // ||r|| / ||rhs|| for the updated residual r of the last iteration
+  bool converged = false;
+};
+
+/* inline functions */
+
+// Runs fn(begin, end) over the rows of `mat` split into contiguous ranges of about equal nonzero
+// count, one per thread, on the thread pool.
+template <typename T, typename F>
+void sparseRanges_(const MatrixCSR<T>& mat, const size_t threads, const F& fn) {
+  const size_t rows = mat.rows();
+  const size_t parts = std::max<size_t>(
+      1, std::min(threadsFor_(mat.nonzeros(), kSparseGrain, threads), rows));
+  const std::uint64_t* row_begin = mat.row_begin_.data();
+  // the row holding the part-th fraction of the nonzeros
+  const auto start = [&](const size_t part) -> size_t {
+    const std::uint64_t target = std::uint64_t(mat.nonzeros()) * part / parts;
+    return std::upper_bound(row_begin, row_begin + rows + 1, target) - row_begin - 1;
+  };
+  parallelRanges_(rows, parts, 1, start, [&](size_t, const size_t begin, const size_t end) {
+    if (begin < end) fn(begin, end);
+  });
+}
+
+template <typename T>
+inline void sparseMatVec_(
+    T* vec_out, const std::uint64_t* row_begin, const std::uint32_t* col, const T* values,
+    const T* vec_in, const size_t rows) {
+  CT_PROFILE_BEGIN(SparseMatVec);
+#ifdef ENABLE_ISPC
+  ispc::SparseMatVec(vec_out, row_begin, col, values, vec_in, rows);
+#else
+  portable::SparseMatVec<T>(vec_out, row_begin, col, values, vec_in, rows);
+#endif
+  CT_PROFILE_END(
+      SparseMatVec, row_begin[rows] - row_begin[0],
+      (row_begin[rows] - row_begin[0]) * (2 * sizeof(T) + 4) + rows * (sizeof(T) + 8));
+}
+
+/* construction */
+
+// Assembles a rows x cols matrix from `count` triplets (row[i], col[i], value[i]) in any order.
+// Triplets at the same position are added, as when summing element contributions of a mesh.
+template <typename T>
+MatrixCSR<T> BuildCsr(
+    const size_t rows, const size_t cols, const std::uint32_t row[], const std::uint32_t col[],
+    const T value[], const size_t count) {
+  assert(cols <= size_t(std::numeric_limits<std::uint32_t>::max()) + 1);
+  using C = compute_t<T>;
+  // counting sort by column, then a stable one by row, leaves every row sorted by column
+  std::vector<size_t> fill(std::max(rows, cols) + 1);
+  for (size_t i = 0; i < count; ++i) {
+    assert(row[i] < rows && col[i] < cols);
+    ++fill[col[i] + 1];
+  }
+  for (size_t c = 1; c <= cols; ++c) fill[c] += fill[c - 1];
+  std::vector<size_t> by_col(count);
+  for (size_t i = 0; i < count; ++i) by_col[fill[col[i]]++] = i;
+
+  MatrixCSR<T> res(rows, cols);
+  std::uint64_t* row_begin = res.row_begin_.data();
+  for (size_t i = 0; i < count; ++i) ++row_begin[row[i] + 1];
+  for (size_t r = 1; r <= rows; ++r) row_begin[r] += row_begin[r - 1];
+  std::copy(row_begin, row_begin + rows, fill.begin());
+  AlignedArray<std::uint32_t> sorted_col(count);
+  AlignedArray<T> sorted_value(count);
+  for (const size_t i : by_col) {
+    const size_t pos = fill[row[i]]++;
+    sorted_col[pos] = col[i];
+    sorted_value[pos] = value[i];
+  }
+
+  // merge repeats in place, row_begin moves down with them
+  size_t nonzeros = 0;
+  for (size_t r = 0; r < rows; ++r) {
+    const size_t begin = row_begin[r];
+    const size_t end = row_begin[r + 1];
+    row_begin[r] = nonzeros;
+    for (size_t k = begin; k < end; ++k) {
+      if (nonzeros > row_begin[r] && sorted_col[nonzeros - 1] == sorted_col[k]) {
+        sorted_value[nonzeros - 1] =
+            static_cast<T>(C(sorted_value[nonzeros - 1]) + C(sorted_value[k]));
+      } else {
+        sorted_col[nonzeros] = sorted_col[k];
+        sorted_value[nonzeros] = sorted_value[k];
+        ++nonzeros;
+      }
+    }
+  }
+  row_begin[rows] = nonzeros;
+  if (nonzeros == count) {
+    res.col_ = std::move(sorted_col);
+    res.values_ = std::move(sorted_value);
+  } else {
+    res.col_ = AlignedArray<std::uint32_t>(nonzeros);
+    res.values_ = AlignedArray<T>(nonzeros);
+    std::copy_n(sorted_col.data(), nonzeros, res.col_.data());
+    std::copy_n(sorted_value.data(), nonzeros, res.values_.data());
+  }
+  return res;
+}
+
+// the diagonal entries of `mat`, 0 where none is stored
+template <typename T>
+VectorRT<T> Diagonal(const MatrixCSR<T>& mat) {
+  VectorRT<T> res(std::min(mat.rows(), mat.cols()));
+  for (size_t r = 0; r < res.size(); ++r) res[r] = mat(r, r);
+  return res;
+}
+
+/* products */
+
+// vec_out = mat vec_in; vec_out must not alias vec_in
+template <typename T>
+void MatVec(
+    const MatrixCSR<T>& mat, const VectorRT<T>& vec_in, VectorRT<T>& vec_out,
+    const SparseOptions& options = {}) {
+  assert(vec_in.size() == mat.cols() && &vec_in != &vec_out);
+  if (vec_out.size() != mat.rows()) vec_out = VectorRT<T>(mat.rows(), kUninitialized);
+  const std::uint64_t* row_begin = mat.row_begin_.data();
+  sparseRanges_(mat, options.threads, [&](const size_t begin, const size_t end) {
+    sparseMatVec_<T>(
+        vec_out.data_.data() + begin, row_begin + begin, mat.col_.data(), mat.values_.data(),
+        vec_in.data_.data(), end - begin);
+  });
+}
+
+template <typename T>
+VectorRT<T> MatVec(
+    const MatrixCSR<T>& mat, const VectorRT<T>& vec, const SparseOptions& options = {}) {
+  VectorRT<T> res(mat.rows(), kUninitialized);
+  MatVec(mat, vec, res, options);
+  return res;
+}
+
+/* solvers */
+
+// Preconditioned conjugate gradients for mat x = rhs with symmetric positive definite `mat`,
+// starting from the x passed in. Allocates its five work vectors once, up front.
+template <typename T>
+CgResult ConjugateGradient(
+    const MatrixCSR<T>& mat, const VectorRT<T>& rhs, VectorRT<T>& x,
+    const CgOptions& options = {}) {
+  static_assert(std::is_floating_point_v<T>, "conjugate gradients need float or double");
+  assert(mat.rows() == mat.cols() && rhs.size() == mat.rows());
+  const size_t len = mat.rows();
+  const SparseOptions sparse{options.threads};
+  const ReduceOptions reduce{kReduceDefault, options.threads};
+  if (x.size() != len) x = VectorRT<T>(len);
+
+  CgResult res;
+  const T rhs_norm = NormL2(rhs, reduce);
+  if (rhs_norm == T(0)) {
+    std::fill_n(x.data_.data(), len, T(0));
+    res.converged = true;
+    return res;
+  }
+  const T threshold = T(options.tolerance) * rhs_norm;
+  const size_t max_iterations = options.max_iterations != 0 ? options.max_iterations : len;
+
+  VectorRT<T> inv_diag(len, kUninitialized);
+  for (size_t r = 0; r < len; ++r) {
+    const T diag = options.jacobi ? mat(r, r) : T(0);
+    inv_diag[r] = diag > T(0) ? T(1) / diag : T(1);
+  }
+  VectorRT<T> residual(len, kUninitialized);
+  VectorRT<T> precond(len, kUninitialized);
+  VectorRT<T> dir(len, kUninitialized);
+  VectorRT<T> mat_dir(len, kUninitialized);
+  MatVec(mat, x, mat_dir, sparse);
+  residual = rhs - mat_dir;
+  precond = inv_diag * residual;
+  dir = precond;
+  T rz = DotProd(residual, precond, reduce);
+  T residual_norm = NormL2(residual, reduce);
+  while (residual_norm > threshold && res.iterations < max_iterations) {
+    MatVec(mat, dir, mat_dir, sparse);
+    const T curvature = DotProd(dir, mat_dir, reduce);
+    // not positive definite along dir, or dir vanished
+    if (!(curvature > T(0))) break;
+    const T alpha = rz / curvature;
+    x += alpha * dir;
+    residual -= alpha * mat_dir;
+    ++res.iterations;
+    residual_norm = NormL2(residual, reduce);
+    if (residual_norm <= threshold) break;
+    precond = inv_diag * residual;
+    const T rz_next = DotProd(residual, precond, reduce);
+    dir = precond + (rz_next / rz) * dir;
+    rz = rz_next;
+  }
+  res.residual = double(residual_norm) / double(rhs_norm);
+  res.converged = residual_norm <= threshold;
+  return res;
+}
+
+/* type defines */
+
+using MatrixCSRf = MatrixCSR<float>;
+using MatrixCSRd = MatrixCSR<double>;
+
+}  // namespace kplutl
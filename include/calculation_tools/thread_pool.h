@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+
+#include "config.h"
+#include "memory.h"
+
+/*
+    Process-wide work-stealing thread pool behind every multithreaded path of the library: the
+    elementwise kernels of VectorRT / MatrixRT, the reductions, transposes, GEMM and the dense
+    factorizations. It also implements the ISPC task runtime (ISPCLaunch / ISPCSync), so ISPC code
+    that uses `launch` runs on the same workers.
+
+    The pool keeps ThreadCount() - 1 workers, because the thread that starts parallel work always
+    takes part in it. Every worker owns a task deque. ParallelTasks deals its tasks out over all
+    deques. A thread pops from the back of its own deque and steals from the front of the others
+    when that one runs dry. A thread waiting for its tasks keeps running whatever it finds, so
+    parallel work may start more parallel work without deadlocking.
+
+    CT_NUM_THREADS=<n> in the environment or SetThreadCount sets the number of threads, the default
+    is one per hardware thread. Elementwise kernels only split arrays of at least twice
+    ParallelGrain() elements, so small vectors and the fixed-size types never touch the pool.
+*/
+
+namespace kplutl {
+// default ParallelGrain(), large enough that a task outweighs handing it to another thread
+constexpr size_t kParallelGrain = size_t(1) << 16;
+// tasks per thread that ParallelFor deals out, the spare ones balance uneven progress
+constexpr size_t kParallelTasksPerThread = 4;
+
+// threads that run parallel work, including the calling one
+size_t ThreadCount();
+
+// Restarts the pool with `threads` threads, 0 takes one per hardware thread. Not meant to race
+// with parallel work running on other threads.
+void SetThreadCount(size_t threads);
+
+// smallest number of elements per task of the elementwise kernels
+size_t ParallelGrain();
+
+// 0 restores kParallelGrain
+void SetParallelGrain(size_t grain);
+
+/* inline functions */
+
+// Runs body(context, i) for every i in [0, count) on the pool and returns once all have finished.
+// The calling thread runs tasks too. Bodies must not throw.
+void parallelTasks_(
+    size_t count, void (*body)(const void* context, size_t index), const void* context);
+
+/* free functions */
+
+// fn(i) for every i in [0, count), concurrently on the pool
+template <typename F>
+void ParallelTasks(const size_t count, const F& fn) {
+  if (count == 1) {
+    fn(size_t(0));
+    return;
+  }
+  parallelTasks_(
+      count, [](const void* context, size_t index) { (*static_cast<const F*>(context))(index); },
+      &fn);
+}
+
+// Runs fn(begin, end) over [0, len) in contiguous ranges of at least `grain` elements, with every
+// range but the last a multiple of `align` long. Ranges run on the pool when there are two or more
+// and on the calling thread otherwise.
+template <typename F>
+void ParallelFor(const size_t len, const size_t grain, const size_t align, const F& fn) {
+  // short arrays leave before asking for the pool
+  const size_t most = len / std::max<size_t>(grain, 1);
+  const size_t threads = most < 2 ? 1 : ThreadCount();
+  if (threads == 1) {
+    if (len > 0) fn(size_t(0), len);
+    return;
+  }
+  const size_t tasks = std::min(most, threads * kParallelTasksPerThread);
+  const size_t step = (len + tasks - 1) / tasks;
+  const size_t aligned = (step + align - 1) / align * align;
+  const size_t count = (len + aligned - 1) / aligned;
+  ParallelTasks(count, [&](const size_t i) {
+    fn(i * aligned, std::min(i * aligned + aligned, len));
+  });
+}
+
+// ParallelFor over the elements of T arrays, ranges starting on kAlignment boundaries
+template <typename T, typename F>
+void parallelForeach_(const size_t len, const F& fn) {
+  ParallelFor(len, ParallelGrain(), PaddedLength<T>(1), fn);
+}
+
+// Threads to split `len` units of work over: `threads` when set, otherwise up to ThreadCount() but
+// at most one per `grain` units, below which a worker costs more than it saves. Never more than
+// len and never less than 1.
+inline size_t threadsFor_(const size_t len, const size_t grain, const size_t threads) {
+  if (threads != 0) return std::max<size_t>(1, std::min(threads, len));
+  if (len < 2 * grain) return 1;
+  return std::max<size_t>(1, std::min(ThreadCount(), len / grain));
+}
+
+// Runs fn(part, begin, end) for every part in [0, parts) on the pool. Part p covers [0, len) from
+// start(p) to start(p + 1), both rounded down to a multiple of `align`; start is only asked for
+// 0 < p < parts and has to grow with p. Ranges may be empty.
+template <typename S, typename F>
+void parallelRanges_(
+    const size_t len, const size_t parts, const size_t align, const S& start, const F& fn) {
+  const auto bound = [&](const size_t part) -> size_t {
+    if (part == 0) return 0;
+    if (part >= parts) return len;
+    return std::min(len, size_t(start(part)) / align * align);
+  };
+  ParallelTasks(parts, [&](const size_t part) { fn(part, bound(part), bound(part + 1)); });
+}
+
+}  // namespace kplutl
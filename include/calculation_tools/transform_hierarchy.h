@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+#include "profile.h"
+#include "vector.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "portable.h"
+#include "thread_pool.h"
+
+/*
+    Flat scene hierarchy: every node has a parent index and a local translation, rotation and
+    scale (TRS), stored as one array per component. World matrices are parent world * T * R * S,
+    row-major and cached per node. Setting a local transform only marks the node dirty. Update
+    then walks down from the dirty nodes breadth-first, one depth level after the other. Each
+    level, the dirty nodes and the children of the nodes recomputed on the level above, is
+    composed in one batched kernel call. Nodes of a level never depend on each other, so wide
+    levels are split over the thread pool. Untouched subtrees are never visited.
+
+    A node can only be added below an existing node, so parents always have smaller indices than
+    their children.
+*/
+
+namespace kplutl {
+// parent of the roots
+constexpr std::uint32_t kNoParent = portable::kTransformNoParent;
+// below this many nodes per task a level is composed on the calling thread
+constexpr size_t kHierarchyGrain = 2048;
+
+template <typename T>
+class TransformHierarchy {
+  static_assert(!std::is_integral_v<T>, "transform hierarchies need a floating-point type");
+
+ public:
+  TransformHierarchy() = default;
+
+  // Adds a node below `parent`, kNoParent for a root, and returns its index. It is dirty until
+  // the next Update.
+  std::uint32_t AddNode(
+      const std::uint32_t parent = kNoParent, const VectorCT<T, 3>& translation = {},
+      const Quaternion<T>& rotation = Quaternion<T>::Identity(),
+      const VectorCT<T, 3>& scale = VectorCT<T, 3>{1, 1, 1}) {
+    assert(parent == kNoParent || parent < size());
+    const auto node = static_cast<std::uint32_t>(size());
+    parent_.push_back(parent);
+    depth_.push_back(parent == kNoParent ? 0 : depth_[parent] + 1);
+    for (auto& comp : local_) comp.push_back(T(0));
+    dirty_.push_back(0);
+    world_.emplace_back();
+    children_valid_ = false;
+    SetLocal(node, translation, rotation, scale);
+    return node;
+  }
+
+  size_t size() const { return parent_.size(); }
+  std::uint32_t Parent(const std::uint32_t node) const { return parent_[node]; }
+  // 0 for the roots
+  size_t Depth(const std::uint32_t node) const { return depth_[node]; }
+
+  VectorCT<T, 3> Translation(const std::uint32_t node) const { return get_<3>(node, 0); }
+  Quaternion<T> Rotation(const std::uint32_t node) const {
+    return Quaternion<T>(get_<4>(node, 3));
+  }
+  VectorCT<T, 3> Scale(const std::uint32_t node) const { return get_<3>(node, 7); }
+
+  void SetTranslation(const std::uint32_t node, const VectorCT<T, 3>& translation) {
+    set_(node, 0, translation);
+  }
+  // `rotation` has to be a unit quaternion
+  void SetRotation(const std::uint32_t node, const Quaternion<T>& rotation) {
+    set_(node, 3, rotation);
+  }
+  void SetScale(const std::uint32_t node, const VectorCT<T, 3>& scale) { set_(node, 7, scale); }
+  void SetLocal(
+      const std::uint32_t node, const VectorCT<T, 3>& translation, const Quaternion<T>& rotation,
+      const VectorCT<T, 3>& scale) {
+    set_(node, 0, translation);
+    set_(node, 3, rotation);
+    set_(node, 7, scale);
+  }
+
+  // world matrix as of the last Update
+  const MatrixCT<T, 4, 4>& World(const std::uint32_t node) const { return world_[node]; }
+  // all world matrices, indexed by node
+  const MatrixCT<T, 4, 4>* WorldMatrices() const { return world_.data(); }
+
+  // Recomputes the world matrices of the nodes set since the last Update and of every node below
+  // them, and returns how many it recomputed.
+  size_t Update() {
+    if (dirty_nodes_.empty()) return 0;
+    if (!children_valid_) buildChildren_();
+    static_assert(sizeof(MatrixCT<T, 4, 4>) == 16 * sizeof(T), "4x4 matrices have to be dense");
+    const T* const local[10]{local_[0].data(), local_[1].data(), local_[2].data(),
+                             local_[3].data(), local_[4].data(), local_[5].data(),
+                             local_[6].data(), local_[7].data(), local_[8].data(),
+                             local_[9].data()};
+    T* world = world_[0];
+    std::stable_sort(
+        dirty_nodes_.begin(), dirty_nodes_.end(),
+        [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+          return depth_[lhs] < depth_[rhs];
+        });
+
+    // batch_ collects one level after the other: the nodes set on that level and the children of
+    // the previous one. Levels above the shallowest dirty node cannot change.
+    batch_.clear();
+    size_t next_dirty = 0, parents = 0, level = depth_[dirty_nodes_.front()];
+    while (true) {
+      const size_t begin = batch_.size();
+      for (size_t i = parents; i < begin; ++i) {
+        const std::uint32_t parent = batch_[i];
+        for (size_t c = child_begin_[parent]; c < child_begin_[parent + 1]; ++c) {
+          const std::uint32_t child = children_[c];
+          // children set since the last Update come from dirty_nodes_ instead
+          if (!dirty_[child]) {
+            dirty_[child] = 1;
+            batch_.push_back(child);
+          }
+        }
+      }
+      for (; next_dirty < dirty_nodes_.size() && depth_[dirty_nodes_[next_dirty]] == level;
+           ++next_dirty) {
+        batch_.push_back(dirty_nodes_[next_dirty]);
+      }
+      parents = begin;
+      if (batch_.size() == begin) {
+        if (next_dirty == dirty_nodes_.size()) break;
+        level = depth_[dirty_nodes_[next_dirty]];
+        continue;
+      }
+      const std::uint32_t* nodes = batch_.data() + begin;
+      ParallelFor(
+          batch_.size() - begin, kHierarchyGrain, 1, [&](const size_t first, const size_t last) {
+            transformCompose_(world, local, nodes + first, last - first);
+          });
+      ++level;
+    }
+    for (const std::uint32_t node : batch_) dirty_[node] = 0;
+    dirty_nodes_.clear();
+    return batch_.size();
+  }
+
+ private:
+  template <size_t N>
+  VectorCT<T, N> get_(const std::uint32_t node, const size_t first) const {
+    VectorCT<T, N> res;
+    for (size_t c = 0; c < N; ++c) res[c] = local_[first + c][node];
+    return res;
+  }
+
+  template <size_t N>
+  void set_(const std::uint32_t node, const size_t first, const VectorCT<T, N>& value) {
+    for (size_t c = 0; c < N; ++c) local_[first + c][node] = value[c];
+    if (!dirty_[node]) {
+      dirty_[node] = 1;
+      dirty_nodes_.push_back(node);
+    }
+  }
+
+  // children of every node, in index order
+  void buildChildren_() {
+    child_begin_.assign(size() + 1, 0);
+    for (const std::uint32_t parent : parent_) {
+      if (parent != kNoParent) ++child_begin_[parent + 1];
+    }
+    for (size_t n = 1; n < child_begin_.size(); ++n) child_begin_[n] += child_begin_[n - 1];
+    std::vector<size_t> fill(child_begin_.begin(), child_begin_.end() - 1);
+    children_.resize(child_begin_.back());
+    for (size_t node = 0; node < size(); ++node) {
+      if (parent_[node] != kNoParent) {
+        children_[fill[parent_[node]]++] = static_cast<std::uint32_t>(node);
+      }
+    }
+    children_valid_ = true;
+  }
+
+  void transformCompose_(
+      T* world, const T* const local[10], const std::uint32_t* nodes, const size_t count) const {
+    CT_PROFILE_BEGIN(TransformComposeSoA);
+#ifdef ENABLE_ISPC
+    ispc::TransformComposeSoA(world, local, parent_.data(), nodes, count);
+#else
+    portable::TransformComposeSoA<T>(world, local, parent_.data(), nodes, count);
+#endif
+    CT_PROFILE_END(TransformComposeSoA, count, count * (42 * sizeof(T) + 8));
+  }
+
+  std::vector<std::uint32_t> parent_;
+  std::vector<size_t> depth_;
+  // translation x, y, z, rotation x, y, z, w, scale x, y, z
+  std::vector<T> local_[10];
+  std::vector<MatrixCT<T, 4, 4>> world_;
+  std::vector<std::uint8_t> dirty_;
+  std::vector<std::uint32_t> dirty_nodes_;  // set since the last Update
+
+  // children_[child_begin_[n], child_begin_[n + 1]) are the children of n
+  std::vector<std::uint32_t> children_;
+  std::vector<size_t> child_begin_;
+  bool children_valid_ = true;
+  std::vector<std::uint32_t> batch_;  // nodes recomputed by the running Update, level by level
+};
+
+/* type defines */
+
+using TransformHierarchyf = TransformHierarchy<float>;
+using TransformHierarchyd = TransformHierarchy<double>;
+
+}  // namespace kplutl
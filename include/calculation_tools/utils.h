@@ -3,33 +3,325 @@
 #include <cstdint>
 
 #include "config.h"
+#include "half.h"
 
 namespace kplutl {
-#ifdef ENABLE_ISPC
-namespace ispc {
-extern "C" {
+/* helpers */
+
+// Keeps a parameter out of template argument deduction, e.g. so nullptr can stand in for an
+// optional array argument.
+template <typename T>
+struct NonDeduced {
+  using type = T;
+};
+
+template <typename T>
+using non_deduced_t = typename NonDeduced<T>::type;
+
+// true while the enclosing call is evaluated at compile time; kernels then take the constexpr
+// portable path instead of ISPC or intrinsics
+constexpr bool isConstantEvaluated_() {
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+  return __builtin_is_constant_evaluated();
+#else
+  return false;
 #endif
-/* basic */
+}
+
+/* vertex transform flags */
+
+enum VertexTransformFlags : std::uint32_t {
+  kVertexTransformNone = 0,
+  kVertexPerspectiveDivide = 1 << 0,  // divide x, y, z by the transformed w
+  kVertexViewportMapping = 1 << 1,    // map NDC to window coordinates, see Viewport
+};
+
+/* stream normalize flags */
+
+enum NormalizeFlags : std::uint32_t {
+  kNormalizeExact = 0,
+  // scale by an estimated 1 / length refined with one Newton step instead of dividing by the
+  // length, see Normalize in vector_stream.h for the error bound
+  kNormalizeFast = 1 << 0,
+};
+
+/* matrix inverse flags */
+
+enum InverseFlags : std::uint32_t {
+  kInverseDefault = 0,
+  kInverseTranspose = 1 << 0,  // write the transposed inverse, as normal matrices want
+};
+
+/* triangular solve flags */
 
-extern void AddForeach(float* out, const float* in_lhs, const float* in_rhs, const std::uint8_t len);
-extern void SubForeach(float* out, const float* in_lhs, const float* in_rhs, const std::uint8_t len);
-extern void MulForeach(float* out, const float* in_lhs, const float* in_rhs, const std::uint8_t len);
-extern void DivForeach(float* out, const float* in_lhs, const float* in_rhs, const std::uint8_t len);
-extern void PowForeach(float* out, const float* in_lhs, const float* in_rhs, const std::uint8_t len);
-extern void AbsForeach(float* out, const float* in_arg, const std::uint8_t len);
-extern void SqrtForeach(float* out, const float* in_arg, const std::uint8_t len);
-extern void NegForeach(float* out, const float* in_arg, const std::uint8_t len);
+enum TriangularFlags : std::uint32_t {
+  kTriangularLower = 0,
+  kTriangularUpper = 1 << 0,         // A is upper instead of lower triangular
+  kTriangularUnitDiagonal = 1 << 1,  // A has ones on its diagonal, which is not read
+};
 
-/* linear algebra */
+/* rotation builder flags */
 
-extern void VectorDotProd(float* out, const float* vec_lhs, const float* vec_rhs, std::uint8_t len);
-extern void VectorCrossProdV3(float vec_out[3], const float vec_lhs[3], const float vec_rhs[3]);
-extern void VectorTransformV4(const float mat_lhs[16], float vec_rhs[4]);
-extern void BuildIdentity(float* mat_arg, const std::uint8_t dim);
-extern void MatrixTranspose(float* mat_out, const float* mat_arg, const std::uint8_t row, const std::uint8_t col);
+enum RotationFlags : std::uint32_t {
+  kRotationDefault = 0,
+  // sine and cosine from a range-reduced polynomial instead of the math library, see sincosFast_
+  // in portable.h for the error bound
+  kRotationFast = 1 << 0,
+  kRotationAffine = 1 << 1,  // write 3x4 matrices, 12 elements apart, instead of 4x4 ones
+};
+
+/* reduction flags */
+
+enum ReduceFlags : std::uint32_t {
+  kReduceDefault = 0,
+  kReduceKahan = 1 << 0,     // compensated (Kahan) summation in every accumulator
+  kReducePairwise = 1 << 1,  // sum kReduceBlock-element blocks, then add the block sums pairwise
+};
+
+// elements per block of kReducePairwise, keep in sync with reduction.ispc
+constexpr std::uint64_t kReduceBlock = 4096;
+
+/* expression bytecode */
+
+// opcodes of the ExprForeach interpreter, keep in sync with basic.ispc
+enum ExprOp : std::int32_t {
+  kExprScalar = 0,  // dst = scalars[lhs]
+  kExprAdd,
+  kExprSub,
+  kExprMul,
+  kExprDiv,
+  kExprNeg,
+  kExprAbs,
+  kExprSqrt,
+};
+
+constexpr std::int32_t kExprOut = -1024;  // dst operand naming the output array
+constexpr int kExprRegisters = 8;
+constexpr int kExprMaxInstructions = 32;
+constexpr int kExprMaxArrays = 16;
+constexpr int kExprMaxScalars = 16;
+
+/* kernels */
+
+// Every kernel with its C signature over element type T, as X(name, params, args, T, suffix). The
+// ISPC build exports each one per element type, the suffix tells them apart: none for float, _f64
+// for double, _i32 for int32 and _f16 for Half (fp16 storage, float arithmetic).
+#define CT_BINARY_KERNEL(X, T, suffix, name)                                    \
+  X(name, (T * out, const T* in_lhs, const T* in_rhs, const std::uint64_t len), \
+    (out, in_lhs, in_rhs, len), T, suffix)
+#define CT_UNARY_KERNEL(X, T, suffix, name) \
+  X(name, (T * out, const T* in_arg, const std::uint64_t len), (out, in_arg, len), T, suffix)
+#define CT_SCALAR_KERNEL(X, T, suffix, name)                                   \
+  X(name, (T * out, const T* in_lhs, const T scalar, const std::uint64_t len), \
+    (out, in_lhs, scalar, len), T, suffix)
+#define CT_SCALAR_LHS_KERNEL(X, T, suffix, name)                               \
+  X(name, (T * out, const T scalar, const T* in_rhs, const std::uint64_t len), \
+    (out, scalar, in_rhs, len), T, suffix)
+#define CT_INPLACE_KERNEL(X, T, suffix, name) \
+  X(name, (T * inout, const T* in_rhs, const std::uint64_t len), (inout, in_rhs, len), T, suffix)
+#define CT_SCALAR_INPLACE_KERNEL(X, T, suffix, name) \
+  X(name, (T * inout, const T scalar, const std::uint64_t len), (inout, scalar, len), T, suffix)
+#define CT_UNARY_INPLACE_KERNEL(X, T, suffix, name) \
+  X(name, (T * inout, const std::uint64_t len), (inout, len), T, suffix)
+
+#define CT_KERNELS(X, T, suffix)                                                               \
+  /* basic */                                                                                  \
+  CT_BINARY_KERNEL(X, T, suffix, AddForeach)                                                   \
+  CT_BINARY_KERNEL(X, T, suffix, SubForeach)                                                   \
+  CT_BINARY_KERNEL(X, T, suffix, MulForeach)                                                   \
+  CT_BINARY_KERNEL(X, T, suffix, DivForeach)                                                   \
+  CT_BINARY_KERNEL(X, T, suffix, PowForeach)                                                   \
+  CT_UNARY_KERNEL(X, T, suffix, AbsForeach)                                                    \
+  CT_UNARY_KERNEL(X, T, suffix, SqrtForeach)                                                   \
+  CT_UNARY_KERNEL(X, T, suffix, NegForeach)                                                    \
+  CT_SCALAR_KERNEL(X, T, suffix, AddScalarForeach)                                             \
+  CT_SCALAR_KERNEL(X, T, suffix, SubScalarForeach)                                             \
+  CT_SCALAR_KERNEL(X, T, suffix, MulScalarForeach)                                             \
+  CT_SCALAR_KERNEL(X, T, suffix, DivScalarForeach)                                             \
+  CT_SCALAR_KERNEL(X, T, suffix, PowScalarForeach)                                             \
+  CT_SCALAR_LHS_KERNEL(X, T, suffix, ScalarSubForeach)                                         \
+  CT_SCALAR_LHS_KERNEL(X, T, suffix, ScalarDivForeach)                                         \
+  CT_SCALAR_LHS_KERNEL(X, T, suffix, ScalarPowForeach)                                         \
+  CT_INPLACE_KERNEL(X, T, suffix, AddInplaceForeach)                                           \
+  CT_INPLACE_KERNEL(X, T, suffix, SubInplaceForeach)                                           \
+  CT_INPLACE_KERNEL(X, T, suffix, MulInplaceForeach)                                           \
+  CT_INPLACE_KERNEL(X, T, suffix, DivInplaceForeach)                                           \
+  CT_INPLACE_KERNEL(X, T, suffix, PowInplaceForeach)                                           \
+  CT_SCALAR_INPLACE_KERNEL(X, T, suffix, AddScalarInplaceForeach)                              \
+  CT_SCALAR_INPLACE_KERNEL(X, T, suffix, SubScalarInplaceForeach)                              \
+  CT_SCALAR_INPLACE_KERNEL(X, T, suffix, MulScalarInplaceForeach)                              \
+  CT_SCALAR_INPLACE_KERNEL(X, T, suffix, DivScalarInplaceForeach)                              \
+  CT_SCALAR_INPLACE_KERNEL(X, T, suffix, PowScalarInplaceForeach)                              \
+  CT_UNARY_INPLACE_KERNEL(X, T, suffix, AbsInplaceForeach)                                     \
+  CT_UNARY_INPLACE_KERNEL(X, T, suffix, SqrtInplaceForeach)                                    \
+  CT_UNARY_INPLACE_KERNEL(X, T, suffix, NegInplaceForeach)                                     \
+  X(ExprForeach,                                                                               \
+    (T * out, const std::int32_t code[], const std::int32_t code_len, const T* const arrays[], \
+     const T scalars[], const std::uint64_t len),                                              \
+    (out, code, code_len, arrays, scalars, len), T, suffix)                                    \
+  /* linear algebra */                                                                         \
+  CT_BINARY_KERNEL(X, T, suffix, VectorDotProd)                                                \
+  X(VectorCrossProdV3, (T vec_out[3], const T vec_lhs[3], const T vec_rhs[3]),                 \
+    (vec_out, vec_lhs, vec_rhs), T, suffix)                                                    \
+  X(VectorTransformV4, (const T mat_lhs[16], T vec_rhs[4]), (mat_lhs, vec_rhs), T, suffix)     \
+  X(VertexTransformSoA,                                                                        \
+    (const T mat_lhs[16], const T in_x[], const T in_y[], const T in_z[], const T in_w[],      \
+     T out_x[], T out_y[], T out_z[], T out_w[], const std::uint64_t count,                    \
+     const std::uint32_t flags, const T viewport[6]),                                          \
+    (mat_lhs, in_x, in_y, in_z, in_w, out_x, out_y, out_z, out_w, count, flags, viewport),     \
+    T, suffix)                                                                                 \
+  X(VertexTransformAoS,                                                                        \
+    (const T mat_lhs[16], const T vec_in[], const std::uint64_t in_stride,                     \
+     const std::uint32_t in_comps, T vec_out[], const std::uint64_t out_stride,                \
+     const std::uint64_t count, const std::uint32_t flags, const T viewport[6]),               \
+    (mat_lhs, vec_in, in_stride, in_comps, vec_out, out_stride, count, flags, viewport),       \
+    T, suffix)                                                                                 \
+  X(MatrixGemm,                                                                                \
+    (const std::uint64_t m, const std::uint64_t n, const std::uint64_t k, const T alpha,       \
+     const T mat_a[], const std::uint64_t lda, const T mat_b[], const std::uint64_t ldb,       \
+     const T beta, T mat_c[], const std::uint64_t ldc),                                        \
+    (m, n, k, alpha, mat_a, lda, mat_b, ldb, beta, mat_c, ldc), T, suffix)                     \
+  X(BuildIdentity, (T * mat_arg, const std::uint64_t dim, const std::uint64_t ld),             \
+    (mat_arg, dim, ld), T, suffix)                                                             \
+  X(MatrixTranspose,                                                                           \
+    (T * mat_out, const T* mat_arg, const std::uint64_t row, const std::uint64_t col,          \
+     const std::uint64_t ld_out, const std::uint64_t ld_arg),                                  \
+    (mat_out, mat_arg, row, col, ld_out, ld_arg), T, suffix)                                   \
+  X(MatrixInverseBatch,                                                                        \
+    (T mat_out[], T det_out[], const T mat_arg[], const std::uint32_t dim,                     \
+     const std::uint64_t ld, const std::uint64_t count, const std::uint32_t flags),            \
+    (mat_out, det_out, mat_arg, dim, ld, count, flags), T, suffix)                             \
+  X(MatrixInverseAffineBatch, (T mat_out[], const T mat_arg[], const std::uint64_t count),     \
+    (mat_out, mat_arg, count), T, suffix)                                                      \
+  X(MatrixProdBatch,                                                                           \
+    (T mat_out[], const T mat_lhs[], const T mat_rhs[], const std::uint32_t dim,               \
+     const std::uint64_t ld, const std::uint64_t lhs_stride, const std::uint64_t rhs_stride,   \
+     const std::uint64_t count),                                                               \
+    (mat_out, mat_lhs, mat_rhs, dim, ld, lhs_stride, rhs_stride, count), T, suffix)            \
+  /* dense factorizations */                                                                   \
+  X(MatrixTriangularSolve,                                                                     \
+    (const std::uint64_t m, const std::uint64_t n, const T mat_a[], const std::uint64_t lda,   \
+     T mat_b[], const std::uint64_t ldb, const std::uint32_t flags),                           \
+    (m, n, mat_a, lda, mat_b, ldb, flags), T, suffix)                                          \
+  X(MatrixLuPanel,                                                                             \
+    (T mat[], const std::uint64_t rows, const std::uint64_t cols, const std::uint64_t ld,      \
+     std::uint64_t pivots[]),                                                                  \
+    (mat, rows, cols, ld, pivots), T, suffix)                                                  \
+  X(MatrixCholeskyBlock,                                                                       \
+    (T mat[], const std::uint64_t dim, const std::uint64_t ld, std::uint64_t info[1]),         \
+    (mat, dim, ld, info), T, suffix)                                                           \
+  /* vector streams */                                                                         \
+  X(StreamDotProd,                                                                             \
+    (T out[], const T* const vec_lhs[], const T* const vec_rhs[], const std::uint32_t comps,   \
+     const std::uint64_t count),                                                               \
+    (out, vec_lhs, vec_rhs, comps, count), T, suffix)                                          \
+  X(StreamCrossProd,                                                                           \
+    (T* const vec_out[3], const T* const vec_lhs[3], const T* const vec_rhs[3],                \
+     const std::uint64_t count),                                                               \
+    (vec_out, vec_lhs, vec_rhs, count), T, suffix)                                             \
+  X(StreamLength,                                                                              \
+    (T out[], const T* const vec_arg[], const std::uint32_t comps, const std::uint64_t count), \
+    (out, vec_arg, comps, count), T, suffix)                                                   \
+  X(StreamNormalize,                                                                           \
+    (T* const vec_out[], const T* const vec_arg[], const std::uint32_t comps,                  \
+     const std::uint64_t count, const std::uint32_t flags),                                    \
+    (vec_out, vec_arg, comps, count, flags), T, suffix)                                        \
+  /* reductions */                                                                             \
+  X(ReduceSum,                                                                                 \
+    (compute_t<T> out[1], const T vec_arg[], const std::uint64_t len,                          \
+     const std::uint32_t flags),                                                               \
+    (out, vec_arg, len, flags), T, suffix)                                                     \
+  X(ReduceAbsSum,                                                                              \
+    (compute_t<T> out[1], const T vec_arg[], const std::uint64_t len,                          \
+     const std::uint32_t flags),                                                               \
+    (out, vec_arg, len, flags), T, suffix)                                                     \
+  X(ReduceDotProd,                                                                             \
+    (compute_t<T> out[1], const T vec_lhs[], const T vec_rhs[], const std::uint64_t len,       \
+     const std::uint32_t flags),                                                               \
+    (out, vec_lhs, vec_rhs, len, flags), T, suffix)                                            \
+  X(ReduceMinMax,                                                                              \
+    (T out[2], std::uint64_t index[2], const T vec_arg[], const std::uint64_t len),            \
+    (out, index, vec_arg, len), T, suffix)                                                     \
+  /* quaternions */                                                                            \
+  X(QuaternionMulSoA,                                                                          \
+    (T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],             \
+     const std::uint64_t count),                                                               \
+    (quat_out, quat_lhs, quat_rhs, count), T, suffix)                                          \
+  X(QuaternionRotateSoA,                                                                       \
+    (T* const vec_out[3], const T* const quat_arg[4], const T* const vec_arg[3],               \
+     const std::uint64_t count),                                                               \
+    (vec_out, quat_arg, vec_arg, count), T, suffix)                                            \
+  X(QuaternionNlerpSoA,                                                                        \
+    (T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],             \
+     const T weight[], const std::uint64_t weight_stride, const std::uint64_t count),          \
+    (quat_out, quat_lhs, quat_rhs, weight, weight_stride, count), T, suffix)                   \
+  X(QuaternionSlerpSoA,                                                                        \
+    (T* const quat_out[4], const T* const quat_lhs[4], const T* const quat_rhs[4],             \
+     const T weight[], const std::uint64_t weight_stride, const std::uint64_t count),          \
+    (quat_out, quat_lhs, quat_rhs, weight, weight_stride, count), T, suffix)                   \
+  X(QuaternionToMatrixSoA,                                                                     \
+    (T mat_out[], const T* const quat_arg[4], const std::uint64_t count),                      \
+    (mat_out, quat_arg, count), T, suffix)                                                     \
+  X(QuaternionFromMatrixSoA,                                                                   \
+    (T* const quat_out[4], const T mat_arg[], const std::uint64_t count),                      \
+    (quat_out, mat_arg, count), T, suffix)                                                     \
+  X(RotationFromEulerSoA,                                                                      \
+    (T mat_out[], const T* const angle[3], const std::uint64_t count,                          \
+     const std::uint32_t flags),                                                               \
+    (mat_out, angle, count, flags), T, suffix)                                                 \
+  X(RotationFromAxisAngleSoA,                                                                  \
+    (T mat_out[], const T* const axis[3], const T angle[], const std::uint64_t count,          \
+     const std::uint32_t flags),                                                               \
+    (mat_out, axis, angle, count, flags), T, suffix)                                           \
+  X(TransformComposeSoA,                                                                       \
+    (T world[], const T* const local[10], const std::uint32_t parent[],                        \
+     const std::uint32_t node[], const std::uint64_t count),                                   \
+    (world, local, parent, node, count), T, suffix)                                            \
+  /* skinning */                                                                               \
+  X(SkinSoA,                                                                                   \
+    (T* const pos_out[3], T* const normal_out[3], const T palette[],                           \
+     const std::uint32_t* const bone[4], const T* const weight[4], const T* const pos_in[3],   \
+     const T* const normal_in[3], const std::uint64_t count),                                  \
+    (pos_out, normal_out, palette, bone, weight, pos_in, normal_in, count), T, suffix)         \
+  /* culling */                                                                                \
+  X(CullAabbSoA,                                                                               \
+    (std::uint32_t out_index[], std::uint64_t out_count[1], const compute_t<T> planes[24],     \
+     const T* const aabb_min[3], const T* const aabb_max[3], const std::uint32_t index_base,   \
+     const std::uint64_t count),                                                               \
+    (out_index, out_count, planes, aabb_min, aabb_max, index_base, count), T, suffix)          \
+  X(CullSphereSoA,                                                                             \
+    (std::uint32_t out_index[], std::uint64_t out_count[1], const compute_t<T> planes[24],     \
+     const T* const sphere[4], const std::uint32_t index_base, const std::uint64_t count),     \
+    (out_index, out_count, planes, sphere, index_base, count), T, suffix)                      \
+  /* sparse */                                                                                 \
+  X(SparseMatVec,                                                                              \
+    (T vec_out[], const std::uint64_t row_begin[], const std::uint32_t col[],                  \
+     const T values[], const T vec_in[], const std::uint64_t rows),                            \
+    (vec_out, row_begin, col, values, vec_in, rows), T, suffix)
+
+#define CT_CONCAT_(name, suffix) name##suffix
+#define CT_CONCAT(name, suffix) CT_CONCAT_(name, suffix)
 
 #ifdef ENABLE_ISPC
+// ISPC kernels, forwarded to the target picked at runtime (see dispatch.h); without ISPC the same
+// kernels come from portable.h
+namespace ispc {
+extern "C" {
+#define CT_DECLARE_KERNEL(name, params, args, T, suffix) extern void CT_CONCAT(name, suffix) params;
+CT_KERNELS(CT_DECLARE_KERNEL, float, )
+CT_KERNELS(CT_DECLARE_KERNEL, double, _f64)
+CT_KERNELS(CT_DECLARE_KERNEL, std::int32_t, _i32)
+CT_KERNELS(CT_DECLARE_KERNEL, Half, _f16)
+#undef CT_DECLARE_KERNEL
 }
+
+// overloads on the element type, so callers write ispc::AddForeach whatever T is
+#define CT_OVERLOAD_KERNEL(name, params, args, T, suffix) \
+  inline void name params { CT_CONCAT(name, suffix) args; }
+CT_KERNELS(CT_OVERLOAD_KERNEL, double, _f64)
+CT_KERNELS(CT_OVERLOAD_KERNEL, std::int32_t, _i32)
+CT_KERNELS(CT_OVERLOAD_KERNEL, Half, _f16)
+#undef CT_OVERLOAD_KERNEL
 }  // namespace ispc
 #endif
 }  // namespace kplutl
\ No newline at end of file
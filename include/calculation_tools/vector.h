@@ -6,31 +6,39 @@
 #include <iterator>
 #include <iostream>
 #include <initializer_list>
+#include <utility>
 
 #include "utils.h"
+#include "profile.h"
+#include "simd.h"
+#include "portable.h"
 
 namespace kplutl {
+template <typename E>
+struct Expr;
+
 template <typename T, size_t N>
 struct VectorCT {
-  std::array<T, N> data_{};
+  // may hold trailing padding lanes, see VectorStorage
+  alignas(VectorStorage<T, N>::kAlign) std::array<T, VectorStorage<T, N>::kLength> data_{};
 
-  VectorCT<T, N>() = default;
-  VectorCT<T, N>(VectorCT<T, N>& vectorCT) = default;
-  VectorCT<T, N>& operator=(VectorCT<T, N>& matrixCT) = default;
-  VectorCT<T, N>(VectorCT<T, N>&& vectorCT) = default;
-  VectorCT<T, N>& operator=(VectorCT<T, N>&& matrixCT) = default;
+  constexpr VectorCT<T, N>() = default;
+  constexpr VectorCT<T, N>(const VectorCT<T, N>& vectorCT) = default;
+  constexpr VectorCT<T, N>& operator=(const VectorCT<T, N>& vectorCT) = default;
+  constexpr VectorCT<T, N>(VectorCT<T, N>&& vectorCT) = default;
+  constexpr VectorCT<T, N>& operator=(VectorCT<T, N>&& vectorCT) = default;
 
-  VectorCT<T, N>(T value) {
+  constexpr VectorCT<T, N>(T value) {
     for (size_t i = 0; i < N; ++i) data_[i] = value;
   }
-  VectorCT<T, N>(std::initializer_list<const T> list) {
+  constexpr VectorCT<T, N>(std::initializer_list<const T> list) {
     assert(list.size() == N);
     size_t i = 0;
     for (auto value : list) data_[i++] = value;
   }
 
   template <typename It>
-  VectorCT<T, N>(It first, It last) {
+  constexpr VectorCT<T, N>(It first, It last) {
     auto size = std::distance(first, last);
     assert(size == N);
     auto it = first;
@@ -40,58 +48,71 @@ struct VectorCT {
     }
   }
 
+  // evaluates a fused expression started with Lazy(), see expression.h
+  template <typename E>
+  VectorCT<T, N>(const Expr<E>& expr) {
+    Assign(*this, expr);
+  }
+
   template <typename S>
-  explicit VectorCT<T, N>(const S* source) {
+  explicit constexpr VectorCT<T, N>(const S* source) {
     for (size_t i = 0; i < N; ++i) data_[i] = (T)source[i];
   }
   template <typename S>
-  explicit VectorCT<T, N>(const VectorCT<S, N>& source) {
+  explicit constexpr VectorCT<T, N>(const VectorCT<S, N>& source) {
     for (size_t i = 0; i < N; ++i) data_[i] = (T)source[i];
   }
 
-  T& operator[](size_t index) { return data_[index]; }
+  constexpr T& operator[](size_t index) { return data_[index]; }
+  constexpr const T& operator[](size_t index) const { return data_[index]; }
 
-  operator T*() { return &data_[0]; };
+  constexpr operator T*() { return data_.data(); };
 
-  operator const T*() const { return reinterpret_cast<const T*>(&data_[0]); }
+  constexpr operator const T*() const { return data_.data(); }
 
-  VectorCT<T, N>& operator+=(const VectorCT<T, N>& lhs) {
-    *this = *this + lhs;
+  template <typename E>
+  VectorCT<T, N>& operator=(const Expr<E>& expr) {
+    Assign(*this, expr);
     return *this;
   }
 
-  VectorCT<T, N>& operator+=(const T scalar) {
-    *this = *this + scalar;
+  constexpr VectorCT<T, N>& operator+=(const VectorCT<T, N>& lhs) {
+    vectorAddInplace_(*this, lhs);
     return *this;
   }
 
-  VectorCT<T, N>& operator-=(const VectorCT<T, N>& lhs) {
-    *this = *this - lhs;
+  constexpr VectorCT<T, N>& operator+=(const T scalar) {
+    vectorAddScalarInplace_(*this, scalar);
     return *this;
   }
 
-  VectorCT<T, N>& operator-=(const T scalar) {
-    *this = *this - scalar;
+  constexpr VectorCT<T, N>& operator-=(const VectorCT<T, N>& lhs) {
+    vectorSubInplace_(*this, lhs);
     return *this;
   }
 
-  VectorCT<T, N>& operator*=(const VectorCT<T, N>& lhs) {
-    *this = *this * lhs;
+  constexpr VectorCT<T, N>& operator-=(const T scalar) {
+    vectorSubScalarInplace_(*this, scalar);
     return *this;
   }
 
-  VectorCT<T, N>& operator*=(const T scalar) {
-    *this = *this * scalar;
+  constexpr VectorCT<T, N>& operator*=(const VectorCT<T, N>& lhs) {
+    vectorMulInplace_(*this, lhs);
     return *this;
   }
 
-  VectorCT<T, N>& operator/=(const VectorCT<T, N>& lhs) {
-    *this = *this / lhs;
+  constexpr VectorCT<T, N>& operator*=(const T scalar) {
+    vectorMulScalarInplace_(*this, scalar);
     return *this;
   }
 
-  VectorCT<T, N>& operator/=(const T scalar) {
-    *this = *this / scalar;
+  constexpr VectorCT<T, N>& operator/=(const VectorCT<T, N>& lhs) {
+    vectorDivInplace_(*this, lhs);
+    return *this;
+  }
+
+  constexpr VectorCT<T, N>& operator/=(const T scalar) {
+    vectorDivScalarInplace_(*this, scalar);
     return *this;
   }
 };
@@ -101,193 +122,684 @@ struct VectorCT {
 using Vector2f = VectorCT<float, 2>;
 using Vector3f = VectorCT<float, 3>;
 using Vector4f = VectorCT<float, 4>;
+using Vector2d = VectorCT<double, 2>;
+using Vector3d = VectorCT<double, 3>;
+using Vector4d = VectorCT<double, 4>;
+using Vector2i = VectorCT<std::int32_t, 2>;
+using Vector3i = VectorCT<std::int32_t, 3>;
+using Vector4i = VectorCT<std::int32_t, 4>;
 
 /* inline functions */
 
 template <typename T, size_t N>
-inline void vectorAdd_(
+constexpr void vectorAdd_(
     VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::AddForeach<T>(out, in_lhs, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Add(B::Load(in_lhs), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(AddForeach);
 #ifdef ENABLE_ISPC
-  ispc::AddForeach(out, in_lhs, in_rhs, N);
+    ispc::AddForeach(out, in_lhs, in_rhs, N);
 #else
-  AddForeach(out, in_lhs, in_rhs, N);
+    portable::AddForeach<T>(out, in_lhs, in_rhs, N);
 #endif
+    CT_PROFILE_END(AddForeach, N, 3 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorSub_(
+constexpr void vectorSub_(
     VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::SubForeach<T>(out, in_lhs, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Sub(B::Load(in_lhs), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(SubForeach);
 #ifdef ENABLE_ISPC
-  ispc::SubForeach(out, in_lhs, in_rhs, N);
+    ispc::SubForeach(out, in_lhs, in_rhs, N);
 #else
-  SubForeach(out, in_lhs, in_rhs, N);
+    portable::SubForeach<T>(out, in_lhs, in_rhs, N);
 #endif
+    CT_PROFILE_END(SubForeach, N, 3 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorMul_(
+constexpr void vectorMul_(
     VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::MulForeach<T>(out, in_lhs, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Mul(B::Load(in_lhs), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(MulForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulForeach(out, in_lhs, in_rhs, N);
+#else
+    portable::MulForeach<T>(out, in_lhs, in_rhs, N);
+#endif
+    CT_PROFILE_END(MulForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorDiv_(
+    VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::DivForeach<T>(out, in_lhs, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Div(B::Load(in_lhs), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(DivForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivForeach(out, in_lhs, in_rhs, N);
+#else
+    portable::DivForeach<T>(out, in_lhs, in_rhs, N);
+#endif
+    CT_PROFILE_END(DivForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorAbs_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+  if (isConstantEvaluated_()) {
+    portable::AbsForeach<T>(out, in_arg, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Abs(B::Load(in_arg)));
+  } else {
+    CT_PROFILE_BEGIN(AbsForeach);
+#ifdef ENABLE_ISPC
+    ispc::AbsForeach(out, in_arg, N);
+#else
+    portable::AbsForeach<T>(out, in_arg, N);
+#endif
+    CT_PROFILE_END(AbsForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorSqrt_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+  if (isConstantEvaluated_()) {
+    portable::SqrtForeach<T>(out, in_arg, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Sqrt(B::Load(in_arg)));
+  } else {
+    CT_PROFILE_BEGIN(SqrtForeach);
 #ifdef ENABLE_ISPC
-  ispc::MulForeach(out, in_lhs, in_rhs, N);
+    ispc::SqrtForeach(out, in_arg, N);
 #else
-  MulForeach(in_lhs, in_rhs, out, N);
+    portable::SqrtForeach<T>(out, in_arg, N);
 #endif
+    CT_PROFILE_END(SqrtForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorNeg_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+  if (isConstantEvaluated_()) {
+    portable::NegForeach<T>(out, in_arg, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Neg(B::Load(in_arg)));
+  } else {
+    CT_PROFILE_BEGIN(NegForeach);
+#ifdef ENABLE_ISPC
+    ispc::NegForeach(out, in_arg, N);
+#else
+    portable::NegForeach<T>(out, in_arg, N);
+#endif
+    CT_PROFILE_END(NegForeach, N, 2 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorDiv_(
+constexpr void vectorPow_(
     VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::PowForeach<T>(out, in_lhs, in_rhs, N);
+  } else {
+    CT_PROFILE_BEGIN(PowForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowForeach(out, in_lhs, in_rhs, N);
+#else
+    portable::PowForeach<T>(out, in_lhs, in_rhs, N);
+#endif
+    CT_PROFILE_END(PowForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorAddScalar_(VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::AddScalarForeach<T>(out, in_lhs, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Add(B::Load(in_lhs), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(AddScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarForeach(out, in_lhs, scalar, N);
+#else
+    portable::AddScalarForeach<T>(out, in_lhs, scalar, N);
+#endif
+    CT_PROFILE_END(AddScalarForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorSubScalar_(VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::SubScalarForeach<T>(out, in_lhs, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Sub(B::Load(in_lhs), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(SubScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubScalarForeach(out, in_lhs, scalar, N);
+#else
+    portable::SubScalarForeach<T>(out, in_lhs, scalar, N);
+#endif
+    CT_PROFILE_END(SubScalarForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorMulScalar_(VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::MulScalarForeach<T>(out, in_lhs, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Mul(B::Load(in_lhs), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(MulScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulScalarForeach(out, in_lhs, scalar, N);
+#else
+    portable::MulScalarForeach<T>(out, in_lhs, scalar, N);
+#endif
+    CT_PROFILE_END(MulScalarForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorDivScalar_(VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::DivScalarForeach<T>(out, in_lhs, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Div(B::Load(in_lhs), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(DivScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivScalarForeach(out, in_lhs, scalar, N);
+#else
+    portable::DivScalarForeach<T>(out, in_lhs, scalar, N);
+#endif
+    CT_PROFILE_END(DivScalarForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorPowScalar_(VectorCT<T, N>& out, const VectorCT<T, N>& in_lhs, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::PowScalarForeach<T>(out, in_lhs, scalar, N);
+  } else {
+    CT_PROFILE_BEGIN(PowScalarForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowScalarForeach(out, in_lhs, scalar, N);
+#else
+    portable::PowScalarForeach<T>(out, in_lhs, scalar, N);
+#endif
+    CT_PROFILE_END(PowScalarForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorScalarSub_(VectorCT<T, N>& out, const T scalar, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::ScalarSubForeach<T>(out, scalar, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Sub(B::Set(scalar), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(ScalarSubForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarSubForeach(out, scalar, in_rhs, N);
+#else
+    portable::ScalarSubForeach<T>(out, scalar, in_rhs, N);
+#endif
+    CT_PROFILE_END(ScalarSubForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorScalarDiv_(VectorCT<T, N>& out, const T scalar, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::ScalarDivForeach<T>(out, scalar, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(out, B::Div(B::Set(scalar), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(ScalarDivForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarDivForeach(out, scalar, in_rhs, N);
+#else
+    portable::ScalarDivForeach<T>(out, scalar, in_rhs, N);
+#endif
+    CT_PROFILE_END(ScalarDivForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorScalarPow_(VectorCT<T, N>& out, const T scalar, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::ScalarPowForeach<T>(out, scalar, in_rhs, N);
+  } else {
+    CT_PROFILE_BEGIN(ScalarPowForeach);
+#ifdef ENABLE_ISPC
+    ispc::ScalarPowForeach(out, scalar, in_rhs, N);
+#else
+    portable::ScalarPowForeach<T>(out, scalar, in_rhs, N);
+#endif
+    CT_PROFILE_END(ScalarPowForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorAddInplace_(VectorCT<T, N>& inout, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::AddInplaceForeach<T>(inout, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Add(B::Load(inout), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(AddInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddInplaceForeach(inout, in_rhs, N);
+#else
+    portable::AddInplaceForeach<T>(inout, in_rhs, N);
+#endif
+    CT_PROFILE_END(AddInplaceForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorSubInplace_(VectorCT<T, N>& inout, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::SubInplaceForeach<T>(inout, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Sub(B::Load(inout), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(SubInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubInplaceForeach(inout, in_rhs, N);
+#else
+    portable::SubInplaceForeach<T>(inout, in_rhs, N);
+#endif
+    CT_PROFILE_END(SubInplaceForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorMulInplace_(VectorCT<T, N>& inout, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::MulInplaceForeach<T>(inout, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Mul(B::Load(inout), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(MulInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulInplaceForeach(inout, in_rhs, N);
+#else
+    portable::MulInplaceForeach<T>(inout, in_rhs, N);
+#endif
+    CT_PROFILE_END(MulInplaceForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorDivInplace_(VectorCT<T, N>& inout, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::DivInplaceForeach<T>(inout, in_rhs, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Div(B::Load(inout), B::Load(in_rhs)));
+  } else {
+    CT_PROFILE_BEGIN(DivInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivInplaceForeach(inout, in_rhs, N);
+#else
+    portable::DivInplaceForeach<T>(inout, in_rhs, N);
+#endif
+    CT_PROFILE_END(DivInplaceForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorPowInplace_(VectorCT<T, N>& inout, const VectorCT<T, N>& in_rhs) {
+  if (isConstantEvaluated_()) {
+    portable::PowInplaceForeach<T>(inout, in_rhs, N);
+  } else {
+    CT_PROFILE_BEGIN(PowInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::PowInplaceForeach(inout, in_rhs, N);
+#else
+    portable::PowInplaceForeach<T>(inout, in_rhs, N);
+#endif
+    CT_PROFILE_END(PowInplaceForeach, N, 3 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorAddScalarInplace_(VectorCT<T, N>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::AddScalarInplaceForeach<T>(inout, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Add(B::Load(inout), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(AddScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarInplaceForeach(inout, scalar, N);
+#else
+    portable::AddScalarInplaceForeach<T>(inout, scalar, N);
+#endif
+    CT_PROFILE_END(AddScalarInplaceForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorSubScalarInplace_(VectorCT<T, N>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::SubScalarInplaceForeach<T>(inout, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Sub(B::Load(inout), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(SubScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubScalarInplaceForeach(inout, scalar, N);
+#else
+    portable::SubScalarInplaceForeach<T>(inout, scalar, N);
+#endif
+    CT_PROFILE_END(SubScalarInplaceForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorMulScalarInplace_(VectorCT<T, N>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::MulScalarInplaceForeach<T>(inout, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Mul(B::Load(inout), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(MulScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::DivForeach(out, in_lhs, in_rhs, N);
+    ispc::MulScalarInplaceForeach(inout, scalar, N);
 #else
-  DivForeach(out, in_lhs, in_rhs, N);
+    portable::MulScalarInplaceForeach<T>(inout, scalar, N);
 #endif
+    CT_PROFILE_END(MulScalarInplaceForeach, N, 2 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorAbs_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+constexpr void vectorDivScalarInplace_(VectorCT<T, N>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::DivScalarInplaceForeach<T>(inout, scalar, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Div(B::Load(inout), B::Set(scalar)));
+  } else {
+    CT_PROFILE_BEGIN(DivScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::AbsForeach(out, in_arg, N);
+    ispc::DivScalarInplaceForeach(inout, scalar, N);
 #else
-  AbsForeach(out, in_arg, N);
+    portable::DivScalarInplaceForeach<T>(inout, scalar, N);
 #endif
+    CT_PROFILE_END(DivScalarInplaceForeach, N, 2 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorSqrt_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+constexpr void vectorPowScalarInplace_(VectorCT<T, N>& inout, const T scalar) {
+  if (isConstantEvaluated_()) {
+    portable::PowScalarInplaceForeach<T>(inout, scalar, N);
+  } else {
+    CT_PROFILE_BEGIN(PowScalarInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::SqrtForeach(out, in_arg, N);
+    ispc::PowScalarInplaceForeach(inout, scalar, N);
 #else
-  SqrtForeach(out, in_arg, N);
+    portable::PowScalarInplaceForeach<T>(inout, scalar, N);
 #endif
+    CT_PROFILE_END(PowScalarInplaceForeach, N, 2 * N * sizeof(T));
+  }
 }
 
 template <typename T, size_t N>
-inline void vectorNeg_(VectorCT<T, N>& out, const VectorCT<T, N>& in_arg) {
+constexpr void vectorAbsInplace_(VectorCT<T, N>& inout) {
+  if (isConstantEvaluated_()) {
+    portable::AbsInplaceForeach<T>(inout, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Abs(B::Load(inout)));
+  } else {
+    CT_PROFILE_BEGIN(AbsInplaceForeach);
 #ifdef ENABLE_ISPC
-  ispc::NegForeach(out, in_arg, N);
+    ispc::AbsInplaceForeach(inout, N);
 #else
-  NegForeach(out, in_arg, N);
+    portable::AbsInplaceForeach<T>(inout, N);
 #endif
+    CT_PROFILE_END(AbsInplaceForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorSqrtInplace_(VectorCT<T, N>& inout) {
+  if (isConstantEvaluated_()) {
+    portable::SqrtInplaceForeach<T>(inout, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Sqrt(B::Load(inout)));
+  } else {
+    CT_PROFILE_BEGIN(SqrtInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SqrtInplaceForeach(inout, N);
+#else
+    portable::SqrtInplaceForeach<T>(inout, N);
+#endif
+    CT_PROFILE_END(SqrtInplaceForeach, N, 2 * N * sizeof(T));
+  }
+}
+
+template <typename T, size_t N>
+constexpr void vectorNegInplace_(VectorCT<T, N>& inout) {
+  if (isConstantEvaluated_()) {
+    portable::NegInplaceForeach<T>(inout, N);
+  } else if constexpr (SimdBackend<T, N>::kEnabled) {
+    using B = SimdBackend<T, N>;
+    B::Store(inout, B::Neg(B::Load(inout)));
+  } else {
+    CT_PROFILE_BEGIN(NegInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::NegInplaceForeach(inout, N);
+#else
+    portable::NegInplaceForeach<T>(inout, N);
+#endif
+    CT_PROFILE_END(NegInplaceForeach, N, 2 * N * sizeof(T));
+  }
 }
 
 /* operators */
 
 template <typename T, size_t N>
-VectorCT<T, N> operator-(const VectorCT<T, N>& vec) {
+constexpr VectorCT<T, N> operator-(const VectorCT<T, N>& vec) {
   VectorCT<T, N> res;
   vectorNeg_(res, vec);
   return res;
 }
 
+// temporaries are reused in place, e.g. `-(lhs - rhs)`
+template <typename T, size_t N>
+constexpr VectorCT<T, N> operator-(VectorCT<T, N>&& vec) {
+  vectorNegInplace_(vec);
+  return std::move(vec);
+}
+
 /* + */
 
 template <typename T, size_t N>
-VectorCT<T, N> operator+(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+constexpr VectorCT<T, N> operator+(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
   VectorCT<T, N> res;
   vectorAdd_(res, lhs, rhs);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator+(const VectorCT<T, N>& lhs, const T scalar) {
-  VectorCT<T, N> res(scalar);
-  vectorAdd_(res, lhs, res);
+constexpr VectorCT<T, N> operator+(const VectorCT<T, N>& lhs, const T scalar) {
+  VectorCT<T, N> res;
+  vectorAddScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator+(const T scalar, const VectorCT<T, N>& rhs) {
-  VectorCT<T, N> res(scalar);
-  vectorAdd_(res, res, rhs);
+constexpr VectorCT<T, N> operator+(const T scalar, const VectorCT<T, N>& rhs) {
+  VectorCT<T, N> res;
+  vectorAddScalar_(res, rhs, scalar);
   return res;
 }
 
 /* - */
 
 template <typename T, size_t N>
-VectorCT<T, N> operator-(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+constexpr VectorCT<T, N> operator-(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
   VectorCT<T, N> res;
   vectorSub_(res, lhs, rhs);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator-(const VectorCT<T, N>& lhs, const T scalar) {
-  VectorCT<T, N> res(scalar);
-  vectorSub_(res, lhs, res);
+constexpr VectorCT<T, N> operator-(const VectorCT<T, N>& lhs, const T scalar) {
+  VectorCT<T, N> res;
+  vectorSubScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator-(const T scalar, const VectorCT<T, N>& rhs) {
-  VectorCT<T, N> res(scalar);
-  vectorSub_(res, res, rhs);
+constexpr VectorCT<T, N> operator-(const T scalar, const VectorCT<T, N>& rhs) {
+  VectorCT<T, N> res;
+  vectorScalarSub_(res, scalar, rhs);
   return res;
 }
 
 /* * */
 
 template <typename T, size_t N>
-VectorCT<T, N> operator*(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+constexpr VectorCT<T, N> operator*(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
   VectorCT<T, N> res;
   vectorMul_(res, lhs, rhs);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator*(const VectorCT<T, N>& lhs, const T scalar) {
-  VectorCT<T, N> res(scalar);
-  vectorMul_(res, lhs, res);
+constexpr VectorCT<T, N> operator*(const VectorCT<T, N>& lhs, const T scalar) {
+  VectorCT<T, N> res;
+  vectorMulScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator*(const T scalar, const VectorCT<T, N>& rhs) {
-  VectorCT<T, N> res(scalar);
-  vectorMul_(res, res, rhs);
+constexpr VectorCT<T, N> operator*(const T scalar, const VectorCT<T, N>& rhs) {
+  VectorCT<T, N> res;
+  vectorMulScalar_(res, rhs, scalar);
   return res;
 }
 
 /* / */
 
 template <typename T, size_t N>
-VectorCT<T, N> operator/(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
+constexpr VectorCT<T, N> operator/(const VectorCT<T, N>& lhs, const VectorCT<T, N>& rhs) {
   VectorCT<T, N> res;
   vectorDiv_(res, lhs, rhs);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator/(const VectorCT<T, N>& lhs, const T scalar) {
-  VectorCT<T, N> res(scalar);
-  vectorDiv_(res, lhs, res);
+constexpr VectorCT<T, N> operator/(const VectorCT<T, N>& lhs, const T scalar) {
+  VectorCT<T, N> res;
+  vectorDivScalar_(res, lhs, scalar);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> operator/(const T scalar, const VectorCT<T, N>& rhs) {
-  VectorCT<T, N> res(scalar);
-  vectorDiv_(res, res, rhs);
+constexpr VectorCT<T, N> operator/(const T scalar, const VectorCT<T, N>& rhs) {
+  VectorCT<T, N> res;
+  vectorScalarDiv_(res, scalar, rhs);
   return res;
 }
 
 /* free functions */
 
 template <typename T, size_t N>
-VectorCT<T, N> Abs(const VectorCT<T, N>& vec) {
+constexpr VectorCT<T, N> Abs(const VectorCT<T, N>& vec) {
   VectorCT<T, N> res;
   vectorAbs_(res, vec);
   return res;
 }
 
 template <typename T, size_t N>
-VectorCT<T, N> Sqrt(const VectorCT<T, N>& vec) {
+constexpr VectorCT<T, N> Abs(VectorCT<T, N>&& vec) {
+  vectorAbsInplace_(vec);
+  return std::move(vec);
+}
+
+template <typename T, size_t N>
+constexpr VectorCT<T, N> Sqrt(const VectorCT<T, N>& vec) {
   VectorCT<T, N> res;
   vectorSqrt_(res, vec);
   return res;
 }
 
+template <typename T, size_t N>
+constexpr VectorCT<T, N> Sqrt(VectorCT<T, N>&& vec) {
+  vectorSqrtInplace_(vec);
+  return std::move(vec);
+}
+
+template <typename T, size_t N>
+constexpr VectorCT<T, N> Pow(const VectorCT<T, N>& base, const VectorCT<T, N>& exponent) {
+  VectorCT<T, N> res;
+  vectorPow_(res, base, exponent);
+  return res;
+}
+
+template <typename T, size_t N>
+constexpr VectorCT<T, N> Pow(const VectorCT<T, N>& base, const T exponent) {
+  VectorCT<T, N> res;
+  vectorPowScalar_(res, base, exponent);
+  return res;
+}
+
+template <typename T, size_t N>
+constexpr VectorCT<T, N> Pow(const T base, const VectorCT<T, N>& exponent) {
+  VectorCT<T, N> res;
+  vectorScalarPow_(res, base, exponent);
+  return res;
+}
+
 /* stream */
 
 template <typename T, size_t N>
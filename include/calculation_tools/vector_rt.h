@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cassert>
+
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+#include <initializer_list>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "vector.h"
+#include "expression.h"
+#include "thread_pool.h"
+
+namespace kplutl {
+// Heap-backed vector whose length is only known at run time. Storage is kAlignment-aligned.
+// Arithmetic is lazy: chained operators are fused into one pass when assigned to a VectorRT.
+template <typename T>
+struct VectorRT {
+  AlignedArray<T> data_;
+
+  VectorRT<T>() = default;
+  VectorRT<T>(const VectorRT<T>& vectorRT) = default;
+  VectorRT<T>& operator=(const VectorRT<T>& vectorRT) = default;
+  VectorRT<T>(VectorRT<T>&& vectorRT) = default;
+  VectorRT<T>& operator=(VectorRT<T>&& vectorRT) = default;
+
+  explicit VectorRT<T>(size_t size) : data_(size) { std::fill_n(data_.data(), size, T{}); }
+  VectorRT<T>(size_t size, UninitializedTag) : data_(size) {}
+  VectorRT<T>(size_t size, T value) : data_(size) { std::fill_n(data_.data(), size, value); }
+  VectorRT<T>(std::initializer_list<const T> list) : data_(list.size()) {
+    std::copy(list.begin(), list.end(), data_.data());
+  }
+
+  template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+  VectorRT<T>(It first, It last) : data_(std::distance(first, last)) {
+    std::copy(first, last, data_.data());
+  }
+
+  template <typename E>
+  VectorRT<T>(const Expr<E>& expr) : data_(expr.Self().Like().size()) {
+    Assign(*this, expr);
+  }
+
+  template <typename S>
+  explicit VectorRT<T>(const VectorRT<S>& source) : data_(source.size()) {
+    for (size_t i = 0; i < size(); ++i) data_[i] = (T)source[i];
+  }
+  template <typename S, size_t N>
+  explicit VectorRT<T>(const VectorCT<S, N>& source) : data_(N) {
+    for (size_t i = 0; i < N; ++i) data_[i] = (T)source[i];
+  }
+
+  size_t size() const { return data_.size(); }
+
+  T& operator[](size_t index) { return data_[index]; }
+  const T& operator[](size_t index) const { return data_[index]; }
+
+  operator T*() { return data_.data(); };
+
+  operator const T*() const { return data_.data(); }
+
+  template <typename E>
+  VectorRT<T>& operator=(const Expr<E>& expr) {
+    if (size() == expr.Self().Like().size()) {
+      Assign(*this, expr);
+    } else {
+      *this = VectorRT<T>(expr);
+    }
+    return *this;
+  }
+
+  VectorRT<T>& operator+=(const VectorRT<T>& lhs) {
+    vectorAddInplace_(*this, lhs);
+    return *this;
+  }
+
+  VectorRT<T>& operator+=(const T scalar) {
+    vectorAddScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  VectorRT<T>& operator+=(const Expr<E>& expr) {
+    *this = *this + expr.Self();
+    return *this;
+  }
+
+  VectorRT<T>& operator-=(const VectorRT<T>& lhs) {
+    vectorSubInplace_(*this, lhs);
+    return *this;
+  }
+
+  VectorRT<T>& operator-=(const T scalar) {
+    vectorSubScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  VectorRT<T>& operator-=(const Expr<E>& expr) {
+    *this = *this - expr.Self();
+    return *this;
+  }
+
+  VectorRT<T>& operator*=(const VectorRT<T>& lhs) {
+    vectorMulInplace_(*this, lhs);
+    return *this;
+  }
+
+  VectorRT<T>& operator*=(const T scalar) {
+    vectorMulScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  VectorRT<T>& operator*=(const Expr<E>& expr) {
+    *this = *this * expr.Self();
+    return *this;
+  }
+
+  VectorRT<T>& operator/=(const VectorRT<T>& lhs) {
+    vectorDivInplace_(*this, lhs);
+    return *this;
+  }
+
+  VectorRT<T>& operator/=(const T scalar) {
+    vectorDivScalarInplace_(*this, scalar);
+    return *this;
+  }
+
+  template <typename E>
+  VectorRT<T>& operator/=(const Expr<E>& expr) {
+    *this = *this / expr.Self();
+    return *this;
+  }
+};
+
+/* type defines */
+
+using VectorXf = VectorRT<float>;
+using VectorXd = VectorRT<double>;
+using VectorXi = VectorRT<std::int32_t>;
+using VectorXh = VectorRT<Half>;
+
+/* inline functions */
+
+template <typename T>
+inline void vectorAddInplace_(VectorRT<T>& inout, const VectorRT<T>& in_rhs) {
+  assert(inout.size() == in_rhs.size());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(AddInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::AddInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(AddInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorSubInplace_(VectorRT<T>& inout, const VectorRT<T>& in_rhs) {
+  assert(inout.size() == in_rhs.size());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(SubInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::SubInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(SubInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorMulInplace_(VectorRT<T>& inout, const VectorRT<T>& in_rhs) {
+  assert(inout.size() == in_rhs.size());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(MulInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::MulInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(MulInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorDivInplace_(VectorRT<T>& inout, const VectorRT<T>& in_rhs) {
+  assert(inout.size() == in_rhs.size());
+  T* data = inout;
+  const T* rhs = in_rhs;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(DivInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivInplaceForeach(data + begin, rhs + begin, end - begin);
+#else
+    portable::DivInplaceForeach<T>(data + begin, rhs + begin, end - begin);
+#endif
+    CT_PROFILE_END(DivInplaceForeach, end - begin, 3 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorAddScalarInplace_(VectorRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(AddScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::AddScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::AddScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(AddScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorSubScalarInplace_(VectorRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(SubScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::SubScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::SubScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(SubScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorMulScalarInplace_(VectorRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(MulScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::MulScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::MulScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(MulScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+template <typename T>
+inline void vectorDivScalarInplace_(VectorRT<T>& inout, const T scalar) {
+  T* data = inout;
+  parallelForeach_<T>(inout.size(), [&](const size_t begin, const size_t end) {
+    CT_PROFILE_BEGIN(DivScalarInplaceForeach);
+#ifdef ENABLE_ISPC
+    ispc::DivScalarInplaceForeach(data + begin, scalar, end - begin);
+#else
+    portable::DivScalarInplaceForeach<T>(data + begin, scalar, end - begin);
+#endif
+    CT_PROFILE_END(DivScalarInplaceForeach, end - begin, 2 * (end - begin) * sizeof(T));
+  });
+}
+
+/* expressions */
+
+template <typename T>
+struct ExprContainer<VectorRT<T>> {
+  using value_type = T;
+  static constexpr bool kRuntime = true;
+
+  static size_t Length(const VectorRT<T>& vec) { return vec.size(); }
+  static bool SameShape(const VectorRT<T>& lhs, const VectorRT<T>& rhs) {
+    return lhs.size() == rhs.size();
+  }
+  static VectorRT<T> MakeLike(const VectorRT<T>& vec) {
+    return VectorRT<T>(vec.size(), kUninitialized);
+  }
+};
+
+// +, -, *, /, Abs and Sqrt on VectorRT build expressions, see expression.h
+template <typename T>
+struct IsLazyContainer<VectorRT<T>> : std::true_type {};
+
+/* stream */
+
+template <typename T>
+std::istream& operator>>(std::istream& in, VectorRT<T>& vec) {
+  for (size_t i = 0; i < vec.size(); ++i) in >> vec[i];
+  return in;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& out, const VectorRT<T>& vec) {
+  out << "( ";
+  for (size_t i = 0; i < vec.size(); ++i) out << vec[i] << (i != vec.size() - 1 ? ", " : "");
+  out << " )";
+  return out;
+}
+
+}  // namespace kplutl
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cassert>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <iostream>
+
+#include "utils.h"
+#include "profile.h"
+#include "memory.h"
+#include "vector.h"
+#include "vector_rt.h"
+#include "portable.h"
+
+namespace kplutl {
+// Batch of N-component vectors (N = 3 or 4) stored as a structure of arrays: component c of every
+// vector is one contiguous kAlignment-aligned array, `(*this)[c]`. The batched DotProd, CrossProd,
+// Length and Normalize below run one vector per SIMD lane instead of one kernel call per vector.
+template <typename T, size_t N>
+struct VectorStream {
+  static_assert(N == 3 || N == 4, "VectorStream holds 3- or 4-component vectors");
+
+  AlignedArray<T> data_;
+  size_t size_ = 0;
+  size_t stride_ = 0;
+
+  VectorStream<T, N>() = default;
+  VectorStream<T, N>(const VectorStream<T, N>& vectorStream) = default;
+  VectorStream<T, N>& operator=(const VectorStream<T, N>& vectorStream) = default;
+  VectorStream<T, N>(VectorStream<T, N>&& vectorStream) = default;
+  VectorStream<T, N>& operator=(VectorStream<T, N>&& vectorStream) = default;
+
+  VectorStream<T, N>(size_t size, UninitializedTag)
+      : data_(N * PaddedLength<T>(size)), size_(size), stride_(PaddedLength<T>(size)) {}
+  explicit VectorStream<T, N>(size_t size) : VectorStream<T, N>(size, kUninitialized) {
+    std::fill_n(data_.data(), data_.size(), T{});
+  }
+  VectorStream<T, N>(size_t size, const VectorCT<T, N>& value)
+      : VectorStream<T, N>(size, kUninitialized) {
+    for (size_t c = 0; c < N; ++c) std::fill_n((*this)[c], stride_, value[c]);
+  }
+
+  // gathers a range of VectorCT<T, N>
+  template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+  VectorStream<T, N>(It first, It last)
+      : VectorStream<T, N>(std::distance(first, last), kUninitialized) {
+    for (size_t i = 0; first != last; ++first) Set(i++, *first);
+  }
+
+  // number of vectors
+  size_t size() const { return size_; }
+  // distance in elements between the starts of consecutive component arrays
+  size_t stride() const { return stride_; }
+
+  T* operator[](size_t component) { return data_.data() + component * stride_; }
+  const T* operator[](size_t component) const { return data_.data() + component * stride_; }
+
+  T* x() { return (*this)[0]; }
+  T* y() { return (*this)[1]; }
+  T* z() { return (*this)[2]; }
+  template <size_t M = N, typename = std::enable_if_t<M == 4>>
+  T* w() {
+    return (*this)[3];
+  }
+  const T* x() const { return (*this)[0]; }
+  const T* y() const { return (*this)[1]; }
+  const T* z() const { return (*this)[2]; }
+  template <size_t M = N, typename = std::enable_if_t<M == 4>>
+  const T* w() const {
+    return (*this)[3];
+  }
+
+  VectorCT<T, N> Get(size_t index) const {
+    assert(index < size_);
+    VectorCT<T, N> res;
+    for (size_t c = 0; c < N; ++c) res[c] = (*this)[c][index];
+    return res;
+  }
+  void Set(size_t index, const VectorCT<T, N>& vec) {
+    assert(index < size_);
+    for (size_t c = 0; c < N; ++c) (*this)[c][index] = vec[c];
+  }
+
+  // component arrays in the form the stream kernels take
+  std::array<T*, N> Components() {
+    std::array<T*, N> res;
+    for (size_t c = 0; c < N; ++c) res[c] = (*this)[c];
+    return res;
+  }
+  std::array<const T*, N> Components() const {
+    std::array<const T*, N> res;
+    for (size_t c = 0; c < N; ++c) res[c] = (*this)[c];
+    return res;
+  }
+};
+
+/* type defines */
+
+using Vector3Stream = VectorStream<float, 3>;
+using Vector4Stream = VectorStream<float, 4>;
+using Vector3dStream = VectorStream<double, 3>;
+using Vector4dStream = VectorStream<double, 4>;
+
+/* inline functions */
+
+template <typename T, size_t N>
+inline void streamDot_(T* out, const VectorStream<T, N>& lhs, const VectorStream<T, N>& rhs) {
+  assert(lhs.size() == rhs.size());
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  CT_PROFILE_BEGIN(StreamDotProd);
+#ifdef ENABLE_ISPC
+  ispc::StreamDotProd(out, lhs_comps.data(), rhs_comps.data(), N, lhs.size());
+#else
+  portable::StreamDotProd<T>(out, lhs_comps.data(), rhs_comps.data(), N, lhs.size());
+#endif
+  CT_PROFILE_END(StreamDotProd, lhs.size(), (2 * N + 1) * lhs.size() * sizeof(T));
+}
+
+template <typename T>
+inline void streamCross_(
+    VectorStream<T, 3>& out, const VectorStream<T, 3>& lhs, const VectorStream<T, 3>& rhs) {
+  assert(lhs.size() == rhs.size() && out.size() == lhs.size());
+  const auto out_comps = out.Components();
+  const auto lhs_comps = lhs.Components();
+  const auto rhs_comps = rhs.Components();
+  CT_PROFILE_BEGIN(StreamCrossProd);
+#ifdef ENABLE_ISPC
+  ispc::StreamCrossProd(out_comps.data(), lhs_comps.data(), rhs_comps.data(), lhs.size());
+#else
+  portable::StreamCrossProd<T>(out_comps.data(), lhs_comps.data(), rhs_comps.data(), lhs.size());
+#endif
+  CT_PROFILE_END(StreamCrossProd, lhs.size(), 9 * lhs.size() * sizeof(T));
+}
+
+template <typename T, size_t N>
+inline void streamLength_(T* out, const VectorStream<T, N>& vec) {
+  const auto comps = vec.Components();
+  CT_PROFILE_BEGIN(StreamLength);
+#ifdef ENABLE_ISPC
+  ispc::StreamLength(out, comps.data(), N, vec.size());
+#else
+  portable::StreamLength<T>(out, comps.data(), N, vec.size());
+#endif
+  CT_PROFILE_END(StreamLength, vec.size(), (N + 1) * vec.size() * sizeof(T));
+}
+
+template <typename T, size_t N>
+inline void streamNormalize_(
+    VectorStream<T, N>& out, const VectorStream<T, N>& vec, const std::uint32_t flags) {
+  assert(out.size() == vec.size());
+  const auto out_comps = out.Components();
+  const auto comps = vec.Components();
+  CT_PROFILE_BEGIN(StreamNormalize);
+#ifdef ENABLE_ISPC
+  ispc::StreamNormalize(out_comps.data(), comps.data(), N, vec.size(), flags);
+#else
+  portable::StreamNormalize<T>(out_comps.data(), comps.data(), N, vec.size(), flags);
+#endif
+  CT_PROFILE_END(StreamNormalize, vec.size(), 2 * N * vec.size() * sizeof(T));
+}
+
+/* free functions */
+
+// one dot product per pair of vectors
+template <typename T, size_t N>
+VectorRT<T> DotProd(const VectorStream<T, N>& lhs, const VectorStream<T, N>& rhs) {
+  VectorRT<T> res(lhs.size(), kUninitialized);
+  streamDot_<T, N>(res, lhs, rhs);
+  return res;
+}
+
+template <typename T>
+VectorStream<T, 3> CrossProd(const VectorStream<T, 3>& lhs, const VectorStream<T, 3>& rhs) {
+  VectorStream<T, 3> res(lhs.size(), kUninitialized);
+  streamCross_(res, lhs, rhs);
+  return res;
+}
+
+template <typename T, size_t N>
+VectorRT<T> Length(const VectorStream<T, N>& vec) {
+  VectorRT<T> res(vec.size(), kUninitialized);
+  streamLength_<T, N>(res, vec);
+  return res;
+}
+
+// Writes the unit vectors of `vec` to `out`, which may be `vec` itself. kNormalizeExact matches
+// Normalize on each VectorCT. With kNormalizeFast every component of a float result is within a
+// relative 2^-21 (about 5e-7) of the exact one, double results within a few ulp; int32 ignores
+// the flag. Zero vectors come out as NaN in exact mode and are unspecified in fast mode.
+template <typename T, size_t N>
+void Normalize(
+    const VectorStream<T, N>& vec, VectorStream<T, N>& out,
+    const std::uint32_t flags = kNormalizeExact) {
+  streamNormalize_(out, vec, flags);
+}
+
+template <typename T, size_t N>
+VectorStream<T, N> Normalize(
+    const VectorStream<T, N>& vec, const std::uint32_t flags = kNormalizeExact) {
+  VectorStream<T, N> res(vec.size(), kUninitialized);
+  streamNormalize_(res, vec, flags);
+  return res;
+}
+
+template <typename T, size_t N>
+std::ostream& operator<<(std::ostream& out, const VectorStream<T, N>& vec) {
+  out << "[ ";
+  for (size_t i = 0; i < vec.size(); ++i) out << vec.Get(i) << (i != vec.size() - 1 ? ", " : "");
+  out << " ]";
+  return out;
+}
+
+}  // namespace kplutl
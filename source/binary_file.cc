@@ -0,0 +1,254 @@
+#include <calculation_tools/binary_file.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CT_BINARY_FILE_MMAP
+#endif
+
+namespace kplutl {
+namespace {
+constexpr std::uint64_t kMaxBytes = std::numeric_limits<std::uint64_t>::max();
+
+// res = a * b + c, false when that does not fit 64 bits
+bool mulAdd_(
+    const std::uint64_t a, const std::uint64_t b, const std::uint64_t c, std::uint64_t& res) {
+  if (b != 0 && a > (kMaxBytes - c) / b) return false;
+  res = a * b + c;
+  return true;
+}
+
+std::uint64_t alignUp_(const std::uint64_t bytes) {
+  return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// bytes from the start of `array` to the end of its last element
+bool arrayExtent_(const BinaryArrayHeader& array, std::uint64_t& extent) {
+  const std::uint64_t elem = DataTypeSize(array.dtype);
+  const std::uint64_t row = array.cols * elem;
+  if (array.count == 0) {
+    extent = 0;
+    return true;
+  }
+  if (array.layout == ArrayLayout::kSoA) {
+    std::uint64_t component;
+    return mulAdd_(array.count, elem, 0, component) && array.stride >= component &&
+           mulAdd_(std::uint64_t(array.rows) * array.cols - 1, array.stride, component, extent);
+  }
+  std::uint64_t element;
+  if (array.rows > 1 && array.row_stride < row) return false;
+  if (!mulAdd_(array.rows - 1, array.row_stride, row, element)) return false;
+  return array.stride >= element && mulAdd_(array.count - 1, array.stride, element, extent);
+}
+
+bool validArray_(
+    const BinaryArrayHeader& array, const std::uint64_t data_begin, const size_t size) {
+  if (array.name[sizeof(array.name) - 1] != '\0' || array.name[0] == '\0') return false;
+  if (DataTypeSize(array.dtype) == 0) return false;
+  if (array.layout != ArrayLayout::kAoS && array.layout != ArrayLayout::kSoA) return false;
+  if (array.rows == 0 || array.cols == 0) return false;
+  if (array.offset % kAlignment != 0 || array.offset < data_begin) return false;
+  if (array.offset > size || array.size > size - array.offset) return false;
+  std::uint64_t extent;
+  return arrayExtent_(array, extent) && extent <= array.size;
+}
+
+bool writeZeros_(std::FILE* file, size_t bytes) {
+  static const char zeros[kAlignment]{};
+  while (bytes != 0) {
+    const size_t len = std::min(bytes, sizeof(zeros));
+    if (std::fwrite(zeros, 1, len, file) != len) return false;
+    bytes -= len;
+  }
+  return true;
+}
+}  // namespace
+
+/* BinaryFile */
+
+void BinaryFile::swap(BinaryFile& other) noexcept {
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(mapped_, other.mapped_);
+  std::swap(arrays_, other.arrays_);
+}
+
+bool BinaryFile::Open(const std::string& path) {
+  Close();
+#ifdef CT_BINARY_FILE_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(BinaryFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  // private and writable: views may be written to, the file never changes
+  void* map = ::mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) return false;
+  data_ = static_cast<std::uint8_t*>(map);
+  size_ = info.st_size;
+  mapped_ = true;
+#else
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in) return false;
+  const std::streamoff bytes = in.tellg();
+  if (bytes < std::streamoff(sizeof(BinaryFileHeader))) return false;
+  data_ = static_cast<std::uint8_t*>(AlignedAlloc(alignUp_(bytes)));
+  size_ = bytes;
+  in.seekg(0);
+  if (!in.read(reinterpret_cast<char*>(data_), bytes)) {
+    Close();
+    return false;
+  }
+#endif
+
+  BinaryFileHeader header;
+  std::memcpy(&header, data_, sizeof(header));
+  const bool valid_header =
+      std::memcmp(header.magic, kBinaryFileMagic, sizeof(header.magic)) == 0 &&
+      header.byte_order == kBinaryFileByteOrder && header.version == kBinaryFileVersion &&
+      header.array_count <= (size_ - sizeof(header)) / sizeof(BinaryArrayHeader);
+  if (!valid_header) {
+    Close();
+    return false;
+  }
+  arrays_.resize(header.array_count);
+  if (!arrays_.empty()) {
+    std::memcpy(
+        arrays_.data(), data_ + sizeof(header), arrays_.size() * sizeof(BinaryArrayHeader));
+  }
+  const std::uint64_t data_begin = sizeof(header) + arrays_.size() * sizeof(BinaryArrayHeader);
+  for (const BinaryArrayHeader& array : arrays_) {
+    if (!validArray_(array, data_begin, size_)) {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void BinaryFile::Close() {
+  if (data_ != nullptr) {
+#ifdef CT_BINARY_FILE_MMAP
+    if (mapped_) ::munmap(data_, size_);
+#endif
+    if (!mapped_) AlignedFree(data_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+  arrays_.clear();
+}
+
+const BinaryArrayHeader* BinaryFile::Find(const std::string& name) const {
+  for (const BinaryArrayHeader& array : arrays_) {
+    if (name == array.name) return &array;
+  }
+  return nullptr;
+}
+
+void BinaryFile::adviseRange_(
+    const BinaryArrayHeader& array, const size_t first, const size_t count,
+    const bool will_need) const {
+#ifdef CT_BINARY_FILE_MMAP
+  if (!mapped_ || count == 0) return;
+  const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+  auto advise = [&](std::uint64_t begin, std::uint64_t end) {
+    // whole pages only; dropping a page a neighbouring range still uses would cost a re-read
+    begin = will_need ? begin / page * page : (begin + page - 1) / page * page;
+    end = will_need ? std::min<std::uint64_t>((end + page - 1) / page * page, size_)
+                    : end / page * page;
+    if (begin >= end) return;
+    ::madvise(data_ + begin, end - begin, will_need ? MADV_WILLNEED : MADV_DONTNEED);
+  };
+  const std::uint64_t elem = DataTypeSize(array.dtype);
+  if (array.layout == ArrayLayout::kSoA) {
+    const size_t components = size_t(array.rows) * array.cols;
+    for (size_t k = 0; k < components; ++k) {
+      const std::uint64_t base = array.offset + k * array.stride;
+      advise(base + first * elem, base + (first + count) * elem);
+    }
+  } else {
+    advise(array.offset + first * array.stride, array.offset + (first + count) * array.stride);
+  }
+#else
+  (void)array;
+  (void)first;
+  (void)count;
+  (void)will_need;
+#endif
+}
+
+/* BinaryFileWriter */
+
+void BinaryFileWriter::add_(
+    const std::string& name, const DataType dtype, const ArrayLayout layout, const size_t rows,
+    const size_t cols, const size_t count, const size_t stride, const size_t row_stride,
+    const void* data, const size_t bytes) {
+  Source source{};
+  if (name.empty() || name.size() >= sizeof(source.header.name)) valid_ = false;
+  const size_t name_len = std::min(name.size(), sizeof(source.header.name) - 1);
+  std::memcpy(source.header.name, name.data(), name_len);
+  source.header.dtype = dtype;
+  source.header.layout = layout;
+  source.header.rows = std::uint32_t(rows);
+  source.header.cols = std::uint32_t(cols);
+  source.header.count = count;
+  source.header.stride = stride;
+  source.header.row_stride = row_stride;
+  source.header.size = alignUp_(bytes);
+  source.data = data;
+  source.bytes = bytes;
+  sources_.push_back(source);
+}
+
+bool BinaryFileWriter::Write(const std::string& path) const {
+  if (!valid_) return false;
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (std::strcmp(sources_[i].header.name, sources_[j].header.name) == 0) return false;
+    }
+  }
+
+  BinaryFileHeader header{};
+  std::memcpy(header.magic, kBinaryFileMagic, sizeof(header.magic));
+  header.byte_order = kBinaryFileByteOrder;
+  header.version = kBinaryFileVersion;
+  header.array_count = sources_.size();
+  std::vector<BinaryArrayHeader> arrays;
+  std::uint64_t offset = alignUp_(sizeof(header) + sources_.size() * sizeof(BinaryArrayHeader));
+  for (const Source& source : sources_) {
+    arrays.push_back(source.header);
+    arrays.back().offset = offset;
+    offset += source.header.size;
+  }
+
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  if (ok && !arrays.empty()) {
+    ok = std::fwrite(arrays.data(), sizeof(BinaryArrayHeader), arrays.size(), file) ==
+         arrays.size();
+  }
+  std::uint64_t written = sizeof(header) + arrays.size() * sizeof(BinaryArrayHeader);
+  for (size_t i = 0; ok && i < sources_.size(); ++i) {
+    const Source& source = sources_[i];
+    ok = writeZeros_(file, arrays[i].offset - written) &&
+         std::fwrite(source.data, 1, source.bytes, file) == source.bytes &&
+         writeZeros_(file, source.header.size - source.bytes);
+    written = arrays[i].offset + source.header.size;
+  }
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace kplutl
@@ -2,4 +2,17 @@
 #include <calculation_tools/utils.h>
 #include <calculation_tools/vector.h>
 #include <calculation_tools/matrix.h>
-#include <calculation_tools/linear_algebra.h>
\ No newline at end of file
+#include <calculation_tools/linear_algebra.h>
+#include <calculation_tools/memory.h>
+#include <calculation_tools/vector_rt.h>
+#include <calculation_tools/vector_stream.h>
+#include <calculation_tools/quaternion.h>
+#include <calculation_tools/graphic.h>
+#include <calculation_tools/transform_hierarchy.h>
+#include <calculation_tools/binary_file.h>
+#include <calculation_tools/reduction.h>
+#include <calculation_tools/factorization.h>
+#include <calculation_tools/sparse.h>
+#include <calculation_tools/matrix_rt.h>
+#include <calculation_tools/expression.h>
+#include <calculation_tools/dispatch.h>
@@ -0,0 +1,306 @@
+#include <calculation_tools/dispatch.h>
+#include <calculation_tools/utils.h>
+#include <calculation_tools/portable.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#define CT_HAS_CPUID
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define CT_HAS_CPUID
+#endif
+
+/*
+    Every ISPC kernel is declared once in CT_KERNELS (utils.h) together with its C signature over
+    the element type. From that list this file builds
+      - the declarations of the per-target symbols (AddForeach_sse2, AddForeach_f64_avx2, ...),
+      - one KernelTable per target compiled in, plus one over the portable kernels,
+      - the unsuffixed ispc::AddForeach, ispc::AddForeach_f64 and friends that utils.h declares,
+        forwarding to the table of the active target.
+*/
+
+// CT_KERNELS for every element type with ISPC kernels
+#define CT_TYPED_KERNELS(X)                 \
+  CT_KERNELS(X, float, )                    \
+  CT_KERNELS(X, double, _f64)               \
+  CT_KERNELS(X, std::int32_t, _i32)         \
+  CT_KERNELS(X, Half, _f16)
+
+#define CT_TARGET_NAME(name, suffix, isa) CT_CONCAT(CT_CONCAT(name, suffix), isa)
+
+namespace kplutl {
+namespace {
+/* kernel tables */
+
+struct KernelTable {
+#define CT_TABLE_MEMBER(name, params, args, T, suffix) void(*CT_CONCAT(name, suffix)) params;
+  CT_TYPED_KERNELS(CT_TABLE_MEMBER)
+#undef CT_TABLE_MEMBER
+};
+
+#define CT_PORTABLE_ENTRY(name, params, args, T, suffix) &portable::name<T>,
+constexpr KernelTable kPortableKernels{CT_TYPED_KERNELS(CT_PORTABLE_ENTRY)};
+#undef CT_PORTABLE_ENTRY
+}  // namespace
+
+#ifdef ENABLE_ISPC
+// per-target symbols exported by ispc_ctlib, see CT_EXPORT in common.isph
+extern "C" {
+#define CT_DECLARE_SSE2(name, params, args, T, suffix) \
+  void CT_TARGET_NAME(name, suffix, _sse2) params;
+#define CT_DECLARE_SSE4(name, params, args, T, suffix) \
+  void CT_TARGET_NAME(name, suffix, _sse4) params;
+#define CT_DECLARE_AVX2(name, params, args, T, suffix) \
+  void CT_TARGET_NAME(name, suffix, _avx2) params;
+#define CT_DECLARE_AVX512SKX(name, params, args, T, suffix) \
+  void CT_TARGET_NAME(name, suffix, _avx512skx) params;
+#ifdef CT_ISPC_TARGET_SSE2
+CT_TYPED_KERNELS(CT_DECLARE_SSE2)
+#endif
+#ifdef CT_ISPC_TARGET_SSE4
+CT_TYPED_KERNELS(CT_DECLARE_SSE4)
+#endif
+#ifdef CT_ISPC_TARGET_AVX2
+CT_TYPED_KERNELS(CT_DECLARE_AVX2)
+#endif
+#ifdef CT_ISPC_TARGET_AVX512SKX
+CT_TYPED_KERNELS(CT_DECLARE_AVX512SKX)
+#endif
+}
+
+namespace {
+#ifdef CT_ISPC_TARGET_SSE2
+#define CT_SSE2_ENTRY(name, params, args, T, suffix) &CT_TARGET_NAME(name, suffix, _sse2),
+constexpr KernelTable kSse2Kernels{CT_TYPED_KERNELS(CT_SSE2_ENTRY)};
+#endif
+#ifdef CT_ISPC_TARGET_SSE4
+#define CT_SSE4_ENTRY(name, params, args, T, suffix) &CT_TARGET_NAME(name, suffix, _sse4),
+constexpr KernelTable kSse4Kernels{CT_TYPED_KERNELS(CT_SSE4_ENTRY)};
+#endif
+#ifdef CT_ISPC_TARGET_AVX2
+#define CT_AVX2_ENTRY(name, params, args, T, suffix) &CT_TARGET_NAME(name, suffix, _avx2),
+constexpr KernelTable kAvx2Kernels{CT_TYPED_KERNELS(CT_AVX2_ENTRY)};
+#endif
+#ifdef CT_ISPC_TARGET_AVX512SKX
+#define CT_AVX512SKX_ENTRY(name, params, args, T, suffix) &CT_TARGET_NAME(name, suffix, _avx512skx),
+constexpr KernelTable kAvx512SkxKernels{CT_TYPED_KERNELS(CT_AVX512SKX_ENTRY)};
+#endif
+}  // namespace
+#endif
+
+namespace {
+/* cpu detection */
+
+struct CpuFeatures {
+  bool sse2 = false;
+  bool sse4 = false;
+  bool avx2 = false;
+  bool avx512skx = false;
+};
+
+#ifdef CT_HAS_CPUID
+void cpuid_(const std::uint32_t leaf, const std::uint32_t subleaf, std::uint32_t regs[4]) {
+#ifdef _MSC_VER
+  int res[4];
+  __cpuidex(res, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; ++i) regs[i] = static_cast<std::uint32_t>(res[i]);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// register state the OS saves on context switch (XCR0)
+std::uint64_t xgetbv_() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  std::uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures detectCpu_() {
+  CpuFeatures res;
+#ifdef CT_HAS_CPUID
+  std::uint32_t regs[4];  // eax, ebx, ecx, edx
+  cpuid_(0, 0, regs);
+  const std::uint32_t max_leaf = regs[0];
+  if (max_leaf < 1) return res;
+
+  cpuid_(1, 0, regs);
+  const std::uint32_t ecx_1 = regs[2];
+  const std::uint32_t edx_1 = regs[3];
+  res.sse2 = edx_1 & (1u << 26);
+  res.sse4 = (ecx_1 & (1u << 19)) && (ecx_1 & (1u << 20));
+
+  // AVX state has to be enabled by the OS as well, XMM and YMM for AVX2, plus opmask and ZMM
+  const bool osxsave = ecx_1 & (1u << 27);
+  const std::uint64_t xcr0 = osxsave ? xgetbv_() : 0;
+  const bool os_ymm = (xcr0 & 0x6) == 0x6;
+  const bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+  if (max_leaf < 7) return res;
+
+  cpuid_(7, 0, regs);
+  const std::uint32_t ebx_7 = regs[1];
+  const bool fma = ecx_1 & (1u << 12);
+  const bool f16c = ecx_1 & (1u << 29);
+  res.avx2 = os_ymm && fma && f16c && (ebx_7 & (1u << 5));
+  // Skylake-SP subset: F, DQ, CD, BW and VL
+  const std::uint32_t skx_bits = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31);
+  res.avx512skx = res.avx2 && os_zmm && (ebx_7 & skx_bits) == skx_bits;
+#endif
+  return res;
+}
+
+const CpuFeatures& cpu_() {
+  static const CpuFeatures features = detectCpu_();
+  return features;
+}
+
+// table of `target`, null when it is not compiled in
+const KernelTable* kernelTable_(const IspcTarget target) {
+  switch (target) {
+    case IspcTarget::kPortable:
+      return &kPortableKernels;
+#ifdef CT_ISPC_TARGET_SSE2
+    case IspcTarget::kSse2:
+      return &kSse2Kernels;
+#endif
+#ifdef CT_ISPC_TARGET_SSE4
+    case IspcTarget::kSse4:
+      return &kSse4Kernels;
+#endif
+#ifdef CT_ISPC_TARGET_AVX2
+    case IspcTarget::kAvx2:
+      return &kAvx2Kernels;
+#endif
+#ifdef CT_ISPC_TARGET_AVX512SKX
+    case IspcTarget::kAvx512Skx:
+      return &kAvx512SkxKernels;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+bool cpuSupports_(const IspcTarget target) {
+  switch (target) {
+    case IspcTarget::kPortable:
+      return true;
+    case IspcTarget::kSse2:
+      return cpu_().sse2;
+    case IspcTarget::kSse4:
+      return cpu_().sse4;
+    case IspcTarget::kAvx2:
+      return cpu_().avx2;
+    case IspcTarget::kAvx512Skx:
+      return cpu_().avx512skx;
+  }
+  return false;
+}
+
+/* selection */
+
+std::atomic<IspcTarget> g_active_target{IspcTarget::kPortable};
+std::atomic<const KernelTable*> g_active_kernels{nullptr};
+
+// best target, unless CT_ISPC_TARGET names another available one
+IspcTarget initialTarget_() {
+  IspcTarget target;
+  const char* env = std::getenv("CT_ISPC_TARGET");
+  if (env != nullptr && ParseIspcTarget(env, target) && IsIspcTargetAvailable(target)) {
+    return target;
+  }
+  return BestIspcTarget();
+}
+
+const KernelTable& activeKernels_() {
+  const KernelTable* kernels = g_active_kernels.load(std::memory_order_acquire);
+  if (kernels == nullptr) {
+    // racing first calls all pick the same target, so a plain store is enough
+    const IspcTarget target = initialTarget_();
+    kernels = kernelTable_(target);
+    g_active_target.store(target, std::memory_order_relaxed);
+    g_active_kernels.store(kernels, std::memory_order_release);
+  }
+  return *kernels;
+}
+}  // namespace
+
+/* api */
+
+const char* IspcTargetName(const IspcTarget target) {
+  switch (target) {
+    case IspcTarget::kPortable:
+      return "portable";
+    case IspcTarget::kSse2:
+      return "sse2";
+    case IspcTarget::kSse4:
+      return "sse4";
+    case IspcTarget::kAvx2:
+      return "avx2";
+    case IspcTarget::kAvx512Skx:
+      return "avx512skx";
+  }
+  return "unknown";
+}
+
+bool ParseIspcTarget(const char* name, IspcTarget& target) {
+  constexpr IspcTarget targets[]{
+      IspcTarget::kPortable, IspcTarget::kSse2, IspcTarget::kSse4, IspcTarget::kAvx2,
+      IspcTarget::kAvx512Skx};
+  for (const IspcTarget candidate : targets) {
+    if (std::strcmp(name, IspcTargetName(candidate)) == 0) {
+      target = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsIspcTargetAvailable(const IspcTarget target) {
+  return kernelTable_(target) != nullptr && cpuSupports_(target);
+}
+
+IspcTarget BestIspcTarget() {
+  constexpr IspcTarget targets[]{
+      IspcTarget::kAvx512Skx, IspcTarget::kAvx2, IspcTarget::kSse4, IspcTarget::kSse2};
+  for (const IspcTarget target : targets) {
+    if (IsIspcTargetAvailable(target)) return target;
+  }
+  return IspcTarget::kPortable;
+}
+
+IspcTarget ActiveIspcTarget() {
+  activeKernels_();
+  return g_active_target.load(std::memory_order_relaxed);
+}
+
+bool SetIspcTarget(const IspcTarget target) {
+  if (!IsIspcTargetAvailable(target)) return false;
+  g_active_target.store(target, std::memory_order_relaxed);
+  g_active_kernels.store(kernelTable_(target), std::memory_order_release);
+  return true;
+}
+
+#ifdef ENABLE_ISPC
+/* forwarding */
+
+namespace ispc {
+extern "C" {
+#define CT_FORWARD(name, params, args, T, suffix) \
+  void CT_CONCAT(name, suffix) params { activeKernels_().CT_CONCAT(name, suffix) args; }
+CT_TYPED_KERNELS(CT_FORWARD)
+#undef CT_FORWARD
+}
+}  // namespace ispc
+#endif
+
+}  // namespace kplutl
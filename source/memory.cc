@@ -0,0 +1,137 @@
+#include <calculation_tools/memory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+namespace kplutl {
+namespace {
+/* counters */
+
+std::atomic<std::uint64_t> g_heap_allocations{0};
+std::atomic<std::uint64_t> g_heap_frees{0};
+std::atomic<std::uint64_t> g_heap_bytes{0};
+std::atomic<std::uint64_t> g_workspace_allocations{0};
+std::atomic<std::uint64_t> g_workspace_bytes{0};
+// last Workspace id handed out, over all threads
+std::atomic<std::uint64_t> g_workspace_scopes{0};
+
+/* arena */
+
+// the first block of an arena; every further one is at least twice the size of the one before
+constexpr size_t kWorkspaceBlock = size_t(1) << 20;
+
+class Arena {
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() {
+    for (const Block& block : blocks_) AlignedFree(block.data);
+  }
+
+  void* Allocate(size_t bytes) {
+    if (bytes == 0) return nullptr;
+    bytes = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+    g_workspace_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_workspace_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    // blocks too small for this allocation are skipped until the next rewind
+    for (; mark_.block < blocks_.size(); ++mark_.block, mark_.used = 0) {
+      const Block& block = blocks_[mark_.block];
+      if (block.size - mark_.used >= bytes) {
+        void* res = block.data + mark_.used;
+        mark_.used += bytes;
+        return res;
+      }
+    }
+    const size_t size =
+        std::max({bytes, kWorkspaceBlock, blocks_.empty() ? 0 : 2 * blocks_.back().size});
+    blocks_.push_back({static_cast<std::uint8_t*>(AlignedAlloc(size)), size});
+    mark_ = {blocks_.size() - 1, bytes};
+    return blocks_.back().data;
+  }
+
+  const WorkspaceMark& Mark() const { return mark_; }
+
+  void Rewind(const WorkspaceMark& mark) {
+    mark_ = mark;
+    if (mark_.block != 0 || mark_.used != 0 || blocks_.size() < 2) return;
+    // empty again: one block for everything the last round needed
+    size_t size = 0;
+    for (const Block& block : blocks_) {
+      size += block.size;
+      AlignedFree(block.data);
+    }
+    blocks_.assign(1, {static_cast<std::uint8_t*>(AlignedAlloc(size)), size});
+  }
+
+  size_t scopes = 0;        // open Workspaces
+  std::uint64_t scope = 0;  // id of the innermost one
+
+ private:
+  struct Block {
+    std::uint8_t* data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  WorkspaceMark mark_;
+};
+
+Arena& arena_() {
+  thread_local Arena arena;
+  return arena;
+}
+}  // namespace
+
+void* AlignedAlloc(const size_t bytes) {
+  if (bytes == 0) return nullptr;
+  g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_heap_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return ::operator new(bytes, std::align_val_t{kAlignment});
+}
+
+void AlignedFree(void* ptr) {
+  if (ptr == nullptr) return;
+  g_heap_frees.fetch_add(1, std::memory_order_relaxed);
+  ::operator delete(ptr, std::align_val_t{kAlignment});
+}
+
+AllocationCounters GetAllocationCounters() {
+  AllocationCounters res;
+  res.heap_allocations = g_heap_allocations.load(std::memory_order_relaxed);
+  res.heap_frees = g_heap_frees.load(std::memory_order_relaxed);
+  res.heap_bytes = g_heap_bytes.load(std::memory_order_relaxed);
+  res.workspace_allocations = g_workspace_allocations.load(std::memory_order_relaxed);
+  res.workspace_bytes = g_workspace_bytes.load(std::memory_order_relaxed);
+  return res;
+}
+
+Workspace::Workspace() : mark_(arena_().Mark()), previous_scope_(arena_().scope) {
+  Arena& arena = arena_();
+  ++arena.scopes;
+  arena.scope = g_workspace_scopes.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+Workspace::~Workspace() {
+  Arena& arena = arena_();
+  --arena.scopes;
+  arena.scope = previous_scope_;
+  arena.Rewind(mark_);
+}
+
+WorkspaceMark workspaceMark_() { return arena_().Mark(); }
+
+std::uint64_t workspaceScope_() { return arena_().scope; }
+
+void* workspaceAllocate_(const size_t bytes) { return arena_().Allocate(bytes); }
+
+void* workspaceAllocateScoped_(const size_t bytes) {
+  Arena& arena = arena_();
+  return arena.scopes != 0 ? arena.Allocate(bytes) : nullptr;
+}
+
+void workspaceRewind_(const WorkspaceMark& mark) { arena_().Rewind(mark); }
+
+}  // namespace kplutl
@@ -0,0 +1,175 @@
+#include <calculation_tools/profile.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CT_HAS_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define CT_HAS_RDTSC
+#endif
+
+namespace kplutl {
+namespace {
+constexpr const char* kKernelNames[]{
+#define CT_KERNEL_NAME(name, params, args, T, suffix) #name,
+    CT_KERNELS(CT_KERNEL_NAME, float, )
+#undef CT_KERNEL_NAME
+};
+static_assert(sizeof(kKernelNames) / sizeof(kKernelNames[0]) == kKernelCount, "one name each");
+
+/* counters */
+
+// fields of KernelCounters, in declaration order
+constexpr size_t kCounterFields = 5;
+
+// Counters of one thread. Only the owner writes them, so a relaxed load and store make an
+// increment; the atomics are there for the snapshots other threads take meanwhile.
+struct ThreadCounters {
+  std::atomic<std::uint64_t> values[kKernelCount][kCounterFields]{};
+};
+
+void addCounters_(KernelProfile& res, const ThreadCounters& counters) {
+  for (size_t k = 0; k < kKernelCount; ++k) {
+    const std::atomic<std::uint64_t>* values = counters.values[k];
+    KernelCounters& out = res.kernels[k];
+    out.calls += values[0].load(std::memory_order_relaxed);
+    out.elements += values[1].load(std::memory_order_relaxed);
+    out.bytes += values[2].load(std::memory_order_relaxed);
+    out.nanoseconds += values[3].load(std::memory_order_relaxed);
+    out.cycles += values[4].load(std::memory_order_relaxed);
+  }
+}
+
+// the counters of the live threads, plus the sums of the ones that exited
+struct Registry {
+  std::mutex mutex;
+  std::vector<ThreadCounters*> threads;
+  KernelProfile exited;
+};
+
+// never destroyed, threads may still exit after the statics are gone
+Registry& registry_() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// registers the thread's counters on its first kernel call and folds them into Registry::exited
+// when the thread ends
+class ThreadSlot {
+ public:
+  ThreadSlot() = default;
+  ThreadSlot(const ThreadSlot&) = delete;
+  ThreadSlot& operator=(const ThreadSlot&) = delete;
+  ~ThreadSlot() {
+    if (counters_ == nullptr) return;
+    Registry& registry = registry_();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    addCounters_(registry.exited, *counters_);
+    registry.threads.erase(
+        std::find(registry.threads.begin(), registry.threads.end(), counters_));
+    delete counters_;
+  }
+
+  ThreadCounters& Counters() {
+    if (counters_ == nullptr) {
+      counters_ = new ThreadCounters();
+      Registry& registry = registry_();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.threads.push_back(counters_);
+    }
+    return *counters_;
+  }
+
+ private:
+  ThreadCounters* counters_ = nullptr;
+};
+
+ThreadCounters& threadCounters_() {
+  thread_local ThreadSlot slot;
+  return slot.Counters();
+}
+
+void add_(std::atomic<std::uint64_t>& counter, const std::uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+std::uint64_t nanoseconds_() {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+std::uint64_t cycles_() {
+#ifdef CT_HAS_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+}  // namespace
+
+const char* KernelName(const KernelId kernel) {
+  const size_t index = static_cast<size_t>(kernel);
+  return index < kKernelCount ? kKernelNames[index] : "unknown";
+}
+
+KernelProfile GetKernelProfile() {
+  Registry& registry = registry_();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  KernelProfile res = registry.exited;
+  for (const ThreadCounters* counters : registry.threads) addCounters_(res, *counters);
+  return res;
+}
+
+std::string KernelProfileReport(const KernelProfile& profile) {
+  std::vector<size_t> called;
+  for (size_t k = 0; k < kKernelCount; ++k) {
+    if (profile.kernels[k].calls != 0) called.push_back(k);
+  }
+  std::stable_sort(called.begin(), called.end(), [&](const size_t lhs, const size_t rhs) {
+    return profile.kernels[lhs].nanoseconds > profile.kernels[rhs].nanoseconds;
+  });
+
+  std::string res;
+  char line[256];
+  std::snprintf(
+      line, sizeof(line), "%-28s %12s %14s %16s %14s %16s %10s\n", "kernel", "calls", "elements",
+      "bytes", "ns", "cycles", "ns/call");
+  res += line;
+  for (const size_t k : called) {
+    const KernelCounters& counters = profile.kernels[k];
+    std::snprintf(
+        line, sizeof(line), "%-28s %12llu %14llu %16llu %14llu %16llu %10.1f\n", kKernelNames[k],
+        static_cast<unsigned long long>(counters.calls),
+        static_cast<unsigned long long>(counters.elements),
+        static_cast<unsigned long long>(counters.bytes),
+        static_cast<unsigned long long>(counters.nanoseconds),
+        static_cast<unsigned long long>(counters.cycles),
+        double(counters.nanoseconds) / double(counters.calls));
+    res += line;
+  }
+  return res;
+}
+
+ProfileStamp profileBegin_() { return {nanoseconds_(), cycles_()}; }
+
+void profileEnd_(
+    const KernelId kernel, const ProfileStamp& start, const std::uint64_t elements,
+    const std::uint64_t bytes) {
+  const std::uint64_t cycles = cycles_();
+  const std::uint64_t nanoseconds = nanoseconds_();
+  std::atomic<std::uint64_t>* values = threadCounters_().values[static_cast<size_t>(kernel)];
+  add_(values[0], 1);
+  add_(values[1], elements);
+  add_(values[2], bytes);
+  add_(values[3], nanoseconds - start.nanoseconds);
+  add_(values[4], cycles - start.cycles);
+}
+
+}  // namespace kplutl
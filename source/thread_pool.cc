@@ -0,0 +1,278 @@
+#include <calculation_tools/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace kplutl {
+namespace {
+/* pool */
+
+// one ParallelTasks call or ISPC launch; it is finished when `pending` drops to 0
+struct Job {
+  void (*body)(const void* context, size_t index);
+  const void* context;
+  std::atomic<size_t> pending;
+};
+
+struct Task {
+  Job* job;
+  size_t index;
+};
+
+// A mutex per deque keeps stealing simple; tasks are coarse enough that the lock is noise.
+struct TaskQueue {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+};
+
+class Pool {
+ public:
+  explicit Pool(const size_t threads) : queues_(threads) {
+    for (auto& queue : queues_) queue = std::make_unique<TaskQueue>();
+    workers_.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) workers_.emplace_back([this, i] { work_(i); });
+  }
+
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  size_t Threads() const { return queues_.size(); }
+
+  // 0 on threads outside the pool, 1 to Threads() - 1 on the workers
+  static size_t ThreadIndex() { return t_index; }
+
+  // deals the tasks of `job` out over all deques, starting with the caller's own
+  void Submit(Job& job, const size_t count) {
+    const size_t home = home_();
+    for (size_t i = 0; i < count; ++i) {
+      TaskQueue& queue = *queues_[(home + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(Task{&job, i});
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      queued_ += count;
+    }
+    wake_.notify_all();
+  }
+
+  // runs tasks, of any job, until every task of `job` has finished
+  void Wait(const Job& job) {
+    const size_t home = home_();
+    while (job.pending.load(std::memory_order_acquire) != 0) {
+      if (!runOne_(home)) std::this_thread::yield();
+    }
+  }
+
+ private:
+  // the deque of the calling thread; threads outside the pool share the first one
+  size_t home_() const { return t_pool == this ? t_index : 0; }
+
+  bool pop_(const size_t home, Task& task) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      TaskQueue& queue = *queues_[(home + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty()) continue;
+      // own work newest first while it is still in cache, stolen work oldest first
+      if (i == 0) {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      } else {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool runOne_(const size_t home) {
+    Task task;
+    if (!pop_(home, task)) return false;
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      --queued_;
+    }
+    task.job->body(task.job->context, task.index);
+    task.job->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  void work_(const size_t index) {
+    t_pool = this;
+    t_index = index;
+    for (;;) {
+      if (runOne_(index)) continue;
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      wake_.wait(lock, [this] { return stop_ || queued_ != 0; });
+      if (stop_) return;
+    }
+  }
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  size_t queued_ = 0;  // tasks in any deque, guarded by sleep_mutex_
+  bool stop_ = false;
+
+  static thread_local const Pool* t_pool;
+  static thread_local size_t t_index;
+};
+
+thread_local const Pool* Pool::t_pool = nullptr;
+thread_local size_t Pool::t_index = 0;
+
+/* settings */
+
+std::mutex g_pool_mutex;
+std::unique_ptr<Pool> g_pool;
+std::atomic<size_t> g_grain{kParallelGrain};
+
+size_t hardwareThreads_() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+// CT_NUM_THREADS when it holds a positive number, otherwise one per hardware thread
+size_t initialThreads_() {
+  const char* env = std::getenv("CT_NUM_THREADS");
+  if (env != nullptr) {
+    char* end = nullptr;
+    const long threads = std::strtol(env, &end, 10);
+    if (end != env && *end == '\0' && threads > 0) return size_t(threads);
+  }
+  return hardwareThreads_();
+}
+
+Pool& pool_() {
+  std::lock_guard<std::mutex> lock(g_pool_mutex);
+  if (!g_pool) g_pool = std::make_unique<Pool>(initialThreads_());
+  return *g_pool;
+}
+}  // namespace
+
+/* api */
+
+size_t ThreadCount() { return pool_().Threads(); }
+
+void SetThreadCount(const size_t threads) {
+  std::unique_ptr<Pool> old;
+  std::lock_guard<std::mutex> lock(g_pool_mutex);
+  old = std::move(g_pool);
+  g_pool = std::make_unique<Pool>(threads != 0 ? threads : hardwareThreads_());
+}
+
+size_t ParallelGrain() { return g_grain.load(std::memory_order_relaxed); }
+
+void SetParallelGrain(const size_t grain) {
+  g_grain.store(grain != 0 ? grain : kParallelGrain, std::memory_order_relaxed);
+}
+
+void parallelTasks_(
+    const size_t count, void (*body)(const void* context, size_t index), const void* context) {
+  if (count == 0) return;
+  Pool& pool = pool_();
+  if (pool.Threads() == 1) {
+    for (size_t i = 0; i < count; ++i) body(context, i);
+    return;
+  }
+  Job job{body, context, {count}};
+  pool.Submit(job, count);
+  pool.Wait(job);
+}
+
+}  // namespace kplutl
+
+#ifdef ENABLE_ISPC
+/* ISPC task runtime */
+
+namespace {
+using IspcTaskFn = void (*)(
+    void* data, int thread_index, int thread_count, int task_index, int task_count,
+    int task_index0, int task_index1, int task_index2, int task_count0, int task_count1,
+    int task_count2);
+
+struct IspcLaunch {
+  IspcTaskFn fn;
+  void* data;
+  int counts[3];
+  kplutl::Job job;
+};
+
+struct IspcAllocation {
+  void* ptr;
+  size_t alignment;
+};
+
+// launches and ISPCAlloc memory of one ISPC function call, released by its ISPCSync
+struct IspcTaskGroup {
+  std::deque<IspcLaunch> launches;  // a deque keeps the jobs in place while they run
+  std::vector<IspcAllocation> allocations;
+};
+
+IspcTaskGroup& ispcGroup_(void** handle) {
+  if (*handle == nullptr) *handle = new IspcTaskGroup;
+  return *static_cast<IspcTaskGroup*>(*handle);
+}
+
+void ispcTask_(const void* context, const size_t index) {
+  const IspcLaunch& launch = *static_cast<const IspcLaunch*>(context);
+  const int task = int(index);
+  const int* counts = launch.counts;
+  const int thread = int(kplutl::Pool::ThreadIndex());
+  launch.fn(
+      launch.data, thread, int(kplutl::ThreadCount()), task, counts[0] * counts[1] * counts[2],
+      task % counts[0], task / counts[0] % counts[1], task / (counts[0] * counts[1]), counts[0],
+      counts[1], counts[2]);
+}
+}  // namespace
+
+extern "C" {
+void* ISPCAlloc(void** handle, const std::int64_t size, const std::int32_t alignment) {
+  IspcTaskGroup& group = ispcGroup_(handle);
+  const size_t align = std::max<size_t>(alignment, sizeof(void*));
+  void* ptr = ::operator new(size_t(size), std::align_val_t{align});
+  group.allocations.push_back(IspcAllocation{ptr, align});
+  return ptr;
+}
+
+void ISPCLaunch(
+    void** handle, void* fn, void* data, const int count0, const int count1, const int count2) {
+  IspcTaskGroup& group = ispcGroup_(handle);
+  const size_t count = size_t(count0) * size_t(count1) * size_t(count2);
+  if (count == 0) return;
+  IspcLaunch& launch = group.launches.emplace_back();
+  launch.fn = reinterpret_cast<IspcTaskFn>(fn);
+  launch.data = data;
+  launch.counts[0] = count0;
+  launch.counts[1] = count1;
+  launch.counts[2] = count2;
+  launch.job.body = ispcTask_;
+  launch.job.context = &launch;
+  launch.job.pending.store(count, std::memory_order_relaxed);
+  kplutl::pool_().Submit(launch.job, count);
+}
+
+void ISPCSync(void* handle) {
+  if (handle == nullptr) return;
+  auto* group = static_cast<IspcTaskGroup*>(handle);
+  for (const IspcLaunch& launch : group->launches) kplutl::pool_().Wait(launch.job);
+  for (const IspcAllocation& allocation : group->allocations) {
+    ::operator delete(allocation.ptr, std::align_val_t{allocation.alignment});
+  }
+  delete group;
+}
+}
+#endif
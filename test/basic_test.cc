@@ -29,6 +29,20 @@ int main() {
   std::cout << "Abs(vec_0): " << Abs(-vec_3) << std::endl;
   std::cout << "Sqrt(vec_3): " << Sqrt(vec_3) << std::endl;
 
+  std::cout << "vec_1 + 1: " << vec_1 + 1.0f << std::endl;
+  std::cout << "10 - vec_1: " << 10.0f - vec_1 << std::endl;
+  std::cout << "2 * vec_1: " << 2.0f * vec_1 << std::endl;
+  std::cout << "6 / vec_1: " << 6.0f / vec_1 << std::endl;
+  std::cout << "Pow(vec_1, 2): " << Pow(vec_1, 2.0f) << std::endl;
+  std::cout << "Pow(2, vec_1): " << Pow(2.0f, vec_1) << std::endl;
+
+  Vector3f vec_acc{vec_1};
+  vec_acc += vec_2;
+  vec_acc *= 2.0f;
+  vec_acc -= 1.0f;
+  vec_acc /= vec_3;
+  std::cout << "((vec_1 + vec_2) * 2 - 1) / vec_3: " << vec_acc << std::endl;
+
   Matrix3X3f mat_1{
       {1, 2, 3},
       {4, 5, 6},
@@ -45,6 +59,9 @@ int main() {
   std::vector<float> mat_vec{1, 4, 7, 2, 5, 8, 3, 6, 9};
   Matrix3X3f mat_3{mat_vec.begin(), mat_vec.end()};
 
+  // rows of a 3x3 matrix are padded to four lanes
+  std::cout << "Matrix3X3f::kLeadingDim: " << Matrix3X3f::kLeadingDim << std::endl;
+
   std::cout << "mat_1: " << mat_1;
   std::cout << "mat_2: " << mat_2;
   std::cout << "mat_3: " << mat_3;
@@ -59,4 +76,24 @@ int main() {
 
   std::cout << "Abs(mat_3): " << Abs(-mat_3);
   std::cout << "Sqrt(mat_3): " << Sqrt(mat_3);
+
+  std::cout << "mat_1 - 1: " << mat_1 - 1.0f;
+  std::cout << "1 / mat_1: " << 1.0f / mat_1;
+  Matrix3X3f mat_acc{mat_1};
+  mat_acc += mat_2;
+  mat_acc /= 10.0f;
+  std::cout << "(mat_1 + mat_2) / 10: " << mat_acc;
+
+  // the same operations over the other kernel types
+  Vector3d vec_d{1, 2, 3};
+  std::cout << "vec_d / 3 + 1: " << vec_d / 3.0 + 1.0 << std::endl;
+  Vector3i vec_i{7, -8, 9};
+  std::cout << "Abs(vec_i) / 2: " << Abs(vec_i) / 2 << std::endl;
+  Matrix4X4d mat_d{
+      {1, 2, 3, 4},
+      {5, 6, 7, 8},
+      {9, 10, 11, 12},
+      {13, 14, 15, 16}
+  };
+  std::cout << "Sqrt(mat_d) * 2: " << Sqrt(mat_d) * 2.0;
 }
\ No newline at end of file
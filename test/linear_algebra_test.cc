@@ -1,6 +1,14 @@
 #include <calculation_tools/linear_algebra.h>
+#include <calculation_tools/graphic.h>
+#include <calculation_tools/vector_stream.h>
+#include <calculation_tools/quaternion.h>
+#include <calculation_tools/transform_hierarchy.h>
 #include "calculation_tools/matrix.h"
 
+#include <cstdint>
+#include <random>
+#include <vector>
+
 using namespace kplutl;
 
 int main() {
@@ -14,6 +22,9 @@ int main() {
   std::cout << "CrossProd(vec_1, vec_2): " << CrossProd(vec_1, vec_2) << std::endl;
   std::cout << "CrossProd(vec_2, vec_1): " << CrossProd(vec_2, vec_1) << std::endl;
 
+  Vector2f vec_3{3, 4};
+  std::cout << "DotProd(vec_3, vec_3): " << DotProd(vec_3, vec_3) << std::endl;
+
   Matrix4X4f mat_transform{
       {2, 0,   0, 1},
       {0, 0.5, 0, 1},
@@ -27,6 +38,8 @@ int main() {
 
   std::cout << "transform(mat_transform, vec_transform): "
             << Transform(mat_transform, vec_transform) << std::endl;
+  std::cout << "MatrixProd(mat_transform, mat_transform):"
+            << MatrixProd(mat_transform, mat_transform);
 
   MatrixCT<float, 3, 2> mat_1{
       {1, 2},
@@ -53,4 +66,425 @@ int main() {
   std::cout << "mat_3: " << mat_3;
 
   std::cout << "MatrixProd(mat_2, mat_3):" << MatrixProd(mat_2, mat_3);
-}
\ No newline at end of file
+
+  Matrix3X3f mat_4{1};
+  Gemm(2.0f, mat_2, mat_3, -1.0f, mat_4);
+  std::cout << "Gemm(2, mat_2, mat_3, -1, ones):" << mat_4;
+
+  Matrix3X3f mat_5{
+      {1, 2, 0},
+      {0, 1, 0},
+      {0, 0, 2}
+  };
+  std::cout << "Determinant(mat_2): " << Determinant(mat_2) << std::endl;
+  std::cout << "Determinant(mat_transform): " << Determinant(mat_transform) << std::endl;
+  std::cout << "Inverse(mat_5):" << Inverse(mat_5);
+  std::cout << "InverseTranspose(mat_5):" << InverseTranspose(mat_5);
+  std::cout << "InverseAffine(mat_transform):" << InverseAffine(mat_transform);
+  bool inverse_equal = true;
+  for (size_t r = 0; r < 4; ++r) {
+    for (size_t c = 0; c < 4; ++c)
+      inverse_equal &= Inverse(mat_transform)[r][c] == InverseAffine(mat_transform)[r][c];
+  }
+  std::cout << "Inverse(mat_transform) == InverseAffine(mat_transform): " << inverse_equal
+            << std::endl;
+  std::cout << "NormalMatrix(BuildScaleMatrix(2, 4, 8)):"
+            << NormalMatrix(BuildScaleMatrix(2.0f, 4.0f, 8.0f));
+
+  // rotation, scale and translation, then a general matrix for the batch kernels
+  std::vector<Matrix4X4f> mat_batch{
+      MatrixProd(
+          MatrixProd(BuildTranslationMatrix(1.0f, -2.0f, 3.0f), BuildRotationMatrixY(0.7f)),
+          BuildScaleMatrix(2.0f, 0.5f, 3.0f)),
+      MatrixProd(BuildRotationMatrixX(-1.2f), BuildTranslationMatrix(0.5f, 0.25f, -4.0f)),
+      Matrix4X4f{{4, 1, 0, 2}, {1, 3, 1, 0}, {0, 2, 5, 1}, {1, 0, 1, 2}},
+  };
+  std::vector<Matrix4X4f> mat_inverse(mat_batch.size()), mat_affine(2);
+  std::vector<float> mat_det(mat_batch.size());
+  Inverse(mat_batch.data(), mat_inverse.data(), mat_batch.size(), mat_det.data());
+  InverseAffine(mat_batch.data(), mat_affine.data(), mat_affine.size());
+  float inverse_error = 0;
+  auto max_error = [&](const Matrix4X4f& lhs, const Matrix4X4f& rhs) {
+    for (size_t r = 0; r < 4; ++r)
+      inverse_error = std::max(inverse_error, Length(lhs[r] - rhs[r]));
+  };
+  for (size_t i = 0; i < mat_batch.size(); ++i) {
+    Matrix4X4f identity;
+    BuildIdentity(identity);
+    max_error(MatrixProd(mat_batch[i], Inverse(mat_batch[i])), identity);
+    max_error(mat_inverse[i], Inverse(mat_batch[i]));
+    max_error(Transpose(InverseTranspose(mat_batch[i])), mat_inverse[i]);
+    if (i < mat_affine.size()) {
+      max_error(InverseAffine(mat_batch[i]), mat_inverse[i]);
+      max_error(mat_affine[i], mat_inverse[i]);
+    }
+    inverse_error = std::max(inverse_error, std::abs(mat_det[i] - Determinant(mat_batch[i])));
+  }
+  std::cout << "Determinant(mat_batch): ( " << mat_det[0] << ", " << mat_det[1] << ", "
+            << mat_det[2] << " )" << std::endl;
+  std::cout << "inverses within 1e-5: " << (inverse_error < 1e-5f) << std::endl;
+
+  // batched products: pairwise, one matrix times many in place, and 3x3 with exact sums
+  std::vector<Matrix4X4f> mat_prod(mat_batch.size()), mat_view = mat_batch;
+  MatrixProd(mat_batch.data(), mat_inverse.data(), mat_prod.data(), mat_batch.size());
+  const Matrix4X4f view = MatrixProd(
+      BuildPerspectiveProjectionMatrixRH(1.0f, -1.0f, 1.0f, -1.0f, 0.5f, 50.0f),
+      BuildViewMatrixRH(Vector3f{1, 2, 3}, Vector3f{0, 0, 0}, Vector3f{0, 1, 0}));
+  MatrixProd(view, mat_view.data(), mat_view.data(), mat_view.size());
+  float prod_error = 0;
+  for (size_t i = 0; i < mat_batch.size(); ++i) {
+    Matrix4X4f identity;
+    BuildIdentity(identity);
+    const Matrix4X4f expected = MatrixProd(view, mat_batch[i]);
+    for (size_t r = 0; r < 4; ++r) {
+      prod_error = std::max(prod_error, Length(mat_prod[i][r] - identity[r]));
+      prod_error = std::max(prod_error, Length(mat_view[i][r] - expected[r]));
+    }
+  }
+  std::vector<Matrix3X3f> mat_small{
+      Matrix3X3f{{1, 2, 0}, {0, 1, 3}, {4, 0, 1}},
+      Matrix3X3f{{2, 0, 1}, {1, 1, 0}, {0, 3, 2}}
+  };
+  std::vector<Matrix3X3f> mat_small_prod(2);
+  MatrixProd(mat_small.data(), mat_small[1], mat_small_prod.data(), 2);
+  std::cout << "batched MatrixProd within 1e-5: " << (prod_error < 1e-5f)
+            << ", mat_small[0] * mat_small[1]:" << mat_small_prod[0];
+
+  std::vector<float> soa_x{1, 2, 3, 4, 5}, soa_y{1, 1, 1, 1, 1}, soa_z{0, 1, 2, 3, 4};
+  std::vector<float> out_x(5), out_y(5), out_z(5), out_w(5);
+
+  TransformSoA(
+      mat_transform, soa_x.data(), soa_y.data(), soa_z.data(), nullptr, out_x.data(),
+      out_y.data(), out_z.data(), out_w.data(), soa_x.size());
+  std::cout << "TransformSoA(mat_transform, soa):" << std::endl;
+  for (size_t i = 0; i < soa_x.size(); ++i)
+    std::cout << "( " << out_x[i] << ", " << out_y[i] << ", " << out_z[i] << ", " << out_w[i]
+              << " )" << std::endl;
+
+  Vector4f aos_in[3]{
+      {1, 1, 1, 1},
+      {2, 2, 2, 1},
+      {3, 3, 3, 1}
+  };
+  Vector4f aos_out[3];
+  Transform(mat_transform, aos_in, aos_out, 3);
+  std::cout << "Transform(mat_transform, aos):" << std::endl;
+  for (auto& vec : aos_out) std::cout << vec << std::endl;
+
+  Matrix4X4f mat_project{
+      {1, 0, 0,  0},
+      {0, 1, 0,  0},
+      {0, 0, 1,  0},
+      {0, 0, -1, 0}
+  };
+  std::vector<float> soa_depth{-1, -2, -3, -4, -5};
+  Viewport<float> viewport{0, 0, 640, 480, 0, 1};
+  ProjectSoA(
+      mat_project, soa_x.data(), soa_y.data(), soa_depth.data(), nullptr, out_x.data(),
+      out_y.data(), out_z.data(), out_w.data(), soa_x.size(), viewport);
+  std::cout << "ProjectSoA(mat_project, soa, viewport):" << std::endl;
+  for (size_t i = 0; i < soa_x.size(); ++i)
+    std::cout << "( " << out_x[i] << ", " << out_y[i] << ", " << out_z[i] << ", " << out_w[i]
+              << " )" << std::endl;
+
+  std::vector<Vector3f> stream_in{{3, 0, 4}, {1, 2, 2}, {0, 5, 0}, {-2, 3, 6}, {1, 1, 1}};
+  Vector3Stream stream_lhs(stream_in.begin(), stream_in.end());
+  Vector3Stream stream_rhs(stream_in.size(), Vector3f{0, 0, 1});
+  std::cout << "stream_lhs: " << stream_lhs << std::endl;
+  std::cout << "DotProd(stream_lhs, stream_rhs): " << DotProd(stream_lhs, stream_rhs) << std::endl;
+  std::cout << "CrossProd(stream_lhs, stream_rhs): " << CrossProd(stream_lhs, stream_rhs)
+            << std::endl;
+  std::cout << "Length(stream_lhs): " << Length(stream_lhs) << std::endl;
+  std::cout << "Normalize(stream_lhs): " << Normalize(stream_lhs) << std::endl;
+  Vector3Stream stream_fast = Normalize(stream_lhs, kNormalizeFast);
+  float fast_error = 0;
+  for (size_t i = 0; i < stream_lhs.size(); ++i)
+    fast_error = std::max(fast_error, Length(stream_fast.Get(i) - Normalize(stream_in[i])));
+  std::cout << "Normalize(stream_lhs, kNormalizeFast) within 1e-6: " << (fast_error < 1e-6f)
+            << std::endl;
+
+  Quaternionf quat_x{1, 0, 0, 0};     // half turn around x
+  Quaternionf quat_y{0, 1, 0, 0};     // half turn around y
+  Quaternionf quat_xyz{0.5f, 0.5f, 0.5f, 0.5f};  // third of a turn around (1, 1, 1)
+  std::cout << "QuaternionProd(quat_x, quat_y): " << QuaternionProd(quat_x, quat_y) << std::endl;
+  std::cout << "Conjugate(quat_xyz): " << Conjugate(quat_xyz) << std::endl;
+  std::cout << "Rotate(quat_xyz, (1, 2, 3)): " << Rotate(quat_xyz, Vector3f{1, 2, 3}) << std::endl;
+  std::cout << "BuildRotationMatrix(quat_xyz):" << BuildRotationMatrix(quat_xyz);
+  std::cout << "ToQuaternion(BuildRotationMatrix(quat_xyz)): "
+            << ToQuaternion(BuildRotationMatrix(quat_xyz)) << std::endl;
+  Quaternionf quat_z = BuildQuaternion(Vector3f{0, 0, 1}, 1.57079633f);
+  Quaternionf quat_slerp = Slerp(Quaternionf::Identity(), quat_z, 0.5f);
+  Quaternionf quat_eighth = BuildQuaternion(Vector3f{0, 0, 1}, 0.785398163f);
+  std::cout << "Slerp(identity, quarter turn around z, 0.5) within 1e-6 of an eighth turn: "
+            << (Length(quat_slerp - quat_eighth) < 1e-6f) << std::endl;
+  std::cout << "Nlerp(quat_x, -quat_x, 0.5): " << Nlerp(quat_x, Quaternionf(-quat_x), 0.5f)
+            << std::endl;
+
+  std::vector<Quaternionf> quat_in{quat_x, quat_y, quat_xyz, quat_z, quat_slerp};
+  QuaternionStream<float> quat_lhs(quat_in.begin(), quat_in.end());
+  QuaternionStream<float> quat_rhs(quat_in.rbegin(), quat_in.rend());
+  QuaternionStream<float> quat_prod = QuaternionProd(quat_lhs, quat_rhs);
+  QuaternionStream<float> quat_lerp = Slerp(quat_lhs, quat_rhs, 0.25f);
+  VectorStream<float, 3> quat_rotated = Rotate(quat_lhs, stream_lhs);
+  std::vector<Matrix4X4f> quat_mats(quat_in.size());
+  BuildRotationMatrix(quat_lhs, quat_mats.data());
+  QuaternionStream<float> quat_back = ToQuaternion(quat_mats.data(), quat_mats.size());
+  float quat_error = 0;
+  for (size_t i = 0; i < quat_in.size(); ++i) {
+    const Quaternionf& lhs = quat_in[i];
+    const Quaternionf& rhs = quat_in[quat_in.size() - 1 - i];
+    quat_error = std::max(quat_error, Length(quat_prod.Get(i) - QuaternionProd(lhs, rhs)));
+    quat_error = std::max(quat_error, Length(quat_lerp.Get(i) - Slerp(lhs, rhs, 0.25f)));
+    quat_error = std::max(quat_error, Length(quat_rotated.Get(i) - Rotate(lhs, stream_in[i])));
+    quat_error = std::max(quat_error, Length(quat_back.Get(i) - ToQuaternion(quat_mats[i])));
+    for (size_t r = 0; r < 4; ++r)
+      quat_error = std::max(quat_error, Length(quat_mats[i][r] - BuildRotationMatrix(lhs)[r]));
+  }
+  std::cout << "QuaternionProd(quat_lhs, quat_rhs): " << quat_prod << std::endl;
+  std::cout << "quaternion streams within 1e-5 of the scalar functions: " << (quat_error < 1e-5f)
+            << std::endl;
+
+  // an orthographic view of x in [3, 7], y in [-1, 1] and z in [-10, 0]; boxes inside, outside,
+  // across a plane, behind, beyond the far plane and around the whole frustum
+  const Frustum<float> frustum = ExtractFrustum(MatrixProd(
+      BuildOrthographicProjectionMatrixRH(2.0f, -2.0f, 1.0f, -1.0f, 0.0f, -10.0f),
+      BuildTranslationMatrix(-5.0f, 0.0f, 0.0f)));
+  std::vector<Vector3f> box_min{{4, -0.5f, -6}, {-1, -0.5f, -6}, {6.5f, 0, -3},
+                                {4, 0, 1},      {4, 0, -12},     {-20, -20, -20}};
+  std::vector<Vector3f> box_max{{6, 0.5f, -4}, {1, 0.5f, -4}, {8, 2, -2},
+                                {6, 1, 2},     {6, 1, -11},   {20, 20, 20}};
+  const std::vector<std::uint32_t> boxes_visible = CullAabbs(
+      frustum, Vector3Stream(box_min.begin(), box_min.end()),
+      Vector3Stream(box_max.begin(), box_max.end()));
+  std::cout << "CullAabbs(frustum, boxes):";
+  for (std::uint32_t index : boxes_visible) std::cout << " " << index;
+  std::cout << std::endl;
+  std::vector<Vector4f> sphere_in{
+      {5, 0, -5, 0.5f}, {8, 0, -5, 0.5f}, {8, 0, -5, 1.5f}, {5, 0, 1, 0.5f}, {5, 0, 0.4f, 0.5f}};
+  const std::vector<std::uint32_t> spheres_visible =
+      CullSpheres(frustum, Vector4Stream(sphere_in.begin(), sphere_in.end()));
+  std::cout << "CullSpheres(frustum, spheres):";
+  for (std::uint32_t index : spheres_visible) std::cout << " " << index;
+  std::cout << std::endl;
+
+  // enough boxes for several ranges, on a grid of quarters so every distance is exact
+  const size_t box_count = 200000;
+  Vector3Stream many_min(box_count, kUninitialized), many_max(box_count, kUninitialized);
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> quarters(-48, 48), extents(0, 8);
+  for (size_t i = 0; i < box_count; ++i) {
+    for (size_t c = 0; c < 3; ++c) {
+      many_min[c][i] = quarters(rng) / 4.0f;
+      many_max[c][i] = many_min[c][i] + extents(rng) / 4.0f;
+    }
+  }
+  std::vector<std::uint32_t> many_expected;
+  for (size_t i = 0; i < box_count; ++i) {
+    bool inside = true;
+    for (const auto& plane : frustum.planes) {
+      float corner[3];
+      for (size_t c = 0; c < 3; ++c) corner[c] = (plane[c] >= 0 ? many_max : many_min)[c][i];
+      const float dist = plane[0] * corner[0] + plane[1] * corner[1] + plane[2] * corner[2];
+      inside = inside && dist + plane[3] >= 0;
+    }
+    if (inside) many_expected.push_back(std::uint32_t(i));
+  }
+  std::cout << "CullAabbs(200000 boxes) matches the scalar test: "
+            << (CullAabbs(frustum, many_min, many_max) == many_expected) << std::endl;
+
+  // a chain of three nodes and a second root; world = parent world * T * R * S
+  TransformHierarchyf hierarchy;
+  const Quaternionf quat_turn = BuildQuaternion(Vector3f{0, 0, 1}, 0.5f);
+  const std::uint32_t node_root = hierarchy.AddNode(kNoParent, Vector3f{1, 2, 3}, quat_turn);
+  const std::uint32_t node_arm = hierarchy.AddNode(
+      node_root, Vector3f{0, 1, 0}, Quaternionf::Identity(), Vector3f{2, 2, 2});
+  const std::uint32_t node_hand = hierarchy.AddNode(node_arm, Vector3f{1, 0, 0}, quat_turn);
+  hierarchy.AddNode();
+  std::cout << "TransformHierarchy Update (new, unchanged, hand, root): " << hierarchy.Update();
+  std::cout << " " << hierarchy.Update();
+  hierarchy.SetScale(node_hand, Vector3f{1, 3, 1});
+  std::cout << " " << hierarchy.Update();
+  hierarchy.SetTranslation(node_root, Vector3f{-1, 0, 0});
+  std::cout << " " << hierarchy.Update() << std::endl;
+  auto local_matrix = [](const TransformHierarchyf& nodes, const std::uint32_t node) {
+    const Vector3f t = nodes.Translation(node), s = nodes.Scale(node);
+    return MatrixProd(
+        MatrixProd(
+            BuildTranslationMatrix(t[0], t[1], t[2]), BuildRotationMatrix(nodes.Rotation(node))),
+        BuildScaleMatrix(s[0], s[1], s[2]));
+  };
+  const Matrix4X4f hand_expected = MatrixProd(
+      MatrixProd(local_matrix(hierarchy, node_root), local_matrix(hierarchy, node_arm)),
+      local_matrix(hierarchy, node_hand));
+  float hand_error = 0;
+  for (size_t r = 0; r < 4; ++r)
+    hand_error = std::max(hand_error, Length(hierarchy.World(node_hand)[r] - hand_expected[r]));
+  std::cout << "TransformHierarchy World(hand) within 1e-5 of the matrix products: "
+            << (hand_error < 1e-5f) << std::endl;
+
+  // a random forest wide enough to split levels over the pool, then a few dirty nodes
+  TransformHierarchyf forest;
+  std::uniform_real_distribution<float> coords(-1.0f, 1.0f);
+  auto random_quat = [&]() {
+    return Normalize(Quaternionf{coords(rng), coords(rng), coords(rng), coords(rng) + 2.0f});
+  };
+  for (size_t i = 0; i < 20000; ++i) {
+    const std::uint32_t parent =
+        i < 4 ? kNoParent : std::uniform_int_distribution<std::uint32_t>(0, i - 1)(rng) / 2;
+    forest.AddNode(
+        parent, Vector3f{coords(rng), coords(rng), coords(rng)}, random_quat(),
+        Vector3f{1 + coords(rng) / 4, 1 + coords(rng) / 4, 1 + coords(rng) / 4});
+  }
+  forest.Update();
+  for (std::uint32_t node = 0; node < forest.size(); node += 997)
+    forest.SetRotation(node, random_quat());
+  size_t forest_expected = 0;
+  std::vector<bool> forest_moved(forest.size());
+  for (std::uint32_t node = 0; node < forest.size(); ++node) {
+    const std::uint32_t parent = forest.Parent(node);
+    forest_moved[node] = node % 997 == 0 || (parent != kNoParent && forest_moved[parent]);
+    forest_expected += forest_moved[node];
+  }
+  const size_t forest_updated = forest.Update();
+  float forest_error = 0;
+  std::vector<Matrix4X4f> forest_world(forest.size());
+  for (std::uint32_t node = 0; node < forest.size(); ++node) {
+    const Matrix4X4f local = local_matrix(forest, node);
+    const std::uint32_t parent = forest.Parent(node);
+    forest_world[node] = parent == kNoParent ? local : MatrixProd(forest_world[parent], local);
+    for (size_t r = 0; r < 4; ++r)
+      forest_error = std::max(forest_error, Length(forest.World(node)[r] - forest_world[node][r]));
+  }
+  std::cout << "TransformHierarchy(20000 nodes) recomputes only the moved subtrees: "
+            << (forest_updated == forest_expected) << ", within 1e-4 of the reference: "
+            << (forest_error < 1e-4f) << std::endl;
+
+  // skinning: one bone, two bones half and half, and a rotation turning the normal with it
+  const std::vector<Matrix4X4f> palette{
+      BuildTranslationMatrix(0.0f, 0.0f, 0.0f), BuildTranslationMatrix(0.0f, 2.0f, 0.0f),
+      BuildRotationMatrixZ(1.5707963f)};
+  VectorStream<std::uint32_t, 4> skin_bones(3);
+  Vector4Stream skin_weights(3);
+  skin_bones.Set(0, VectorCT<std::uint32_t, 4>{1, 0, 0, 0});
+  skin_bones.Set(1, VectorCT<std::uint32_t, 4>{0, 1, 0, 0});
+  skin_bones.Set(2, VectorCT<std::uint32_t, 4>{2, 0, 0, 0});
+  skin_weights.Set(0, Vector4f{1, 0, 0, 0});
+  skin_weights.Set(1, Vector4f{0.5f, 0.5f, 0, 0});
+  skin_weights.Set(2, Vector4f{1, 0, 0, 0});
+  const Vector3Stream skin_pos(3, Vector3f{1, 0, 0}), skin_normal(3, Vector3f{0, 0, 2});
+  Vector3Stream skinned_pos, skinned_normal;
+  Skin(
+      palette.data(), skin_bones, skin_weights, skin_pos, skin_normal, skinned_pos,
+      skinned_normal);
+  std::cout << "Skin positions: " << skinned_pos.Get(0) << skinned_pos.Get(1)
+            << ", normal: " << skinned_normal.Get(1) << ", rotated: "
+            << (Length(skinned_pos.Get(2) - Vector3f{0, 1, 0}) < 1e-6f) << std::endl;
+
+  // a crowd-sized mesh over a palette of rigid bones, against blending with MatrixCT operators
+  const size_t skin_count = 20000;
+  std::vector<Matrix4X4f> bone_palette(64);
+  for (Matrix4X4f& bone : bone_palette) {
+    bone = MatrixProd(
+        BuildTranslationMatrix(coords(rng), coords(rng), coords(rng)),
+        BuildRotationMatrix(random_quat()));
+  }
+  VectorStream<std::uint32_t, 4> crowd_bones(skin_count);
+  Vector4Stream crowd_weights(skin_count);
+  Vector3Stream crowd_pos(skin_count, kUninitialized), crowd_normal(skin_count, kUninitialized);
+  std::uniform_int_distribution<std::uint32_t> bone_index(0, 63);
+  for (size_t i = 0; i < skin_count; ++i) {
+    const Vector4f raw{coords(rng) + 1, coords(rng) + 1, i % 2 ? 0.0f : coords(rng) + 1, 0};
+    crowd_weights.Set(i, raw / (raw[0] + raw[1] + raw[2]));
+    crowd_bones.Set(i, {bone_index(rng), bone_index(rng), bone_index(rng), bone_index(rng)});
+    crowd_pos.Set(i, Vector3f{coords(rng), coords(rng), coords(rng)});
+    crowd_normal.Set(i, Normalize(Vector3f{coords(rng), coords(rng), coords(rng) + 2}));
+  }
+  Vector3Stream crowd_pos_out, crowd_normal_out;
+  Skin(
+      bone_palette.data(), crowd_bones, crowd_weights, crowd_pos, crowd_normal, crowd_pos_out,
+      crowd_normal_out);
+  float skin_error = 0;
+  for (size_t i = 0; i < skin_count; ++i) {
+    Matrix4X4f blend(0.0f);
+    for (size_t k = 0; k < 4; ++k) {
+      blend = blend + bone_palette[crowd_bones[k][i]] * crowd_weights[k][i];
+    }
+    const Vector3f pos = crowd_pos.Get(i), normal = crowd_normal.Get(i);
+    const Vector4f pos_h = Transform(blend, Vector4f{pos[0], pos[1], pos[2], 1});
+    const Vector4f normal_h = Transform(blend, Vector4f{normal[0], normal[1], normal[2], 0});
+    const Vector3f pos_expected{pos_h[0], pos_h[1], pos_h[2]};
+    const Vector3f normal_expected = Normalize(Vector3f{normal_h[0], normal_h[1], normal_h[2]});
+    skin_error = std::max(skin_error, Length(crowd_pos_out.Get(i) - pos_expected));
+    skin_error = std::max(skin_error, Length(crowd_normal_out.Get(i) - normal_expected));
+  }
+  std::cout << "Skin(20000 vertices) within 1e-5 of the MatrixCT blend: " << (skin_error < 1e-5f)
+            << std::endl;
+
+  // batched rotation builders against composing the single-axis matrices and the quaternion path
+  const size_t rotation_count = 5000;
+  std::uniform_real_distribution<float> angles(-10.0f, 10.0f);
+  Vector3Stream euler(rotation_count, kUninitialized);
+  Vector3Stream rotation_axis(rotation_count, kUninitialized);
+  std::vector<float> rotation_angle(rotation_count);
+  for (size_t i = 0; i < rotation_count; ++i) {
+    euler.Set(i, Vector3f{angles(rng), angles(rng), angles(rng)});
+    rotation_axis.Set(i, Normalize(Vector3f{coords(rng), coords(rng), coords(rng) + 2}));
+    rotation_angle[i] = angles(rng);
+  }
+  std::vector<Matrix4X4f> euler_exact(rotation_count), euler_fast(rotation_count);
+  std::vector<Matrix4X4f> axis_angle_fast(rotation_count);
+  std::vector<MatrixCT<float, 3, 4>> euler_affine(rotation_count);
+  BuildRotationMatrix(euler, euler_exact.data());
+  BuildRotationMatrix(euler, euler_fast.data(), kRotationFast);
+  BuildRotationMatrix(euler, euler_affine.data());
+  BuildRotationMatrix(rotation_axis, rotation_angle.data(), axis_angle_fast.data(), kRotationFast);
+  float euler_error = 0, euler_fast_error = 0, axis_angle_error = 0, affine_error = 0;
+  for (size_t i = 0; i < rotation_count; ++i) {
+    const Vector3f angle = euler.Get(i);
+    const Matrix4X4f expected = MatrixProd(
+        BuildRotationMatrixZ(angle[2]),
+        MatrixProd(BuildRotationMatrixY(angle[1]), BuildRotationMatrixX(angle[0])));
+    const Matrix4X4f single = BuildRotationMatrix(angle[0], angle[1], angle[2]);
+    const Matrix4X4f from_quat =
+        BuildRotationMatrix(BuildQuaternion(rotation_axis.Get(i), rotation_angle[i]));
+    for (size_t r = 0; r < 4; ++r) {
+      euler_error = std::max(euler_error, Length(euler_exact[i][r] - expected[r]));
+      euler_error = std::max(euler_error, Length(single[r] - expected[r]));
+      euler_fast_error = std::max(euler_fast_error, Length(euler_fast[i][r] - expected[r]));
+      axis_angle_error =
+          std::max(axis_angle_error, Length(axis_angle_fast[i][r] - from_quat[r]));
+    }
+    for (size_t r = 0; r < 3; ++r)
+      affine_error = std::max(affine_error, Length(euler_affine[i][r] - euler_exact[i][r]));
+  }
+  std::cout << "BuildRotationMatrix(5000 Euler triples) within 1e-5 of Rz * Ry * Rx: "
+            << (euler_error < 1e-5f) << ", fast: " << (euler_fast_error < 1e-5f)
+            << ", 3x4 rows equal: " << (affine_error == 0)
+            << ", axis-angle fast within 1e-5 of the quaternion: " << (axis_angle_error < 1e-5f)
+            << std::endl;
+
+  // folded at compile time through the portable backend
+  constexpr Matrix4X4f mat_const =
+      MatrixProd(BuildTranslationMatrix(1.0f, 2.0f, 3.0f), BuildScaleMatrix(2.0f, 2.0f, 2.0f));
+  static_assert(mat_const[0][0] == 2.0f && mat_const[1][3] == 2.0f, "constexpr MatrixProd");
+  constexpr Vector3f vec_const = CrossProd(Vector3f{1, 0, 0}, Vector3f{0, 1, 0}) * 2.0f + 1.0f;
+  static_assert(vec_const[2] == 3.0f, "constexpr CrossProd");
+  constexpr Vector4f vec_const_transform = Transform(mat_const, Vector4f{1, 1, 1, 1});
+  static_assert(vec_const_transform[2] == 5.0f, "constexpr Transform");
+  constexpr float len_const = Length(Vector2f{3, 4});
+  static_assert(len_const == 5.0f, "constexpr Length");
+  constexpr Quaternionf quat_const =
+      QuaternionProd(Quaternionf{1, 0, 0, 0}, Quaternionf{0, 1, 0, 0});
+  static_assert(quat_const.z() == 1.0f, "constexpr QuaternionProd");
+  constexpr Quaternionf quat_const_slerp =
+      Slerp(Quaternionf::Identity(), Quaternionf{0, 0, 1, 0}, 0.5f);
+  static_assert(portable::abs_(quat_const_slerp.z() - 0.70710678f) < 1e-6f, "constexpr Slerp");
+  constexpr Matrix4X4f mat_const_inverse = InverseAffine(mat_const);
+  static_assert(mat_const_inverse[0][0] == 0.5f && mat_const_inverse[1][3] == -1.0f,
+                "constexpr InverseAffine");
+  static_assert(Determinant(mat_const) == 8.0f, "constexpr Determinant");
+  std::cout << "constexpr MatrixProd(translation, scale):" << mat_const;
+  std::cout << "constexpr CrossProd(x, y) * 2 + 1: " << vec_const << std::endl;
+  std::cout << "constexpr Transform(mat_const, (1, 1, 1, 1)): " << vec_const_transform << std::endl;
+  std::cout << "constexpr Length((3, 4)): " << len_const << std::endl;
+}
@@ -0,0 +1,418 @@
+#include <calculation_tools/linear_algebra.h>
+#include <calculation_tools/dispatch.h>
+#include <calculation_tools/reduction.h>
+#include <calculation_tools/factorization.h>
+#include <calculation_tools/sparse.h>
+#include <calculation_tools/graphic.h>
+#include <calculation_tools/binary_file.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <numeric>
+#include <tuple>
+
+using namespace kplutl;
+
+int main() {
+  VectorXf vec_1{1, 2, 3, 4, 5};
+  VectorXf vec_2(5, 2.0f);
+
+  std::cout << "vec_1: " << vec_1 << std::endl;
+  std::cout << "vec_2: " << vec_2 << std::endl;
+
+  std::cout << "vec_1 + vec_2: " << vec_1 + vec_2 << std::endl;
+  std::cout << "vec_1 - vec_2: " << vec_1 - vec_2 << std::endl;
+  std::cout << "vec_1 * vec_2: " << vec_1 * vec_2 << std::endl;
+  std::cout << "vec_1 / vec_2: " << vec_1 / vec_2 << std::endl;
+  std::cout << "vec_1 + 1: " << vec_1 + 1.0f << std::endl;
+  std::cout << "Sqrt(vec_1): " << Sqrt(vec_1) << std::endl;
+  std::cout << "Abs(-vec_1): " << Abs(-vec_1) << std::endl;
+  std::cout << "DotProd(vec_1, vec_2): " << DotProd(vec_1, vec_2) << std::endl;
+
+  // the whole chain is evaluated in a single pass
+  VectorXf vec_fused = vec_1 * vec_2 + vec_1 - 1.0f;
+  std::cout << "vec_1 * vec_2 + vec_1 - 1: " << vec_fused << std::endl;
+  vec_fused = Sqrt(Abs(vec_fused - vec_2 * 4.0f)) / (vec_2 + vec_1);
+  std::cout << "Sqrt(Abs(vec_fused - vec_2 * 4)) / (vec_2 + vec_1): " << vec_fused << std::endl;
+
+  Vector3f vec_ct_1{1, 2, 3};
+  Vector3f vec_ct_2{4, 5, 6};
+  Vector3f vec_ct_fused = Lazy(vec_ct_1) * vec_ct_2 + vec_ct_1 - vec_ct_2;
+  std::cout << "Lazy(vec_ct_1) * vec_ct_2 + vec_ct_1 - vec_ct_2: " << vec_ct_fused << std::endl;
+  // a bare operand is a plain copy
+  const VectorXf vec_copy = Lazy(vec_1);
+  const Vector3f vec_ct_copy = Lazy(vec_ct_2);
+  std::cout << "Lazy(vec_1): " << vec_copy << ", Lazy(vec_ct_2): " << vec_ct_copy << std::endl;
+
+  // well past the old 255-element kernel limit
+  const size_t big = 4 * 1024 * 1024;
+  VectorXf vec_big(big, kUninitialized);
+  std::iota(&vec_big[0], &vec_big[0] + big, 0.0f);
+  VectorXf vec_half(big, 0.5f);
+  vec_big *= vec_half;
+  std::cout << "big: size " << vec_big.size() << ", last " << vec_big[big - 1] << std::endl;
+  std::cout << "DotProd(ones, halves): " << DotProd(VectorXf(big, 1.0f), vec_half) << std::endl;
+
+  MatrixXf mat_1{
+      {1, 2, 3},
+      {4, 5, 6}
+  };
+  std::cout << "mat_1: " << mat_1;
+  std::cout << "mat_1.ld(): " << mat_1.ld() << std::endl;
+  std::cout << "mat_1 * 2: " << mat_1 * 2.0f;
+  MatrixXf mat_fused = mat_1 * mat_1 - mat_1 / 2.0f;
+  std::cout << "mat_1 * mat_1 - mat_1 / 2: " << mat_fused;
+  // compound assignment from an expression
+  VectorXf vec_acc(5, 1.0f);
+  vec_acc += vec_1 * vec_2;
+  vec_acc /= vec_2 + 1.0f;
+  MatrixXf mat_acc = mat_1;
+  mat_acc -= mat_1 / 2.0f;
+  mat_acc *= mat_1 + 1.0f;
+  std::cout << "vec_acc += vec_1 * vec_2, /= vec_2 + 1: " << vec_acc << std::endl;
+  std::cout << "mat_acc -= mat_1 / 2, *= mat_1 + 1: " << mat_acc;
+  std::cout << "Transpose(mat_1): " << Transpose(mat_1);
+  std::cout << "MatrixProd(mat_1, Transpose(mat_1)): " << MatrixProd(mat_1, Transpose(mat_1));
+
+  MatrixXf mat_big(1500, 700, 1.0f);
+  MatrixXf mat_big_t = Transpose(mat_big);
+  std::cout << "Transpose(1500 x 700): " << mat_big_t.rows() << " x " << mat_big_t.cols()
+            << std::endl;
+
+  MatrixXf mat_id(3, 3);
+  BuildIdentity(mat_id);
+  std::cout << "BuildIdentity(mat_id): " << mat_id;
+
+  // double, int32 and half run the same kernels, half computes in float and stores fp16
+  VectorXd vec_d{1, 2, 3, 4, 5};
+  std::cout << "Sqrt(vec_d) * 2 - 1: " << VectorXd(Sqrt(vec_d) * 2.0 - 1.0) << std::endl;
+  std::cout << "DotProd(vec_d, vec_d): " << DotProd(vec_d, vec_d) << std::endl;
+  VectorXi vec_i{1, -2, 3, -4, 5};
+  std::cout << "Abs(vec_i) * 3 / 2: " << VectorXi(Abs(vec_i) * 3 / 2) << std::endl;
+  VectorXh vec_h{1, 2, 3, 4, 5};
+  VectorXh vec_h_fused = vec_h * vec_h + 0.5f;
+  std::cout << "vec_h * vec_h + 0.5: " << vec_h_fused << std::endl;
+  std::cout << "DotProd(vec_h, vec_h): " << DotProd(vec_h, vec_h) << std::endl;
+  std::cout << "Half(65504 + 16): " << Half(65520.0f) << ", Half(1 / 3): " << Half(1.0f / 3)
+            << std::endl;
+  MatrixXd mat_d{
+      {1, 2},
+      {3, 4}
+  };
+  std::cout << "MatrixProd(mat_d, mat_d): " << MatrixProd(mat_d, mat_d);
+
+  // reductions, long enough for several threads and pairwise blocks; the values are exact
+  VectorXf vec_long(1 << 20, kUninitialized);
+  for (size_t i = 0; i < vec_long.size(); ++i) vec_long[i] = float(i % 7) - 3;
+  vec_long[12345] = -8;
+  vec_long[777777] = 9;
+  vec_long[900000] = 9;
+  for (const std::uint32_t flags : {kReduceDefault, kReduceKahan, kReducePairwise}) {
+    for (const size_t threads : {size_t(1), size_t(3)}) {
+      const ReduceOptions options{flags, threads};
+      const MinMaxResult<float> min_max = MinMax(vec_long, options);
+      std::cout << "flags " << flags << ", " << threads << " threads: Sum "
+                << Sum(vec_long, options) << ", NormL1 " << NormL1(vec_long, options)
+                << ", DotProd " << DotProd(vec_long, vec_long, options) << ", MinMax "
+                << min_max.min << " at " << min_max.argmin << ", " << min_max.max << " at "
+                << min_max.argmax << std::endl;
+    }
+  }
+  std::cout << "NormL2(vec_1): " << NormL2(vec_1) << ", NormInf(vec_i): " << NormInf(vec_i)
+            << ", ArgMin(vec_i): " << ArgMin(vec_i) << ", Sum(vec_h): " << Sum(vec_h)
+            << std::endl;
+  // 0.1 is not exact in float, compensated sums stay close to the double reference
+  VectorXf vec_tenths(1 << 22, 0.1f);
+  const double tenths = double(0.1f) * vec_tenths.size();
+  const ReduceOptions kahan{kReduceKahan, 1};
+  const ReduceOptions pairwise{kReducePairwise, 1};
+  const auto within = [&](const float sum) { return std::abs(sum - tenths) < 1e-5 * tenths; };
+  std::cout << "Sum(vec_tenths) within 1e-5 relative, Kahan: " << within(Sum(vec_tenths, kahan))
+            << ", pairwise: " << within(Sum(vec_tenths, pairwise)) << std::endl;
+
+  // dense solves: a small system with x = (1, 2, 3) and a larger one over several panels and
+  // threads, checked through the residual of every right-hand side
+  MatrixXd mat_spd{
+      {4, -2, 1},
+      {-2, 4, -2},
+      {1, -2, 4}
+  };
+  VectorXd rhs_spd{3, 0, 9};
+  const VectorXd x_lu = Solve(mat_spd, rhs_spd);
+  const VectorXd x_cholesky = Solve(FactorCholesky(mat_spd), rhs_spd);
+  const auto near_123 = [](const VectorXd& x) {
+    return std::abs(x[0] - 1) < 1e-12 && std::abs(x[1] - 2) < 1e-12 && std::abs(x[2] - 3) < 1e-12;
+  };
+  std::cout << "Solve(mat_spd, rhs_spd) is (1, 2, 3), LU: " << near_123(x_lu)
+            << ", Cholesky: " << near_123(x_cholesky) << std::endl;
+  MatrixXd mat_singular{
+      {1, 2},
+      {2, 4}
+  };
+  std::cout << "FactorLu(mat_singular).singular: " << FactorLu(mat_singular).singular
+            << ", FactorCholesky(-mat_spd).positive_definite: "
+            << FactorCholesky(MatrixXd(mat_spd * -1.0)).positive_definite << std::endl;
+  const size_t dim = 300;
+  MatrixXd mat_dense(dim, dim, kUninitialized);
+  MatrixXd rhs_dense(dim, 5, kUninitialized);
+  for (size_t r = 0; r < dim; ++r) {
+    for (size_t c = 0; c < dim; ++c) mat_dense[r][c] = double((r * 7 + c * 13) % 17) - 8;
+    for (size_t c = 0; c < 5; ++c) rhs_dense[r][c] = double((r + c) % 5);
+    mat_dense[r][r] += 10.0 * dim;
+  }
+  const FactorOptions blocked{32, 3};
+  const MatrixXd x_dense = SolveMany(FactorLu(mat_dense, blocked), rhs_dense, blocked);
+  // diagonally dominant, so A + A^T is positive definite
+  MatrixXd mat_sym = mat_dense + Transpose(mat_dense);
+  const MatrixXd x_sym = SolveMany(FactorCholesky(mat_sym, blocked), rhs_dense, blocked);
+  const auto residual = [&](const MatrixXd& mat, const MatrixXd& x) {
+    const MatrixXd res = MatrixProd(mat, x) - rhs_dense;
+    double worst = 0;
+    for (size_t r = 0; r < dim; ++r) {
+      for (size_t c = 0; c < 5; ++c) worst = std::max(worst, std::abs(res[r][c]));
+    }
+    return worst;
+  };
+  std::cout << "SolveMany(300 x 300, 5 right-hand sides) residual below 1e-10, LU: "
+            << (residual(mat_dense, x_dense) < 1e-10)
+            << ", Cholesky: " << (residual(mat_sym, x_sym) < 1e-10) << std::endl;
+
+  // sparse matrices: triplets out of order with one repeat, then a 2D Poisson problem (5-point
+  // Laplacian on a 100 x 100 grid) through conjugate gradients, checked by its true residual
+  const std::uint32_t coo_row[6]{2, 0, 1, 0, 2, 0};
+  const std::uint32_t coo_col[6]{3, 2, 1, 0, 0, 2};
+  const float coo_value[6]{5, 1, 3, 2, 4, 0.5f};
+  const MatrixCSRf mat_coo = BuildCsr<float>(3, 4, coo_row, coo_col, coo_value, 6);
+  std::cout << "BuildCsr nonzeros: " << mat_coo.nonzeros() << ", (0, 2): " << mat_coo(0, 2)
+            << ", (1, 0): " << mat_coo(1, 0) << ", row_begin: " << mat_coo.row_begin_[1] << " "
+            << mat_coo.row_begin_[2] << " " << mat_coo.row_begin_[3] << std::endl;
+  std::cout << "MatVec(mat_coo, (1, 2, 3, 4)): " << MatVec(mat_coo, VectorXf{1, 2, 3, 4})
+            << std::endl;
+  const size_t grid = 100;
+  std::vector<std::uint32_t> poisson_row, poisson_col;
+  std::vector<double> poisson_value;
+  for (size_t y = 0; y < grid; ++y) {
+    for (size_t x = 0; x < grid; ++x) {
+      const auto add = [&](const size_t nx, const size_t ny, const double value) {
+        poisson_row.push_back(std::uint32_t(y * grid + x));
+        poisson_col.push_back(std::uint32_t(ny * grid + nx));
+        poisson_value.push_back(value);
+      };
+      add(x, y, 4);
+      if (x > 0) add(x - 1, y, -1);
+      if (x + 1 < grid) add(x + 1, y, -1);
+      if (y > 0) add(x, y - 1, -1);
+      if (y + 1 < grid) add(x, y + 1, -1);
+    }
+  }
+  const MatrixCSRd mat_poisson = BuildCsr<double>(
+      grid * grid, grid * grid, poisson_row.data(), poisson_col.data(), poisson_value.data(),
+      poisson_value.size());
+  VectorXd rhs_poisson(grid * grid, kUninitialized);
+  for (size_t i = 0; i < rhs_poisson.size(); ++i) rhs_poisson[i] = double(i % 7) - 3;
+  const VectorXd spmv_serial = MatVec(mat_poisson, rhs_poisson, SparseOptions{1});
+  const VectorXd spmv_parallel = MatVec(mat_poisson, rhs_poisson, SparseOptions{3});
+  std::cout << "MatVec(poisson) 3 threads match 1 thread: "
+            << std::equal(
+                   &spmv_serial[0], &spmv_serial[0] + spmv_serial.size(), &spmv_parallel[0])
+            << std::endl;
+  VectorXd x_poisson(grid * grid);
+  const CgResult cg = ConjugateGradient(mat_poisson, rhs_poisson, x_poisson, CgOptions{1e-10});
+  const VectorXd cg_residual = rhs_poisson - MatVec(mat_poisson, x_poisson);
+  std::cout << "ConjugateGradient(poisson) converged: " << cg.converged
+            << ", residual below 1e-8: " << (NormL2(cg_residual) < 1e-8 * NormL2(rhs_poisson))
+            << ", iterations below 400: " << (cg.iterations < 400) << std::endl;
+  // rows far longer than a gang, against the dense product; the sums are exact
+  std::vector<std::uint32_t> wide_row, wide_col;
+  std::vector<float> wide_value;
+  VectorXf vec_wide(300, kUninitialized);
+  VectorXf dense_wide(8);
+  for (size_t c = 0; c < 300; ++c) vec_wide[c] = float(c % 5);
+  for (size_t r = 0; r < 8; ++r) {
+    for (size_t c = 0; c < 300; ++c) {
+      wide_row.push_back(std::uint32_t(r));
+      wide_col.push_back(std::uint32_t(c));
+      wide_value.push_back(float((r * 5 + c * 3) % 7) - 3);
+      dense_wide[r] += wide_value.back() * vec_wide[c];
+    }
+  }
+  const MatrixCSRf mat_wide = BuildCsr<float>(
+      8, 300, wide_row.data(), wide_col.data(), wide_value.data(), wide_value.size());
+  std::cout << "MatVec(8 x 300 dense rows) matches: "
+            << (NormInf(VectorXf(MatVec(mat_wide, vec_wide) - dense_wide)) == 0) << std::endl;
+
+  // the thread pool: with four threads and a small grain every kernel below is split into several
+  // tasks, which must give the same result as the single-threaded run
+  const size_t threads = ThreadCount();
+  const auto pool_results = [] {
+    const size_t len = 100003;
+    VectorXf vec_a(len, kUninitialized);
+    VectorXf vec_b(len, kUninitialized);
+    for (size_t i = 0; i < len; ++i) {
+      vec_a[i] = float(i % 101) * 0.5f;
+      vec_b[i] = float(i % 37) + 1.0f;
+    }
+    VectorXf vec_sum = vec_a * vec_b + vec_a;
+    vec_sum += vec_b;
+    vec_sum *= 0.25f;
+    MatrixXf mat_a(300, 200, kUninitialized);
+    MatrixXf mat_b(200, 150, kUninitialized);
+    for (size_t r = 0; r < 300; ++r) {
+      for (size_t c = 0; c < 200; ++c) mat_a[r][c] = float((r * 3 + c * 5) % 11) - 5.0f;
+    }
+    for (size_t r = 0; r < 200; ++r) {
+      for (size_t c = 0; c < 150; ++c) mat_b[r][c] = float((r * 7 + c) % 13) - 6.0f;
+    }
+    return std::make_tuple(vec_sum, Transpose(mat_a), MatrixProd(mat_a, mat_b));
+  };
+  SetThreadCount(1);
+  const auto serial = pool_results();
+  SetThreadCount(4);
+  SetParallelGrain(1024);
+  const auto parallel = pool_results();
+  std::atomic<size_t> nested_sum{0};
+  ParallelFor(64, 1, 1, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      ParallelFor(1000, 10, 1, [&](const size_t inner_begin, const size_t inner_end) {
+        for (size_t j = inner_begin; j < inner_end; ++j) nested_sum += j;
+      });
+    }
+  });
+  SetParallelGrain(0);
+  SetThreadCount(threads);
+  const auto same = [](const MatrixXf& lhs, const MatrixXf& rhs) {
+    for (size_t r = 0; r < lhs.rows(); ++r) {
+      if (!std::equal(lhs[r], lhs[r] + lhs.cols(), rhs[r])) return false;
+    }
+    return lhs.rows() == rhs.rows() && lhs.cols() == rhs.cols();
+  };
+  const VectorXf& vec_serial = std::get<0>(serial);
+  const VectorXf& vec_parallel = std::get<0>(parallel);
+  std::cout << "4 threads match 1 thread, elementwise: "
+            << std::equal(&vec_serial[0], &vec_serial[0] + vec_serial.size(), &vec_parallel[0])
+            << ", Transpose: " << same(std::get<1>(serial), std::get<1>(parallel))
+            << ", MatrixProd: " << same(std::get<2>(serial), std::get<2>(parallel))
+            << ", nested ParallelFor: " << (nested_sum == 64 * 499500) << std::endl;
+
+  // a simulation-style step: temporaries of the operators, a transpose, an LU solve and a sum,
+  // all inside a Workspace; after the first round it runs without touching the heap
+  MatrixXf step_mat(48, 48);
+  VectorXf step_rhs(48);
+  for (size_t r = 0; r < step_mat.rows(); ++r) {
+    step_rhs[r] = float(r % 5);
+    for (size_t c = 0; c < step_mat.cols(); ++c) {
+      step_mat[r][c] = r == c ? 50.0f : float(r ^ c) / 64;
+    }
+  }
+  auto step = [&]() {
+    Workspace workspace;
+    const MatrixXf prod = MatrixProd(step_mat, Transpose(step_mat));
+    const MatrixXf scaled = prod * 0.5f + 1.0f;
+    return Sum(Solve(scaled, step_rhs));
+  };
+  const float step_first = step();
+  const AllocationCounters step_before = GetAllocationCounters();
+  float step_last = 0;
+  for (int i = 0; i < 3; ++i) step_last = step();
+  const AllocationCounters step_counters = GetAllocationCounters() - step_before;
+  std::cout << "Workspace steps: same result " << (step_first == step_last)
+            << ", heap allocations " << step_counters.heap_allocations << ", workspace allocations "
+            << (step_counters.workspace_allocations > 0) << std::endl;
+  // containers from before a Workspace keep heap storage when they are assigned inside it
+  VectorXf outer_copy;
+  VectorXf outer_moved(2);
+  {
+    Workspace workspace;
+    const VectorXf inside(16, 1.0f);
+    std::cout << "VectorRT in a Workspace owns its storage: " << inside.data_.owned() << std::endl;
+    const VectorXf inside_sum = vec_1 + vec_2;
+    outer_copy = inside_sum;
+    outer_moved = vec_1 * 2.0f;
+  }
+  {
+    Workspace workspace;
+    const VectorXf overwrite(64, 7.0f);
+    std::cout << "assigned in a Workspace, read after the next one: " << outer_copy << " "
+              << outer_moved << ", own their storage " << outer_copy.data_.owned()
+              << outer_moved.data_.owned() << std::endl;
+  }
+
+  // kernel counters, all zero unless built with CT_ENABLE_PROFILE
+  const KernelProfile profile_before = GetKernelProfile();
+  VectorXf profile_sum = vec_1;
+  for (int i = 0; i < 3; ++i) profile_sum = vec_1 + vec_2 * 2.0f;
+  const float profile_dot = DotProd(vec_1, vec_2);
+  const KernelProfile profile = GetKernelProfile() - profile_before;
+  const std::uint64_t profile_calls = kProfileEnabled ? 3 : 0;
+  std::cout << "KernelProfile: " << KernelName(KernelId::kExprForeach) << " calls "
+            << (profile[KernelId::kExprForeach].calls == profile_calls) << ", elements "
+            << (profile[KernelId::kExprForeach].elements == 5 * profile_calls) << ", "
+            << KernelName(KernelId::kVectorDotProd) << " called "
+            << ((profile[KernelId::kVectorDotProd].calls > 0) == kProfileEnabled)
+            << ", report rows "
+            << ((KernelProfileReport(profile).find("ExprForeach") != std::string::npos) ==
+                kProfileEnabled)
+            << ", results " << profile_sum << " " << profile_dot << std::endl;
+
+  // a small mesh through the binary container: written from the containers, read back as views
+  // of the mapped file
+  const char* mesh_path = "runtime_test_mesh.bin";
+  Vector3Stream mesh_position(4, kUninitialized);
+  const std::vector<Vector3f> mesh_normal{{0, 0, 1}, {0, 1, 0}, {1, 0, 0}, {0, 0, 1}};
+  for (size_t i = 0; i < mesh_position.size(); ++i) {
+    mesh_position.Set(i, Vector3f{float(i), float(i % 2), 2.0f});
+  }
+  const std::uint32_t mesh_index[6]{0, 1, 2, 2, 1, 3};
+  const std::vector<Matrix4X4f> mesh_bones{BuildScaleMatrix(2.0f, 2.0f, 2.0f), Matrix4X4f(1.0f)};
+  const VectorXf mesh_weight{0.5f, 0.25f, 0.125f, 0.125f};
+  BinaryFileWriter writer;
+  writer.AddStream("position", mesh_position);
+  writer.AddVectors("normal", mesh_normal.data(), mesh_normal.size());
+  writer.AddArray("index", mesh_index, 6);
+  writer.AddMatrices("bones", mesh_bones.data(), mesh_bones.size());
+  writer.AddArray("weight", mesh_weight);
+  writer.AddMatrix("mat", mat_1);
+  std::cout << "BinaryFileWriter::Write: " << writer.Write(mesh_path) << std::endl;
+  {
+    BinaryFile mesh;
+    std::cout << "BinaryFile::Open: " << mesh.Open(mesh_path) << ", arrays: " << mesh.size()
+              << std::endl;
+    const Vector3Stream position = mesh.Stream<float, 3>("position");
+    const VectorXf weight = mesh.Array<float>("weight");
+    std::cout << "views: " << !weight.data_.owned() << !position.data_.owned()
+              << ", Length(position): " << Length(position) << std::endl;
+    std::cout << "weight * 4: " << weight * 4.0f << ", Sum: " << Sum(weight) << std::endl;
+    std::cout << "normal[1]: " << mesh.Vectors<float, 3>("normal")[1]
+              << ", index: " << mesh.Array<std::uint32_t>("index")
+              << ", bones[0]:" << mesh.Matrices<float, 4, 4>("bones")[0];
+    std::cout << "mat:" << mesh.Matrix<float>("mat");
+    std::cout << "as double: " << mesh.Array<double>("weight").size()
+              << ", missing: " << mesh.Array<float>("uv").size() << std::endl;
+    float chunked_sum = 0;
+    mesh.ForEachChunk(*mesh.Find("weight"), 3, [&](const size_t first, const size_t count) {
+      for (size_t i = first; i < first + count; ++i) chunked_sum += weight[i];
+    });
+    std::cout << "ForEachChunk sum: " << chunked_sum << std::endl;
+  }
+  // cut after the array headers, so the arrays point past the end of the file
+  std::string mesh_bytes(1024, '\0');
+  std::ifstream(mesh_path, std::ios::binary).read(&mesh_bytes[0], mesh_bytes.size());
+  std::ofstream(mesh_path, std::ios::binary | std::ios::trunc).write(mesh_bytes.data(), 1024);
+  BinaryFile truncated;
+  std::cout << "BinaryFile::Open(truncated): " << truncated.Open(mesh_path) << std::endl;
+  std::remove(mesh_path);
+
+  // the same fused expression on every ISPC target this machine can run
+  const IspcTarget active_target = ActiveIspcTarget();
+  for (IspcTarget target :
+       {IspcTarget::kPortable, IspcTarget::kSse2, IspcTarget::kSse4, IspcTarget::kAvx2,
+        IspcTarget::kAvx512Skx}) {
+    if (!SetIspcTarget(target)) continue;
+    VectorXf vec_target = vec_1 * vec_2 + vec_1;
+    std::cout << "vec_1 * vec_2 + vec_1 on " << IspcTargetName(ActiveIspcTarget()) << ": "
+              << vec_target << std::endl;
+  }
+  SetIspcTarget(active_target);
+}